@@ -170,6 +170,7 @@ int check(checker_t *c) {
     // if AB commuted, we could also check BA but this won't be 
     // true in general.
     for(int i = 0; i < 10; i++) {
+        arena_mark_t m = arena_mark(&c->arena);
         // 1.  initialize the state.
         c->init(c);     
         // 2. run A()
@@ -181,6 +182,8 @@ int check(checker_t *c) {
         // 4. check that the state passes.
         if(!c->check(c))
             panic("check failed sequentially: code is broken\n");
+        // 5. free whatever the trial allocated.
+        arena_reset_to_mark(&c->arena, m);
     }
 
     // shows how to run code with single stepping: do the same sequential
@@ -188,12 +191,14 @@ int check(checker_t *c) {
     // should still pass (obviously)
     checker = c;
     for(int i = 0; i < 10; i++) {
+        arena_mark_t m = arena_mark(&c->arena);
         c->init(c);
         run_A_at_userlevel(c);
         if(!c->B(c))
             panic("B should not fail\n");
         if(!c->check(c))
             panic("check failed sequentially: code is broken\n");
+        arena_reset_to_mark(&c->arena, m);
     }
 
     //******************************************************************
@@ -217,9 +222,11 @@ int check(checker_t *c) {
     // 
     //      checker:  when done running A(),B():
     //          c->check()
+    //          reset c->arena to a mark taken before init()
     //          if(!switched_p)
     //              break;
     //  }
+    //  arena_free_all(&c->arena)
     // 
     //  return 0 if there were errors.
     todo("implement true interleaving!\n");
@@ -7,6 +7,7 @@
 #include "rpi-constants.h"
 #include "cpsr-util.h"
 #include "breakpoint.h"
+#include "arena.h"
 
 
 // simple debug macro: can turn it off/on by calling <brk_verbose({0,1})>
@@ -30,6 +31,11 @@ typedef struct checker {
     // if you need state.
     volatile void *state;
 
+    // scratch memory for a single trial: init(), A() and B() can
+    // arena_alloc from it and never free.  the checker resets it after
+    // each trial so a long run doesn't use up the heap.
+    kmalloc_arena_t arena;
+
     // A and B are user supplied.  A() can't fail (so <void>)
     // B() can fail (returns 0) if can't run given current
     // state.
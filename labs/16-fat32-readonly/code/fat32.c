@@ -2,6 +2,7 @@
 #include "fat32.h"
 #include "fat32-helpers.h"
 #include "pi-sd.h"
+#include "arena.h"
 
 // Print extra tracing info when this is enabled.  You can and should add your
 // own.
@@ -10,6 +11,13 @@ static int init_p = 0;
 
 fat32_boot_sec_t boot_sector;
 
+// raw directory contents (`get_dirents`) are only needed until we've
+// turned them into what we return, so they come from this arena rather
+// than kmalloc: every routine that calls `get_dirents` takes a mark
+// first and resets to it before it returns.  otherwise an `ls` in a loop
+// eventually runs the heap out.
+static kmalloc_arena_t scratch;
+
 
 fat32_fs_t fat32_mk(mbr_partition_ent_t *partition) {
   demand(!init_p, "the fat32 module is already in use\n");
@@ -142,7 +150,8 @@ static fat32_dirent_t *get_dirents(fat32_fs_t *fs, uint32_t cluster_start, uint3
   // `get_cluster_chain_length`)
   unimplemented();
 
-  // TODO: allocate a buffer large enough to hold the whole directory
+  // TODO: allocate a buffer large enough to hold the whole directory.  use
+  // `arena_alloc(&scratch, ...)`: the caller frees it.
   unimplemented();
 
   // TODO: read in the whole directory (see `read_cluster_chain`)
@@ -153,11 +162,14 @@ static fat32_dirent_t *get_dirents(fat32_fs_t *fs, uint32_t cluster_start, uint3
 pi_directory_t fat32_readdir(fat32_fs_t *fs, pi_dirent_t *dirent) {
   demand(init_p, "fat32 not initialized!");
   demand(dirent->is_dir_p, "tried to readdir a file!");
+  arena_mark_t m = arena_mark(&scratch);
+
   // TODO: use `get_dirents` to read the raw dirent structures from the disk
   uint32_t n_dirents;
   fat32_dirent_t *dirents = get_dirents(fs, dirent->cluster_id, &n_dirents);
 
-  // TODO: allocate space to store the pi_dirent_t return values
+  // TODO: allocate space to store the pi_dirent_t return values: the caller
+  // keeps these, so kmalloc them (not `scratch`).
   unimplemented();
 
   // TODO: iterate over the directory and create pi_dirent_ts for every valid
@@ -167,10 +179,14 @@ pi_directory_t fat32_readdir(fat32_fs_t *fs, pi_dirent_t *dirent) {
 
   // TODO: create a pi_directory_t using the dirents and the number of valid
   // dirents we found
-  return (pi_directory_t) {
+  pi_directory_t dir = {
     .dirents = NULL,
     .ndirents = 0,
   };
+
+  // done with the raw dirents.
+  arena_reset_to_mark(&scratch, m);
+  return dir;
 }
 
 static int find_dirent_with_name(fat32_dirent_t *dirents, int n, char *filename) {
@@ -184,6 +200,7 @@ static int find_dirent_with_name(fat32_dirent_t *dirents, int n, char *filename)
 pi_dirent_t *fat32_stat(fat32_fs_t *fs, pi_dirent_t *directory, char *filename) {
   demand(init_p, "fat32 not initialized!");
   demand(directory->is_dir_p, "tried to use a file as a directory");
+  arena_mark_t m = arena_mark(&scratch);
 
   // TODO: use `get_dirents` to read the raw dirent structures from the disk
   unimplemented();
@@ -196,6 +213,7 @@ pi_dirent_t *fat32_stat(fat32_fs_t *fs, pi_dirent_t *directory, char *filename)
   // TODO: allocate enough space for the dirent, then convert
   // (`dirent_convert`) the fat32 dirent into a Pi dirent.
   pi_dirent_t *dirent = NULL;
+  arena_reset_to_mark(&scratch, m);
   return dirent;
 }
 
@@ -203,6 +221,7 @@ pi_file_t *fat32_read(fat32_fs_t *fs, pi_dirent_t *directory, char *filename) {
   // This should be pretty similar to readdir, but simpler.
   demand(init_p, "fat32 not initialized!");
   demand(directory->is_dir_p, "tried to use a file as a directory!");
+  arena_mark_t m = arena_mark(&scratch);
 
   // TODO: read the dirents of the provided directory and look for one matching the provided name
   unimplemented();
@@ -223,6 +242,7 @@ pi_file_t *fat32_read(fat32_fs_t *fs, pi_dirent_t *directory, char *filename) {
     .n_data = 0,
     .n_alloc = 0,
   };
+  arena_reset_to_mark(&scratch, m);
   return file;
 }
 
@@ -30,6 +30,7 @@
 #include "fast-hash32.h"
 #include "pix-internal.h"
 #include "breakpoint.h"
+#include "slab.h"
 #include "small-prog.h"
 
 #include "syscall-num.h"
@@ -341,7 +342,7 @@ static inline proc_t proc_mk(const char *name) {
 }
 
 static inline proc_t *proc_new(const char *name) {
-    proc_t *p = kmalloc(sizeof *p);
+    proc_t *p = slab_alloc(sizeof *p);
     *p = proc_mk(name);
     return p;
 }
@@ -463,11 +464,12 @@ int sys_waitpid(long pid, uint32_t options) {
 static int sys_fork(void) {
     assert(!config.vm_off_p);
 
-    proc_t *p = kmalloc(sizeof *p);
+    proc_t *p = slab_alloc(sizeof *p);
     *p = *curproc;
 
     p->pid  = ++npid;
     p->nkids    = 0;
+    p->parent   = curproc;
     p->asid = asid_get();
 
     let cur = curproc;
@@ -518,7 +520,20 @@ static void sys_exit(int exitcode) {
         pq_append(&runq, w);
     }
 
-    // XXX: right now we don't free.
+    // only our parent can waitpid on us, so once both of us have
+    // exited the proc_t can go.  kids that already exited go now;
+    // the rest have no parent and go when they exit.
+    for(int i = 0; i < p->nkids; i++) {
+        proc_t *k = p->kids[i];
+        if(k->status == PROC_EXITED)
+            slab_free(k);
+        else
+            k->parent = 0;
+    }
+    // nothing below touches <p>: schedule() switches to someone else.
+    // XXX: we don't free the sections in <p->pins>.
+    if(!p->parent)
+        slab_free(p);
 
     schedule();
 }
@@ -5,6 +5,19 @@
  *	  a histogram table from the heap.
  *	- implement functions so that given a pc value, you can increment
  *	  its associated count
+ *
+ * once this works: libpi/include/gprof.h is the full version.  it 
+ * keeps a sparse table of pcs instead of one entry per instruction, 
+ * samples call stacks by walking the frame pointers (our 
+ * interrupts-asm.S passes the saved registers as the second argument:
+ * r11 is the fp) and dumps a binary frame that "my-install --gprof" 
+ * turns into a per-function flat profile and call graph using the 
+ * .elf's symbols.  to try it:
+ *      void interrupt_vector(unsigned pc, uint32_t *regs) {
+ *          ...
+ *          gprof_sample(pc, regs[11]);
+ *      }
+ * and call gprof_init(0,0) / gprof_dump() instead of ours.
  */
 #include "rpi.h"
 
@@ -0,0 +1,117 @@
+// interrupt latency: cycles from raising a GPIO pin to the first line
+// of its interrupt handler, for
+//   1. the trampoline from 0-timer-int: save everything, one C routine
+//      that checks the pending registers.
+//   2. libpi's irq_register: caller-saved registers only and a direct
+//      call through the per-source table (libpi/include/irq.h).
+//   3. the same handler on the FIQ.
+//
+// NOTE: loop <out_pin> back to <in_pin> with a jumper.
+//
+// the GPIO edge detect and the write to the pin cost the same in all
+// three, so the differences are the trampolines and dispatch.
+#include "rpi.h"
+#include "irq.h"
+#include "cycle-count.h"
+
+enum { out_pin = 21, in_pin = 20, NTRIALS = 32 };
+
+static volatile uint32_t t_handler;
+static volatile unsigned nint;
+
+static void handler(uint32_t pc, void *arg) {
+    t_handler = cycle_cnt_read();
+    gpio_event_clear(in_pin);
+    nint++;
+}
+
+// 1. the old way.  we keep the table and trampoline here so they
+// don't get linked into everything else.
+#define STR2(x) #x
+#define STR(x) STR2(x)
+asm(".text\n"
+    ".align 5\n"
+    "slow_vector_table:\n"
+    "    ldr pc, =unhandled_reset\n"
+    "    ldr pc, =unhandled_undefined_instruction\n"
+    "    ldr pc, =unhandled_swi\n"
+    "    ldr pc, =unhandled_prefetch_abort\n"
+    "    ldr pc, =unhandled_data_abort\n"
+    "    ldr pc, =unhandled_reset\n"
+    "    ldr pc, =slow_irq_asm\n"
+    "    ldr pc, =unhandled_fiq\n"
+    "slow_irq_asm:\n"
+    "    mov sp, #" STR(INT_STACK_ADDR) "\n"
+    "    sub lr, lr, #4\n"
+    "    push {r0-r12,lr}\n"
+    "    mov r0, lr\n"
+    "    bl slow_interrupt_vector\n"
+    "    pop {r0-r12,lr}\n"
+    "    movs pc, lr\n"
+    ".ltorg\n");
+extern uint32_t slow_vector_table[];
+
+void slow_interrupt_vector(unsigned pc) {
+    dev_barrier();
+    if(GET32(IRQ_pending_2) & (1 << (GPIO_INT0 - 32)))
+        handler(pc, 0);
+    dev_barrier();
+}
+
+static void measure(const char *name) {
+    unsigned min = ~0, sum = 0;
+
+    // the first trial warms the caches: not counted.
+    for(unsigned i = 0; i <= NTRIALS; i++) {
+        gpio_write(out_pin, 0);
+        delay_us(10);
+        nint = 0;
+
+        uint32_t s = cycle_cnt_read();
+        gpio_write(out_pin, 1);
+        uint32_t start = timer_get_usec();
+        while(!nint)
+            if(timer_get_usec() - start > 1000)
+                panic("no interrupt: is pin %d looped back to pin %d?\n",
+                    out_pin, in_pin);
+
+        uint32_t t = t_handler - s;
+        if(!i)
+            continue;
+        if(t < min)
+            min = t;
+        sum += t;
+    }
+    output("%s: min=%d cycles, average=%d cycles\n", name, min, sum / NTRIALS);
+}
+
+void notmain(void) {
+    caches_enable();
+    cycle_cnt_init();
+
+    gpio_set_output(out_pin);
+    gpio_write(out_pin, 0);
+    gpio_set_input(in_pin);
+
+    irq_init();
+    gpio_int_rising_edge(in_pin);
+    gpio_event_clear(in_pin);
+
+    void *ours = irq_vector_base_set(slow_vector_table);
+    PUT32(IRQ_Enable_2, 1 << (GPIO_INT0 - 32));
+    cpsr_int_enable();
+    measure("full save + polling");
+    cpsr_int_disable();
+    irq_vector_base_set(ours);
+
+    irq_register(IRQ_GPIO0, handler, 0);
+    cpsr_int_enable();
+    measure("irq_register");
+    cpsr_int_disable();
+
+    fiq_register(IRQ_GPIO0, handler, 0);
+    fiq_enable();
+    measure("fiq");
+    fiq_disable();
+    fiq_unregister();
+}
@@ -0,0 +1,45 @@
+// cooperative (no preemption): the highest priority runnable thread
+// always goes first, equal priorities round-robin on yield, and a
+// fork of a higher priority thread switches to it right away.
+#include "test-header.h"
+
+static int order[32], norder;
+
+static void logit(void *arg) {
+    order[norder++] = (int)arg;
+    rpi_yield();
+    order[norder++] = (int)arg;
+}
+
+static void child(void *arg) {
+    order[norder++] = (int)arg;
+}
+
+// forks something above itself: runs it before going on.
+static void parent(void *arg) {
+    order[norder++] = (int)arg;
+    rpi_fork_prio(child, (void *)99, 30);
+    order[norder++] = (int)arg;
+}
+
+void notmain(void) {
+    test_init();
+
+    rpi_fork_prio(logit, (void *)1, 1);
+    rpi_fork_prio(logit, (void *)20, 20);
+    rpi_fork_prio(logit, (void *)10, 10);
+    rpi_fork_prio(logit, (void *)11, 10);
+    rpi_fork_prio(parent, (void *)5, 5);
+    rpi_thread_start();
+
+    static const int expect[] = { 20, 20, 10, 11, 10, 11, 5, 99, 5, 1, 1 };
+    unsigned n = sizeof expect / sizeof expect[0];
+    for(unsigned i = 0; i < norder; i++)
+        trace("ran %d\n", order[i]);
+    assert(norder == n);
+    for(unsigned i = 0; i < n; i++)
+        if(order[i] != expect[i])
+            panic("run %d: expected %d, got %d\n", i, expect[i], order[i]);
+    test_done();
+    trace("SUCCESS\n");
+}
@@ -0,0 +1,68 @@
+// priority inversion, with preemption on:
+//   - <low> owns a wait queue and works for a while.
+//   - <high> wakes up and waits on the queue.
+//   - <mid> wakes up and wants the cpu for longer than <low> needs.
+// without inheritance <mid> runs ahead of <low> and so keeps <high>
+// waiting for all of its work.  with it, <low> runs at <high>'s
+// priority until it hands the queue over.
+#include "test-header.h"
+
+enum { LOW = 1, MID = 5, HIGH = 10 };
+
+static rpi_waitq_t q;
+static char order[16];
+static volatile unsigned nlog;
+
+static void note(char c) {
+    uint32_t cpsr = cpsr_int_disable();
+    order[nlog++] = c;
+    cpsr_int_reset(cpsr);
+}
+
+static void spin_usec(unsigned usec) {
+    unsigned start = timer_get_usec();
+    while(timer_get_usec() - start < usec)
+        ;
+}
+
+static void low(void *arg) {
+    rpi_waitq_set_owner(&q, rpi_cur_thread());
+    spin_usec(5000);
+    trace("low: priority while holding = %d\n", rpi_cur_thread()->prio);
+    assert(rpi_cur_thread()->prio == HIGH);
+    note('L');
+    // wake first: we still hold <q> so nothing below <high> can get in.
+    rpi_waitq_wakeup(&q);
+    rpi_waitq_set_owner(&q, 0);
+    note('l');
+}
+
+static void high(void *arg) {
+    rpi_sleep_us(1000);
+    note('h');
+    rpi_waitq_wait(&q);
+    note('H');
+}
+
+static void mid(void *arg) {
+    rpi_sleep_us(2000);
+    note('m');
+    spin_usec(20000);
+    note('M');
+}
+
+void notmain(void) {
+    test_init();
+    rpi_preempt_init(1000);
+
+    rpi_fork_prio(low, 0, LOW);
+    rpi_fork_prio(high, 0, HIGH);
+    rpi_fork_prio(mid, 0, MID);
+    rpi_thread_start();
+
+    order[nlog] = 0;
+    trace("order = <%s>\n", order);
+    assert(strcmp(order, "hLHmMl") == 0);
+    test_done();
+    trace("SUCCESS\n");
+}
@@ -0,0 +1,89 @@
+// the bounded-latency version of ../code-threads/7-test-realtime-yield.c
+//
+// there, the pwm threads poll the clock and yield, so how late an
+// edge is depends on how long everyone else runs between yields.
+// here they sleep until absolute deadlines at high priority: the
+// system timer interrupt wakes them and they preempt whatever is
+// running, so the lateness is the interrupt path plus the switch no
+// matter what else is going on.  to show it, two low priority threads
+// burn the cpu without ever yielding.
+#include "test-header.h"
+
+// generous: the wakeup path is a few usec.
+enum { MAX_LATENCY_USEC = 30, NCYCLES = 1000, PERIOD_USEC = 200 };
+
+struct pwm {
+    unsigned duty;      // between 0 and 100
+    unsigned pin;
+    uint32_t max_late, tot_late;
+};
+
+static volatile int ndone;
+
+// wake at <deadline> and note how late we were.
+static void wait_until(struct pwm *p, uint64_t deadline) {
+    rpi_sleep_until(deadline);
+    uint32_t late = timer_get_usec64() - deadline;
+    if(late > p->max_late)
+        p->max_late = late;
+    p->tot_late += late;
+}
+
+static void blink(void *arg) {
+    struct pwm *p = arg;
+
+    gpio_set_output(p->pin);
+    demand(p->duty > 0 && p->duty < 100, wierd duty cycle!);
+
+    unsigned on_usec = p->duty * PERIOD_USEC / 100;
+    unsigned off_usec = PERIOD_USEC - on_usec;
+
+    // absolute deadlines: lateness doesn't add up.
+    uint64_t t = timer_get_usec64() + PERIOD_USEC;
+    for(int i = 0; i < NCYCLES; i++) {
+        wait_until(p, t);
+        gpio_set_on(p->pin);
+        t += on_usec;
+
+        wait_until(p, t);
+        gpio_set_off(p->pin);
+        t += off_usec;
+    }
+    uint32_t cpsr = cpsr_int_disable();
+    ndone++;
+    cpsr_int_reset(cpsr);
+}
+
+// never yields.
+static void hog(void *arg) {
+    unsigned n = 0;
+    while(ndone < 2)
+        n++;
+    trace("hog %d: preempted %d times\n",
+        rpi_cur_thread()->tid, rpi_cur_thread()->npreempted);
+}
+
+void notmain(void) {
+    test_init();
+    rpi_preempt_init(2000);
+
+    struct pwm t_75 = {.duty = 75, .pin = 20 },
+               t_25 = {.duty = 25, .pin = 21 };
+
+    rpi_fork_prio(hog, 0, 1);
+    rpi_fork_prio(hog, 0, 1);
+    rpi_fork_prio(blink, &t_75, 20);
+    rpi_fork_prio(blink, &t_25, 20);
+    rpi_thread_start();
+
+    struct pwm *p[] = { &t_75, &t_25 };
+    for(unsigned i = 0; i < 2; i++) {
+        trace("pin %d: max late = %d usec, average = %d usec\n",
+            p[i]->pin, p[i]->max_late, p[i]->tot_late / (2*NCYCLES));
+        if(p[i]->max_late > MAX_LATENCY_USEC)
+            panic("pin %d was %d usec late: bound is %d\n",
+                p[i]->pin, p[i]->max_late, MAX_LATENCY_USEC);
+    }
+    test_done();
+    trace("DONE\n");
+}
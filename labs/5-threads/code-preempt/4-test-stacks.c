@@ -0,0 +1,97 @@
+// stacks: a thousand threads alive at once on 1KB stacks, each
+// recursing to a different depth before it yields.
+//  - the painted high-water mark grows with the depth.
+//  - once they have exited every stack is back in the pool, and a
+//    second thousand reuse them without taking more heap.
+//  - a default stack is RPI_STACK_DEFAULT; a guarded one sits right
+//    on top of the section given to the guard routine.  (no VM here,
+//    so the routine only records the section.)
+#include "test-header.h"
+#include "slab.h"
+
+enum { NTH = 1000, SMALL = 1024, MAXDEPTH = 4 };
+
+static unsigned used[NTH], nran;
+
+// each level takes a frame plus <pad>.
+static unsigned __attribute__((noinline)) recurse(unsigned n) {
+    volatile uint32_t pad[8];
+    pad[0] = n;
+    if(!n)
+        rpi_yield();
+    else
+        pad[1] = recurse(n - 1);
+    return pad[0];
+}
+
+static void small(void *arg) {
+    unsigned i = (unsigned)arg;
+    recurse(i % MAXDEPTH);
+    used[i] = rpi_stack_highwater(rpi_cur_thread());
+    nran++;
+}
+
+static void wave(void) {
+    nran = 0;
+    for(unsigned i = 0; i < NTH; i++)
+        rpi_fork_stack(small, (void *)i, RPI_PRIO_DEFAULT, SMALL);
+    // all NTH are forked before any runs.
+    assert(rpi_stack_stats().live == NTH);
+    rpi_thread_start();
+    assert(nran == NTH);
+    assert(rpi_stack_stats().live == 0);
+}
+
+static uint32_t guard_sec;
+static void fake_protect(uint32_t sec) {
+    guard_sec = sec;
+}
+
+static unsigned big_nbytes, big_used;
+static void big(void *arg) {
+    rpi_thread_t *t = rpi_cur_thread();
+    big_nbytes = t->stack.nbytes;
+    big_used = rpi_stack_highwater(t);
+}
+
+void notmain(void) {
+    // like test_init, but enough heap for everything at once.
+    kmalloc_init_mb(16);
+    redzone_init();
+
+    wave();
+    for(unsigned i = 0; i < NTH; i++) {
+        if(!used[i] || used[i] >= SMALL)
+            panic("thread %d: used %d bytes of %d\n", i, used[i], SMALL);
+        // same depth, same usage; deeper, more.
+        if(i >= MAXDEPTH)
+            assert(used[i] == used[i - MAXDEPTH]);
+        if(i % MAXDEPTH)
+            assert(used[i] > used[i - 1]);
+    }
+    for(unsigned d = 0; d < MAXDEPTH; d++)
+        output("depth %d: %d of %d bytes\n", d, used[d], SMALL);
+
+    unsigned heap = slab_stats().heap_bytes;
+    wave();
+    rpi_stack_stats_t s = rpi_stack_stats();
+    output("%d threads, max %d stack bytes live, heap %d bytes\n",
+        s.nalloc, s.max_live_bytes, slab_stats().heap_bytes);
+    assert(s.max_live_bytes == NTH * SMALL);
+    assert(slab_stats().heap_bytes == heap);
+
+    rpi_fork(big, 0);
+    rpi_thread_start();
+    output("default stack: used %d of %d bytes\n", big_used, big_nbytes);
+    assert(big_nbytes == RPI_STACK_DEFAULT && big_used < big_nbytes);
+
+    rpi_stack_guard_init(fake_protect);
+    rpi_thread_t *t = rpi_fork_guarded(big, 0, RPI_PRIO_DEFAULT);
+    assert(guard_sec % RPI_STACK_SECTION == 0);
+    assert((uint32_t)t->stack.base == guard_sec + RPI_STACK_SECTION);
+    rpi_thread_start();
+    assert(big_nbytes == RPI_STACK_SECTION);
+    output("guarded stack: used %d of %d bytes\n", big_used, big_nbytes);
+
+    redzone_check("done with test");
+}
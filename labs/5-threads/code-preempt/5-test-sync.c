@@ -0,0 +1,175 @@
+// rpi-sync.h:
+//  1. mutex: threads bump a shared counter, yielding in the middle of
+//     the critical section so the others pile up on the lock.
+//  2. condition variables: a bounded buffer with producers and
+//     consumers, checked by summing everything that went through.
+//  3. a thread that exits holding a mutex: rpi_exit hands it to the
+//     thread waiting for it.
+//  4. semaphore from an interrupt: a timer wheel callback does
+//     rpi_sem_up every PERIOD usec and a thread waits on it.  it is
+//     blocked (off the run queue) in between, so the scheduler sits in
+//     its wfi loop.
+#include "test-header.h"
+#include "rpi-sync.h"
+#include "rpi-systimer.h"
+
+/**********************************************************************
+ * 1. mutex.
+ */
+enum { NTH = 4, NINC = 50 };
+
+static rpi_mutex_t cnt_lock = RPI_MUTEX_INIT("counter");
+static volatile unsigned counter;
+
+static void incr(void *arg) {
+    for(unsigned i = 0; i < NINC; i++) {
+        rpi_mutex_lock(&cnt_lock);
+        unsigned x = counter;
+        rpi_yield();
+        counter = x + 1;
+        rpi_mutex_unlock(&cnt_lock);
+    }
+}
+
+static void test_mutex(void) {
+    for(unsigned i = 0; i < NTH; i++)
+        rpi_fork(incr, 0);
+    rpi_thread_start();
+    rpi_mutex_stats_print(&cnt_lock);
+    assert(counter == NTH * NINC);
+    assert(cnt_lock.nacquire == NTH * NINC);
+    assert(cnt_lock.nwait > 0);
+    assert(!cnt_lock.q.owner);
+}
+
+/**********************************************************************
+ * 2. bounded buffer.
+ */
+enum { NSLOT = 4, NPROD = 3, NCONS = 2, NITEM = 100 };
+
+static rpi_mutex_t buf_lock = RPI_MUTEX_INIT("buffer");
+static rpi_cond_t not_full = RPI_COND_INIT("not full"),
+                  not_empty = RPI_COND_INIT("not empty");
+static unsigned buf[NSLOT], nbuf, head, tail;
+static unsigned sum_in, sum_out, nout;
+
+static void producer(void *arg) {
+    unsigned base = (unsigned)arg * 1000;
+    for(unsigned i = 1; i <= NITEM; i++) {
+        rpi_mutex_lock(&buf_lock);
+        while(nbuf == NSLOT)
+            rpi_cond_wait(&not_full, &buf_lock);
+        buf[head++ % NSLOT] = base + i;
+        nbuf++;
+        sum_in += base + i;
+        rpi_cond_signal(&not_empty);
+        rpi_mutex_unlock(&buf_lock);
+    }
+}
+
+static void consumer(void *arg) {
+    while(1) {
+        rpi_mutex_lock(&buf_lock);
+        while(!nbuf && nout < NPROD * NITEM)
+            rpi_cond_wait(&not_empty, &buf_lock);
+        if(nout == NPROD * NITEM) {
+            rpi_mutex_unlock(&buf_lock);
+            return;
+        }
+        sum_out += buf[tail++ % NSLOT];
+        nbuf--;
+        if(++nout == NPROD * NITEM)
+            rpi_cond_broadcast(&not_empty);     // wake the other consumers.
+        rpi_cond_signal(&not_full);
+        rpi_mutex_unlock(&buf_lock);
+    }
+}
+
+static void test_cond(void) {
+    for(unsigned i = 0; i < NCONS; i++)
+        rpi_fork(consumer, 0);
+    for(unsigned i = 0; i < NPROD; i++)
+        rpi_fork(producer, (void *)i);
+    rpi_thread_start();
+    rpi_mutex_stats_print(&buf_lock);
+    output("not full: %d waits, not empty: %d waits\n",
+        not_full.nwait, not_empty.nwait);
+    assert(nout == NPROD * NITEM && !nbuf);
+    assert(sum_in == sum_out);
+    assert(not_full.nwait > 0);
+}
+
+/**********************************************************************
+ * 3. exiting with a mutex held.
+ */
+static rpi_mutex_t dead_lock = RPI_MUTEX_INIT("exits holding");
+static int got_dead_lock;
+
+static void exits_holding(void *arg) {
+    rpi_mutex_lock(&dead_lock);
+    rpi_yield();        // let the other one block on it.
+}
+
+static void waits_for_it(void *arg) {
+    rpi_mutex_lock(&dead_lock);
+    got_dead_lock = 1;
+    rpi_mutex_unlock(&dead_lock);
+}
+
+static void test_exit_holding(void) {
+    rpi_fork(exits_holding, 0);
+    rpi_fork(waits_for_it, 0);
+    rpi_thread_start();
+    rpi_mutex_stats_print(&dead_lock);
+    assert(got_dead_lock);
+    assert(dead_lock.nwait == 1);
+    assert(!dead_lock.q.owner);
+}
+
+/**********************************************************************
+ * 4. semaphore posted from an interrupt.
+ */
+enum { NTICK = 20, PERIOD = 2000 };
+
+static rpi_sem_t tick = RPI_SEM_INIT("tick", 0);
+static tw_timer_t tick_timer;
+static unsigned nposted;
+static uint32_t posted_at;
+static unsigned max_lat;
+
+static void post(tw_timer_t *t, void *arg) {
+    posted_at = timer_get_usec();
+    rpi_sem_up(&tick);
+    if(++nposted < NTICK)
+        timer_wheel_add(t, PERIOD, post, 0);
+}
+
+static void waiter(void *arg) {
+    for(unsigned i = 0; i < NTICK; i++) {
+        rpi_sem_down(&tick);
+        unsigned lat = timer_get_usec() - posted_at;
+        if(lat > max_lat)
+            max_lat = lat;
+    }
+}
+
+static void test_sem_irq(void) {
+    rpi_preempt_init(10*1000);
+    rpi_fork(waiter, 0);
+    timer_wheel_add(&tick_timer, PERIOD, post, 0);
+    rpi_thread_start();
+    output("sem <%s>: %d downs, %d blocked, max wakeup latency %d usec\n",
+        tick.name, tick.nacquire, tick.nwait, max_lat);
+    assert(tick.nacquire == NTICK && !tick.count);
+    // it was asleep every time the interrupt came.
+    assert(tick.nwait == NTICK);
+}
+
+void notmain(void) {
+    test_init();
+    test_mutex();
+    test_cond();
+    test_exit_holding();
+    test_sem_irq();
+    test_done();
+}
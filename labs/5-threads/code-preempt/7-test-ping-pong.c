@@ -0,0 +1,144 @@
+// how many cycles a switch costs.
+//
+//  1. raw: bounce between two stacks with nothing but the switch.
+//     the old full-frame switch (r0-r12, lr, pc, cpsr, resumed with
+//     ldm + rfe: kept here as a copy) against rpi_cswitch's one stm
+//     and one ldm of r4-r12, pc.
+//  2. two threads at the same priority yielding to each other, with
+//     the VFP off, lazy with one thread using it, lazy with both using
+//     it (every switch traps and swaps) and eager (every switch
+//     swaps).  the threads leave different values in s0 and s31 and
+//     check they are still there after each yield.
+//
+// prints its numbers rather than checking them, except that lazy mode
+// must not reload the VFP for a thread nobody else touched it for.
+#include "test-header.h"
+#include "cycle-count.h"
+
+/**********************************************************************
+ * raw switches.
+ */
+typedef void (*switch_fn_t)(uint32_t **old_sp_save, const uint32_t *new_sp);
+
+// the switch we had before this one.
+void full_cswitch(uint32_t **old_sp_save, const uint32_t *new_sp);
+asm(".text\n"
+    ".align 2\n"
+    ".globl full_cswitch\n"
+    "full_cswitch:\n"
+    "    mrs     r2, cpsr\n"
+    "    push    {r2}\n"
+    "    push    {lr}\n"
+    "    push    {r0-r12, lr}\n"
+    "    str     sp, [r0]\n"
+    "    mov     sp, r1\n"
+    "    ldm     sp!, {r0-r12, lr}\n"
+    "    rfeia   sp!\n");
+
+enum { NRAW = 1000 };
+
+static switch_fn_t sw;
+static uint32_t *main_sp, *pong_sp;
+static uint32_t pong_stack[1024] __attribute__((aligned(8)));
+
+static void __attribute__((noreturn)) ponger(void) {
+    while(1)
+        sw(&pong_sp, main_sp);
+}
+
+// cycles per switch, bouncing to ponger and back NRAW times.
+static uint32_t raw_pingpong(switch_fn_t fn) {
+    uint32_t *top = &pong_stack[1024];
+    if(fn == full_cswitch) {
+        uint32_t *f = top - 16;
+        memset(f, 0, 16*4);
+        f[14] = (uint32_t)ponger;       // pc
+        f[15] = cpsr_get();             // cpsr: interrupts off.
+        pong_sp = f;
+    } else {
+        rpi_frame_t *f = (rpi_frame_t *)top - 1;
+        memset(f, 0, sizeof *f);
+        f->pc = (uint32_t)ponger;
+        pong_sp = (void *)f;
+    }
+    sw = fn;
+
+    uint32_t s = cycle_cnt_read();
+    for(unsigned i = 0; i < NRAW; i++)
+        sw(&main_sp, pong_sp);
+    return (cycle_cnt_read() - s) / (2*NRAW);
+}
+
+/**********************************************************************
+ * thread switches.
+ */
+enum { NYIELD = 1000 };
+
+static unsigned fp_users;
+static uint32_t start, end, nloads[2];
+
+// the kernel is soft-float: use the VFP by hand.
+static inline void vfp_put(uint32_t x) {
+    asm volatile(".fpu vfp\n"
+                 "fmsr s0, %0\n"
+                 "fmsr s31, %1\n" :: "r"(x), "r"(~x));
+}
+static inline void vfp_check(uint32_t x) {
+    uint32_t lo, hi;
+    asm volatile(".fpu vfp\n"
+                 "fmrs %0, s0\n"
+                 "fmrs %1, s31\n" : "=r"(lo), "=r"(hi));
+    if(lo != x || hi != ~x)
+        panic("tid=%d: vfp has %x,%x, expected %x,%x\n",
+            rpi_tid(), lo, hi, x, ~x);
+}
+
+// thread 0 yields first: after its last yield returns, both threads
+// have switched NYIELD times.
+static void pinger(void *arg) {
+    unsigned id = (unsigned)arg;
+    int fp = id < fp_users;
+
+    if(!id)
+        start = cycle_cnt_read();
+    for(unsigned i = 0; i < NYIELD; i++) {
+        uint32_t x = id << 16 | i;
+        if(fp)
+            vfp_put(x);
+        rpi_yield();
+        if(fp)
+            vfp_check(x);
+    }
+    if(!id)
+        end = cycle_cnt_read();
+    nloads[id] = rpi_cur_thread()->nvfp_loads;
+}
+
+static uint32_t thread_pingpong(const char *msg, rpi_vfp_mode_t mode, unsigned users) {
+    rpi_vfp_init(mode);
+    fp_users = users;
+    rpi_fork(pinger, (void *)0);
+    rpi_fork(pinger, (void *)1);
+    rpi_thread_start();
+
+    uint32_t cyc = (end - start) / (2*NYIELD);
+    output("%s: %d cycles per yield+switch (vfp loads: %d, %d)\n",
+        msg, cyc, nloads[0], nloads[1]);
+    return cyc;
+}
+
+void notmain(void) {
+    test_init();
+    cycle_cnt_init();
+
+    output("raw switch, old full frame: %d cycles\n", raw_pingpong(full_cswitch));
+    output("raw switch, rpi_cswitch:    %d cycles\n", raw_pingpong(rpi_cswitch));
+
+    thread_pingpong("vfp off           ", RPI_VFP_OFF, 0);
+    thread_pingpong("vfp lazy, 1 user  ", RPI_VFP_LAZY, 1);
+    // thread 0 got the VFP once and kept it.
+    assert(nloads[0] == 1 && nloads[1] == 0);
+    thread_pingpong("vfp lazy, 2 users ", RPI_VFP_LAZY, 2);
+    thread_pingpong("vfp eager, 2 users", RPI_VFP_EAGER, 2);
+    test_done();
+}
@@ -0,0 +1,96 @@
+// engler,cs140e: thread stacks.  see rpi-stack.h
+#include "rpi.h"
+#include "rpi-stack.h"
+#include "slab.h"
+
+static rpi_stack_stats_t stats;
+
+static rpi_stack_guard_fn guard_protect;
+// freed guarded stacks: kmalloc can't take them back, so we keep them.
+// the link is in the stack's lowest word (the section under it faults).
+static uint32_t *guarded_free;
+
+static void paint(rpi_stack_t *s) {
+    uint32_t *p = s->base, *e = rpi_stack_top(s);
+    while(p < e)
+        *p++ = RPI_STACK_PAINT;
+}
+
+static rpi_stack_t hand_out(rpi_stack_t s) {
+    paint(&s);
+    stats.nalloc++;
+    stats.live++;
+    stats.live_bytes += s.nbytes;
+    if(stats.live_bytes > stats.max_live_bytes)
+        stats.max_live_bytes = stats.live_bytes;
+    return s;
+}
+
+rpi_stack_t rpi_stack_alloc(unsigned nbytes) {
+    if(!nbytes)
+        nbytes = RPI_STACK_DEFAULT;
+    if(nbytes > RPI_STACK_MAX)
+        panic("stack of %d bytes: max is %d\n", nbytes, RPI_STACK_MAX);
+
+    // a power of two: a slab class, so nothing is lost rounding.
+    unsigned n = RPI_STACK_MIN;
+    while(n < nbytes)
+        n *= 2;
+
+    // paint() writes all of it anyway.
+    void *p = slab_alloc_notzero(n);
+    assert((uint32_t)p % 8 == 0);
+    return hand_out((rpi_stack_t){ .base = p, .nbytes = n });
+}
+
+rpi_stack_t rpi_stack_alloc_guarded(void) {
+    if(!guard_protect)
+        panic("guarded stack: call rpi_stack_guard_init first\n");
+
+    uint32_t *base = guarded_free;
+    if(base)
+        guarded_free = (uint32_t *)base[0];
+    else {
+        // [guard section][stack section]
+        uint32_t sec = (uint32_t)kmalloc_aligned(2*RPI_STACK_SECTION,
+                                                    RPI_STACK_SECTION);
+        guard_protect(sec);
+        base = (uint32_t *)(sec + RPI_STACK_SECTION);
+        stats.nguarded++;
+    }
+    return hand_out((rpi_stack_t){
+        .base = base,
+        .nbytes = RPI_STACK_SECTION,
+        .guarded = 1
+    });
+}
+
+void rpi_stack_free(rpi_stack_t *s) {
+    if(!s->base)
+        return;
+    if(s->guarded) {
+        s->base[0] = (uint32_t)guarded_free;
+        guarded_free = s->base;
+    } else
+        slab_free(s->base);
+
+    stats.nfree++;
+    stats.live--;
+    stats.live_bytes -= s->nbytes;
+    *s = (rpi_stack_t){0};
+}
+
+unsigned rpi_stack_used(const rpi_stack_t *s) {
+    uint32_t *p = s->base, *e = rpi_stack_top(s);
+    while(p < e && *p == RPI_STACK_PAINT)
+        p++;
+    return (e - p) * 4;
+}
+
+void rpi_stack_guard_init(rpi_stack_guard_fn protect) {
+    guard_protect = protect;
+}
+
+rpi_stack_stats_t rpi_stack_stats(void) {
+    return stats;
+}
@@ -0,0 +1,87 @@
+// engler,cs140e: thread stacks for rpi-thread.c.
+#ifndef __RPI_STACK_H__
+#define __RPI_STACK_H__
+/*
+ * a stack is any power of two from RPI_STACK_MIN to RPI_STACK_MAX
+ * bytes (requests are rounded up).  they come from slab.h, which has
+ * exactly those sizes as classes: freeing a stack puts it on its
+ * class's free list and the next thread that wants that size gets it
+ * back in O(1).  small threads don't pay for big ones.
+ *
+ * every stack is painted with RPI_STACK_PAINT when it is handed out:
+ *   - rpi_stack_used: how deep it ever got (the high-water mark) is
+ *     the distance from the top to the lowest word that isn't paint.
+ *   - rpi_stack_ok: the lowest word is a canary.  the thread package
+ *     checks it every time it switches away from a thread, so an
+ *     overflow panics at the next switch instead of corrupting
+ *     whatever is under the stack.
+ *
+ * with VM on you can also have guarded stacks: 1MB with a 1MB section
+ * under it that faults on any access, so an overflow is a data abort
+ * at the offending instruction.  the threads package doesn't know
+ * about page tables: rpi_stack_guard_init gives it the routine that
+ * takes away access to a section.  they cost 2MB of address space and
+ * memory each, so they are for the few threads you're worried about.
+ */
+#include "rpi.h"
+
+enum {
+    // smaller requests are rounded up to this.  a thread's stack also
+    // takes the interrupt trampoline's 32-byte frame, and one printk
+    // puts a PRINTK_BUFSIZE (128 byte) buffer on it: 256 bytes was
+    // gone after a printk or two, and the canary only tells you at the
+    // next switch, after the damage.
+    RPI_STACK_MIN = 1024,
+    RPI_STACK_MAX = 1024 * 1024,
+    RPI_STACK_DEFAULT = 8 * 1024,
+    RPI_STACK_SECTION = 1024 * 1024,
+};
+
+#define RPI_STACK_PAINT 0x5a5a5a5a
+
+typedef struct {
+    uint32_t *base;         // lowest address.
+    uint32_t nbytes;
+    uint32_t guarded;
+} rpi_stack_t;
+
+// at least <nbytes> (0 = RPI_STACK_DEFAULT), painted.  panics if it's
+// bigger than RPI_STACK_MAX or there is no memory.
+rpi_stack_t rpi_stack_alloc(unsigned nbytes);
+
+// a RPI_STACK_SECTION stack with a guard section under it.  panics if
+// rpi_stack_guard_init hasn't been called.
+rpi_stack_t rpi_stack_alloc_guarded(void);
+
+void rpi_stack_free(rpi_stack_t *s);
+
+static inline uint32_t *rpi_stack_top(const rpi_stack_t *s) {
+    return s->base + s->nbytes / 4;
+}
+
+// 0 if the canary at the bottom has been overwritten.
+static inline int rpi_stack_ok(const rpi_stack_t *s) {
+    return s->base[0] == RPI_STACK_PAINT;
+}
+
+// high-water mark in bytes.
+unsigned rpi_stack_used(const rpi_stack_t *s);
+
+// <protect>(sec) must make the 1MB section at <sec> fault on any
+// access: unmap it or give it no-access permissions in your page
+// table.  guarded stacks are carved out of the kmalloc heap, so it
+// has to be mapped section by section (pinned VM is).
+typedef void (*rpi_stack_guard_fn)(uint32_t sec);
+void rpi_stack_guard_init(rpi_stack_guard_fn protect);
+
+typedef struct {
+    unsigned nalloc, nfree;     // calls so far.
+    unsigned live;              // stacks in use.
+    unsigned live_bytes;        // their total size.
+    unsigned max_live_bytes;    // high-water mark of <live_bytes>.
+    unsigned nguarded;          // guarded stacks ever made.
+} rpi_stack_stats_t;
+
+rpi_stack_stats_t rpi_stack_stats(void);
+
+#endif
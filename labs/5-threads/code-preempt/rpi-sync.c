@@ -0,0 +1,152 @@
+// engler,cs140e: mutexes, condition variables, semaphores.  see
+// rpi-sync.h
+//
+// every operation runs with interrupts off so that checking the state
+// and blocking on the wait queue can't be split by an interrupt
+// handler (or, with preemption, another thread).
+#include "rpi.h"
+#include "rpi-sync.h"
+#include "cycle-count.h"
+
+/******************************************************************
+ * mutexes.
+ */
+
+void rpi_mutex_init(rpi_mutex_t *m, const char *name) {
+    *m = RPI_MUTEX_INIT(name);
+}
+
+static void got_it(rpi_mutex_t *m) {
+    m->nacquire++;
+    m->locked_at = cycle_cnt_read();
+}
+
+void rpi_mutex_lock(rpi_mutex_t *m) {
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *me = rpi_cur_thread();
+    if(m->q.owner == me)
+        panic("mutex <%s>: tid=%d already holds it\n", m->name, me->tid);
+
+    if(!m->q.owner)
+        rpi_waitq_set_owner(&m->q, me);
+    else {
+        m->nwait++;
+        // unlock makes us the owner before it wakes us.
+        rpi_waitq_wait(&m->q);
+        if(m->q.owner != me)
+            panic("mutex <%s>: woke up without it\n", m->name);
+    }
+    got_it(m);
+    cpsr_int_reset(cpsr);
+}
+
+int rpi_mutex_trylock(rpi_mutex_t *m) {
+    uint32_t cpsr = cpsr_int_disable();
+    int ok = !m->q.owner;
+    if(ok) {
+        rpi_waitq_set_owner(&m->q, rpi_cur_thread());
+        got_it(m);
+    } else
+        m->ntryfail++;
+    cpsr_int_reset(cpsr);
+    return ok;
+}
+
+// the best waiter gets the lock before it can run.
+static void unlock(void *arg) {
+    rpi_mutex_t *m = arg;
+    rpi_thread_t *me = rpi_cur_thread();
+    if(m->q.owner != me)
+        panic("mutex <%s>: tid=%d unlocking but doesn't hold it\n",
+            m->name, me->tid);
+
+    uint32_t cyc = cycle_cnt_read() - m->locked_at;
+    m->tot_hold_cyc += cyc;
+    if(cyc > m->max_hold_cyc)
+        m->max_hold_cyc = cyc;
+
+    rpi_waitq_handoff(&m->q);
+}
+
+void rpi_mutex_unlock(rpi_mutex_t *m) {
+    uint32_t cpsr = cpsr_int_disable();
+    unlock(m);
+    cpsr_int_reset(cpsr);
+}
+
+// the total, not an average: no divide (see rpi.h).
+void rpi_mutex_stats_print(rpi_mutex_t *m) {
+    output("mutex <%s>: %d acquires, %d waited, %d trylock failures, hold cycles: max=%u total=%u\n",
+        m->name, m->nacquire, m->nwait, m->ntryfail, m->max_hold_cyc, m->tot_hold_cyc);
+}
+
+/******************************************************************
+ * condition variables.
+ */
+
+void rpi_cond_init(rpi_cond_t *c, const char *name) {
+    *c = RPI_COND_INIT(name);
+}
+
+void rpi_cond_wait(rpi_cond_t *c, rpi_mutex_t *m) {
+    uint32_t cpsr = cpsr_int_disable();
+    c->nwait++;
+    // we're on <c> before the lock is free: a signal sent by whoever
+    // takes it next can't miss us.
+    rpi_waitq_wait_then(&c->q, unlock, m);
+    rpi_mutex_lock(m);
+    cpsr_int_reset(cpsr);
+}
+
+void rpi_cond_signal(rpi_cond_t *c) {
+    uint32_t cpsr = cpsr_int_disable();
+    c->nsignal++;
+    rpi_waitq_wakeup(&c->q);
+    cpsr_int_reset(cpsr);
+}
+
+void rpi_cond_broadcast(rpi_cond_t *c) {
+    uint32_t cpsr = cpsr_int_disable();
+    c->nsignal++;
+    rpi_waitq_wakeup_all(&c->q);
+    cpsr_int_reset(cpsr);
+}
+
+/******************************************************************
+ * semaphores.
+ */
+
+void rpi_sem_init(rpi_sem_t *s, const char *name, unsigned count) {
+    *s = RPI_SEM_INIT(name, count);
+}
+
+void rpi_sem_down(rpi_sem_t *s) {
+    uint32_t cpsr = cpsr_int_disable();
+    s->nacquire++;
+    if(s->count)
+        s->count--;
+    else {
+        s->nwait++;
+        // rpi_sem_up gives us the unit directly.
+        rpi_waitq_wait(&s->q);
+    }
+    cpsr_int_reset(cpsr);
+}
+
+int rpi_sem_trydown(rpi_sem_t *s) {
+    uint32_t cpsr = cpsr_int_disable();
+    int ok = s->count != 0;
+    if(ok) {
+        s->count--;
+        s->nacquire++;
+    }
+    cpsr_int_reset(cpsr);
+    return ok;
+}
+
+void rpi_sem_up(rpi_sem_t *s) {
+    uint32_t cpsr = cpsr_int_disable();
+    if(!rpi_waitq_wakeup(&s->q))
+        s->count++;
+    cpsr_int_reset(cpsr);
+}
@@ -0,0 +1,94 @@
+// engler,cs140e: blocking locks, condition variables and semaphores
+// for rpi-thread.h.
+#ifndef __RPI_SYNC_H__
+#define __RPI_SYNC_H__
+/*
+ * all three are a wait queue (rpi-thread.h) plus a little state: a
+ * thread that has to wait is taken off the run queues until someone
+ * wakes it, instead of spinning on rpi_yield.
+ *
+ *   - rpi_mutex_t: the holder is the wait queue's owner, so it inherits
+ *     the priority of whoever is waiting for it.  unlock hands the lock
+ *     straight to the highest-priority waiter: nobody can barge in
+ *     ahead of it.  not recursive.  if the holder exits, rpi_exit
+ *     hands the lock on the same way (that last hold isn't counted in
+ *     the hold-cycle stats: rpi-thread.c doesn't know it's a mutex).
+ *   - rpi_cond_t: mesa style (re-check your condition in a loop).
+ *   - rpi_sem_t: counting.  rpi_sem_up hands the unit straight to a
+ *     waiter if there is one.
+ *
+ * from an interrupt handler you can call rpi_sem_up, rpi_cond_signal
+ * and rpi_cond_broadcast: the woken thread runs when the handler
+ * returns if it beats whoever was interrupted.  nothing else here may
+ * be called from one.
+ *
+ * each one counts how it is used so you can see which locks are hot:
+ * acquires, how many of those had to wait and, for mutexes, how long
+ * it was held in cycles (wall time: includes time the holder was
+ * preempted).  see rpi_mutex_stats_print.
+ */
+#include "rpi-thread.h"
+
+typedef struct {
+    rpi_waitq_t q;          // q.owner is the holder.
+    const char *name;
+
+    // stats.
+    uint32_t nacquire;      // successful lock/trylock calls.
+    uint32_t nwait;         // ... that had to block.
+    uint32_t ntryfail;      // trylocks that failed.
+    uint32_t max_hold_cyc;
+    uint32_t tot_hold_cyc;  // wraps after ~6 sec of holding at 700MHz.
+    uint32_t locked_at;     // cycle count when it was acquired.
+} rpi_mutex_t;
+
+#define RPI_MUTEX_INIT(_name) ((rpi_mutex_t){ .name = _name })
+
+void rpi_mutex_init(rpi_mutex_t *m, const char *name);
+void rpi_mutex_lock(rpi_mutex_t *m);
+// 1 if we got it, 0 if someone holds it.
+int rpi_mutex_trylock(rpi_mutex_t *m);
+void rpi_mutex_unlock(rpi_mutex_t *m);
+
+// does the current thread hold <m>?
+static inline int rpi_mutex_held(rpi_mutex_t *m) {
+    return m->q.owner == rpi_cur_thread();
+}
+
+void rpi_mutex_stats_print(rpi_mutex_t *m);
+
+typedef struct {
+    rpi_waitq_t q;
+    const char *name;
+
+    uint32_t nwait, nsignal;
+} rpi_cond_t;
+
+#define RPI_COND_INIT(_name) ((rpi_cond_t){ .name = _name })
+
+void rpi_cond_init(rpi_cond_t *c, const char *name);
+// release <m> (which we must hold), wait for a signal, reacquire <m>.
+void rpi_cond_wait(rpi_cond_t *c, rpi_mutex_t *m);
+// wake the highest-priority waiter / all of them.
+void rpi_cond_signal(rpi_cond_t *c);
+void rpi_cond_broadcast(rpi_cond_t *c);
+
+typedef struct {
+    rpi_waitq_t q;
+    const char *name;
+    volatile unsigned count;
+
+    uint32_t nacquire;      // downs.
+    uint32_t nwait;         // ... that had to block.
+} rpi_sem_t;
+
+#define RPI_SEM_INIT(_name, _count) \
+    ((rpi_sem_t){ .name = _name, .count = _count })
+
+void rpi_sem_init(rpi_sem_t *s, const char *name, unsigned count);
+void rpi_sem_down(rpi_sem_t *s);
+// 1 if we got a unit, 0 if the count was 0.
+int rpi_sem_trydown(rpi_sem_t *s);
+void rpi_sem_up(rpi_sem_t *s);
+
+#endif
@@ -0,0 +1,736 @@
+// engler, cs140e: preemptive priority threads.  see rpi-thread.h
+//
+// everything that touches the run queues, wait queues or a thread's
+// state runs with interrupts off: either in an interrupt (the handlers
+// and rpi_irq_switch) or between cpsr_int_disable and cpsr_int_reset.
+// the same goes for the VFP state (rpi_undef runs with them off too).
+#include "rpi.h"
+#include "rpi-thread.h"
+#include "irq.h"
+#include "rpi-systimer.h"
+#include "cycle-count.h"
+
+// off so thousands of threads don't flood the uart: to trace every
+// fork and exit, change to "if 1"
+#if 0
+#   define th_trace(args...) trace(args)
+#else
+#   define th_trace(args...) do { } while(0)
+#endif
+
+// if you want to turn off redzone checking,
+// change to "if 0"
+#if 1
+#   include "redzone.h"
+#   define RZ_CHECK() redzone_check(0)
+#else
+#   define RZ_CHECK() do { } while(0)
+#endif
+
+// a doubly-linked list through <next>/<prev>: the run queues and the
+// wait queues (whose <head>/<tail> come first for the same reason).
+typedef struct {
+    rpi_thread_t *head, *tail;
+} th_list_t;
+_Static_assert(offsetof(rpi_waitq_t, head) == offsetof(th_list_t, head)
+            && offsetof(rpi_waitq_t, tail) == offsetof(th_list_t, tail),
+            "waitq must start with a th_list_t");
+
+static th_list_t runq[RPI_NPRIO];
+static uint32_t runq_bits;              // bit p set = runq[p] non-empty.
+static th_list_t freeq;
+// exited but still holding their stacks: one of them may have been
+// running on it until a moment ago.  reap() gives them back.
+static th_list_t zombies;
+
+static rpi_thread_t *cur_thread;        // current running thread.
+static rpi_thread_t *scheduler_thread;  // rpi_thread_start's caller.
+static unsigned nthreads;               // forked and not exited.
+
+static unsigned tid = 1;
+
+// preemption state.
+static int preempt_p;
+static uint32_t slice_usec;
+static tw_timer_t slice_timer;
+static int in_irq, need_resched, slice_expired;
+// rpi_waitq_wait_then is about to switch anyway: don't switch early.
+static int defer_switch;
+static uint32_t switch_usec;            // when <cur_thread> got the cpu.
+
+extern uint32_t rpi_thread_vectors[];
+
+// VFP state.
+static rpi_vfp_mode_t vfp_mode;
+static rpi_vfp_t *vfp_owner;            // whose registers are in the VFP.
+static rpi_vfp_t boot_vfp;              // rpi_thread_start's caller's.
+#define FPEXC_EN (1 << 30)
+
+/******************************************************************
+ * lists.
+ */
+static void list_append(th_list_t *l, rpi_thread_t *t) {
+    t->next = 0;
+    t->prev = l->tail;
+    if(l->tail)
+        l->tail->next = t;
+    else
+        l->head = t;
+    l->tail = t;
+}
+
+static void list_push(th_list_t *l, rpi_thread_t *t) {
+    t->prev = 0;
+    t->next = l->head;
+    if(l->head)
+        l->head->prev = t;
+    else
+        l->tail = t;
+    l->head = t;
+}
+
+static void list_remove(th_list_t *l, rpi_thread_t *t) {
+    if(t->prev)
+        t->prev->next = t->next;
+    else
+        l->head = t->next;
+    if(t->next)
+        t->next->prev = t->prev;
+    else
+        l->tail = t->prev;
+    t->next = t->prev = 0;
+}
+
+// highest priority first, behind others of the same priority.
+static void list_insert_prio(th_list_t *l, rpi_thread_t *t) {
+    rpi_thread_t *p = l->head;
+    while(p && p->prio >= t->prio)
+        p = p->next;
+    if(!p)
+        list_append(l, t);
+    else if(!p->prev)
+        list_push(l, t);
+    else {
+        t->prev = p->prev;
+        t->next = p;
+        p->prev->next = t;
+        p->prev = t;
+    }
+}
+
+/******************************************************************
+ * run queues.
+ */
+
+// <front>: it was preempted by a higher priority thread, so it goes
+// back ahead of the others at its priority.
+static void runq_add(rpi_thread_t *t, int front) {
+    t->state = TH_RUNNABLE;
+    th_list_t *q = &runq[t->prio];
+    if(front)
+        list_push(q, t);
+    else
+        list_append(q, t);
+    runq_bits |= 1 << t->prio;
+}
+
+static void runq_remove(rpi_thread_t *t) {
+    th_list_t *q = &runq[t->prio];
+    list_remove(q, t);
+    if(!q->head)
+        runq_bits &= ~(1 << t->prio);
+}
+
+// O(1): the highest non-empty queue.
+static rpi_thread_t *runq_highest(void) {
+    if(!runq_bits)
+        return 0;
+    return runq[31 - __builtin_clz(runq_bits)].head;
+}
+
+// does <t> get the cpu ahead of whoever is running?  the scheduler
+// thread (idle) loses to everyone.
+static int beats_cur(rpi_thread_t *t) {
+    return cur_thread == scheduler_thread || t->prio > cur_thread->prio;
+}
+
+/******************************************************************
+ * switching.
+ */
+
+// where <t>'s VFP registers live when it doesn't have the VFP.  the
+// scheduler thread is our caller so it shares the boot state.
+static rpi_vfp_t *vfp_state(rpi_thread_t *t) {
+    if(!t || t == scheduler_thread)
+        return &boot_vfp;
+    return &t->vfp;
+}
+
+static void vfp_switch(rpi_thread_t *old, rpi_thread_t *next) {
+    switch(vfp_mode) {
+    case RPI_VFP_OFF:
+        break;
+    case RPI_VFP_LAZY:
+        // the next VFP instruction traps to rpi_undef if it isn't ours.
+        rpi_fpexc_set(vfp_owner == vfp_state(next) ? FPEXC_EN : 0);
+        break;
+    case RPI_VFP_EAGER:
+        rpi_vfp_save(vfp_state(old));
+        rpi_vfp_restore(vfp_state(next));
+        next->nvfp_loads++;
+        break;
+    }
+}
+
+static void slice_done(tw_timer_t *tw, void *arg) {
+    slice_expired = 1;
+    need_resched = 1;
+}
+
+// charge the outgoing thread and start the incoming one's slice.
+static void account(rpi_thread_t *old, rpi_thread_t *next) {
+    uint32_t now = timer_get_usec();
+    old->run_usec += now - switch_usec;
+    switch_usec = now;
+    if(old->stack.base && !rpi_stack_ok(&old->stack))
+        panic("tid=%d: stack overflow: used all %d bytes\n",
+            old->tid, old->stack.nbytes);
+    next->nruns++;
+    next->state = TH_RUNNING;
+    if(old != next)
+        vfp_switch(old, next);
+    cur_thread = next;
+
+    if(!preempt_p)
+        return;
+    slice_expired = 0;
+    if(next == scheduler_thread)
+        timer_wheel_cancel(&slice_timer);
+    else
+        timer_wheel_add(&slice_timer, slice_usec, slice_done, 0);
+}
+
+// <cur_thread> has been put wherever it is going (a run queue, a wait
+// queue, nowhere): run the best thread, or the scheduler if there
+// are none.  interrupts are off.
+static void schedule(void) {
+    rpi_thread_t *old = cur_thread, *next = runq_highest();
+    if(next)
+        runq_remove(next);
+    else
+        next = scheduler_thread;
+
+    if(next == old) {
+        next->state = TH_RUNNING;
+        return;
+    }
+    account(old, next);
+    rpi_cswitch(&old->saved_sp, next->saved_sp);
+}
+
+// <t> just became runnable: if it beats the current thread, switch
+// now, or on the way out of the interrupt if we're in one.
+static void preempt_check(rpi_thread_t *t) {
+    if(!cur_thread || !beats_cur(t))
+        return;
+    if(in_irq || defer_switch)
+        need_resched = 1;
+    else if(cur_thread != scheduler_thread) {
+        runq_add(cur_thread, 1);
+        schedule();
+    }
+}
+
+// the preempted thread resumes in here, on its way back out through
+// the trampoline.
+void rpi_irq_switch(uint32_t pc) {
+    in_irq = 1;
+    irq_dispatch(pc);
+    in_irq = 0;
+
+    if(!need_resched || !cur_thread)
+        return;
+    need_resched = 0;
+
+    rpi_thread_t *old = cur_thread, *next = runq_highest();
+    int expired = slice_expired;
+    if(old != scheduler_thread) {
+        if(expired)
+            old->nexpired++;
+        // a new slice if nobody else gets to go.
+        if(!next || next->prio < old->prio
+        || (next->prio == old->prio && !expired)) {
+            if(expired)
+                account(old, old);
+            return;
+        }
+        old->npreempted++;
+        runq_add(old, !expired);
+    } else if(!next)
+        return;
+
+    runq_remove(next);
+    account(old, next);
+    rpi_cswitch(&old->saved_sp, next->saved_sp);
+}
+
+/******************************************************************
+ * lazy VFP.
+ */
+
+// arm coprocessor instructions (ldc/stc, mcrr/mrrc, cdp/mcr/mrc) for
+// cp10 or cp11: all of VFP.
+static int is_vfp_insn(uint32_t insn) {
+    if(insn >> 28 == 0xf)
+        return 0;
+    if(((insn >> 25) & 0b111) != 0b110 && ((insn >> 24) & 0xf) != 0b1110)
+        return 0;
+    return ((insn >> 8) & 0xe) == 0xa;
+}
+
+void rpi_undef(uint32_t pc) {
+    uint32_t insn = *(uint32_t *)pc;
+    // with the VFP on it's a real undefined instruction (or a VFP
+    // exception, which we don't handle either).
+    if(vfp_mode != RPI_VFP_LAZY || !is_vfp_insn(insn)
+    || (rpi_fpexc_get() & FPEXC_EN))
+        panic("undefined instruction at pc=%x: %x\n", pc, insn);
+
+    rpi_fpexc_set(FPEXC_EN);
+    rpi_vfp_t *v = vfp_state(cur_thread);
+    if(vfp_owner != v) {
+        if(vfp_owner)
+            rpi_vfp_save(vfp_owner);
+        rpi_vfp_restore(v);
+        vfp_owner = v;
+        if(cur_thread)
+            cur_thread->nvfp_loads++;
+    }
+}
+
+void rpi_vfp_init(rpi_vfp_mode_t mode) {
+    if(cur_thread)
+        panic("rpi_vfp_init: call before rpi_thread_start\n");
+    rpi_vfp_access_on();
+
+    // whatever is in the VFP now goes back where it belongs: after
+    // this our caller's registers are the live ones.
+    if(vfp_mode == RPI_VFP_LAZY && vfp_owner != &boot_vfp) {
+        rpi_fpexc_set(FPEXC_EN);
+        if(vfp_owner)
+            rpi_vfp_save(vfp_owner);
+        rpi_vfp_restore(&boot_vfp);
+    }
+    vfp_owner = &boot_vfp;
+    vfp_mode = mode;
+
+    switch(mode) {
+    case RPI_VFP_OFF:
+        rpi_fpexc_set(0);
+        break;
+    case RPI_VFP_LAZY:
+        irq_vector_base_set(rpi_thread_vectors);
+        rpi_fpexc_set(FPEXC_EN);
+        break;
+    case RPI_VFP_EAGER:
+        rpi_fpexc_set(FPEXC_EN);
+        break;
+    default:
+        panic("bad vfp mode %d\n", mode);
+    }
+}
+
+/******************************************************************
+ * priority inheritance.
+ */
+
+// <t>'s base priority or its highest waiter's, whichever is higher.
+static unsigned inherited_prio(rpi_thread_t *t) {
+    unsigned p = t->base_prio;
+    for(rpi_waitq_t *q = t->held; q; q = q->next_held)
+        if(q->head && q->head->prio > p)
+            p = q->head->prio;
+    return p;
+}
+
+// move <t> to priority <p> on whatever queue it is on.
+static void prio_move(rpi_thread_t *t, unsigned p) {
+    switch(t->state) {
+    case TH_RUNNABLE:
+        runq_remove(t);
+        t->prio = p;
+        runq_add(t, 0);
+        break;
+    case TH_BLOCKED:
+        list_remove((th_list_t *)t->blocked_on, t);
+        t->prio = p;
+        list_insert_prio((th_list_t *)t->blocked_on, t);
+        break;
+    default:
+        t->prio = p;
+        break;
+    }
+}
+
+// recompute <t>'s priority and pass the change along the chain of
+// owners it is waiting on.
+static void prio_update(rpi_thread_t *t) {
+    for(unsigned n = 0; t; n++) {
+        if(n > nthreads)
+            panic("wait queue cycle: deadlock at tid=%d\n", t->tid);
+        unsigned p = inherited_prio(t);
+        if(p == t->prio)
+            return;
+        prio_move(t, p);
+        t = t->state == TH_BLOCKED ? t->blocked_on->owner : 0;
+    }
+}
+
+// the current thread's priority may have dropped below a runnable one.
+static void prio_dropped(void) {
+    rpi_thread_t *t = runq_highest();
+    if(t && cur_thread != scheduler_thread && cur_thread->state == TH_RUNNING
+    && t->prio > cur_thread->prio) {
+        if(in_irq)
+            need_resched = 1;
+        else {
+            runq_add(cur_thread, 1);
+            schedule();
+        }
+    }
+}
+
+/******************************************************************
+ * wait queues.
+ */
+
+void rpi_waitq_wait_then(rpi_waitq_t *q, void (*fn)(void *), void *arg) {
+    RZ_CHECK();
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *t = cur_thread;
+    if(!t || t == scheduler_thread)
+        panic("rpi_waitq_wait: not called from a thread\n");
+
+    t->state = TH_BLOCKED;
+    t->blocked_on = q;
+    list_insert_prio((th_list_t *)q, t);
+    if(q->owner)
+        prio_update(q->owner);
+    if(fn) {
+        // whoever <fn> wakes waits for the schedule() below.
+        defer_switch = 1;
+        fn(arg);
+        defer_switch = 0;
+    }
+    schedule();
+    cpsr_int_reset(cpsr);
+}
+
+void rpi_waitq_wait(rpi_waitq_t *q) {
+    rpi_waitq_wait_then(q, 0, 0);
+}
+
+static rpi_thread_t *wakeup(rpi_waitq_t *q) {
+    rpi_thread_t *t = q->head;
+    if(!t)
+        return 0;
+    list_remove((th_list_t *)q, t);
+    t->blocked_on = 0;
+    runq_add(t, 0);
+    return t;
+}
+
+rpi_thread_t *rpi_waitq_wakeup(rpi_waitq_t *q) {
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *t = wakeup(q);
+    if(t) {
+        if(q->owner)
+            prio_update(q->owner);
+        preempt_check(t);
+    }
+    cpsr_int_reset(cpsr);
+    return t;
+}
+
+unsigned rpi_waitq_wakeup_all(rpi_waitq_t *q) {
+    uint32_t cpsr = cpsr_int_disable();
+    unsigned n = 0;
+    rpi_thread_t *t, *best = 0;
+    for(; (t = wakeup(q)); n++)
+        if(!best || t->prio > best->prio)
+            best = t;
+    if(best) {
+        if(q->owner)
+            prio_update(q->owner);
+        preempt_check(best);
+    }
+    cpsr_int_reset(cpsr);
+    return n;
+}
+
+// the waiter is off <q> and runnable before the owner changes, so
+// when the old owner drops back to its own priority the switch (if
+// any) is to a thread that already holds <q>.
+rpi_thread_t *rpi_waitq_handoff(rpi_waitq_t *q) {
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *t = wakeup(q);
+    rpi_waitq_set_owner(q, t);
+    cpsr_int_reset(cpsr);
+    return t;
+}
+
+void rpi_waitq_set_owner(rpi_waitq_t *q, rpi_thread_t *t) {
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *old = q->owner;
+    if(old != t) {
+        if(old) {
+            rpi_waitq_t **p = &old->held;
+            while(*p != q)
+                p = &(*p)->next_held;
+            *p = q->next_held;
+            q->next_held = 0;
+        }
+        q->owner = t;
+        if(t) {
+            q->next_held = t->held;
+            t->held = q;
+            prio_update(t);
+        }
+        if(old) {
+            prio_update(old);
+            if(old == cur_thread)
+                prio_dropped();
+        }
+    }
+    cpsr_int_reset(cpsr);
+}
+
+/******************************************************************
+ * sleeping.
+ */
+
+static void sleep_done(tw_timer_t *tw, void *arg) {
+    rpi_thread_t *t = arg;
+    assert(t->state == TH_SLEEPING);
+    runq_add(t, 0);
+    preempt_check(t);
+}
+
+void rpi_sleep_until(uint64_t deadline) {
+    RZ_CHECK();
+    if(!preempt_p) {
+        while(timer_get_usec64() < deadline)
+            rpi_yield();
+        return;
+    }
+
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *t = cur_thread;
+    if(!t || t == scheduler_thread)
+        panic("rpi_sleep: not called from a thread\n");
+    t->state = TH_SLEEPING;
+    timer_wheel_add_at(&t->sleep_timer, deadline, sleep_done, t);
+    schedule();
+    cpsr_int_reset(cpsr);
+}
+
+void rpi_sleep_us(uint32_t usec) {
+    rpi_sleep_until(timer_get_usec64() + usec);
+}
+
+/******************************************************************
+ * thread blocks.
+ */
+
+// we're not running on any of their stacks.
+static void reap(void) {
+    rpi_thread_t *t;
+    while((t = zombies.head)) {
+        list_remove(&zombies, t);
+        rpi_stack_free(&t->stack);
+        list_push(&freeq, t);
+    }
+}
+
+static rpi_thread_t *th_alloc(void) {
+    RZ_CHECK();
+    reap();
+    rpi_thread_t *t = freeq.head;
+    if(t)
+        list_remove(&freeq, t);
+    else
+        t = kmalloc_aligned(sizeof *t, 8);
+    memset(t, 0, sizeof *t);
+    t->tid = tid++;
+    return t;
+}
+
+rpi_thread_t *rpi_cur_thread(void) {
+    assert(cur_thread);
+    RZ_CHECK();
+    return cur_thread;
+}
+
+// every thread starts here (rpi_fork sets up its first frame for
+// rpi_thread_trampoline).
+static void __attribute__((noreturn))
+thread_entry(rpi_code_t code, void *arg) {
+    if(preempt_p)
+        cpsr_int_enable();
+    code(arg);
+    rpi_exit(0);
+    not_reached();
+}
+
+// <guarded>: a guarded stack, otherwise one of <stack_nbytes>.
+static rpi_thread_t *
+th_fork(rpi_code_t code, void *arg, unsigned prio, unsigned stack_nbytes, int guarded) {
+    RZ_CHECK();
+    if(prio >= RPI_NPRIO)
+        panic("priority %d: must be less than %d\n", prio, RPI_NPRIO);
+
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *t = th_alloc();
+    t->base_prio = t->prio = prio;
+    t->stack = guarded ? rpi_stack_alloc_guarded()
+                       : rpi_stack_alloc(stack_nbytes);
+
+    // starts with interrupts off, like any thread coming out of
+    // rpi_cswitch: thread_entry turns them on.
+    rpi_frame_t *f = (rpi_frame_t *)rpi_stack_top(&t->stack) - 1;
+    memset(f, 0, sizeof *f);
+    f->r[0] = (uint32_t)code;           // r4
+    f->r[1] = (uint32_t)arg;            // r5
+    f->r[2] = (uint32_t)thread_entry;   // r6
+    f->pc = (uint32_t)rpi_thread_trampoline;
+    t->saved_sp = (void *)f;
+
+    th_trace("rpi_fork: tid=%d, prio=%d, code=[%p], arg=[%x], stack=%d bytes\n",
+            t->tid, prio, code, arg, t->stack.nbytes);
+    nthreads++;
+    runq_add(t, 0);
+    preempt_check(t);
+    cpsr_int_reset(cpsr);
+    return t;
+}
+
+rpi_thread_t *
+rpi_fork_stack(rpi_code_t code, void *arg, unsigned prio, unsigned stack_nbytes) {
+    return th_fork(code, arg, prio, stack_nbytes, 0);
+}
+
+rpi_thread_t *rpi_fork_guarded(rpi_code_t code, void *arg, unsigned prio) {
+    return th_fork(code, arg, prio, 0, 1);
+}
+
+rpi_thread_t *rpi_fork_prio(rpi_code_t code, void *arg, unsigned prio) {
+    return th_fork(code, arg, prio, RPI_STACK_DEFAULT, 0);
+}
+
+rpi_thread_t *rpi_fork(rpi_code_t code, void *arg) {
+    return rpi_fork_prio(code, arg, RPI_PRIO_DEFAULT);
+}
+
+void rpi_exit(int exitcode) {
+    RZ_CHECK();
+    cpsr_int_disable();
+    rpi_thread_t *t = cur_thread;
+    if(!t || t == scheduler_thread)
+        panic("rpi_exit: not called from a thread\n");
+
+    th_trace("rpi_exit: tid=%d exiting, ran %d usec in %d slices, stack used %d of %d bytes\n",
+        t->tid, (uint32_t)t->run_usec, t->nruns,
+        rpi_stack_highwater(t), t->stack.nbytes);
+    t->state = TH_EXITED;
+    nthreads--;
+    // its VFP registers die with it.
+    if(vfp_owner == &t->vfp)
+        vfp_owner = 0;
+
+    // whatever we still own goes to its best waiter, as if we had
+    // released it: a mutex we die holding is unlocked, not lost.
+    while(t->held)
+        rpi_waitq_handoff(t->held);
+    // we're still on its stack: the next th_alloc or rpi_thread_start
+    // frees it.
+    list_push(&zombies, t);
+    schedule();
+    not_reached();
+}
+
+void rpi_yield(void) {
+    RZ_CHECK();
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *t = runq_highest(), *cur = cur_thread;
+    if(cur && cur != scheduler_thread && t && t->prio >= cur->prio) {
+        runq_add(cur, 0);
+        schedule();
+    }
+    cpsr_int_reset(cpsr);
+}
+
+void rpi_set_prio(unsigned prio) {
+    if(prio >= RPI_NPRIO)
+        panic("priority %d: must be less than %d\n", prio, RPI_NPRIO);
+    uint32_t cpsr = cpsr_int_disable();
+    rpi_thread_t *t = rpi_cur_thread();
+    t->base_prio = prio;
+    prio_update(t);
+    prio_dropped();
+    cpsr_int_reset(cpsr);
+}
+
+static void wheel_interrupt(uint32_t pc, void *arg) {
+    timer_wheel_interrupt();
+}
+
+void rpi_preempt_init(uint32_t usec) {
+    assert(usec >= TIMER_WHEEL_MIN_USEC);
+    irq_init();
+    irq_vector_base_set(rpi_thread_vectors);
+    timer_wheel_init(RPI_THREAD_TIMER_CHAN);
+    // compare register <n> is interrupt source <n>.
+    irq_register(RPI_THREAD_TIMER_CHAN, wheel_interrupt, 0);
+    slice_usec = usec;
+    preempt_p = 1;
+}
+
+// our caller is not a thread: it gets a thread block (so we can
+// switch away from it) but never goes on a run queue.  it runs when
+// no thread can, and waits for an interrupt if some are blocked.
+void rpi_thread_start(void) {
+    RZ_CHECK();
+    th_trace("starting threads!\n");
+    if(!nthreads)
+        goto end;
+
+    uint32_t cpsr = cpsr_int_disable();
+    if(!scheduler_thread)
+        scheduler_thread = th_alloc();
+    cur_thread = scheduler_thread;
+    cur_thread->state = TH_RUNNING;
+    switch_usec = timer_get_usec();
+    // lock hold times (rpi-sync.h) are in cycles.
+    cycle_cnt_init();
+
+    while(nthreads) {
+        if(runq_bits) {
+            schedule();
+            continue;
+        }
+        if(!preempt_p)
+            panic("%d threads blocked with preemption off: deadlock\n", nthreads);
+        // an interrupt that wakes someone switches straight to them.
+        wait_for_interrupt();
+        cpsr_int_enable();
+        cpsr_int_disable();
+    }
+    if(preempt_p)
+        timer_wheel_cancel(&slice_timer);
+    reap();
+    cur_thread = 0;
+    cpsr_int_reset(cpsr);
+end:
+    RZ_CHECK();
+    th_trace("done with all threads, returning\n");
+}
@@ -0,0 +1,253 @@
+// engler,cs140e: preemptive priority threads.
+#ifndef __RPI_THREAD_H__
+#define __RPI_THREAD_H__
+/*
+ * same interface as the cooperative package in ../code-threads plus:
+ *   - priorities: 0 (lowest) .. RPI_NPRIO-1.  the highest-priority
+ *     runnable thread runs; threads of equal priority round-robin.
+ *     each priority has its own run queue and a bitmap says which are
+ *     non-empty, so picking the next thread is one clz.
+ *   - preemption (rpi_preempt_init): a timer interrupt ends a thread's
+ *     time slice, and a thread woken from an interrupt (a sleep
+ *     deadline, a device) runs as soon as the handler returns if it
+ *     has higher priority than whoever was running.
+ *   - wait queues that can name an owner: the owner runs at the
+ *     priority of its highest waiter until it gives the queue up
+ *     (priority inheritance), so a low-priority thread holding
+ *     something a high-priority one needs can't be starved by the
+ *     ones in between.
+ *
+ * without rpi_preempt_init it is the cooperative package: switches
+ * only happen in rpi_yield, rpi_waitq_wait, rpi_exit, etc.
+ *
+ * every switch goes through rpi_cswitch, which saves only what the C
+ * calling convention says a call preserves (see <rpi_frame_t>).  the
+ * interrupt trampoline saves the rest before it calls anything, so a
+ * thread that was preempted is resumed by a yield and the other way
+ * around.
+ *
+ * threads can use the VFP (rpi_vfp_init): by default its registers
+ * are switched lazily, only when a second thread touches it.
+ *
+ * mutexes, condition variables and semaphores are in rpi-sync.h.
+ *
+ * each thread's stack is its own size (rpi_fork_stack), from a pool,
+ * painted so we know how much of it was used (see rpi-stack.h).
+ */
+#include "rpi.h"
+#include "rpi-inline-asm.h"
+#include "timer-wheel.h"
+#include "rpi-stack.h"
+
+enum {
+    RPI_NPRIO = 32,
+    RPI_PRIO_DEFAULT = RPI_NPRIO / 2,
+    // system timer compare register we take for slices and sleeps.
+    RPI_THREAD_TIMER_CHAN = 1,
+};
+
+// what's on top of a thread's stack when it is not running: pushed
+// and popped by rpi_cswitch (rpi-thread-asm.S) with one stm and one
+// ldm.  the caller-saved registers and the cpsr aren't in it: its
+// caller doesn't expect them kept and switches with interrupts off.
+// a thread preempted by an interrupt has the trampoline's frame under
+// this one (r0-r3, r12, lr, then pc and cpsr for rfe).
+typedef struct {
+    uint32_t r[9];      // r4-r12: r12 just keeps sp 8-byte aligned.
+    uint32_t pc;        // where it resumes.
+} rpi_frame_t;
+_Static_assert(sizeof(rpi_frame_t) == 10*4, "frame layout changed");
+
+// the VFP registers a thread owns: s0-s31 (= d0-d15) and the fpscr.
+typedef struct {
+    uint64_t d[16];
+    uint32_t fpscr;
+} rpi_vfp_t;
+
+typedef enum {
+    TH_RUNNABLE = 1,
+    TH_RUNNING,
+    TH_BLOCKED,         // on a wait queue.
+    TH_SLEEPING,        // until a deadline.
+    TH_EXITED,
+} rpi_thread_state_t;
+
+struct rpi_waitq;
+
+typedef struct rpi_thread {
+    // must be first: the asm uses it.
+    uint32_t *saved_sp;
+
+    // run queue or wait queue we are on.
+    struct rpi_thread *next, *prev;
+    uint32_t tid;
+    const char *annot;
+
+    uint8_t base_prio;      // what we were given.
+    uint8_t prio;           // with whatever we inherited.
+    uint8_t state;
+
+    struct rpi_waitq *blocked_on;   // if TH_BLOCKED.
+    struct rpi_waitq *held;         // queues we own.
+    tw_timer_t sleep_timer;
+
+    // accounting: updated on every switch.
+    uint64_t run_usec;      // total time on the cpu.
+    uint32_t nruns;         // times given the cpu (or a new slice).
+    uint32_t npreempted;    // times switched out by an interrupt.
+    uint32_t nexpired;      // slices that ran out.
+    uint32_t nvfp_loads;    // times its VFP registers were loaded.
+
+    rpi_vfp_t vfp;          // saved VFP registers if it doesn't have it.
+
+    // the scheduler thread runs on its caller's stack: 0 here.
+    rpi_stack_t stack;
+} rpi_thread_t;
+_Static_assert(offsetof(rpi_thread_t, saved_sp) == 0,
+                "stack save area must be at offset 0");
+
+// main routines.
+
+// run threads until they have all exited.  with preemption on, this
+// is also the idle loop: it waits for interrupts when everyone is
+// blocked.
+void rpi_thread_start(void);
+
+rpi_thread_t *rpi_cur_thread(void);
+
+typedef void (*rpi_code_t)(void *);
+
+// fork at RPI_PRIO_DEFAULT / at <prio>, with a RPI_STACK_DEFAULT stack.
+rpi_thread_t *rpi_fork(rpi_code_t code, void *arg);
+rpi_thread_t *rpi_fork_prio(rpi_code_t code, void *arg, unsigned prio);
+
+// fork with a stack of at least <stack_nbytes> (0 = the default).
+rpi_thread_t *
+rpi_fork_stack(rpi_code_t code, void *arg, unsigned prio, unsigned stack_nbytes);
+// fork with a guarded stack (rpi_stack_guard_init).
+rpi_thread_t *rpi_fork_guarded(rpi_code_t code, void *arg, unsigned prio);
+
+// how many bytes of its stack <t> has used so far.
+static inline unsigned rpi_stack_highwater(rpi_thread_t *t) {
+    return t->stack.base ? rpi_stack_used(&t->stack) : 0;
+}
+
+// any wait queue we still own is handed to its best waiter
+// (rpi_waitq_handoff): a mutex we exit holding goes to the next locker.
+void rpi_exit(int exitcode);
+
+// let threads of the same or higher priority run.
+void rpi_yield(void);
+
+// change the current thread's priority.
+void rpi_set_prio(unsigned prio);
+
+// turn on preemption with <slice_usec> time slices: takes over the
+// vector table (irq.h) and system timer compare register
+// RPI_THREAD_TIMER_CHAN.  call before rpi_thread_start; register your
+// own handlers with irq_register as usual.
+void rpi_preempt_init(uint32_t slice_usec);
+
+// block until <deadline> (timer_get_usec64 time) or for <usec>.
+// without preemption these yield until the time has passed.
+void rpi_sleep_until(uint64_t deadline);
+void rpi_sleep_us(uint32_t usec);
+
+/***************************************************************
+ * floating point.  the kernel is built soft-float, so only threads
+ * that use VFP instructions themselves (asm, or files built with
+ * -mfpu=vfp -mfloat-abi=softfp) need any of this.  interrupt handlers
+ * must not use it.
+ *
+ *   - RPI_VFP_OFF: any VFP instruction is an undefined instruction.
+ *   - RPI_VFP_LAZY: a switch only turns the VFP off (FPEXC.EN) unless
+ *     the next thread owns it.  the first VFP instruction after that
+ *     traps (undefined instruction), and the handler saves the old
+ *     owner's registers, loads ours and retries it.  switches between
+ *     threads that don't fight over the VFP cost nothing extra.
+ *   - RPI_VFP_EAGER: save and restore on every switch.  the naive way:
+ *     it's here to compare against.
+ *
+ * call before rpi_thread_start.  lazy mode takes over the vector table
+ * (like rpi_preempt_init).
+ */
+typedef enum {
+    RPI_VFP_OFF = 0,
+    RPI_VFP_LAZY,
+    RPI_VFP_EAGER,
+} rpi_vfp_mode_t;
+
+void rpi_vfp_init(rpi_vfp_mode_t mode);
+
+/***************************************************************
+ * wait queues: the piece to build locks, condition variables and
+ * device waits out of.
+ *
+ * waiters are kept highest priority first (fifo within a priority).
+ * to wait for something an interrupt handler does, disable interrupts,
+ * check for it and then rpi_waitq_wait: there's no window for the wakeup to
+ * get lost, and interrupts are back how you had them when it returns.
+ */
+typedef struct rpi_waitq {
+    rpi_thread_t *head, *tail;
+    // who the waiters are waiting on (0 = nobody): it inherits their
+    // priority.
+    rpi_thread_t *owner;
+    struct rpi_waitq *next_held;    // on <owner>'s list.
+} rpi_waitq_t;
+
+#define RPI_WAITQ_INIT ((rpi_waitq_t){0})
+
+// block the current thread on <q> until someone wakes it.
+void rpi_waitq_wait(rpi_waitq_t *q);
+// same, but call <fn>(<arg>) once we're on <q> and before we switch:
+// to give up a lock while waiting (rpi_cond_wait) without a window
+// where a wakeup gets lost.  <fn> may wake threads but not block.
+void rpi_waitq_wait_then(rpi_waitq_t *q, void (*fn)(void *), void *arg);
+// wake the highest-priority waiter: returns it (0 if none).  can be
+// called from interrupt handlers.
+rpi_thread_t *rpi_waitq_wakeup(rpi_waitq_t *q);
+// wake everyone: returns how many.
+unsigned rpi_waitq_wakeup_all(rpi_waitq_t *q);
+// make <t> the owner of <q> (0 to release it): the old owner drops
+// back to whatever else it is holding.
+void rpi_waitq_set_owner(rpi_waitq_t *q, rpi_thread_t *t);
+// pass <q> on: wake its highest-priority waiter and make it the owner
+// in one step (0 = no waiters, <q> now has no owner).
+rpi_thread_t *rpi_waitq_handoff(rpi_waitq_t *q);
+
+/***************************************************************
+ * internal routines.
+ */
+
+// save the current thread's frame, store its sp in <*old_sp_save>
+// and resume the frame at <new_sp>.  interrupts must be off.
+void rpi_cswitch(uint32_t **old_sp_save, const uint32_t *new_sp);
+
+// a new thread's first frame resumes here: calls r6(r4, r5).
+void rpi_thread_trampoline(void);
+
+// called by the interrupt trampoline with the interrupted pc: runs
+// the handlers and switches if they made someone better runnable.
+void rpi_irq_switch(uint32_t pc);
+
+// called by the undefined instruction trampoline with the pc of the
+// instruction: returns to retry it if it was a VFP trap.
+void rpi_undef(uint32_t pc);
+
+// VFP (rpi-thread-asm.S).
+void rpi_vfp_save(rpi_vfp_t *v);
+void rpi_vfp_restore(const rpi_vfp_t *v);
+uint32_t rpi_fpexc_get(void);
+void rpi_fpexc_set(uint32_t fpexc);
+// turn on access to the VFP coprocessors (cp10, cp11 in the cpacr).
+void rpi_vfp_access_on(void);
+
+static inline unsigned rpi_tid(void) {
+    rpi_thread_t *t = rpi_cur_thread();
+    if(!t)
+        panic("rpi_threads not running\n");
+    return t->tid;
+}
+
+#endif
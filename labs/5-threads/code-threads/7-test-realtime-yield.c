@@ -1,6 +1,8 @@
 #include "test-header.h"
 
 // test that we can yield and do a simple realtime thing.
+// (../code-preempt/3-test-realtime-preempt.c does it with preemption
+// and gets a latency bound.)
 struct pwm {
     unsigned duty;  // between 0 and 100
     unsigned pin;
@@ -0,0 +1,151 @@
+// unix side of the optional faster link (../2-pi-side/boot-defs.h
+// and ../2-pi-side/boot-baud.h).   if anything goes wrong at the fast
+// rate we go back to BOOT_BAUD and resync on a single word.
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "put-code.h"
+
+// what we ask for: set by my-install --boot-baud.
+unsigned boot_baud_want = BOOT_BAUD;
+
+// current rate of the link.
+static unsigned boot_baud = BOOT_BAUD;
+
+enum {
+    // must be longer than the pi's BOOT_SYNC_USEC so it's back at
+    // BOOT_BAUD when we resend BAUD_SYNC there.
+    SYNC_USEC       = 500 * 1000,
+    FALLBACK_USEC   = 2 * 1000 * 1000,
+};
+
+// termios speed for <baud> or 0 if this os doesn't have it.
+static speed_t baud_to_speed(unsigned baud) {
+    switch(baud) {
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+#ifdef B500000
+    case 500000: return B500000;
+#endif
+#ifdef B921600
+    case 921600: return B921600;
+#endif
+#ifdef B1000000
+    case 1000000: return B1000000;
+#endif
+#ifdef B1500000
+    case 1500000: return B1500000;
+#endif
+#ifdef B2000000
+    case 2000000: return B2000000;
+#endif
+#ifdef B3000000
+    case 3000000: return B3000000;
+#endif
+    default: return 0;
+    }
+}
+
+int boot_baud_ok(unsigned baud) {
+    return baud_to_speed(baud) != 0;
+}
+
+// change the tty's speed, leaving the rest (and the timeout) alone.
+// if <flush_p> we drop any input: it's junk from the switch.
+static void tty_set_baud(int fd, unsigned baud, int flush_p) {
+    // let what we sent at the old rate get out of the usb-serial
+    // adapter: tcdrain only waits for the kernel's buffer.
+    if(tcdrain(fd) < 0)
+        sys_die(tcdrain, failed);
+    usleep(10*1000);
+
+    struct termios tty;
+    if(tcgetattr(fd, &tty) < 0)
+        sys_die(tcgetattr, failed);
+    if(cfsetspeed(&tty, baud_to_speed(baud)) < 0)
+        sys_die(cfsetspeed, failed);
+    if(tcsetattr(fd, TCSANOW, &tty) < 0)
+        sys_die(tcsetattr, failed);
+    if(flush_p) {
+        tcflush(fd, TCIFLUSH);
+        buf_read_flush(fd);
+    }
+    boot_baud = baud;
+}
+
+// slide a 32-bit window over the input until it is <word>, skipping
+// junk from a rate change.  returns 0 after <usec>.
+static int wait_for_word(int fd, uint32_t word, unsigned usec) {
+    uint32_t w = 0;
+    time_usec_t start = time_get_usec();
+    while(time_get_usec() - start < usec) {
+        uint8_t b;
+        if(buf_read_timeout(fd, &b, 1, 10*1000) != 1)
+            continue;
+        w = w >> 8 | (uint32_t)b << 24;
+        if(w == word)
+            return 1;
+    }
+    return 0;
+}
+
+// call after get_op() returned GET_BAUD.
+void boot_baud_reply(int fd) {
+    unsigned pi_max = get_uint32(fd);
+    unsigned baud = boot_baud_want < pi_max ? boot_baud_want : pi_max;
+    if(!boot_baud_ok(baud)) {
+        output("BOOT: no termios speed for %d baud: staying at %d\n",
+                baud, boot_baud);
+        baud = boot_baud;
+    }
+
+    put_uint32(fd, PUT_BAUD);
+    put_uint32(fd, baud);
+    if(baud == boot_baud)
+        return;
+
+    tty_set_baud(fd, baud, 1);
+    put_uint32(fd, BAUD_SYNC);
+    if(wait_for_word(fd, BAUD_SYNC, SYNC_USEC)) {
+        output("BOOT: switched to %d baud\n", baud);
+        return;
+    }
+
+    // the pi has given up by now: meet it at BOOT_BAUD.
+    output("BOOT: no BAUD_SYNC at %d baud: staying at %d\n", baud, BOOT_BAUD);
+    tty_set_baud(fd, BOOT_BAUD, 1);
+    put_uint32(fd, BAUD_SYNC);
+}
+
+// <op> is what the pi sent after the code instead of BOOT_SUCCESS.
+// if we are at a fast rate it is likely junk from the pi having
+// switched back to BOOT_BAUD after a crc failure: follow it and
+// return the pi's next op (GET_CODE: it wants the code again).
+// otherwise return <op> unchanged.
+uint32_t boot_baud_recover(int fd, uint32_t op) {
+    if(op == BOOT_SUCCESS || op == BOOT_ERROR || boot_baud == BOOT_BAUD)
+        return op;
+
+    output("BOOT: got %x at %d baud: falling back to %d\n",
+            op, boot_baud, BOOT_BAUD);
+    tty_set_baud(fd, BOOT_BAUD, 1);
+    if(!wait_for_word(fd, BAUD_FALLBACK, FALLBACK_USEC))
+        panic("pi never sent BAUD_FALLBACK\n");
+    put_uint32(fd, BAUD_SYNC);
+
+    // the pi may have sent another BAUD_FALLBACK before it saw ours.
+    while((op = get_uint32(fd)) == BAUD_FALLBACK)
+        ;
+    return op;
+}
+
+unsigned boot_baud_current(void) {
+    return boot_baud;
+}
+
+// after BOOT_SUCCESS: the program will talk at BOOT_BAUD.
+void boot_baud_reset(int fd) {
+    if(boot_baud != BOOT_BAUD)
+        tty_set_baud(fd, BOOT_BAUD, 0);
+}
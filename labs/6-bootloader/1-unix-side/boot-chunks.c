@@ -0,0 +1,159 @@
+// unix side of the chunked transfer (../2-pi-side/boot-chunks.h).
+//
+// selective repeat: we keep up to <window> chunks past the oldest
+// unacked one in flight, resend a chunk when the pi NAKs it, and
+// resend the oldest unacked chunk when nothing comes back in time.
+#include <string.h>
+#include "put-code.h"
+#include "boot-crc32.h"
+
+boot_chunk_stats_t boot_chunk_stats;
+
+// 0 = use the window the pi asks for.
+unsigned boot_chunk_window = 0;
+// 0 = from the baud rate.
+unsigned boot_chunk_timeout_usec = 0;
+
+enum {
+    // give up after this many timeouts in a row.
+    MAX_TIMEOUTS = 10,
+};
+
+void boot_chunk_send(int fd, const uint8_t *buf, unsigned n,
+                        unsigned chunk_size, unsigned seq) {
+    unsigned off = seq * chunk_size;
+    assert(off < n);
+    unsigned nb = n - off < chunk_size ? n - off : chunk_size;
+
+    uint32_t crc = crc32_inc(buf + off, nb, crc32(&seq, 4));
+    uint32_t hdr[4] = { CHUNK, seq, nb, crc };
+    write_exact(fd, hdr, sizeof hdr);
+    write_exact(fd, buf + off, nb);
+    boot_chunk_stats.nsent++;
+}
+
+// get the next [op, seq, ~seq] from the pi, where <op> is <op0> or
+// <op1>, sliding over junk.  returns 0 if nothing in <usec>.
+// BOOT_SUCCESS and BOOT_ERROR come back with no seq.
+//
+// we check the last 12 bytes after every byte rather than committing
+// to an op once we see one: if a byte of an ack got dropped, the
+// BOOT_SUCCESS right after it still shows up.
+int boot_get_reply(int fd, uint32_t op0, uint32_t op1,
+                    uint32_t *op, uint32_t *seq, unsigned usec) {
+    time_usec_t start = time_get_usec();
+    // oldest to newest.
+    uint32_t w0 = 0, w1 = 0, w2 = 0;
+
+    while(time_get_usec() - start < usec) {
+        uint8_t b;
+        // can_read_timeout needs < 1sec.
+        if(buf_read_timeout(fd, &b, 1, 10*1000) != 1)
+            continue;
+        w0 = w0 >> 8 | w1 << 24;
+        w1 = w1 >> 8 | w2 << 24;
+        w2 = w2 >> 8 | (uint32_t)b << 24;
+
+        if(w2 == BOOT_SUCCESS || w2 == BOOT_ERROR) {
+            *op = w2;
+            return 1;
+        }
+        if((w0 == op0 || w0 == op1) && w2 == ~w1) {
+            *op = w0;
+            *seq = w1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// how long to wait for a reply: the time to send a window's worth,
+// plus slop for usb.  has to stay under the pi's timeout
+// (BOOT_CHUNK_TIMEOUT_USEC: 2 sec) or the pi gives up first: at
+// 115200 it's ~0.8 sec.
+static unsigned reply_usec(unsigned chunk_size, unsigned window) {
+    if(boot_chunk_timeout_usec)
+        return boot_chunk_timeout_usec;
+    unsigned bytes = window * (chunk_size + 16);
+    unsigned long usec = bytes * 10ULL * 1000 * 1000 / boot_baud_current();
+    return usec + 100*1000;
+}
+
+uint32_t boot_put_chunks(int fd, const uint8_t *buf, unsigned n) {
+    uint32_t cksum      = get_uint32(fd);
+    uint32_t chunk_size = get_uint32(fd);
+    uint32_t window     = get_uint32(fd);
+    uint32_t have       = get_uint32(fd);
+    uint32_t have_crc   = get_uint32(fd);
+
+    if(cksum != crc32(buf, n))
+        panic("GET_CHUNKS: pi has crc %x, we sent %x\n", cksum, crc32(buf,n));
+    if(!chunk_size || !window)
+        panic("GET_CHUNKS: bad chunk size %d or window %d\n", chunk_size, window);
+    if(boot_chunk_window && boot_chunk_window < window)
+        window = boot_chunk_window;
+
+    // resume if the pi's prefix is the start of our program.
+    unsigned start = 0;
+    if(have && have <= n && crc32(buf, have) == have_crc) {
+        start = have;
+        output("BOOT: pi already has %d bytes: resuming\n", have);
+    }
+    boot_chunk_stats.resume_off = start;
+    put_uint32(fd, PUT_CHUNKS);
+    put_uint32(fd, start);
+
+    unsigned nchunks = (n + chunk_size - 1) / chunk_size;
+    uint8_t *acked = calloc(nchunks + 1, 1);
+    unsigned base = 0;      // oldest unacked.
+    for(; base < nchunks && base * chunk_size < start; base++)
+        acked[base] = 1;
+    unsigned next = base;   // next never sent.
+    unsigned nacked = base;
+    unsigned ntimeouts = 0;
+    unsigned usec = reply_usec(chunk_size, window);
+
+    uint32_t op = 0;
+    while(nacked < nchunks) {
+        while(next < nchunks && next - base < window)
+            boot_chunk_send(fd, buf, n, chunk_size, next++);
+
+        uint32_t seq = 0;
+        if(!boot_get_reply(fd, CHUNK_ACK, CHUNK_NAK, &op, &seq, usec)) {
+            if(++ntimeouts > MAX_TIMEOUTS)
+                panic("pi stopped answering: %d of %d chunks acked\n",
+                        nacked, nchunks);
+            boot_chunk_stats.ntimeout++;
+            boot_chunk_stats.nresent++;
+            boot_chunk_send(fd, buf, n, chunk_size, base);
+            continue;
+        }
+        ntimeouts = 0;
+
+        switch(op) {
+        // our last acks got lost but the pi finished.
+        case BOOT_SUCCESS:
+        case BOOT_ERROR:
+            goto done;
+        case CHUNK_ACK:
+            if(seq < nchunks && !acked[seq]) {
+                acked[seq] = 1;
+                nacked++;
+            }
+            while(base < nchunks && acked[base])
+                base++;
+            break;
+        case CHUNK_NAK:
+            if(seq < next && !acked[seq]) {
+                boot_chunk_stats.nnak++;
+                boot_chunk_stats.nresent++;
+                boot_chunk_send(fd, buf, n, chunk_size, seq);
+            }
+            break;
+        }
+    }
+    op = 0;
+done:
+    free(acked);
+    return op;
+}
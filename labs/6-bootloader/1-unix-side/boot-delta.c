@@ -0,0 +1,213 @@
+// unix side of the compressed, delta transfer
+// (../2-pi-side/boot-delta.h).
+//
+// the pi tells us the crc of each block of the image it booted last.
+// any block of ours with the same crc (and size) we send as a copy of
+// that block; the rest we lz4 compress, or send as-is if that doesn't
+// make them smaller.  we work out every block before the pi asks so
+// it never waits on the compressor.
+#include <string.h>
+#include "put-code.h"
+#include "boot-crc32.h"
+
+boot_delta_stats_t boot_delta_stats;
+
+enum {
+    // the pi re-asks after its timeout (boot-chunks.h: 2 sec), so if
+    // nothing shows up in this long it's gone.
+    DELTA_TIMEOUT_USEC = 5*1000*1000,
+
+    LZ_MIN          = 4,        // shortest match lz4 can encode.
+    LZ_WINDOW       = 65535,    // farthest back a match can point.
+    LZ_HASH_BITS    = 12,
+};
+
+/**********************************************************************
+ * lz4 block format: a sequence is
+ *   [token, <more literal len>, <literals>, offset:16, <more match len>]
+ * where the token's high nibble is the literal count and its low nibble
+ * the match length - 4, 15 in either meaning "add the bytes that
+ * follow, until one isn't 255".  the last sequence is only literals.
+ */
+
+static unsigned lz_hash(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t *lz_len(uint8_t *o, unsigned len) {
+    for(; len >= 255; len -= 255)
+        *o++ = 255;
+    *o++ = len;
+    return o;
+}
+
+// emit <nlit> literals and then a <mlen> match <moff> back (mlen = 0
+// for the last sequence).  returns 0 if it won't fit before <oe>.
+static uint8_t *lz_seq(uint8_t *o, uint8_t *oe, const uint8_t *lit,
+                        unsigned nlit, unsigned moff, unsigned mlen) {
+    if(oe - o < 1 + nlit/255 + 1 + nlit + 2 + mlen/255 + 1)
+        return 0;
+
+    unsigned ml = mlen ? mlen - LZ_MIN : 0;
+    *o++ = (nlit < 15 ? nlit : 15) << 4 | (ml < 15 ? ml : 15);
+    if(nlit >= 15)
+        o = lz_len(o, nlit - 15);
+    memcpy(o, lit, nlit);
+    o += nlit;
+
+    if(!mlen)
+        return o;
+    *o++ = moff;
+    *o++ = moff >> 8;
+    if(ml >= 15)
+        o = lz_len(o, ml - 15);
+    return o;
+}
+
+// greedy: take the most recent earlier spot with the same 4 bytes.
+unsigned boot_lz_compress(uint8_t *out, unsigned outn,
+                    const uint8_t *buf, unsigned off, unsigned n) {
+    int head[1 << LZ_HASH_BITS];
+    memset(head, -1, sizeof head);
+
+    unsigned end = off + n;
+    // what's before <off> is already on the pi.
+    for(unsigned p = off > LZ_WINDOW ? off - LZ_WINDOW : 0; p < off; p++)
+        if(p + LZ_MIN <= end)
+            head[lz_hash(buf + p)] = p;
+
+    uint8_t *o = out, *oe = out + outn;
+    unsigned p = off, lit = off;
+    while(p + LZ_MIN <= end) {
+        unsigned h = lz_hash(buf + p);
+        int c = head[h];
+        head[h] = p;
+        if(c < 0 || p - c > LZ_WINDOW || memcmp(buf + c, buf + p, LZ_MIN)) {
+            p++;
+            continue;
+        }
+
+        unsigned len = LZ_MIN;
+        while(p + len < end && buf[c + len] == buf[p + len])
+            len++;
+        if(!(o = lz_seq(o, oe, buf + lit, p - lit, p - c, len)))
+            return 0;
+        for(unsigned q = p + 1; q < p + len && q + LZ_MIN <= end; q++)
+            head[lz_hash(buf + q)] = q;
+        p += len;
+        lit = p;
+    }
+    if(!(o = lz_seq(o, oe, buf + lit, end - lit, 0, 0)))
+        return 0;
+    return o - out;
+}
+
+/**********************************************************************
+ * the transfer.
+ */
+
+// what we send for one block.
+typedef struct {
+    uint32_t how, arg, crc;
+    const uint8_t *data;
+    unsigned ndata;
+} delta_rec_t;
+
+static unsigned block_len(unsigned n, unsigned bsize, unsigned i) {
+    unsigned off = i * bsize;
+    return n - off < bsize ? n - off : bsize;
+}
+
+// a block of the pi's last image that's the same as ours, or -1.
+// the same spot is the common case so try it first.
+static int
+find_copy(uint32_t *have_crc, unsigned have, unsigned bsize,
+                unsigned i, unsigned len, uint32_t crc) {
+    unsigned nhave = (have + bsize - 1) / bsize;
+    if(i < nhave && have_crc[i] == crc && block_len(have, bsize, i) == len)
+        return i;
+    for(unsigned j = 0; j < nhave; j++)
+        if(have_crc[j] == crc && block_len(have, bsize, j) == len)
+            return j;
+    return -1;
+}
+
+uint32_t boot_put_delta(int fd, const uint8_t *buf, unsigned n) {
+    uint32_t cksum = get_uint32(fd);
+    uint32_t bsize = get_uint32(fd);
+    uint32_t have  = get_uint32(fd);
+
+    if(cksum != crc32(buf, n))
+        panic("GET_DELTA: pi has crc %x, we sent %x\n", cksum, crc32(buf,n));
+    if(!bsize || bsize > 64*1024)
+        panic("GET_DELTA: bad block size %d\n", bsize);
+
+    unsigned nhave = (have + bsize - 1) / bsize;
+    uint32_t *have_crc = calloc(nhave + 1, sizeof *have_crc);
+    for(unsigned j = 0; j < nhave; j++)
+        have_crc[j] = get_uint32(fd);
+
+    unsigned nblocks = (n + bsize - 1) / bsize;
+    delta_rec_t *recs = calloc(nblocks + 1, sizeof *recs);
+    uint8_t *lz = malloc(n + 1);
+    uint8_t *lz_end = lz;
+
+    boot_delta_stats = (boot_delta_stats_t){};
+    boot_delta_stats_t *s = &boot_delta_stats;
+    for(unsigned i = 0; i < nblocks; i++) {
+        delta_rec_t *r = &recs[i];
+        unsigned off = i * bsize;
+        unsigned len = block_len(n, bsize, i);
+        r->crc = crc32_inc(buf + off, len, crc32(&i, 4));
+
+        int j = find_copy(have_crc, have, bsize, i, len, crc32(buf + off, len));
+        unsigned k;
+        if(j >= 0) {
+            r->how = DELTA_COPY;
+            r->arg = j;
+            s->ncopy++;
+        // has to be smaller than the block to be worth it.
+        } else if((k = boot_lz_compress(lz_end, len - 1, buf, off, len))) {
+            r->how = DELTA_LZ;
+            r->arg = r->ndata = k;
+            r->data = lz_end;
+            lz_end += k;
+            s->nlz++;
+        } else {
+            r->how = DELTA_RAW;
+            r->arg = r->ndata = len;
+            r->data = buf + off;
+            s->nraw++;
+        }
+        s->nbytes += 5*4 + r->ndata;
+    }
+    output("BOOT: delta: pi has %d of %d blocks, sending %d bytes for %d\n",
+        s->ncopy, nblocks, s->nbytes, n);
+
+    uint32_t op, i, last = ~0;
+    while(1) {
+        if(!boot_get_reply(fd, DELTA_GET_BLOCK, DELTA_GET_BLOCK, &op, &i,
+                                                DELTA_TIMEOUT_USEC))
+            panic("pi stopped asking for blocks\n");
+        if(op != DELTA_GET_BLOCK)
+            break;
+        if(i >= nblocks)
+            panic("pi asked for block %d of %d\n", i, nblocks);
+        if(i == last)
+            s->nresent++;
+        last = i;
+
+        delta_rec_t *r = &recs[i];
+        uint32_t hdr[5] = { DELTA_BLOCK, i, r->how, r->arg, r->crc };
+        write_exact(fd, hdr, sizeof hdr);
+        if(r->ndata)
+            write_exact(fd, r->data, r->ndata);
+    }
+
+    free(lz);
+    free(recs);
+    free(have_crc);
+    return op;
+}
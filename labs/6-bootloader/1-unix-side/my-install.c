@@ -31,7 +31,7 @@ static void usage(const char *msg, ...) {
     vfprintf(stderr, msg, args);
     va_end(args);
 
-    output("\nusage: %s [--trace-all] [--trace-control] [--baud <rate>] [--addr <addr>] ([device] | [--last] | [--first] [--device <device>]) <pi-program>\n", progname);
+    output("\nusage: %s [--trace-all] [--trace-control] [--baud <rate>] [--boot-baud <rate>] [--addr <addr>] [--binlog] [--gprof] ([device] | [--last] | [--first] [--device <device>]) <pi-program>\n", progname);
     output("    pi-program = has a '.bin' suffix\n");
     output("    specify a device using any method:\n");
     output("        <device>: has a '/dev' prefix\n");
@@ -39,9 +39,12 @@ static void usage(const char *msg, ...) {
     output("        --first: gets the first serial device mounted\n");
     output("        --device <device>: manually specify <device>\n");
     output("    --baud <baud_rate>: manually specify baud_rate\n");
+    output("    --boot-baud <baud_rate>: send the program at up to <baud_rate> (e.g., 1000000)\n");
     output("    --addr <addr>: set load/jump address (e.g., 0x8000)\n");
     output("    --trace-all: trace all put/get between rpi and unix side\n");
     output("    --trace-control: trace only control [no data] messages\n");
+    output("    --binlog: decode the pi's binlog records using <pi-program>'s .elf\n");
+    output("    --gprof: report the pi's gprof_dump using <pi-program>'s .elf\n");
     exit(1);
 }
 
@@ -87,6 +90,11 @@ int main(int argc, char *argv[]) {
     // used to pass the file descriptor to another program.
     char **exec_argv = 0;
 
+    // decode binlog records (libpi/include/binlog.h) in the output.
+    int binlog_p = 0;
+    // report profiles (libpi/include/gprof.h) when the pi is done.
+    int gprof_p = 0;
+
     // a good extension challenge: tune timeout and baud rate transmission
     //
     // on linux, baud rates are defined in:
@@ -130,6 +138,13 @@ int main(int argc, char *argv[]) {
             if(!argv[i])
                 usage("missing argument to --baud\n");
             baud_rate = parse_baud_or_die(argv[i]);
+        } else if(strcmp(argv[i], "--boot-baud") == 0) {
+            i++;
+            if(!argv[i])
+                usage("missing argument to --boot-baud\n");
+            boot_baud_want = parse_ul_or_die(argv[i], "--boot-baud");
+            if(!boot_baud_ok(boot_baud_want))
+                usage("--boot-baud: unsupported rate <%s>\n", argv[i]);
         } else if(strcmp(argv[i], "--addr") == 0) {
             i++;
             if(!argv[i])
@@ -137,6 +152,10 @@ int main(int argc, char *argv[]) {
             boot_addr = parse_ul_or_die(argv[i], "--addr");
             if(boot_addr == 0 || boot_addr >= (512u * 1024u * 1024u))
                 usage("--addr has invalid address: %x\n", boot_addr);
+        } else if(strcmp(argv[i], "--binlog") == 0) {
+            binlog_p = 1;
+        } else if(strcmp(argv[i], "--gprof") == 0) {
+            gprof_p = 1;
         } else if(strcmp(argv[i], "--exec") == 0) {
             i++;
             if(!argv[i])
@@ -192,7 +211,17 @@ int main(int argc, char *argv[]) {
     simple_boot(fd, boot_addr, code, nbytes);
 
     // 5. echo output from pi
-    if(!exec_argv)
+    if(binlog_p) {
+        // the format strings are in the .elf next to the .bin
+        char *elf = strdupf("%.*s.elf", (int)strlen(pi_prog) - 4, pi_prog);
+        pi_binlog_cat(fd, dev_name, elf);
+    } else if(gprof_p) {
+        // symbols from the .elf; folded stacks go next to it.
+        int n = strlen(pi_prog) - 4;
+        char *elf = strdupf("%.*s.elf", n, pi_prog);
+        char *folded = strdupf("%.*s.folded", n, pi_prog);
+        pi_gprof_cat(fd, dev_name, elf, folded);
+    } else if(!exec_argv)
         pi_echo(0, fd, dev_name);
     else {
         todo("not handling exec_argv");
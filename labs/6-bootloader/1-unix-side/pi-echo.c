@@ -55,9 +55,12 @@ void pi_echo(int unix_fd, int pi_fd, const char *portname) {
             write_exact(pi_fd, buf, n);
         }
 
-        if(!can_read_timeout(pi_fd, 1000))
-            continue;
-        n = read(pi_fd, buf, sizeof buf - 1);
+        // what the bootloader read ahead (buf-read.c) comes first.
+        if(!(n = buf_read_drain(pi_fd, buf, sizeof buf - 1))) {
+            if(!can_read_timeout(pi_fd, 1000))
+                continue;
+            n = read(pi_fd, buf, sizeof buf - 1);
+        }
 
         if(!n) {
             // this isn't the program's fault.  so we exit(0).
@@ -24,37 +24,36 @@
 void put_uint8(int fd, uint8_t b)   { write_exact(fd, &b, 1); }
 void put_uint32(int fd, uint32_t u) { write_exact(fd, &u, 4); }
 
+// read exactly <n> bytes.  buf_read (libunix/buf-read.c) does one 
+// read() system call for everything that has shown up and hands the 
+// rest out of a buffer: a read() per byte is most of our cpu time.
+static void get_exact(int fd, void *data, unsigned n) {
+    for(uint8_t *p = data; n; ) {
+        int res;
+        if((res = buf_read(fd, p, n)) < 0) 
+            die("my-install: tty-USB read() returned error=%d (%s): disconnected?\n", res, strerror(res));
+        if(res == 0)
+            die("my-install: tty-USB read() returned 0 bytes.  r/pi not responding [reboot it?]\n");
+        p += res;
+        n -= res;
+    }
+}
+
 uint8_t get_uint8(int fd) {
     uint8_t b;
-
-    int res;
-    if((res = read(fd, &b, 1)) < 0) 
-        die("my-install: tty-USB read() returned error=%d (%s): disconnected?\n", res, strerror(res));
-    if(res == 0)
-        die("my-install: tty-USB read() returned 0 bytes.  r/pi not responding [reboot it?]\n");
-
-    // impossible for anything else.
-    assert(res == 1);
+    get_exact(fd, &b, 1);
     return b;
 }
 
-// we do 4 distinct get_uint8's b/c the bytes get dribbled back to 
-// use one at a time --- when we try to read 4 bytes at once it will
-// fail.
+// the bytes get dribbled back to us one at a time, so a single read
+// of 4 can come up short: <get_exact> keeps going until it has them.
 //
-// note: the other way to do is to assign these to a char array b and 
-//  return *(unsigned)b
-// however, the compiler doesn't have to align b to what unsigned 
-// requires, so this can go awry.  easier to just do the simple way.
-// we do with |= to force get_byte to get called in the right order 
-//  (get_byte(fd) | get_byte(fd) << 8 ...) 
-// isn't guaranteed to be called in that order b/c '|' is not a seq point.
+// note: we read into a uint32_t rather than a char array b and 
+// returning *(unsigned)b since the compiler doesn't have to align b 
+// to what unsigned requires.   (little-endian only.)
 uint32_t get_uint32(int fd) {
     uint32_t u;
-    u  = get_uint8(fd);
-    u |= (uint32_t)get_uint8(fd) << 8;
-    u |= (uint32_t)get_uint8(fd) << 16;
-    u |= (uint32_t)get_uint8(fd) << 24;
+    get_exact(fd, &u, 4);
     return u;
 }
 
@@ -175,7 +174,7 @@ boot_check(int fd, const char *msg, unsigned exp, unsigned got) {
     // after error: just echo the pi output so we can kind of see what is going
     // on.   <TRACE_FD> is used later.
     unsigned char b;
-    while(fd != TRACE_FD && read(fd, &b, 1) == 1) {
+    while(fd != TRACE_FD && buf_read(fd, &b, 1) == 1) {
         // fputc(b, stderr);
         fprintf(stderr, "%c [%d]", b,b);
     }
@@ -203,6 +202,7 @@ void simple_boot(int fd, uint32_t boot_addr, const uint8_t *buf, unsigned n) {
     // is busted.
     trace("simple_boot: sending %d bytes, crc32=%x\n", n, crc32(buf,n));
     boot_output("waiting for a start\n");
+    io_stats_reset();
 
     // NOTE: only call <get_op> to assign to the <op> var.
     uint32_t op;
@@ -239,14 +239,30 @@ void simple_boot(int fd, uint32_t boot_addr, const uint8_t *buf, unsigned n) {
     // 2. drain any extra GET_PROG_INFOS
     todo("drain any extra GET_PROG_INFOS");
 
+    // 2b. the pi asks if we want a faster link: if <op> is GET_BAUD,
+    //     call <boot_baud_reply(fd)> (boot-baud.c) and then get the 
+    //     next op as usual.
+
     // 3. check that we received a GET_CODE
+    //
+    //    (if you did the chunked pi side, the pi sends GET_CHUNKS 
+    //    instead: call <boot_put_chunks(fd, buf, n)> (boot-chunks.c)
+    //    in place of steps 3 and 4.  for the delta one it sends 
+    //    GET_DELTA: call <boot_put_delta(fd, buf, n)> (boot-delta.c),
+    //    which returns the op for step 5.)
     todo("check that we received a GET_CODE");
 
     // 4. handle it: send a PUT_CODE + the code.
     todo("send PUT_CODE + the code in <buf>");
 
-    // 5. Wait for BOOT_SUCCESS
+    // 5. Wait for BOOT_SUCCESS.  if the crc failed at a fast baud 
+    //    rate the pi goes back to 115200 and asks for the code again: 
+    //    pass what you got to <boot_baud_recover(fd,op)> and if it 
+    //    returns GET_CODE go back to step 3.
     todo("wait for BOOT_SUCCESS");
 
-    boot_output("bootloader: Done.\n");
+    // the pi program talks at 115200.
+    boot_baud_reset(fd);
+    boot_output("bootloader: Done: %d bytes/sec, %d bytes in %d read() calls.\n",
+        io_stats_bps(), (unsigned)io_stats.nrx, io_stats.nreads);
 }
@@ -26,4 +26,55 @@ extern int trace_p;
 // <addr> = pi address to put the code at [buf, buf+n).
 void simple_boot(int fd, uint32_t addr, const uint8_t *buf, unsigned n);
 
+// boot-baud.c: optional faster link (see ../2-pi-side/boot-baud.h)
+extern unsigned boot_baud_want;     // set by my-install --boot-baud
+int boot_baud_ok(unsigned baud);
+void boot_baud_reply(int fd);
+uint32_t boot_baud_recover(int fd, uint32_t op);
+void boot_baud_reset(int fd);
+unsigned boot_baud_current(void);
+
+// boot-chunks.c: chunked transfer (see ../2-pi-side/boot-chunks.h)
+typedef struct {
+    unsigned nsent;         // chunks sent, counting resends.
+    unsigned nresent;       // resends (NAK or timeout).
+    unsigned nnak;          // NAKs from the pi.
+    unsigned ntimeout;      // times nothing came back in time.
+    unsigned resume_off;    // byte offset we started at.
+} boot_chunk_stats_t;
+extern boot_chunk_stats_t boot_chunk_stats;
+extern unsigned boot_chunk_window;  // 0 = what the pi asks for.
+extern unsigned boot_chunk_timeout_usec; // 0 = from the baud rate.
+
+// call after get_op() returned GET_CHUNKS.  returns 0 once the pi has
+// acked every chunk (get BOOT_SUCCESS as usual), or BOOT_SUCCESS or 
+// BOOT_ERROR if the pi sent it in place of an ack.
+uint32_t boot_put_chunks(int fd, const uint8_t *buf, unsigned n);
+// send chunk <seq> of <buf>.
+void boot_chunk_send(int fd, const uint8_t *buf, unsigned n,
+                        unsigned chunk_size, unsigned seq);
+// wait up to <usec> for [op0 or op1, seq, ~seq], BOOT_SUCCESS or
+// BOOT_ERROR from the pi, skipping junk.  0 = nothing came.
+int boot_get_reply(int fd, uint32_t op0, uint32_t op1,
+                    uint32_t *op, uint32_t *seq, unsigned usec);
+
+// boot-delta.c: compressed + delta transfer (../2-pi-side/boot-delta.h)
+typedef struct {
+    unsigned ncopy;         // blocks the pi already had.
+    unsigned nlz;           // blocks sent compressed.
+    unsigned nraw;          // blocks sent as-is (didn't compress).
+    unsigned nbytes;        // bytes sent for the blocks.
+    unsigned nresent;       // blocks the pi asked for again.
+} boot_delta_stats_t;
+extern boot_delta_stats_t boot_delta_stats;
+
+// call after get_op() returned GET_DELTA.  returns BOOT_SUCCESS or
+// BOOT_ERROR, whichever the pi sent after the last block.
+uint32_t boot_put_delta(int fd, const uint8_t *buf, unsigned n);
+// lz4-compress (block format) buf[off, off+n) into <out>; matches can
+// go back to the start of <buf>.  returns the size, or 0 if it needs
+// more than <outn> bytes.
+unsigned boot_lz_compress(uint8_t *out, unsigned outn,
+                    const uint8_t *buf, unsigned off, unsigned n);
+
 #endif
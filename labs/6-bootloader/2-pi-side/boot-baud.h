@@ -0,0 +1,114 @@
+// optional faster link for the bootloader: after the pi has the
+// program info it asks unix what rate to switch to (see boot-defs.h
+// for the messages).   at 115200 a 1MB program takes ~90 seconds; at
+// 1M baud about 10.
+//
+// like get-code.h, the file that includes this must provide:
+//   int boot_uart_set_baud(uint32_t baud): switch the uart to <baud>
+//      (anything in flight is lost).  return 0 (and don't change
+//      anything) if the uart can't do <baud> closely enough.
+//   uint32_t boot_uart_max_baud(void): fastest rate we'll accept.
+//   void boot_flush_tx(void): wait until all output has left.
+// along with boot_get8/boot_put8/boot_has_data.
+//
+// the rule that keeps this simple: whenever anything goes wrong at
+// a fast rate both sides go back to BOOT_BAUD and resync by looking
+// for a single agreed-on word.
+#ifndef __BOOT_BAUD_H__
+#define __BOOT_BAUD_H__
+#include "boot-defs.h"
+
+enum {
+    // how long the pi waits for unix's BAUD_SYNC at the new rate.
+    // unix has to wait longer than this before it gives up (so that
+    // the pi is back at BOOT_BAUD when unix resends it).
+    BOOT_SYNC_USEC      = 200 * 1000,
+    // how often the pi repeats BAUD_FALLBACK until unix answers.
+    BOOT_FALLBACK_USEC  = 100 * 1000,
+};
+
+// current rate of the link.
+static uint32_t boot_baud = BOOT_BAUD;
+
+static inline void boot_baud_switch(uint32_t baud) {
+    boot_flush_tx();
+    if(!boot_uart_set_baud(baud))
+        boot_err(BOOT_ERROR, "boot_baud_switch: uart refused a rate it accepted before\n");
+    boot_baud = baud;
+}
+
+// slide a 32-bit window over the input until it equals BAUD_SYNC.
+// this skips any garbage from the switch, no matter its length.
+// returns 0 if <usec> passes first (<usec> = 0: wait forever).
+// <w> is the window so callers can resume a search.
+static inline int boot_baud_sync(uint32_t *w, uint32_t usec) {
+    uint32_t start = timer_get_usec();
+    while(*w != BAUD_SYNC) {
+        if(boot_has_data())
+            *w = *w >> 8 | (uint32_t)boot_get8() << 24;
+        else if(usec && timer_get_usec() - start >= usec)
+            return 0;
+    }
+    return 1;
+}
+
+// call after receiving PUT_PROG_INFO and before sending GET_CODE.
+// returns the rate we ended up at.
+static inline uint32_t boot_baud_negotiate(void) {
+    uint32_t max = boot_uart_max_baud();
+    boot_put32(GET_BAUD);
+    boot_put32(max);
+
+    if(boot_get32() != PUT_BAUD)
+        boot_err(BOOT_ERROR, "boot_baud_negotiate: expected PUT_BAUD\n");
+    uint32_t baud = boot_get32();
+    if(baud == boot_baud)
+        return boot_baud;
+
+    // unix switched right after sending PUT_BAUD; so do we.
+    uint32_t w = 0;
+    if(baud <= max && boot_uart_set_baud(baud)) {
+        boot_baud = baud;
+        if(boot_baud_sync(&w, BOOT_SYNC_USEC)) {
+            boot_put32(BAUD_SYNC);
+            return boot_baud;
+        }
+        boot_baud_switch(BOOT_BAUD);
+    }
+
+    // it didn't work (or we can't do <baud>): unix will give up too
+    // and send BAUD_SYNC at BOOT_BAUD.
+    w = 0;
+    boot_baud_sync(&w, 0);
+    return boot_baud;
+}
+
+// call when the code's crc is wrong.  if we are at a fast rate, go
+// back to BOOT_BAUD and get unix to do the same: returns 1 and the
+// caller should send GET_CODE again.   returns 0 if we were already
+// at BOOT_BAUD (a real error).
+static inline int boot_baud_fallback(void) {
+    if(boot_baud == BOOT_BAUD)
+        return 0;
+    boot_baud_switch(BOOT_BAUD);
+
+    // unix is still listening at the fast rate, so it sees junk
+    // until it falls back: keep saying it until we hear BAUD_SYNC.
+    uint32_t w = 0;
+    do {
+        boot_put32(BAUD_FALLBACK);
+    } while(!boot_baud_sync(&w, BOOT_FALLBACK_USEC));
+    return 1;
+}
+
+// call after BOOT_SUCCESS, before jumping to the program: it expects
+// the uart at BOOT_BAUD.   the delay gives unix time to switch back
+// before the program prints.
+static inline void boot_baud_done(void) {
+    if(boot_baud == BOOT_BAUD)
+        return;
+    boot_baud_switch(BOOT_BAUD);
+    delay_ms(20);
+}
+
+#endif
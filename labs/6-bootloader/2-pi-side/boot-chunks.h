@@ -0,0 +1,208 @@
+// chunked, windowed code transfer: replaces steps 4-6 of get_code
+// ([GET_CODE, cksum], [PUT_CODE, <code>], check the crc) so that an
+// error costs one chunk instead of the whole program.  see boot-defs.h
+// for the messages.
+//
+// we write each chunk straight to where it goes, so the pi needs no
+// buffer and can take chunks in any order: unix keeps up to <window>
+// outstanding and resends just the ones that get NAK'd or time out.
+//
+// resume: if unix goes quiet mid-transfer (ctrl-c, cable) we return 0
+// and remember the longest prefix we have.  the next GET_CHUNKS
+// reports its size and crc; if unix's program starts the same it
+// starts from there.  (this only works while the bootloader keeps
+// running: a reboot reloads kernel.img over the load area.)
+//
+// needs what get-code.h needs plus crc32_inc and timer_get_usec;
+// include after boot-baud.h.
+#ifndef __BOOT_CHUNKS_H__
+#define __BOOT_CHUNKS_H__
+#include "boot-defs.h"
+
+enum {
+    BOOT_CHUNK_SIZE     = 1024,
+    BOOT_CHUNK_WINDOW   = 8,
+    BOOT_CHUNK_MAX      = 8192,     // so at most 8MB.
+    // we crc as the bytes arrive, this many at a time, so we never
+    // fall far enough behind for the 8-byte rx FIFO to overflow.
+    BOOT_CHUNK_CRC_STEP = 64,
+};
+
+// how long we wait for a byte before deciding unix is gone.  unix
+// resends well before this.
+#ifndef BOOT_CHUNK_TIMEOUT_USEC
+#   define BOOT_CHUNK_TIMEOUT_USEC (2*1000*1000)
+#endif
+
+// pi address to pointer: the unix tests (../tests-pty) override it.
+#ifndef boot_addr_to_ptr
+#   define boot_addr_to_ptr(addr) ((uint8_t *)(addr))
+#endif
+
+// survives across get_code calls (not reboots).
+static struct {
+    uint32_t addr;      // where the prefix is.
+    uint32_t nhave;     // how many bytes at <addr> we know are good.
+} boot_resume;
+
+// bit <i> set = chunk <i> is in place.
+static uint32_t boot_chunk_bits[BOOT_CHUNK_MAX / 32];
+
+static inline int boot_chunk_has(uint32_t i) {
+    return (boot_chunk_bits[i / 32] >> (i % 32)) & 1;
+}
+static inline void boot_chunk_set(uint32_t i) {
+    boot_chunk_bits[i / 32] |= 1 << (i % 32);
+}
+
+// read <n> bytes, giving up if nothing shows up for
+// BOOT_CHUNK_TIMEOUT_USEC.  returns 0 if we gave up.
+static inline int boot_getn_timeout(void *data, uint32_t n) {
+    uint8_t *p = data;
+    for(uint32_t i = 0; i < n; ) {
+        if(!boot_has_data()) {
+            uint32_t start = timer_get_usec();
+            while(!boot_has_data())
+                if(timer_get_usec() - start >= BOOT_CHUNK_TIMEOUT_USEC)
+                    return 0;
+        }
+        i += boot_get_burst(p + i, n - i);
+    }
+    boot_xfer_rx(n);
+    return 1;
+}
+
+static inline int boot_get8_timeout(uint8_t *b) {
+    return boot_getn_timeout(b, 1);
+}
+
+static inline int boot_get32_timeout(uint32_t *u) {
+    return boot_getn_timeout(u, 4);
+}
+
+// unix went quiet: remember the prefix we have for next time.
+static inline int boot_chunks_stop(uint32_t nbytes) {
+    uint32_t i = 0;
+    while(i < BOOT_CHUNK_MAX && boot_chunk_has(i))
+        i++;
+    uint32_t n = i * BOOT_CHUNK_SIZE;
+    boot_resume.nhave = n < nbytes ? n : nbytes;
+
+    // the next my-install starts at BOOT_BAUD (boot-baud.h).
+    if(boot_baud != BOOT_BAUD)
+        boot_baud_switch(BOOT_BAUD);
+    return 0;
+}
+
+// read chunk <seq>'s data into <p>; *ok = 1 if its crc is <crc>.
+// returns 0 on timeout.
+static inline int
+boot_chunk_read(uint32_t seq, uint8_t *p, uint32_t n, uint32_t crc, int *ok) {
+    uint32_t c = crc32(&seq, 4);
+    for(uint32_t i = 0; i < n; ) {
+        uint32_t e = i + BOOT_CHUNK_CRC_STEP;
+        if(e > n)
+            e = n;
+        if(!boot_getn_timeout(&p[i], e - i))
+            return 0;
+        c = crc32_inc(&p[i], e - i, c);
+        i = e;
+    }
+    *ok = (c == crc);
+    return 1;
+}
+
+// what get_code returns (instead of an address) when unix went away
+// mid-transfer: notmain calls get_code again rather than rebooting, so
+// the next my-install can resume.  0 still means "give up: reboot".
+#define BOOT_RETRY 0xffffffff
+
+// call after PUT_PROG_INFO (and boot_baud_negotiate) instead of
+// sending GET_CODE.  returns 1 when all <nbytes> are at <addr> and
+// match <cksum>.  returns 0 if unix went away: have get_code return
+// BOOT_RETRY and the next my-install will pick up where this one
+// stopped.
+static inline int
+boot_get_chunks(uint32_t addr, uint32_t nbytes, uint32_t cksum) {
+    if(nbytes > BOOT_CHUNK_MAX * BOOT_CHUNK_SIZE)
+        boot_err(BOOT_ERROR, "boot_get_chunks: program too big\n");
+    uint32_t nchunks = (nbytes + BOOT_CHUNK_SIZE - 1) / BOOT_CHUNK_SIZE;
+
+    // only a prefix at the same address is any use.
+    uint32_t have = boot_resume.addr == addr ? boot_resume.nhave : 0;
+    if(have > nbytes)
+        have = nbytes / BOOT_CHUNK_SIZE * BOOT_CHUNK_SIZE;
+    boot_put32(GET_CHUNKS);
+    boot_put32(cksum);
+    boot_put32(BOOT_CHUNK_SIZE);
+    boot_put32(BOOT_CHUNK_WINDOW);
+    boot_put32(have);
+    boot_put32(crc32(boot_addr_to_ptr(addr), have));
+
+    // unix isn't streaming yet so a plain get is fine.
+    if(boot_get32() != PUT_CHUNKS)
+        boot_err(BOOT_ERROR, "boot_get_chunks: expected PUT_CHUNKS\n");
+    uint32_t start = boot_get32();
+    if(start > have || (start % BOOT_CHUNK_SIZE && start != nbytes))
+        boot_err(BOOT_ERROR, "boot_get_chunks: bad start offset\n");
+
+    memset(boot_chunk_bits, 0, sizeof boot_chunk_bits);
+    uint32_t nleft = nchunks;
+    for(uint32_t i = 0; i < nchunks && i * BOOT_CHUNK_SIZE < start; i++) {
+        boot_chunk_set(i);
+        nleft--;
+    }
+    boot_resume.addr = addr;
+
+    // a duplicate of a chunk we already have goes here so a corrupt
+    // resend can't clobber the good copy.
+    static uint8_t dup[BOOT_CHUNK_SIZE];
+
+    uint32_t w = 0;
+    while(nleft) {
+        // find the next header: skips anything left from a chunk we
+        // lost bytes of.
+        uint8_t b;
+        if(!boot_get8_timeout(&b))
+            return boot_chunks_stop(nbytes);
+        w = w >> 8 | (uint32_t)b << 24;
+        if(w != CHUNK)
+            continue;
+        w = 0;
+
+        uint32_t seq, n, crc;
+        if(!boot_get32_timeout(&seq)
+        || !boot_get32_timeout(&n)
+        || !boot_get32_timeout(&crc))
+            return boot_chunks_stop(nbytes);
+
+        // CHUNK showed up in the data: keep looking.
+        if(seq >= nchunks)
+            continue;
+        uint32_t off = seq * BOOT_CHUNK_SIZE;
+        uint32_t exp = nbytes - off < BOOT_CHUNK_SIZE ? nbytes - off : BOOT_CHUNK_SIZE;
+        if(n != exp)
+            continue;
+
+        int dup_p = boot_chunk_has(seq), ok;
+        uint8_t *p = dup_p ? dup : boot_addr_to_ptr(addr + off);
+        if(!boot_chunk_read(seq, p, n, crc, &ok))
+            return boot_chunks_stop(nbytes);
+
+        boot_put32(ok ? CHUNK_ACK : CHUNK_NAK);
+        boot_put32(seq);
+        boot_put32(~seq);
+        if(ok && !dup_p) {
+            boot_chunk_set(seq);
+            nleft--;
+        }
+    }
+
+    // every chunk checked out: the whole thing should too.
+    if(crc32(boot_addr_to_ptr(addr), nbytes) != cksum)
+        boot_err(BOOT_ERROR, "boot_get_chunks: chunks ok but program crc is not\n");
+    boot_resume.nhave = 0;
+    return 1;
+}
+
+#endif
@@ -24,6 +24,64 @@ enum {
 
     PRINT_STRING    = 0xDDDDEEEE,       // pi sends to print a string.
 
+    // optional faster link: see boot-baud.h and ../1-unix-side/boot-baud.c
+    //   pi:   [GET_BAUD, max baud the pi's uart can do]
+    //   unix: [PUT_BAUD, baud] : baud <= max, BOOT_BAUD = stay put.
+    // if <baud> is new both sides switch and then
+    //   unix: [BAUD_SYNC]      : at the new rate.
+    //   pi:   [BAUD_SYNC]      : at the new rate.
+    // if the pi doesn't get a clean BAUD_SYNC it goes back to
+    // BOOT_BAUD and says nothing; unix then times out and does the
+    // same.
+    //
+    // if the code crc fails at the new rate the pi switches back to
+    // BOOT_BAUD and sends [BAUD_FALLBACK, GET_CODE, cksum] to get the
+    // code again.
+    BOOT_BAUD       = 115200,           // rate everyone starts at.
+    GET_BAUD        = 0x12122121,       // pi sends
+    PUT_BAUD        = 0x34344343,       // unix sends
+    BAUD_SYNC       = 0x56566565,       // both send
+    BAUD_FALLBACK   = 0x78788787,       // pi sends
+
+    // chunked transfer in place of GET_CODE/PUT_CODE: see boot-chunks.h
+    //   pi:   [GET_CHUNKS, cksum, chunk size, window, 
+    //          nbytes it already has, crc32 of those bytes]
+    //   unix: [PUT_CHUNKS, offset it will start at]
+    //   unix: [CHUNK, seq, nbytes, crc, <data>]  (<= window unacked)
+    //   pi:   [CHUNK_ACK, seq, ~seq] or [CHUNK_NAK, seq, ~seq] (bad crc)
+    // chunk <seq> is the bytes at offset seq * chunk size.  <crc> is
+    // the crc32 of <seq> followed by the data, so a corrupted <seq>
+    // can't put good data in the wrong place; ~seq does the same for
+    // the acks.   unix 
+    // resends a chunk on a NAK or if no ack shows up in time.  when 
+    // all are acked the pi checks <cksum> and sends BOOT_SUCCESS.
+    GET_CHUNKS      = 0x9a9aa9a9,       // pi sends
+    PUT_CHUNKS      = 0xbcbccbcb,       // unix sends
+    CHUNK           = 0xdedeeded,       // unix sends
+    CHUNK_ACK       = 0xf0f00f0f,       // pi sends
+    CHUNK_NAK       = 0xe1e11e1e,       // pi sends
+
+    // compressed + delta transfer in place of GET_CODE/PUT_CODE: see
+    // boot-delta.h
+    //   pi:   [GET_DELTA, cksum, block size, nbytes of the last image
+    //          it booted, crc32 of each block of that image]
+    // then for each block <i> of the new image, in order:
+    //   pi:   [DELTA_GET_BLOCK, i, ~i]
+    //   unix: [DELTA_BLOCK, i, how, arg, crc, <data>]
+    // where <how> is
+    //   DELTA_COPY: the pi has it: block <arg> of its last image.
+    //   DELTA_LZ:   <data> is <arg> bytes of lz4 (block format).
+    //   DELTA_RAW:  <data> is the <arg> bytes of the block.
+    // <crc> is the crc32 of <i> followed by the block's bytes.  if
+    // it's bad (or nothing shows up) the pi asks for <i> again.  after
+    // the last block the pi checks <cksum> and sends BOOT_SUCCESS.
+    GET_DELTA       = 0x2d2dd2d2,       // pi sends
+    DELTA_GET_BLOCK = 0x3c3cc3c3,       // pi sends
+    DELTA_BLOCK     = 0x4b4bb4b4,       // unix sends
+    DELTA_COPY      = 1,
+    DELTA_LZ        = 2,
+    DELTA_RAW       = 3,
+
 #if 0
     // if you want to be fancy, you could uncomment this and return
     // more precise errors.
@@ -45,6 +103,18 @@ static inline const char *boot_op_to_str(unsigned op) {
     case BOOT_SUCCESS:   return "BOOT_SUCCESS";
     case PRINT_STRING:   return "PRINT_STRING";
     case BOOT_ERROR:     return "BOOT_ERROR";
+    case GET_BAUD:       return "GET_BAUD";
+    case PUT_BAUD:       return "PUT_BAUD";
+    case BAUD_SYNC:      return "BAUD_SYNC";
+    case BAUD_FALLBACK:  return "BAUD_FALLBACK";
+    case GET_CHUNKS:     return "GET_CHUNKS";
+    case PUT_CHUNKS:     return "PUT_CHUNKS";
+    case CHUNK:          return "CHUNK";
+    case CHUNK_ACK:      return "CHUNK_ACK";
+    case CHUNK_NAK:      return "CHUNK_NAK";
+    case GET_DELTA:      return "GET_DELTA";
+    case DELTA_GET_BLOCK: return "DELTA_GET_BLOCK";
+    case DELTA_BLOCK:    return "DELTA_BLOCK";
     default:             return "UNKNOWN";
     }
 }
@@ -0,0 +1,219 @@
+// compressed, delta code transfer: another way to replace steps 4-6
+// of get_code (boot-chunks.h is the other).  see boot-defs.h for the
+// messages.
+//
+// most reboots resend a program that differs from the last one in a
+// few KB.  so after each boot we keep a copy of the image in a stash
+// above anything programs use (BOOT_STASH_ADDR) and next time send
+// unix a crc of each 4KB block of it.  unix says which blocks of the
+// new image we already have --- usually almost all of them --- and
+// sends the rest lz4 compressed.
+//
+// nothing protects the stash: if the program (or the firmware on
+// reboot) writes over it the crcs won't match and unix just sends
+// those blocks.   a wrong match is caught by the crc of the whole
+// program, after which we drop the stash.
+//
+// we ask for one block at a time and unpack it before asking for the
+// next, so a long match copy can't overflow the 8-byte rx fifo.  lz4
+// matches point back into what we already unpacked, which is right
+// there at the load address: the only buffer is one compressed block.
+//
+// needs what boot-chunks.h needs plus memcpy; include after it.
+#ifndef __BOOT_DELTA_H__
+#define __BOOT_DELTA_H__
+#include "boot-defs.h"
+
+enum {
+    BOOT_DELTA_BLOCK    = 4096,
+    BOOT_DELTA_MAX      = 8*1024*1024,
+    // give up after this many bad copies of one block.
+    BOOT_DELTA_TRIES    = 8,
+    BOOT_STASH_MAGIC    = 0x57a5400d,
+};
+
+// 256MB: above HIGHEST_USED_ADDR (rpi-constants.h) and below the gpu.
+#ifndef BOOT_STASH_ADDR
+#   define BOOT_STASH_ADDR 0x10000000
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t nbytes;
+    uint8_t data[];
+} boot_stash_t;
+
+// the unix tests (../tests-pty) override this.
+#ifndef boot_stash
+#   define boot_stash ((boot_stash_t *)BOOT_STASH_ADDR)
+#endif
+
+// size of the image in the stash: 0 if there isn't one.
+static inline uint32_t boot_stash_nbytes(void) {
+    if(boot_stash->magic != BOOT_STASH_MAGIC)
+        return 0;
+    if(boot_stash->nbytes > BOOT_DELTA_MAX)
+        return 0;
+    return boot_stash->nbytes;
+}
+
+// size of block <i> of an <nbytes> image.
+static inline uint32_t boot_delta_len(uint32_t nbytes, uint32_t i) {
+    uint32_t off = i * BOOT_DELTA_BLOCK;
+    return nbytes - off < BOOT_DELTA_BLOCK ? nbytes - off : BOOT_DELTA_BLOCK;
+}
+
+// unpack lz4 (block format) <src> into base[off, off+n).  matches can
+// point back into earlier blocks but not before <base>.  returns 0 if
+// <src> is malformed or doesn't make exactly <n> bytes.
+static inline int boot_lz_decode(uint8_t *base, uint32_t off, uint32_t n,
+                                const uint8_t *src, uint32_t srcn) {
+    uint8_t *d = base + off, *e = d + n;
+    const uint8_t *s = src, *se = src + srcn;
+
+    while(s < se) {
+        uint32_t tok = *s++;
+
+        // literals.
+        uint32_t len = tok >> 4;
+        if(len == 15) {
+            uint8_t b;
+            do {
+                if(s == se)
+                    return 0;
+                len += b = *s++;
+            } while(b == 255);
+        }
+        if(len > se - s || len > e - d)
+            return 0;
+        memcpy(d, s, len);
+        d += len;
+        s += len;
+
+        // the last sequence is only literals.
+        if(s == se)
+            break;
+
+        // match: <moff> back from <d>.
+        if(se - s < 2)
+            return 0;
+        uint32_t moff = s[0] | s[1] << 8;
+        s += 2;
+        if(!moff || moff > d - base)
+            return 0;
+        len = tok & 15;
+        if(len == 15) {
+            uint8_t b;
+            do {
+                if(s == se)
+                    return 0;
+                len += b = *s++;
+            } while(b == 255);
+        }
+        len += 4;
+        if(len > e - d)
+            return 0;
+        // can overlap what it's making: byte at a time.
+        const uint8_t *m = d - moff;
+        while(len--)
+            *d++ = *m++;
+    }
+    return d == e;
+}
+
+// ask for block <i> of the <nbytes> image at <base> and put it in
+// place.  returns 1 if it checks out.
+static inline int boot_delta_block(uint8_t *base, uint32_t nbytes, uint32_t i) {
+    boot_put32(DELTA_GET_BLOCK);
+    boot_put32(i);
+    boot_put32(~i);
+
+    // skip anything left from a record we gave up on.
+    uint32_t w = 0;
+    while(w != DELTA_BLOCK) {
+        uint8_t b;
+        if(!boot_get8_timeout(&b))
+            return 0;
+        w = w >> 8 | (uint32_t)b << 24;
+    }
+    uint32_t seq, how, arg, crc;
+    if(!boot_get32_timeout(&seq)
+    || !boot_get32_timeout(&how)
+    || !boot_get32_timeout(&arg)
+    || !boot_get32_timeout(&crc))
+        return 0;
+    if(seq != i)
+        return 0;
+
+    uint32_t n = boot_delta_len(nbytes, i);
+    uint8_t *dst = base + i * BOOT_DELTA_BLOCK;
+    static uint8_t lz[BOOT_DELTA_BLOCK];
+
+    switch(how) {
+    case DELTA_COPY: {
+        uint32_t have = boot_stash_nbytes();
+        if(arg >= (have + BOOT_DELTA_BLOCK - 1) / BOOT_DELTA_BLOCK
+        || boot_delta_len(have, arg) != n)
+            return 0;
+        memcpy(dst, &boot_stash->data[arg * BOOT_DELTA_BLOCK], n);
+        break;
+    }
+    case DELTA_RAW:
+        if(arg != n)
+            return 0;
+        if(!boot_getn_timeout(dst, n))
+            return 0;
+        break;
+    case DELTA_LZ:
+        if(arg > sizeof lz)
+            return 0;
+        if(!boot_getn_timeout(lz, arg))
+            return 0;
+        if(!boot_lz_decode(base, i * BOOT_DELTA_BLOCK, n, lz, arg))
+            return 0;
+        break;
+    default:
+        return 0;
+    }
+    return crc32_inc(dst, n, crc32(&i, 4)) == crc;
+}
+
+// call after PUT_PROG_INFO (and boot_baud_negotiate) instead of
+// sending GET_CODE.  returns once all <nbytes> are at <addr> and
+// match <cksum>; on failure sends BOOT_ERROR and reboots.
+static inline void
+boot_get_delta(uint32_t addr, uint32_t nbytes, uint32_t cksum) {
+    if(nbytes > BOOT_DELTA_MAX)
+        boot_err(BOOT_ERROR, "boot_get_delta: program too big\n");
+
+    uint32_t have = boot_stash_nbytes();
+    boot_put32(GET_DELTA);
+    boot_put32(cksum);
+    boot_put32(BOOT_DELTA_BLOCK);
+    boot_put32(have);
+    for(uint32_t off = 0; off < have; off += BOOT_DELTA_BLOCK) {
+        uint32_t n = boot_delta_len(have, off / BOOT_DELTA_BLOCK);
+        boot_put32(crc32(&boot_stash->data[off], n));
+    }
+
+    uint8_t *base = boot_addr_to_ptr(addr);
+    uint32_t nblocks = (nbytes + BOOT_DELTA_BLOCK - 1) / BOOT_DELTA_BLOCK;
+    for(uint32_t i = 0; i < nblocks; i++) {
+        unsigned tries = 1;
+        while(!boot_delta_block(base, nbytes, i))
+            if(tries++ == BOOT_DELTA_TRIES)
+                boot_err(BOOT_ERROR, "boot_get_delta: too many bad blocks\n");
+    }
+
+    if(crc32(base, nbytes) != cksum) {
+        boot_stash->magic = 0;
+        boot_err(BOOT_ERROR, "boot_get_delta: blocks ok but program crc is not\n");
+    }
+
+    // keep a copy for next time.
+    memcpy(boot_stash->data, base, nbytes);
+    boot_stash->nbytes = nbytes;
+    boot_stash->magic = BOOT_STASH_MAGIC;
+}
+
+#endif
@@ -0,0 +1,52 @@
+// block reads and writes for the bootloader, plus byte counts and
+// elapsed time for bytes/sec.
+//
+// besides the routines listed in get-code.h the includer provides
+//   uint32_t boot_get_burst(uint8_t *p, uint32_t n): wait for a byte
+//      and then read everything already in the rx fifo, up to <n>.
+//      returns how many (>= 1).
+// so we pay for the has-data checks and barriers once per burst
+// instead of once per byte.  see main.c.
+#ifndef __BOOT_IO_H__
+#define __BOOT_IO_H__
+
+// bytes through boot_getn and boot_putn (and the timeout versions in
+// boot-chunks.h).
+static struct {
+    uint32_t nrx, ntx;
+    uint32_t start_usec;    // when the first byte came in.
+} boot_xfer;
+
+static inline void boot_xfer_rx(uint32_t n) {
+    if(!boot_xfer.nrx)
+        boot_xfer.start_usec = timer_get_usec();
+    boot_xfer.nrx += n;
+}
+
+// bytes/sec both ways since the first byte came in.  split so that
+// n * 1000 can't overflow.
+static inline uint32_t boot_xfer_bps(void) {
+    uint32_t ms = (timer_get_usec() - boot_xfer.start_usec) / 1000;
+    uint32_t n = boot_xfer.nrx + boot_xfer.ntx;
+    if(!ms)
+        return 0;
+    return n / ms * 1000 + n % ms * 1000 / ms;
+}
+
+// read <n> bytes into <data>.  loops forever if they don't show up.
+static inline void boot_getn(void *data, uint32_t n) {
+    uint8_t *p = data;
+    for(uint32_t i = 0; i < n; )
+        i += boot_get_burst(p + i, n - i);
+    boot_xfer_rx(n);
+}
+
+// send <n> bytes from <data>.
+static inline void boot_putn(const void *data, uint32_t n) {
+    const uint8_t *p = data;
+    for(uint32_t i = 0; i < n; i++)
+        boot_put8(p[i]);
+    boot_xfer.ntx += n;
+}
+
+#endif
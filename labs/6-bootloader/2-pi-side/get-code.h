@@ -1,8 +1,10 @@
 // bootloader helpers and interface.  The file that includes this
-// must provide three routines:
+// must provide four routines:
 //   uint8_t boot_get8(void): read 8-bits from network (uart)
 //   void boot_put8(uint8_t b): send 8-bits on network (uart)
 //   boot_has_data(): returns 1 if there is data on the network.
+//   boot_flush_tx(): wait until everything sent has left.
+// and boot_get_burst (boot-io.h) and the two in boot-baud.h.
 //
 // we could provide these as routines in a structure (poor-man's
 // OO) but we want the lowest overhead possible given that we want 
@@ -19,6 +21,7 @@
 #include "rpi.h"
 #include "boot-crc32.h"  // has the crc32 implementation.
 #include "boot-defs.h"   // protocol opcode values.
+#include "boot-io.h"     // boot_getn, boot_putn
 
 /***************************************************************
  * 1. Helper routines.  You shouldn't need to modify these for
@@ -34,20 +37,14 @@
 // After you get the simple version working, you should fix 
 // it by making a timeout version.
 static inline uint32_t boot_get32(void) {
-    uint32_t u = boot_get8();
-        u |= (uint32_t)boot_get8() << 8;
-        u |= (uint32_t)boot_get8() << 16;
-        u |= (uint32_t)boot_get8() << 24;
+    uint32_t u;
+    boot_getn(&u, 4);
     return u;
 }
 
-// send 32-bits on network connection.  (possibly let the
-// network implementation override for efficiency)
+// send 32-bits on network connection.
 static inline void boot_put32(uint32_t u) {
-    boot_put8((u >> 0)  & 0xff);
-    boot_put8((u >> 8)  & 0xff);
-    boot_put8((u >> 16) & 0xff);
-    boot_put8((u >> 24) & 0xff);
+    boot_putn(&u, 4);
 }
 
 // send a string <msg> to the unix side to print.  
@@ -96,10 +93,16 @@ static inline void
 boot_err(uint32_t error_opcode, const char *msg) {
     boot_putk(msg);
     boot_put32(error_opcode);
-    uart_flush_tx();
+    boot_flush_tx();
     rpi_reboot();
 }
 
+// optional faster baud rate, chunked and delta transfer: you don't 
+// need to modify these either.
+#include "boot-baud.h"
+#include "boot-chunks.h"
+#include "boot-delta.h"
+
 /*****************************************************************
  * 2. Your bootloader implementation goes below. 
  *
@@ -156,6 +159,10 @@ uint32_t get_code(void) {
     //    we echo cksum back in step 4 to help debugging.
     boot_todo("wait for laptop/server response: echo checksum back");
 
+    // 2b. ask unix if it wants a faster link (see boot-baud.h).  it
+    //    is done by the time this returns: just keep going.
+    boot_baud_negotiate();
+
     // 3. If the binary will collide with us, abort with a BOOT_ERROR. 
     // 
     //    check that the sent code (<base_addr> through 
@@ -171,6 +178,15 @@ uint32_t get_code(void) {
     //    for definitions.
     boot_todo("check that binary will not hit the bootloader code");
 
+    // NOTE: steps 4, 5, 6 can all be replaced by 
+    //      if(!boot_get_chunks(addr, nbytes, cksum))
+    //          return BOOT_RETRY;
+    // which moves the code in checked chunks and can resume (see 
+    // boot-chunks.h), or by
+    //      boot_get_delta(addr, nbytes, cksum);
+    // which only moves what changed since the last boot, compressed
+    // (see boot-delta.h).   do the simple version first.
+
     // 4. send [GET_CODE, cksum] back.
     boot_todo("send [GET_CODE, cksum] back\n");
 
@@ -179,17 +195,28 @@ uint32_t get_code(void) {
     //  <addr> using PUT8
     //
     // common mistake: computing the offset incorrectly.
+    //
+    // once it works, <boot_getn> (boot-io.h) reads the whole thing 
+    // at once and is a lot faster.
     boot_todo("boot_get8() each code byte and use PUT8() to write it to memory");
 
     // 6. verify the cksum of the copied code using:
     //         boot-crc32.h:crc32.
-    //    if fails, abort with a BOOT_ERROR.
+    //    if fails: if <boot_baud_fallback()> returns 1 we were 
+    //    going too fast and are now back at 115200: go back to 
+    //    step 4 and get the code again.  otherwise abort with a 
+    //    BOOT_ERROR.
     boot_todo("verify the checksum of copied code");
 
     // 7. send back a BOOT_SUCCESS!
     boot_putk("<PUT YOUR NAME HERE>: success: Received the program!");
     boot_todo("fill in your name above");
 
+    // how fast that went (boot-io.h): my-install prints it.
+    char rate[64];
+    snprintk(rate, sizeof rate, "transfer: %d bytes/sec\n", boot_xfer_bps());
+    boot_putk(rate);
+
     // woo!
     boot_put32(BOOT_SUCCESS);
 
@@ -199,7 +226,7 @@ uint32_t get_code(void) {
     // isn't working, put the delay back.  However, it makes it much faster
     // to test multiple programs without it.
     // delay_ms(500);
-    uart_flush_tx();
+    boot_flush_tx();
 
     return addr;
 }
@@ -7,13 +7,32 @@
  * which does the actual getting and loading of the code.
  */
 #include "rpi.h"
+#include "boot-defs.h"
+#ifdef BOOT_USE_PL011
+#   include "pl011-uart.h"
+#else
+    // so the code below compiles: never called.
+#   define pl011_has_data()      0
+#   define pl011_get8()          0
+#   define pl011_put8(x)         ((void)(x))
+#   define pl011_flush_tx()      do { } while(0)
+#endif
 
 /*******************************************************
  * UART implementation of our routines.
+ *
+ * we start (and end) on the mini-uart at 115200.  if unix
+ * asks for a faster rate (boot-baud.h) we use the pl011 when it's 
+ * linked in (Makefile: BOOT_USE_PL011) since its clock is 
+ * independent of the gpu's core clock; otherwise we reprogram the 
+ * mini-uart.  both use pins 14 and 15.
  */
+static int pl011_on;
 
 // non-blocking: returns 1 if there is data, 0 otherwise.
 static inline int boot_has_data(void) {
+    if(pl011_on)
+        return pl011_has_data();
     return uart_has_data();
 }
 
@@ -25,9 +44,37 @@ static inline int boot_has_data(void) {
 // can check by making sure you get a get_code() < 0 
 // (not reboot, not lockup) if there is an error.
 static inline uint8_t boot_get8(void) {
+    if(pl011_on)
+        return pl011_get8();
     return uart_get8();
 }
 
+// wait for a byte, then take everything already in the rx fifo (up 
+// to <n>).  boot_getn (boot-io.h) uses this so we check and barrier
+// once per burst rather than once per byte.
+static uint32_t boot_get_burst(uint8_t *p, uint32_t n) {
+    uint32_t i = 0;
+    if(pl011_on) {
+        p[i++] = pl011_get8();
+        while(i < n && pl011_has_data())
+            p[i++] = pl011_get8();
+        return i;
+    }
+
+    enum {
+        AUX_MU_IO   = 0x20215040,
+        AUX_MU_LSR  = 0x20215054,   // bit 0: rx fifo has data.
+    };
+    while(!uart_has_data())
+        ;
+    dev_barrier();
+    do {
+        p[i++] = GET32(AUX_MU_IO) & 0xff;
+    } while(i < n && (GET32(AUX_MU_LSR) & 1));
+    dev_barrier();
+    return i;
+}
+
 // sends 8-bits on the network connection.
 //
 // should probably allow this to return a failure code
@@ -36,16 +83,93 @@ static inline uint8_t boot_get8(void) {
 // can check by making sure you get a get_code() < 0 
 // (not reboot, not lockup) if there is an error.
 static void boot_put8(uint8_t x) {
-    uart_put8(x);
+    if(pl011_on)
+        pl011_put8(x);
+    else
+        uart_put8(x);
+}
+
+// wait until all output has left.
+static void boot_flush_tx(void) {
+    if(pl011_on)
+        pl011_flush_tx();
+    else
+        uart_flush_tx();
+}
+
+// the mini-uart's baud rate is 250MHz / (8 * (reg + 1)) (bcm2835 
+// p11).  the usb-serial side has its own error so we don't take
+// anything more than 2% off.
+static int mini_uart_set_baud(uint32_t baud) {
+    enum {
+        AUX_MU_CNTL = 0x20215060,
+        AUX_MU_BAUD = 0x20215068,
+        MINI_CLK    = 250*1000*1000 / 8,
+    };
+    uint32_t reg = (MINI_CLK + baud/2) / baud - 1;
+    uint32_t actual = MINI_CLK / (reg + 1);
+    uint32_t err = actual > baud ? actual - baud : baud - actual;
+    if(err > baud / 50)
+        return 0;
+
+    // turn off tx/rx while we change it.
+    dev_barrier();
+    PUT32(AUX_MU_CNTL, 0);
+    PUT32(AUX_MU_BAUD, reg);
+    PUT32(AUX_MU_CNTL, 0b11);
+    dev_barrier();
+    return 1;
+}
+
+// switch the link to <baud>: returns 0 if we can't.
+static int boot_uart_set_baud(uint32_t baud) {
+#ifdef BOOT_USE_PL011
+    // back to the mini-uart, which is what everyone expects.
+    if(baud == BOOT_BAUD) {
+        if(pl011_on) {
+            pl011_disable();
+            uart_init();
+            pl011_on = 0;
+        }
+        return mini_uart_set_baud(baud);
+    }
+    // the pl011 runs from a 48MHz clock divided by 16 * <integer>
+    if((48*1000*1000/16) % baud != 0)
+        return 0;
+    uart_disable();
+    pl011_uart_init(baud);
+    pl011_on = 1;
+    return 1;
+#else
+    return mini_uart_set_baud(baud);
+#endif
+}
+
+// the most we accept: the pl011 tops out at 3M.  the mini-uart can go
+// higher on paper but past 1M it can't hit common rates within 2%.
+static uint32_t boot_uart_max_baud(void) {
+#ifdef BOOT_USE_PL011
+    return 3000000;
+#else
+    return 1000000;
+#endif
 }
 
 #include "get-code.h"
 
 void notmain(void) {
-    uint32_t addr = get_code();
+    // BOOT_RETRY: unix went away in the middle of a chunked transfer
+    // (boot-chunks.h).  go again without rebooting so we keep what we
+    // have and the next my-install can resume.
+    uint32_t addr;
+    while((addr = get_code()) == BOOT_RETRY)
+        ;
     if(!addr)
         rpi_reboot();
 
+    // back to the mini-uart at 115200 if we switched.
+    boot_baud_done();
+
     // blx to addr.  
     // could also call it as a function pointer.
     BRANCHTO(addr);
@@ -0,0 +1,192 @@
+#ifndef __PTY_PI_H__
+#define __PTY_PI_H__
+// a fake pi on the other end of a pty, for running the pi-side
+// bootloader helpers (../2-pi-side/boot-*.h) against the unix side
+// (../1-unix-side/boot-*.c) with no hardware.
+//
+// the two ends of a pty share one termios, so the fake pi can see
+// what rate unix has set.  whenever that differs from the rate the
+// fake pi's "uart" is at, every byte going either way gets garbled
+// --- like a real mismatched link.   the fake can also drop and
+// corrupt bytes on purpose (<pty_pi_noise>).
+//
+// the pi-side code is the real code; only the uart, timer and memory
+// are fake.
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+
+#include "put-code.h"
+#include "boot-crc32.h"
+
+static int pi_fd;
+static uint32_t pi_rate = BOOT_BAUD;  // rate of the fake pi's uart.
+static uint32_t pi_max = 1000000;
+static int pi_pl011_p;          // only rates that divide 3M.
+
+// noise: out of every <n> bytes, drop or corrupt one (0 = never).
+static struct {
+    unsigned rx_drop, rx_corrupt, tx_drop;
+    int on;
+} pi_noise;
+static unsigned pi_nrx_dropped, pi_nrx_corrupted, pi_ntx_dropped;
+
+// the pi's memory from ARMBASE up.
+static uint8_t pi_mem[8*1024*1024];
+#define boot_addr_to_ptr(addr) (&pi_mem[(addr) - ARMBASE])
+
+// the last image (boot-delta.h): lasts as long as the fake pi process.
+static uint32_t pi_stash[(8 + 8*1024*1024) / 4];
+#define boot_stash ((boot_stash_t *)pi_stash)
+
+// our own so the faults are the same every run.
+static unsigned pi_rand(unsigned n) {
+    static uint32_t x = 1;
+    x = x * 1103515245 + 12345;
+    return (x >> 8) % n;
+}
+static int pi_fault(unsigned n) {
+    return pi_noise.on && n && pi_rand(n) == 0;
+}
+
+// rate unix has the tty at.
+static uint32_t line_rate(void) {
+    struct termios t;
+    if(tcgetattr(pi_fd, &t) < 0)
+        sys_die(tcgetattr, failed);
+    switch(cfgetospeed(&t)) {
+    case B115200:   return 115200;
+    case B921600:   return 921600;
+    case B1000000:  return 1000000;
+    case B3000000:  return 3000000;
+    default:        return 0;
+    }
+}
+static uint8_t garble(uint8_t b) {
+    return line_rate() == pi_rate ? b : b ^ 0xa5;
+}
+
+static int boot_has_data(void) {
+    return can_read(pi_fd);
+}
+static uint8_t boot_get8(void) {
+    uint8_t b;
+    while(1) {
+        // the tty has a read timeout: just retry.
+        if(read(pi_fd, &b, 1) != 1)
+            continue;
+        if(pi_fault(pi_noise.rx_drop)) {
+            pi_nrx_dropped++;
+            continue;
+        }
+        if(pi_fault(pi_noise.rx_corrupt)) {
+            pi_nrx_corrupted++;
+            b ^= 1 << pi_rand(8);
+        }
+        return garble(b);
+    }
+}
+static void boot_put8(uint8_t b) {
+    if(pi_fault(pi_noise.tx_drop)) {
+        pi_ntx_dropped++;
+        return;
+    }
+    b = garble(b);
+    write_exact(pi_fd, &b, 1);
+}
+static uint32_t boot_get_burst(uint8_t *p, uint32_t n) {
+    uint32_t i = 0;
+    do {
+        p[i++] = boot_get8();
+    } while(i < n && can_read(pi_fd));
+    return i;
+}
+static void boot_flush_tx(void) {
+    tcdrain(pi_fd);
+}
+static uint32_t boot_uart_max_baud(void) {
+    return pi_max;
+}
+static int boot_uart_set_baud(uint32_t baud) {
+    if(baud != BOOT_BAUD && pi_pl011_p && 3000000 % baud)
+        return 0;
+    pi_rate = baud;
+    return 1;
+}
+
+static uint32_t timer_get_usec(void) { return time_get_usec(); }
+static void delay_ms(unsigned ms) { usleep(ms * 1000); }
+
+#include "boot-io.h"
+
+static uint32_t boot_get32(void) {
+    uint32_t u;
+    boot_getn(&u, 4);
+    return u;
+}
+static void boot_put32(uint32_t u) {
+    boot_putn(&u, 4);
+}
+static void boot_err(uint32_t op, const char *msg) {
+    output("ERROR: fake pi: %s", msg);
+    boot_put32(op);
+    exit(1);
+}
+
+#include "boot-baud.h"
+#include "boot-chunks.h"
+#include "boot-delta.h"
+
+static void pi_expect(uint32_t exp) {
+    uint32_t got = boot_get32();
+    if(got != exp) {
+        output("ERROR: fake pi: expected %s, got %x\n", boot_op_to_str(exp), got);
+        boot_put32(BOOT_ERROR);
+        exit(1);
+    }
+}
+
+// fork <pi> on the slave end of a new pty; returns the master (set
+// to 115200, 8n1) for unix to use.
+static int pty_pi_start(void (*pi)(void), pid_t *pid) {
+    int m = posix_openpt(O_RDWR | O_NOCTTY);
+    if(m < 0 || grantpt(m) < 0 || unlockpt(m) < 0)
+        sys_die(posix_openpt, failed);
+    int s = open(ptsname(m), O_RDWR | O_NOCTTY);
+    if(s < 0)
+        sys_die(open, cannot open pty);
+    set_tty_to_8n1(m, B115200, 1.0);
+
+    if((*pid = fork()) < 0)
+        sys_die(fork, failed);
+    if(!*pid) {
+        close(m);
+        pi_fd = s;
+        pi();
+        exit(0);
+    }
+    close(s);
+    return m;
+}
+
+// wait for the fake pi to exit; die if it failed.
+static void pty_pi_wait(int fd, pid_t pid) {
+    int status;
+    if(waitpid(pid, &status, 0) < 0)
+        sys_die(waitpid, failed);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        panic("fake pi failed\n");
+    close(fd);
+}
+
+// unix side: die unless <got> == <exp>.
+static void expect(uint32_t exp, uint32_t got) {
+    if(exp != got)
+        panic("expected %s, got %x [%s]\n",
+            boot_op_to_str(exp), got, boot_op_to_str(got));
+}
+
+#endif
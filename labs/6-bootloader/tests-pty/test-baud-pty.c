@@ -0,0 +1,103 @@
+// run the baud-rate negotiation (../2-pi-side/boot-baud.h and
+// ../1-unix-side/boot-baud.c) over a pty against a fake pi (pty-pi.h)
+// that garbles bytes whenever its rate and unix's differ.
+#include "pty-pi.h"
+
+static int pi_corrupt_p;        // corrupt the first fast transfer.
+
+// the bootloader a student would write, with the baud steps added.
+static void fake_pi(void) {
+    boot_put32(GET_PROG_INFO);
+    pi_expect(PUT_PROG_INFO);
+    boot_get32();   // addr
+    uint32_t n = boot_get32();
+    uint32_t crc = boot_get32();
+
+    boot_baud_negotiate();
+
+    static uint8_t code[1<<20];
+    while(1) {
+        boot_put32(GET_CODE);
+        boot_put32(crc);
+        pi_expect(PUT_CODE);
+        for(unsigned i = 0; i < n; i++)
+            code[i] = boot_get8();
+        if(pi_corrupt_p && boot_baud != BOOT_BAUD) {
+            code[n/2] ^= 1;
+            pi_corrupt_p = 0;
+        }
+        if(crc32(code, n) == crc)
+            break;
+        if(!boot_baud_fallback())
+            boot_err(BOOT_ERROR, "bad crc\n");
+    }
+    boot_put32(BOOT_SUCCESS);
+    boot_baud_done();
+
+    // the "program": talks at BOOT_BAUD.
+    boot_put32(0x12345678);
+    exit(0);
+}
+
+/**********************************************************************
+ * unix side: what put-code.c:simple_boot does, with the baud steps.
+ */
+static void unix_boot(int fd, const uint8_t *code, unsigned n) {
+    expect(GET_PROG_INFO, get_uint32(fd));
+    put_uint32(fd, PUT_PROG_INFO);
+    put_uint32(fd, ARMBASE);
+    put_uint32(fd, n);
+    put_uint32(fd, crc32(code, n));
+
+    uint32_t op = get_uint32(fd);
+    if(op == GET_BAUD) {
+        boot_baud_reply(fd);
+        op = get_uint32(fd);
+    }
+    while(1) {
+        expect(GET_CODE, op);
+        expect(crc32(code, n), get_uint32(fd));
+        put_uint32(fd, PUT_CODE);
+        write_exact(fd, code, n);
+
+        op = boot_baud_recover(fd, get_uint32(fd));
+        if(op != GET_CODE)
+            break;
+        trace("pi asked for the code again\n");
+    }
+    expect(BOOT_SUCCESS, op);
+    boot_baud_reset(fd);
+
+    uint32_t hello = get_uint32(fd);
+    if(hello != 0x12345678)
+        panic("program output at the wrong rate? got %x\n", hello);
+}
+
+static void run(const char *name, unsigned want, unsigned max, int pl011_p, int corrupt_p) {
+    trace("---- %s: want=%d, pi max=%d%s%s\n", name, want, max,
+        pl011_p ? ", pl011" : "", corrupt_p ? ", corrupt" : "");
+
+    static uint8_t code[64*1024];
+    for(unsigned i = 0; i < sizeof code; i++)
+        code[i] = random();
+
+    pi_max = max;
+    pi_pl011_p = pl011_p;
+    pi_corrupt_p = corrupt_p;
+    pid_t pid;
+    int fd = pty_pi_start(fake_pi, &pid);
+
+    boot_baud_want = want;
+    unix_boot(fd, code, sizeof code);
+    pty_pi_wait(fd, pid);
+    trace("%s: ok\n", name);
+}
+
+int main(void) {
+    run("no switch",        115200, 1000000, 0, 0);
+    run("switch",           921600, 1000000, 0, 0);
+    run("pi max",          3000000, 1000000, 0, 0);
+    run("pi refuses",       921600, 3000000, 1, 0);
+    run("crc fallback",    1000000, 1000000, 0, 1);
+    return 0;
+}
@@ -0,0 +1,171 @@
+// run the chunked transfer (../2-pi-side/boot-chunks.h and
+// ../1-unix-side/boot-chunks.c) over a pty against a fake pi
+// (pty-pi.h): clean, with dropped and corrupted bytes both ways, at
+// a fast baud rate, and resuming after unix goes away mid-transfer.
+#define BOOT_CHUNK_TIMEOUT_USEC (300*1000)
+#include "pty-pi.h"
+
+// wait up to <usec> for input.
+static int pi_wait(uint32_t usec) {
+    uint32_t s = timer_get_usec();
+    while(!boot_has_data())
+        if(timer_get_usec() - s >= usec)
+            return 0;
+    return 1;
+}
+
+// the bootloader a student would write using boot_get_chunks.
+static uint32_t get_code(void) {
+    do {
+        boot_put32(GET_PROG_INFO);
+    } while(!pi_wait(300*1000));
+
+    pi_expect(PUT_PROG_INFO);
+    uint32_t addr = boot_get32();
+    uint32_t n = boot_get32();
+    uint32_t crc = boot_get32();
+
+    boot_baud_negotiate();
+
+    pi_noise.on = 1;
+    int ok = boot_get_chunks(addr, n, crc);
+    pi_noise.on = 0;
+    if(!ok)
+        return 0;
+
+    boot_put32(BOOT_SUCCESS);
+    boot_baud_done();
+    return addr;
+}
+
+static void fake_pi(void) {
+    unsigned ntries = 1;
+    while(!get_code())
+        ntries++;
+
+    // the counts depend on timing: just say which kinds happened.
+    output("TRACE: fake pi: %d tries, faults:%s%s%s\n", ntries,
+        pi_nrx_dropped ? " rx-drop" : "",
+        pi_nrx_corrupted ? " rx-corrupt" : "",
+        pi_ntx_dropped ? " tx-drop" : "");
+
+    // the "program": talks at BOOT_BAUD.
+    boot_put32(0x12345678);
+}
+
+/**********************************************************************
+ * unix side: what put-code.c:simple_boot does, with chunks.
+ */
+
+// skip anything until the next GET_PROG_INFO.
+static void wait_prog_info(int fd) {
+    uint32_t w = 0;
+    while(w != GET_PROG_INFO)
+        w = w >> 8 | (uint32_t)get_uint8(fd) << 24;
+}
+
+// boot up to the point where the pi sent GET_CHUNKS.
+static void unix_start(int fd, const uint8_t *code, unsigned n) {
+    wait_prog_info(fd);
+    put_uint32(fd, PUT_PROG_INFO);
+    put_uint32(fd, ARMBASE);
+    put_uint32(fd, n);
+    put_uint32(fd, crc32(code, n));
+
+    uint32_t op;
+    // the pi may have sent a few more GET_PROG_INFOs.
+    while((op = get_uint32(fd)) == GET_PROG_INFO)
+        ;
+    if(op == GET_BAUD) {
+        boot_baud_reply(fd);
+        op = get_uint32(fd);
+    }
+    expect(GET_CHUNKS, op);
+}
+
+static void unix_boot(int fd, const uint8_t *code, unsigned n) {
+    unix_start(fd, code, n);
+    boot_chunk_stats = (boot_chunk_stats_t){};
+
+    uint32_t op = boot_put_chunks(fd, code, n);
+    if(!op)
+        op = get_uint32(fd);
+    expect(BOOT_SUCCESS, op);
+    boot_baud_reset(fd);
+
+    uint32_t hello;
+    while((hello = get_uint32(fd)) != 0x12345678)
+        ;
+}
+
+static uint8_t code[300*1024 + 17];
+
+static void stats(const char *name) {
+    boot_chunk_stats_t s = boot_chunk_stats;
+    trace("%s: ok: resumed at %d, resent %d chunks%s\n", name,
+        s.resume_off, s.nresent, s.nresent ? " (>0)" : "");
+}
+
+// faults: out of every <drop> bytes to the pi one is dropped, out of
+// every <corrupt> one is corrupted, and out of every <ack_drop> from
+// the pi one is dropped.
+static void run(const char *name, unsigned want,
+    unsigned drop, unsigned corrupt, unsigned ack_drop) {
+    trace("---- %s\n", name);
+    for(unsigned i = 0; i < sizeof code; i++)
+        code[i] = random();
+
+    pi_noise.rx_drop = drop;
+    pi_noise.rx_corrupt = corrupt;
+    pi_noise.tx_drop = ack_drop;
+    pid_t pid;
+    int fd = pty_pi_start(fake_pi, &pid);
+
+    boot_baud_want = want;
+    unix_boot(fd, code, sizeof code);
+    pty_pi_wait(fd, pid);
+    // how many resends depends on timing: just say if there were any.
+    boot_chunk_stats.nresent = boot_chunk_stats.nresent > 0;
+    stats(name);
+}
+
+// unix sends the first <k> chunks, goes away, then comes back.
+static void resume(const char *name, unsigned k) {
+    trace("---- %s\n", name);
+    for(unsigned i = 0; i < sizeof code; i++)
+        code[i] = random();
+    pi_noise = (typeof(pi_noise)){};
+
+    pid_t pid;
+    int fd = pty_pi_start(fake_pi, &pid);
+
+    boot_baud_want = BOOT_BAUD;
+    unix_start(fd, code, sizeof code);
+    for(unsigned i = 0; i < 5; i++)
+        get_uint32(fd);
+    put_uint32(fd, PUT_CHUNKS);
+    put_uint32(fd, 0);
+    for(unsigned i = 0; i < k; i++)
+        boot_chunk_send(fd, code, sizeof code, BOOT_CHUNK_SIZE, i);
+
+    // "ctrl-c": the pi times out and starts over.
+    usleep(2 * BOOT_CHUNK_TIMEOUT_USEC);
+    tcflush(fd, TCIFLUSH);
+    buf_read_flush(fd);
+
+    unix_boot(fd, code, sizeof code);
+    pty_pi_wait(fd, pid);
+    if(boot_chunk_stats.resume_off != k * BOOT_CHUNK_SIZE)
+        panic("expected to resume at %d\n", k * BOOT_CHUNK_SIZE);
+    stats(name);
+}
+
+int main(void) {
+    // the pty is fast: resend well before the pi's (shortened) timeout.
+    boot_chunk_timeout_usec = 50*1000;
+    run("clean", BOOT_BAUD, 0, 0, 0);
+    run("noisy", BOOT_BAUD, 20000, 50000, 500);
+    run("noisy at 1M baud", 1000000, 20000, 50000, 500);
+    resume("resume", 100);
+    return 0;
+}
@@ -0,0 +1,140 @@
+// run the compressed, delta transfer (../2-pi-side/boot-delta.h and
+// ../1-unix-side/boot-delta.c) over a pty against a fake pi
+// (pty-pi.h).  one fake pi boots a series of images so its stash
+// carries over from one to the next, like a bootloader that keeps
+// getting rebooted.
+#define BOOT_CHUNK_TIMEOUT_USEC (300*1000)
+#include "pty-pi.h"
+
+enum { NBYTES = 200*1024 + 17, HELLO = 0x12345678 };
+
+// what each boot does to the fake pi.
+static struct boot {
+    const char *name;
+    unsigned rx_drop, rx_corrupt;   // pi_noise.
+    int trash_p;                    // flip a stash byte first.
+} boots[] = {
+    { "first boot: nothing stashed" },
+    { "same image" },
+    { "a few bytes changed" },
+    { "stash trashed",  .trash_p = 1 },
+    { "random bytes" },
+    { "noisy", .rx_drop = 20000, .rx_corrupt = 20000 },
+};
+enum { NBOOTS = sizeof boots / sizeof boots[0] };
+
+// wait up to <usec> for input.
+static int pi_wait(uint32_t usec) {
+    uint32_t s = timer_get_usec();
+    while(!boot_has_data())
+        if(timer_get_usec() - s >= usec)
+            return 0;
+    return 1;
+}
+
+static void fake_pi(void) {
+    for(unsigned k = 0; k < NBOOTS; k++) {
+        struct boot *b = &boots[k];
+        if(b->trash_p)
+            boot_stash->data[5*BOOT_DELTA_BLOCK + 7] ^= 1;
+
+        do {
+            boot_put32(GET_PROG_INFO);
+        } while(!pi_wait(300*1000));
+        pi_expect(PUT_PROG_INFO);
+        uint32_t addr = boot_get32();
+        uint32_t n = boot_get32();
+        uint32_t crc = boot_get32();
+
+        pi_noise.rx_drop = b->rx_drop;
+        pi_noise.rx_corrupt = b->rx_corrupt;
+        pi_noise.on = 1;
+        boot_get_delta(addr, n, crc);
+        pi_noise.on = 0;
+
+        boot_put32(BOOT_SUCCESS);
+        // the "program".
+        boot_put32(HELLO);
+    }
+}
+
+/**********************************************************************
+ * unix side.
+ */
+
+// something like a program: a few dozen "functions" over and over,
+// some one-off words, and runs of zeros.
+static void mk_prog(uint8_t *p, unsigned n) {
+    static uint8_t fn[32][48];
+    for(unsigned i = 0; i < sizeof fn; i++)
+        fn[i / 48][i % 48] = random();
+
+    for(unsigned i = 0; i < n; ) {
+        unsigned k, r = random() % 8;
+        if(r == 0)
+            for(k = 0; k < 4 && i < n; k++)
+                p[i++] = random();
+        else if(r == 1)
+            for(k = 0; k < 64 && i < n; k++)
+                p[i++] = 0;
+        else {
+            uint8_t *f = fn[random() % 32];
+            for(k = 0; k < 48 && i < n; k++)
+                p[i++] = f[k];
+        }
+    }
+}
+
+static void boot(int fd, const char *name, const uint8_t *code, unsigned n) {
+    trace("---- %s\n", name);
+
+    uint32_t w = 0;
+    while(w != GET_PROG_INFO)
+        w = w >> 8 | (uint32_t)get_uint8(fd) << 24;
+    put_uint32(fd, PUT_PROG_INFO);
+    put_uint32(fd, ARMBASE);
+    put_uint32(fd, n);
+    put_uint32(fd, crc32(code, n));
+
+    uint32_t op;
+    while((op = get_uint32(fd)) == GET_PROG_INFO)
+        ;
+    expect(GET_DELTA, op);
+    expect(BOOT_SUCCESS, boot_put_delta(fd, code, n));
+    expect(HELLO, get_uint32(fd));
+
+    boot_delta_stats_t *s = &boot_delta_stats;
+    // how many get resent depends on timing: just say if any were.
+    trace("%s: ok: %d copied, %d lz, %d raw%s\n", name,
+        s->ncopy, s->nlz, s->nraw, s->nresent ? ", some resent" : "");
+}
+
+static uint8_t code[NBYTES], rand_code[NBYTES / 2];
+
+int main(void) {
+    mk_prog(code, sizeof code);
+    for(unsigned i = 0; i < sizeof rand_code; i++)
+        rand_code[i] = random();
+
+    pid_t pid;
+    int fd = pty_pi_start(fake_pi, &pid);
+
+    boot(fd, boots[0].name, code, sizeof code);
+    boot(fd, boots[1].name, code, sizeof code);
+
+    // three blocks.
+    code[100]++;
+    code[50*1024]++;
+    code[sizeof code - 1]++;
+    boot(fd, boots[2].name, code, sizeof code);
+    boot(fd, boots[3].name, code, sizeof code);
+    boot(fd, boots[4].name, rand_code, sizeof rand_code);
+
+    code[10*1024]++;
+    boot(fd, boots[5].name, code, sizeof code);
+    if(!boot_delta_stats.nresent)
+        panic("noise but nothing resent?\n");
+
+    pty_pi_wait(fd, pid);
+    return 0;
+}
@@ -1,8 +1,203 @@
+// a tiny behavioral model of the mini-uart so we can run the
+// interrupt-driven uart driver (libpi/staff-src/uart-int.c) on unix.
+// used by tests-uart-int/ in place of fake-pi.c.
+//
+// unlike fake-pi.c (where device memory just remembers the last write)
+// the registers here act like the hardware:
+//  - 8-byte tx and rx FIFOs.
+//  - time advances one tick per GET32/PUT32; every <ticks_per_byte> (32)
+//    ticks one byte leaves the tx FIFO (we print it to stdout) and
+//    one byte of pending input (<fake_uart_input>) arrives in the rx
+//    FIFO --- or is lost if the FIFO is full.
+//  - IER/IIR/LSR behave as in the bcm2835 manual (with the errata).
+//  - if the cpu has interrupts on (we model the cpsr bit) and the
+//    uart has something pending we call <interrupt_vector> right
+//    then, just as the hardware would between two instructions.
+//
+// if you don't use the uart in lab 5 you can also just use the
+// <uart_put8> / <uart_flush_tx> fakes at the bottom.
 #include "rpi.h"
+#undef panic
+#undef output
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define output(msg...) do { printf(msg); fflush(stdout); } while(0)
+#define panic(msg, args...) do {                                    \
+    output("%s:%s:%d:PANIC:" msg, __FILE__, __FUNCTION__, __LINE__, ##args); \
+    exit(1);                                                        \
+} while(0)
+
+enum {
+    AUX_MU_IO   = 0x20215040,
+    AUX_MU_IER  = 0x20215044,
+    AUX_MU_IIR  = 0x20215048,
+    AUX_MU_LSR  = 0x20215054,
+
+    IRQ_Enable_1  = 0x2000b210,
+    IRQ_Disable_1 = 0x2000b21c,
+    AUX_IRQ     = 1<<29,
+
+    FIFO_N = 8,
+};
+
+// real hw: a byte at 115200 baud is thousands of cycles; we only need
+// it to be slower than the cpu can refill the 8-byte FIFO.
+static unsigned ticks_per_byte = 32;
+static unsigned tick, ier, aux_irq_on;
+
+// tx and rx FIFOs.
+static uint8_t txq[FIFO_N], rxq[FIFO_N];
+static unsigned tx_n, rx_n;
+static unsigned nsent, rx_lost;
+
+// input that hasn't "arrived" yet.
+static const char *input;
+
+// the modeled cpsr interrupt bit and whether we are in a handler.
+static int int_on, in_handler;
+
+static int tx_pending(void) { return (ier & 2) && tx_n == 0; }
+static int rx_pending(void) { return (ier & 1) && rx_n > 0; }
+
+void interrupt_vector(unsigned pc);
+
+// deliver an interrupt if one is pending and the cpu allows it.
+static void check_int(void) {
+    if(int_on && !in_handler && aux_irq_on && (tx_pending() || rx_pending())) {
+        in_handler = 1;
+        int_on = 0;
+        interrupt_vector(0);
+        int_on = 1;
+        in_handler = 0;
+    }
+}
+
+static void advance(void) {
+    tick++;
+    if(tick % ticks_per_byte == 0) {
+        if(tx_n) {
+            putchar(txq[0]);
+            for(unsigned i = 1; i < tx_n; i++)
+                txq[i-1] = txq[i];
+            tx_n--;
+            nsent++;
+        }
+        if(input && *input) {
+            if(rx_n < FIFO_N)
+                rxq[rx_n++] = *input;
+            else
+                rx_lost++;
+            input++;
+        }
+    }
+    check_int();
+}
+
+void PUT32(uint32_t addr, uint32_t v) {
+    switch(addr) {
+    case AUX_MU_IO:
+        if(tx_n == FIFO_N)
+            panic("wrote a full tx FIFO: byte lost\n");
+        txq[tx_n++] = v;
+        break;
+    case AUX_MU_IER:
+        if(v & 3 && (v & 0b1100) != 0b1100)
+            panic("errata: IER bits 2,3 must be set for interrupts\n");
+        ier = v;
+        break;
+    case IRQ_Enable_1: aux_irq_on |= (v & AUX_IRQ) != 0; break;
+    case IRQ_Disable_1: if(v & AUX_IRQ) aux_irq_on = 0; break;
+    default: panic("write to unmodeled address: %x\n", addr);
+    }
+    advance();
+}
+void put32(volatile void *addr, uint32_t v) {
+    PUT32((uint32_t)(uint64_t)addr, v);
+}
+
+uint32_t GET32(uint32_t addr) {
+    uint32_t v;
+    switch(addr) {
+    case AUX_MU_IO:
+        if(!rx_n)
+            panic("read from empty rx FIFO\n");
+        v = rxq[0];
+        for(unsigned i = 1; i < rx_n; i++)
+            rxq[i-1] = rxq[i];
+        rx_n--;
+        break;
+    case AUX_MU_IER: v = ier; break;
+    case AUX_MU_IIR:
+        if(rx_pending())
+            v = 0b100;
+        else if(tx_pending())
+            v = 0b010;
+        else
+            v = 1;
+        break;
+    case AUX_MU_LSR:
+        v = (rx_n > 0) | (tx_n < FIFO_N) << 5 | (tx_n == 0) << 6;
+        break;
+    default: panic("read of unmodeled address: %x\n", addr);
+    }
+    advance();
+    return v;
+}
+uint32_t get32(const volatile void *addr) {
+    return GET32((uint32_t)(uint64_t)addr);
+}
+
+uint32_t cpsr_int_disable(void) {
+    uint32_t old = int_on ? 0 : 1<<7;
+    int_on = 0;
+    return old;
+}
+// turning interrupts on takes any that are pending right away.
+uint32_t cpsr_int_enable(void) {
+    uint32_t old = int_on ? 0 : 1<<7;
+    int_on = 1;
+    check_int();
+    return old;
+}
+uint32_t cpsr_int_reset(uint32_t cpsr) {
+    return (cpsr & (1<<7)) ? cpsr_int_disable() : cpsr_int_enable();
+}
+int cpsr_int_enabled(void) { return int_on; }
+
+// waiting is just letting time pass.
+void rpi_wait(void) { advance(); }
+void dev_barrier(void) {}
+
+// queue <s> to arrive on the rx line.
+void fake_uart_input(const char *s) { input = s; }
+void fake_uart_ticks_per_byte(unsigned n) { ticks_per_byte = n; }
+
+void rpi_reboot(void) {
+    // let the tx FIFO drain.
+    while(tx_n)
+        advance();
+    output("TRACE: fake-uart: sent %d bytes, lost %d rx bytes\n",
+                nsent, rx_lost);
+    exit(0);
+}
+
+// same as libpi/staff-src/clean-reboot.c
+void clean_reboot(void) {
+    rpi_putbuf_flush();
+    putk("DONE!!!\n");
+    rpi_putbuf_flush();
+    rpi_reboot();
+}
+
+int main(void) {
+    notmain();
+    clean_reboot();
+}
 
 // if you don't use the uart in lab 5, have fake versions.
 int uart_put8(uint8_t c) {
-    
     putchar(c);
     return c;
 }
@@ -10,4 +205,3 @@ int uart_put8(uint8_t c) {
 void uart_flush_tx(void) {
     fflush(stdout);
 }
-
@@ -0,0 +1,17 @@
+// lots of printk's with interrupts on: everything should come out, in
+// order, without printk ever waiting on the uart.
+#include "uart-int-test.h"
+
+void notmain(void) {
+    uart_int_init();
+    cpsr_int_enable();
+
+    for(int i = 0; i < 100; i++)
+        printk("TRACE: line %d: the quick brown fox jumps over the lazy dog\n", i);
+    // single characters go through the queue too.
+    putk("TRACE: ");
+    rpi_putchar('o');
+    rpi_putchar('k');
+    rpi_putchar('\n');
+    stats_print();
+}
@@ -0,0 +1,19 @@
+// with interrupts off nothing drains the tx queue: printk drops what
+// doesn't fit and counts it rather than blocking.   once interrupts 
+// come back on the queued part goes out.
+#include "uart-int-test.h"
+
+void notmain(void) {
+    uart_int_init();
+
+    // 100 * 100 bytes > the tx queue.
+    for(int i = 0; i < 100; i++)
+        printk("TRACE: %d: %80s\n", i, "xxx");
+
+    cpsr_int_enable();
+    // wait til the backlog drains, else this message gets dropped too.
+    uart_int_flush_tx();
+    uart_int_stats_t s = uart_int_stats();
+    printk("TRACE: dropped %d bytes, max queued=%d\n", s.tx_dropped, s.tx_max);
+    assert(s.tx_dropped);
+}
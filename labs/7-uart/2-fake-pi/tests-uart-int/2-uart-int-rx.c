@@ -0,0 +1,26 @@
+// input arrives while we are busy printing: the rx interrupt should
+// move it into the rx queue before the 8-byte FIFO overruns.
+#include "uart-int-test.h"
+
+static const char msg[] = 
+    "this is a long message that is much longer than the 8 byte fifo";
+
+void notmain(void) {
+    uart_int_init();
+    cpsr_int_enable();
+
+    fake_uart_input(msg);
+    for(int i = 0; i < 40; i++)
+        printk("TRACE: busy %d\n", i);
+
+    char buf[sizeof msg];
+    unsigned n = 0;
+    while(n < sizeof msg - 1) {
+        n += uart_int_getn(buf+n, sizeof msg - 1 - n);
+        rpi_wait();
+    }
+    buf[n] = 0;
+    printk("TRACE: got <%s>\n", buf);
+    assert(strcmp(buf, msg) == 0);
+    stats_print();
+}
@@ -0,0 +1,23 @@
+#ifndef __UART_INT_TEST_H__
+#define __UART_INT_TEST_H__
+#include "rpi.h"
+#include "uart-int.h"
+
+// from ../fake-uart.c
+void fake_uart_input(const char *s);
+void fake_uart_ticks_per_byte(unsigned n);
+uint32_t cpsr_int_enable(void);
+uint32_t cpsr_int_disable(void);
+
+// all our interrupts are from the uart.
+void interrupt_vector(unsigned pc) {
+    if(!uart_int_handler())
+        panic("interrupt but uart had nothing pending\n");
+}
+
+static inline void stats_print(void) {
+    uart_int_stats_t s = uart_int_stats();
+    printk("TRACE: tx dropped=%d, rx dropped=%d\n", 
+        s.tx_dropped, s.rx_dropped);
+}
+#endif
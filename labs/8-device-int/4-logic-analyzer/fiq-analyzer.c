@@ -0,0 +1,50 @@
+/*
+ * FIQ logic analyzer (la-fiq.h): we toggle <out_pin> at shrinking
+ * periods and capture <in_pin>, then print the capture.  convert it
+ * with
+ *      my-install fiq-analyzer.bin > capture.out
+ *      unix/la-vcd capture.out capture.vcd
+ *
+ * NOTE: make sure you connect your GPIO 20 to your GPIO 21 (i.e., have
+ * it "loopback")
+ *
+ * the same cpu makes the edges and takes the FIQs, so at the fastest
+ * rates the FIQ steals time from the loop making them: the periods
+ * you see stretch rather than edges getting lost.
+ */
+#include "rpi.h"
+#include "cycle-util.h"
+#include "la-fiq.h"
+
+enum { out_pin = 21, in_pin = 20, NTOGGLE = 64 };
+
+void notmain(void) {
+    caches_enable();
+    cycle_cnt_init();
+
+    gpio_set_output(out_pin);
+    gpio_write(out_pin, 0);
+    la_t la = la_init(in_pin, 64*1024, 64*1024);
+    la_start(&la);
+
+    // half periods in cycles: 700 = 500KHz square wave, 175 = 2MHz.
+    static const unsigned half[] = { 7000, 2800, 1400, 700, 350, 175 };
+    unsigned nsent = 0;
+    for(unsigned i = 0; i < sizeof half / sizeof half[0]; i++) {
+        unsigned c = cycle_cnt_read();
+        for(unsigned j = 0; j < NTOGGLE; j++)
+            c = write_cyc_until(out_pin, !(j & 1), c, half[i]);
+        gpio_write(out_pin, 0);
+        nsent += NTOGGLE;
+
+        la_drain(&la);
+        delay_us(100);
+        la_drain(&la);
+        output("half period=%d cycles: %d edges sent, %d captured so far\n",
+            half[i], nsent, la.nedges);
+    }
+    la_stop(&la);
+    output("%d edges sent, %d captured, %d lost, %d merged\n",
+        nsent, la.nedges, la.nlost, la.nmerged);
+    la_dump(&la);
+}
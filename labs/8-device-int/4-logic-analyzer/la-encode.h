@@ -0,0 +1,44 @@
+#ifndef __LA_ENCODE_H__
+#define __LA_ENCODE_H__
+// capture format shared by the pi (la-fiq.c) and unix (unix/la-vcd.c).
+//
+// a capture is a start level and then one record per edge:
+//      varint(cycles since the previous edge << 1 | new level)
+// varints are LEB128: 7 bits per byte, low first, high bit = more.
+// most edges are a few hundred cycles apart so take two bytes.
+//
+// the pi prints it as text so it survives the uart and my-install:
+//      LA-BEGIN: pin=20 mhz=700 level=1 nedges=1234
+//      LA-DATA: <up to 32 bytes in hex>
+//      ...
+//      LA-END: nlost=0 nmerged=3
+#include <stdint.h>
+
+enum { LA_DATA_PER_LINE = 32 };
+
+// encode <v> at <p>: returns the number of bytes (at most 10).
+static inline unsigned la_put(uint8_t *p, uint64_t v) {
+    unsigned n = 0;
+    while(v >= 0x80) {
+        p[n++] = v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    return n;
+}
+
+// decode one varint from the <n> bytes at <p> into <*v>: returns the
+// bytes used, or 0 if it runs off the end.
+static inline unsigned la_get(const uint8_t *p, unsigned n, uint64_t *v) {
+    uint64_t x = 0;
+    for(unsigned i = 0; i < n && i < 10; i++) {
+        x |= (uint64_t)(p[i] & 0x7f) << (7*i);
+        if(!(p[i] & 0x80)) {
+            *v = x;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+#endif
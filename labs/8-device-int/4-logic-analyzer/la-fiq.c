@@ -0,0 +1,116 @@
+// FIQ logic analyzer: see la-fiq.h
+#include "rpi.h"
+#include "irq.h"
+#include "cycle-count.h"
+#include "la-fiq.h"
+#include "la-encode.h"
+
+extern uint32_t la_vector_table[];
+void la_fiq_regs_set(la_ring_t *ring, uint32_t mask);
+
+la_t la_init(unsigned pin, unsigned ring_nbytes, unsigned out_nbytes) {
+    if(pin >= 32)
+        panic("pin %d: only bank 0 (pins 0..31)\n", pin);
+    if(ring_nbytes < 8 || ring_nbytes & (ring_nbytes - 1))
+        panic("ring size %d: must be a power of two\n", ring_nbytes);
+
+    la_t la = {
+        .pin = pin,
+        .nbytes = ring_nbytes,
+        .ring = kmalloc_aligned(sizeof(la_ring_t) + ring_nbytes, 8),
+        .out = kmalloc(out_nbytes),
+        .out_cap = out_nbytes,
+    };
+
+    // everything off while we take over the FIQ.
+    irq_init();
+    gpio_set_input(pin);
+    gpio_int_rising_edge(pin);
+    gpio_int_falling_edge(pin);
+    gpio_event_clear(pin);
+    irq_vector_base_set(la_vector_table);
+    return la;
+}
+
+void la_start(la_t *la) {
+    la->level = la->start_level = gpio_read(la->pin);
+    la->last_cyc = cycle_cnt_read();
+    la->tail = la->ring->head;
+    la_fiq_regs_set(la->ring, la->nbytes - 1);
+
+    // bcm p116: route GPIO bank 0 to the FIQ (and not the IRQ).
+    dev_barrier();
+    PUT32(IRQ_Disable_2, 1 << (GPIO_INT0 - 32));
+    PUT32(IRQ_FIQ_control, 1 << 7 | GPIO_INT0);
+    dev_barrier();
+    gpio_event_clear(la->pin);
+    fiq_enable();
+}
+
+void la_stop(la_t *la) {
+    fiq_disable();
+    dev_barrier();
+    PUT32(IRQ_FIQ_control, 0);
+    dev_barrier();
+    la_drain(la);
+}
+
+unsigned la_drain(la_t *la) {
+    unsigned n = 0;
+    uint32_t head = la->ring->head;
+
+    // the FIQ lapped us: skip to the oldest entry still there.
+    if(head - la->tail > la->nbytes) {
+        la->nlost += (head - la->tail - la->nbytes) / 8;
+        la->tail = head - la->nbytes;
+    }
+    while(la->tail != head) {
+        // volatile so the loads can't move past the <head> re-read
+        // below.
+        const volatile uint32_t *e =
+            &la->ring->buf[(la->tail & (la->nbytes - 1)) / 4];
+        uint32_t cyc = e[0], lev = e[1];
+
+        // if it lapped us while we read, the entry may be torn.
+        if(la->ring->head - la->tail > la->nbytes)
+            return n + la_drain(la);
+        la->tail += 8;
+
+        unsigned level = (lev >> la->pin) & 1;
+        if(level == la->level) {
+            la->nmerged++;
+            continue;
+        }
+        if(la->out_cap - la->out_n < 10) {
+            la->nlost++;
+            continue;
+        }
+        uint64_t v = (uint64_t)(cyc - la->last_cyc) << 1 | level;
+        la->out_n += la_put(&la->out[la->out_n], v);
+        la->last_cyc = cyc;
+        la->level = level;
+        la->nedges++;
+        n++;
+    }
+    return n;
+}
+
+void la_dump(la_t *la) {
+    printk("LA-BEGIN: pin=%d mhz=%d level=%d nedges=%d\n",
+        la->pin, CYC_PER_USEC, la->start_level, la->nedges);
+
+    // one printk per line.
+    char line[LA_DATA_PER_LINE * 2 + 1];
+    for(unsigned i = 0; i < la->out_n; i += LA_DATA_PER_LINE) {
+        unsigned n = la->out_n - i;
+        if(n > LA_DATA_PER_LINE)
+            n = LA_DATA_PER_LINE;
+        for(unsigned j = 0; j < n; j++) {
+            line[2*j] = "0123456789abcdef"[la->out[i+j] >> 4];
+            line[2*j+1] = "0123456789abcdef"[la->out[i+j] & 0xf];
+        }
+        line[2*n] = 0;
+        printk("LA-DATA: %s\n", line);
+    }
+    printk("LA-END: nlost=%d nmerged=%d\n", la->nlost, la->nmerged);
+}
@@ -0,0 +1,61 @@
+#ifndef __LA_FIQ_H__
+#define __LA_FIQ_H__
+// a logic analyzer that samples GPIO edges from the FIQ.
+//
+// the FIQ handler (la-fiq-asm.S) sits right at the FIQ vector and
+// keeps everything it needs in the FIQ's banked registers, so an edge
+// costs about ten instructions and two device reads: no stack, no
+// function calls, no pending register reads.  it stores the cycle
+// counter and the whole GPIO level register into a power-of-two ring
+// and never checks for room: if you don't drain fast enough it
+// overwrites the oldest, and <la_drain> counts what was lost.
+//
+// <la_drain> (call it from your main loop, with interrupts on) turns
+// ring entries into delta-encoded edges (la-encode.h), merging samples
+// where <pin> didn't change (we missed the other edge or a glitch was
+// too fast to see).  <la_dump> prints the capture: run it through
+// unix/la-vcd to get a .vcd for gtkwave/pulseview.
+//
+// only bank 0 (pins 0..31) and only one analyzer: it owns the FIQ and
+// the vector base (we don't handle IRQs while capturing).
+#include "rpi.h"
+
+// what the FIQ handler writes: its offsets are in la-fiq-asm.S.
+typedef struct {
+    volatile uint32_t head;     // bytes written so far.
+    uint32_t pad;               // so buf is 8-byte aligned.
+    uint32_t buf[];             // { cycle count, GPLEV0 } pairs.
+} la_ring_t;
+
+typedef struct {
+    unsigned pin;
+
+    la_ring_t *ring;
+    uint32_t nbytes;            // of ring->buf: a power of two.
+    uint32_t tail;              // bytes drained.
+
+    // the capture.
+    uint8_t *out;
+    unsigned out_n, out_cap;
+    unsigned start_level, level;
+    uint32_t last_cyc;
+
+    unsigned nedges, nmerged, nlost;
+} la_t;
+
+// sample <pin> on both edges into a <ring_nbytes> ring (a power of
+// two) and keep up to <out_nbytes> of encoded capture.
+la_t la_init(unsigned pin, unsigned ring_nbytes, unsigned out_nbytes);
+
+// turn on the FIQ: the capture starts at the current level.
+void la_start(la_t *la);
+// move what the FIQ has sampled into the capture: returns how many
+// edges that added.
+unsigned la_drain(la_t *la);
+// turn off the FIQ and drain what's left.
+void la_stop(la_t *la);
+
+// print the capture (la-encode.h).
+void la_dump(la_t *la);
+
+#endif
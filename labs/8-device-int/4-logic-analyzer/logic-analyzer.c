@@ -29,6 +29,7 @@ void interrupt_vector(unsigned pc) {
     //  - make sure you clear the GPIO event!
     //  - using the circular buffer is pretty slow. should tune this.
     //    easy way is to use a uint32_t array where the counter is volatile.
+    //  - la-fiq.h does this from the FIQ, in about ten instructions.
     unsigned s = cycle_cnt_read();
 
     dev_barrier();
@@ -0,0 +1,128 @@
+// convert a capture printed by the FIQ logic analyzer (../la-fiq.h)
+// into a .vcd you can open in gtkwave or pulseview:
+//      ./la-vcd capture.out [capture.vcd]
+// the capture can be mixed in with other output: we only look at the
+// LA-* lines (see ../la-encode.h).  writes to stdout if you don't give
+// an output file.
+#include <string.h>
+#include "libunix.h"
+#include "../la-encode.h"
+
+typedef struct {
+    unsigned pin, mhz, level, nedges;
+    uint8_t *data;
+    unsigned n, cap;
+    int begin_p, end_p;
+} capture_t;
+
+static int hex(int c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static void data_line(capture_t *c, const char *s, unsigned lineno) {
+    for(; *s && *s != '\n'; s += 2) {
+        int hi = hex(s[0]), lo = s[1] ? hex(s[1]) : -1;
+        if(hi < 0 || lo < 0)
+            panic("line %d: bad hex <%s>\n", lineno, s);
+        if(c->n == c->cap) {
+            c->cap = c->cap ? 2 * c->cap : 4096;
+            c->data = realloc(c->data, c->cap);
+            assert(c->data);
+        }
+        c->data[c->n++] = hi << 4 | lo;
+    }
+}
+
+static capture_t parse(FILE *in) {
+    capture_t c = {0};
+    char line[1024], *s;
+    unsigned lineno = 0, nlost, nmerged;
+
+    while(fgets(line, sizeof line, in)) {
+        lineno++;
+        if((s = strstr(line, "LA-BEGIN: "))) {
+            if(sscanf(s, "LA-BEGIN: pin=%u mhz=%u level=%u nedges=%u",
+                    &c.pin, &c.mhz, &c.level, &c.nedges) != 4)
+                panic("line %d: bad LA-BEGIN <%s>\n", lineno, s);
+            if(!c.mhz)
+                panic("line %d: mhz=0\n", lineno);
+            c.begin_p = 1;
+        } else if((s = strstr(line, "LA-DATA: "))) {
+            if(!c.begin_p || c.end_p)
+                panic("line %d: LA-DATA outside a capture\n", lineno);
+            data_line(&c, s + strlen("LA-DATA: "), lineno);
+        } else if((s = strstr(line, "LA-END: "))) {
+            if(sscanf(s, "LA-END: nlost=%u nmerged=%u", &nlost, &nmerged) != 2)
+                panic("line %d: bad LA-END <%s>\n", lineno, s);
+            if(nlost)
+                fprintf(stderr, "la-vcd: the pi lost %u edges: "
+                    "the capture has gaps\n", nlost);
+            c.end_p = 1;
+            break;
+        }
+    }
+    if(!c.begin_p)
+        panic("no LA-BEGIN line: not a capture?\n");
+    if(!c.end_p)
+        fprintf(stderr, "la-vcd: no LA-END line: capture is truncated\n");
+    return c;
+}
+
+// cycles to ns, rounded.
+static uint64_t ns(uint64_t cyc, unsigned mhz) {
+    return (cyc * 1000 + mhz / 2) / mhz;
+}
+
+static void vcd(FILE *out, capture_t *c) {
+    fprintf(out, "$comment r/pi FIQ logic analyzer: %u edges $end\n", c->nedges);
+    fprintf(out, "$timescale 1ns $end\n");
+    fprintf(out, "$scope module pi $end\n");
+    fprintf(out, "$var wire 1 ! gpio%u $end\n", c->pin);
+    fprintf(out, "$upscope $end\n");
+    fprintf(out, "$enddefinitions $end\n");
+    fprintf(out, "#0\n$dumpvars\n%u!\n$end\n", c->level);
+
+    uint64_t cyc = 0, last = 0;
+    unsigned nedges = 0;
+    for(unsigned i = 0; i < c->n; ) {
+        uint64_t v;
+        unsigned k = la_get(&c->data[i], c->n - i, &v);
+        if(!k)
+            panic("truncated record at byte %d\n", i);
+        i += k;
+
+        cyc += v >> 1;
+        uint64_t t = ns(cyc, c->mhz);
+        // two edges in the same ns: keep them apart so viewers show both.
+        if(nedges && t <= last)
+            t = last + 1;
+        fprintf(out, "#%llu\n%u!\n", (unsigned long long)t, (unsigned)(v & 1));
+        last = t;
+        nedges++;
+    }
+    if(nedges != c->nedges)
+        fprintf(stderr, "la-vcd: header says %u edges, data has %u\n",
+            c->nedges, nedges);
+}
+
+int main(int argc, char *argv[]) {
+    if(argc < 2 || argc > 3)
+        die("usage: %s capture.out [out.vcd]\n", argv[0]);
+
+    FILE *in = fopen(argv[1], "r");
+    if(!in)
+        sys_die(fopen, "can't open <%s>", argv[1]);
+    capture_t c = parse(in);
+    fclose(in);
+
+    FILE *out = stdout;
+    if(argc == 3 && !(out = fopen(argv[2], "w")))
+        sys_die(fopen, "can't open <%s>", argv[2]);
+    vcd(out, &c);
+    if(out != stdout)
+        fclose(out);
+    free(c.data);
+    return 0;
+}
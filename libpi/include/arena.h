@@ -0,0 +1,69 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+// arena (region) allocation: for a burst of objects that all die
+// together (a directory listing, a checker trial, ...).
+//
+//      kmalloc_arena_t a = {};
+//      arena_mark_t m = arena_mark(&a);
+//      char *buf = arena_alloc(&a, n);
+//      ...
+//      arena_reset_to_mark(&a, m);     // <buf> and friends are gone.
+//
+// allocation is a bump of an offset into the current chunk.  nothing is
+// freed one object at a time: <arena_reset_to_mark> throws away
+// everything allocated after the mark and <arena_free_all> everything,
+// period.
+//
+// chunks come from slab_alloc (slab.h), which sits on the kmalloc heap.
+// a reset keeps the chunks for the next round; arena_free_all hands them
+// back to slab so someone else can use them.
+//
+// an all-zero kmalloc_arena_t is a ready to use empty arena with
+// <ARENA_CHUNK_NBYTES> chunks.
+#include "rpi.h"
+
+// default chunk size.
+#define ARENA_CHUNK_NBYTES (16*1024)
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    unsigned nbytes;            // usable bytes after this header.
+} arena_chunk_t;
+
+typedef struct {
+    arena_chunk_t *chunks;      // every chunk we hold, in order of use.
+    arena_chunk_t *cur;         // being carved (0 = haven't started).
+    unsigned off;               // bytes used in <cur>.
+
+    unsigned chunk_nbytes;      // 0 = ARENA_CHUNK_NBYTES.
+    unsigned heap_bytes;        // total held in chunks.
+} kmalloc_arena_t;
+
+// where the arena was: a zero mark is the empty arena.
+typedef struct {
+    arena_chunk_t *cur;
+    unsigned off;
+} arena_mark_t;
+
+// empty arena that grabs <chunk_nbytes> at a time (0 for the default).
+void arena_init(kmalloc_arena_t *a, unsigned chunk_nbytes);
+
+// 0-filled, 8-byte aligned.  requests bigger than a chunk get a chunk
+// of their own (at most SLAB_MAX_NBYTES).
+void *arena_alloc(kmalloc_arena_t *a, unsigned nbytes);
+// same, aligned to <align> (a power of two).
+void *arena_alloc_aligned(kmalloc_arena_t *a, unsigned nbytes, unsigned align);
+
+static inline arena_mark_t arena_mark(kmalloc_arena_t *a) {
+    return (arena_mark_t){ .cur = a->cur, .off = a->off };
+}
+
+// free everything allocated since <m> was taken.  the chunks stay
+// with the arena.  <m> must be from this arena and not from before a
+// reset to an earlier mark or an <arena_free_all>.
+void arena_reset_to_mark(kmalloc_arena_t *a, arena_mark_t m);
+
+// free everything and give the chunks back to slab.
+void arena_free_all(kmalloc_arena_t *a);
+
+#endif
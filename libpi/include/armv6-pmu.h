@@ -1,7 +1,8 @@
 // single header file code to setup/use the armv6 performance
 // monitor unit (PMU).  note: the r/pi does not propagate
 // the PMU interrupt, unfortunately, so there is no way to 
-// do a sampling profiler by using it.
+// do a sampling profiler by using it.  (gprof.h's gprof_pmu_*
+// reads the counters from the timer interrupt instead.)
 //
 // we do some unsavory cpp tricks.
 #ifndef __ARMV6_PMU_H__
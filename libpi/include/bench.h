@@ -0,0 +1,82 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+// benchmark harness: named, repeated, overhead-corrected cycle counts.
+//
+//      BENCH_REGION_BYTES("memcpy-4k", 4096) {
+//          memcpy(dst, src, 4096);
+//      }
+//
+// runs the body <BENCH_NWARM> times to warm the caches (not counted),
+// then <BENCH_NTRIALS> more times with the cycle counter read around
+// each run, and prints one line:
+//
+//      BENCH-REGION: name=memcpy-4k trials=11 min=1012 median=1020
+//          max=1291 overhead=9 bytes=4096 usec=1 wrapped=0
+//
+// (all on one line: key=value pairs so a script can pull them apart;
+// libpi/tests/bench-diff.sh compares two runs.)
+//   - the cycles are less <overhead>: the cost of an empty region,
+//     measured the first time you use one.
+//   - bytes is <nbytes> (0 = don't print).  bench-diff.sh turns it
+//     into cycles per byte.
+//   - usec is the median trial in microseconds.
+//   - unsigned subtraction handles the cycle counter wrapping once.  a
+//     run long enough for it to wrap completely (~6sec at 700MHz) is
+//     caught with the microsecond timer: its cycles are reported as
+//     0xffffffff and counted in <wrapped>.  use usec for those.
+//
+// don't break or return out of the body: the region is a for-loop and
+// the line is printed when the last trial finishes.  the result is
+// also left in <bench_last>.
+#include "rpi.h"
+#include "cycle-count.h"
+
+enum {
+    BENCH_NWARM         = 2,
+    BENCH_NTRIALS       = 11,
+    BENCH_MAX_TRIALS    = 64,
+    // a trial at least this long might have wrapped the cycle counter.
+    BENCH_WRAP_USEC     = 6*1000*1000,
+};
+
+typedef struct {
+    const char *name;
+    unsigned nbytes, nwarm, ntrials;
+
+    // runs started so far and when the current one started.
+    unsigned i;
+    uint32_t cyc0, usec0;
+    uint32_t cyc[BENCH_MAX_TRIALS], usec[BENCH_MAX_TRIALS];
+    int calibrate_p;
+} bench_t;
+
+typedef struct {
+    const char *name;
+    unsigned ntrials, nwrapped;
+    uint32_t min, median, max;  // cycles, less <overhead>.
+    uint32_t overhead;
+    uint32_t usec;              // median.
+    unsigned nbytes;
+} bench_result_t;
+
+extern bench_result_t bench_last;
+
+#define BENCH_REGION_CFG(_name, _nbytes, _nwarm, _ntrials)                  \
+    for(bench_t _bench = bench_mk(_name, _nbytes, _nwarm, _ntrials);        \
+        bench_next(&_bench); )
+
+#define BENCH_REGION(_name)                                                 \
+    BENCH_REGION_CFG(_name, 0, BENCH_NWARM, BENCH_NTRIALS)
+
+#define BENCH_REGION_BYTES(_name, _nbytes)                                  \
+    BENCH_REGION_CFG(_name, _nbytes, BENCH_NWARM, BENCH_NTRIALS)
+
+// don't call these directly: use the macros.
+bench_t bench_mk(const char *name, unsigned nbytes, unsigned nwarm, unsigned ntrials);
+// end the last run (if any): returns 1 if there is another to do.
+int bench_next(bench_t *b);
+
+// the overhead we subtract (calibrates if we haven't yet).
+uint32_t bench_overhead(void);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef __BINLOG_H__
+#define __BINLOG_H__
+// deferred binary logging: printk without the printing.
+//
+//      binlog("sent %d bytes to %x\n", n, addr);
+//
+// records just
+//   1. the format string's id (its offset in the ".binlog_fmt" section),
+//   2. the cycle counter,
+//   3. the raw 32-bit arguments
+// into a ring buffer.  nothing is formatted on the pi: the format
+// strings live in an (INFO) section that the linker keeps in the .elf
+// but not the .bin.  <binlog_flush> ships the raw words over the uart
+// and the unix side (libunix/pi-binlog.c) looks the strings up in the
+// .elf and does the printf.
+//
+// a call is a handful of stores rather than the hundreds of cycles per
+// character of printk+uart, so you can leave it on.
+//
+// restrictions:
+//   - <fmt> must be a string literal.
+//   - at most <BINLOG_NARGS_MAX> arguments, each of which is stored as
+//     a uint32_t: cast pointers to (uint32_t); no %llx.
+//   - %s only works for strings in the binary (e.g., literals): the
+//     unix side looks up the address in the .elf.
+//   - the cycle counter wraps every ~6sec at 700MHz; the unix side
+//     assumes records are closer together than that.
+#include "rpi.h"
+#include "rpi-inline-asm.h"
+#include "cycle-count.h"
+
+#define BINLOG_NARGS_MAX 15
+
+// start of each frame that binlog_flush sends.
+#define BINLOG_MAGIC 0xb1b10600
+
+// each record is:
+//  word 0: id << 4 | nargs
+//  word 1: cycle count.
+//  word 2..: the nargs arguments.
+typedef struct {
+    uint32_t *buf;
+    unsigned nwords;        // power of two.
+
+    // free-running: [tail,head) holds records.
+    volatile unsigned head, tail;
+    volatile unsigned ndropped; // records lost b/c ring was full.
+} binlog_t;
+
+extern binlog_t binlog_ring;
+
+// log to <buf>: <nbytes> must be a power of two.  also enables the
+// cycle counter.
+void binlog_init(void *buf, unsigned nbytes);
+
+// send everything logged so far to the unix side as one frame
+// (see binlog.c) using rpi_putbuf.
+void binlog_flush(void);
+
+// append one record.   don't call directly: use <binlog>.
+static inline void
+binlog_write(uint32_t id, unsigned nargs, const uint32_t *args) {
+    binlog_t *b = &binlog_ring;
+    unsigned n = nargs + 2;
+
+    uint32_t cpsr = cpsr_int_disable();
+    unsigned head = b->head;
+    if(b->nwords - (head - b->tail) < n)
+        b->ndropped++;
+    else {
+        uint32_t *w = b->buf;
+        unsigned mask = b->nwords - 1;
+        w[head++ & mask] = id << 4 | nargs;
+        w[head++ & mask] = cycle_cnt_read();
+        for(unsigned i = 0; i < nargs; i++)
+            w[head++ & mask] = args[i];
+        b->head = head;
+    }
+    cpsr_int_reset(cpsr);
+}
+
+#define binlog(_fmt, _args...) do {                                 \
+    static const char _binlog_fmt[]                                 \
+        __attribute__((section(".binlog_fmt"), used)) = _fmt;       \
+    const uint32_t _binlog_args[] = { 0, ##_args };                 \
+    _Static_assert(sizeof _binlog_args / 4 - 1 <= BINLOG_NARGS_MAX, \
+                "too many binlog arguments");                       \
+    binlog_write((uint32_t)_binlog_fmt,                             \
+                sizeof _binlog_args / 4 - 1, &_binlog_args[1]);     \
+} while(0)
+
+#endif
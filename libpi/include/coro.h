@@ -0,0 +1,194 @@
+#ifndef __CORO_H__
+#define __CORO_H__
+// stackless coroutines (dunkels' protothreads) and an event loop that
+// runs them: for drivers with many outstanding operations, where a
+// thread and a stack per operation is too much.
+//
+// a coroutine is a function that runs until it has to wait and then
+// returns; the next call picks up where it left off.  its state lives
+// in a struct that starts with a coro_t, not on a stack:
+//
+//      typedef struct {
+//          coro_t c;               // must be first.
+//          char line[80];
+//          unsigned n;
+//      } reader_t;
+//
+//      static coro_status_t reader(coro_t *c) {
+//          reader_t *r = (void *)c;
+//          CORO_BEGIN(c);
+//          for(r->n = 0; r->n < sizeof r->line - 1; r->n++) {
+//              CORO_WAIT_READY(c, coro_uart_ready, 0);
+//              r->line[r->n] = uart_get8();
+//          }
+//          CORO_END(c);
+//      }
+//
+//      coro_sched_t s;
+//      reader_t r;
+//      coro_sched_init(&s);
+//      coro_spawn(&s, &r.c, reader, "reader");
+//      coro_run(&s);                   // until every coroutine is done.
+//
+// the rules (it's a switch on __LINE__ underneath):
+//   - locals don't survive a wait: keep anything you need across one
+//     in your struct.
+//   - no switch statements around a wait, and at most one wait per
+//     source line.
+//   - only the coroutine function itself can wait, not functions it
+//     calls.  run helpers as coroutines of their own.
+//
+// what a coroutine waits on decides what it costs while waiting:
+//   - CORO_SLEEP_US / CORO_SLEEP_UNTIL: on a timer wheel
+//     (timer-wheel.h), so a thousand sleepers cost nothing until
+//     they're due.
+//   - CORO_WAIT_READY(c, fn, arg): the loop calls <fn>(arg) once per
+//     pass (uart_has_data, nrf_nbytes_avail, a flag an interrupt
+//     handler sets) and only resumes the coroutine when it's true.
+//     CORO_WAIT_READY_TIMEOUT also gives up after <usec>: check
+//     coro_timed_out(c).
+//   - CORO_WAIT_UNTIL(c, cond): any expression, but the loop has to
+//     resume the coroutine every pass to check it.
+//   - CORO_YIELD: let everyone else have a pass.
+//
+// device predicates, e.g. for the nrf (labs/14-nrf-networking):
+//
+//      static int nrf_ready(void *nic) {
+//          return nrf_nbytes_avail(nic) > 0;
+//      }
+//      ...
+//      CORO_WAIT_READY_TIMEOUT(c, nrf_ready, p->nic, 1000);
+//      if(coro_timed_out(c))
+//          ...
+//
+// time is timer_get_usec64().  nothing here is interrupt safe: run
+// the loop from one place and have interrupt handlers set flags or
+// fill rings (ring-T.h) that a predicate checks.
+#include "rpi.h"
+#include "timer-wheel.h"
+
+typedef enum {
+    CORO_WAITING = 0,
+    CORO_DONE = 1,
+} coro_status_t;
+
+typedef struct coro coro_t;
+typedef coro_status_t (*coro_fn_t)(coro_t *c);
+typedef int (*coro_ready_fn_t)(void *arg);
+
+enum {
+    CORO_RUNNABLE = 1,
+    CORO_RUNNING,
+    CORO_POLLING,       // on the poll list (CORO_WAIT_READY / _UNTIL).
+    CORO_SLEEPING,      // only on the timer wheel.
+    CORO_EXITED,
+};
+
+struct coro {
+    uint32_t lc;            // __LINE__ to resume at, 0 = the start.
+    coro_fn_t fn;
+    const char *name;
+    struct coro_sched *s;
+
+    // run list or poll list.
+    coro_t *next, *prev;
+    uint8_t state;
+    uint8_t timed_out;      // the last wait ended by its timeout.
+
+    // what it waits on.
+    coro_ready_fn_t ready;  // 0 = resume it to check (CORO_WAIT_UNTIL).
+    void *ready_arg;
+    tw_timer_t timer;
+
+    uint32_t nresumes;
+};
+
+typedef struct {
+    coro_t *head, *tail;
+} coro_list_t;
+
+typedef struct coro_sched {
+    coro_list_t runq, pollq;
+    tw_t wheel;
+    unsigned ncoros;            // spawned and not done.
+
+    // stats.
+    uint32_t npasses;           // coro_run_once calls.
+    uint32_t nresumes;          // coroutine calls.
+    uint32_t npolls;            // ready predicate calls.
+    uint32_t nidle;             // passes with nobody to run.
+} coro_sched_t;
+
+void coro_sched_init(coro_sched_t *s);
+
+// <c> starts at the beginning of <fn> on the next pass.  <c> must stay
+// around until it's done.
+void coro_spawn(coro_sched_t *s, coro_t *c, coro_fn_t fn, const char *name);
+
+// one pass: fire due timers, poll the pollers, run whoever is ready.
+// returns how many coroutines are left.  for folding into a loop you
+// already have.
+unsigned coro_run_once(coro_sched_t *s);
+
+// pass after pass until every coroutine is done.
+void coro_run(coro_sched_t *s);
+
+static inline int coro_timed_out(const coro_t *c) {
+    return c->timed_out;
+}
+
+// for the macros.
+void coro_wait_ready_(coro_t *c, coro_ready_fn_t fn, void *arg, uint32_t usec);
+void coro_sleep_until_(coro_t *c, uint64_t deadline);
+void coro_yield_(coro_t *c);
+
+#define CORO_BEGIN(c)   switch((c)->lc) { case 0:
+#define CORO_END(c)     } (c)->lc = 0; return CORO_DONE
+
+// finish now.
+#define CORO_EXIT(c)    do { (c)->lc = 0; return CORO_DONE; } while(0)
+
+// set up the wait with <arm>, return, and come back right after it.
+#define CORO_WAIT_(c, arm) do {                                 \
+    (c)->lc = __LINE__;                                         \
+    arm;                                                        \
+    return CORO_WAITING;                                        \
+    case __LINE__:;                                             \
+} while(0)
+
+#define CORO_YIELD(c)   CORO_WAIT_(c, coro_yield_(c))
+
+#define CORO_SLEEP_UNTIL(c, deadline) \
+    CORO_WAIT_(c, coro_sleep_until_(c, deadline))
+#define CORO_SLEEP_US(c, usec) \
+    CORO_SLEEP_UNTIL(c, timer_get_usec64() + (usec))
+
+// doesn't wait at all if <fn>(arg) is already true.
+#define CORO_WAIT_READY(c, fn, arg) do {                        \
+    (c)->timed_out = 0;                                         \
+    if(!(fn)(arg))                                              \
+        CORO_WAIT_(c, coro_wait_ready_(c, fn, arg, 0));         \
+} while(0)
+
+#define CORO_WAIT_READY_TIMEOUT(c, fn, arg, usec) do {          \
+    (c)->timed_out = 0;                                         \
+    if(!(fn)(arg))                                              \
+        CORO_WAIT_(c, coro_wait_ready_(c, fn, arg, usec));      \
+} while(0)
+
+// <cond> is re-checked each pass by resuming us.
+#define CORO_WAIT_UNTIL(c, cond) do {                           \
+    (c)->lc = __LINE__;                                         \
+    case __LINE__:                                              \
+    if(!(cond)) {                                               \
+        coro_wait_ready_(c, 0, 0, 0);                           \
+        return CORO_WAITING;                                    \
+    }                                                           \
+} while(0)
+
+// ready predicates for the devices libpi knows about.
+static inline int coro_uart_ready(void *arg) {
+    return uart_has_data();
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef __GPROF_H__
+#define __GPROF_H__
+// statistical profiler: sample the pc (and call stack) from a timer
+// interrupt, symbolize on the unix side.
+//
+//      gprof_init(0, 0);
+//      timer_init(...); enable_interrupts();
+//      ...
+//      // in your interrupt handler, with the interrupted pc and the
+//      // saved r11 (fp) from the register block:
+//      gprof_sample(pc, regs[11]);
+//      ...
+//      gprof_dump();
+//
+// (see below for the hardware event version.)
+//
+// the pi keeps two sparse (open-addressed) tables, so memory goes with
+// how many different places we sample rather than the code size:
+//   - pc -> count: the flat profile.
+//   - call stack -> count: the call graph.  stacks come from walking
+//     the frame pointers, so build the code you care about with
+//       CFLAGS += -fno-omit-frame-pointer -mapcs-frame
+//     without that (or for a pc with no frame yet) the stack is just
+//     the pc.
+// neither table knows about functions: the pi has no symbols.
+// <gprof_dump> ships both as one binary frame with rpi_putbuf and the
+// unix side (libunix/pi-gprof.c, "my-install --gprof") reads the .elf's
+// symbol table, buckets the pcs by function and prints a gprof-style
+// flat profile and call graph plus folded stacks for flame graphs.
+//
+// sampling is off during <gprof_dump>, so the dump doesn't profile
+// itself.
+#include "rpi.h"
+
+// start of each frame <gprof_dump> sends.
+#define GPROF_MAGIC 0x67706601
+
+enum {
+    GPROF_MAX_DEPTH = 16,       // deepest call stack we keep.
+    GPROF_NPCS      = 4096,     // default table sizes.
+    GPROF_NSTACKS   = 1024,
+
+    // first word of each frame: what it holds.
+    GPROF_SAMPLES   = 1,
+    GPROF_PMU       = 2,
+};
+
+// frame layout (all 32-bit words):
+//   magic, nwords, crc32 of the <nwords> words that follow, then
+//      GPROF_SAMPLES, nsamples, npcs, nstacks, nlost_pcs, nlost_stacks
+//      npcs x { pc, count }
+//      nstacks x { count, depth, pc[0] .. pc[depth-1] }
+// where pc[0] is the sampled pc and pc[i+1] is the return address in
+// pc[i]'s caller.  "lost" counts samples that didn't fit in a table.
+
+// allocate (kmalloc) room for <npcs> different pcs and <nstacks>
+// different call stacks, each rounded up to a power of two.  0 gives
+// the defaults.  starts sampling.
+void gprof_init(unsigned npcs, unsigned nstacks);
+
+// record one sample: <pc> is where we interrupted, <fp> the frame
+// pointer (r11) at that point, or 0 to skip the call stack.  call from
+// the interrupt handler.
+void gprof_sample(uint32_t pc, uint32_t fp);
+
+// record a call stack you already have: pcs[0] is the sampled pc.
+void gprof_sample_stack(const uint32_t *pcs, unsigned depth);
+
+// turn sampling on and off: returns the old setting.
+int gprof_enable(int on_p);
+
+// send everything so far as one frame.
+void gprof_dump(void);
+
+// forget all the samples.
+void gprof_reset(void);
+
+/**********************************************************************
+ * hardware events: which functions miss in the caches,
+ * mispredict branches and stall.
+ *
+ * the ARM1176 PMU has a cycle counter and two event counters, and the
+ * pi doesn't route its overflow interrupt, so we can't sample on
+ * events.  instead each timer tick charges whatever the counters did
+ * since the last tick to the pc it interrupted (so a function gets
+ * events in proportion to the time it runs) and every GPROF_PMU_ROTATE
+ * ticks we move the two event counters to the next pair of events.
+ * the cycles are counted for each pair separately so the unix side can
+ * turn counts into rates (CPI, misses per 1000 instructions, % of
+ * cycles stalled) that don't depend on how long each pair was on.
+ *
+ *      gprof_pmu_init(0);
+ *      // in the timer interrupt handler:
+ *      gprof_pmu_sample(pc);
+ *      ...
+ *      gprof_pmu_dump();
+ *
+ * the PMU frame is:
+ *      GPROF_PMU, nticks, npairs, npcs, nlost,
+ *      npairs x { event0, event1 }     (armv6-pmu.h event numbers)
+ *      npcs x { pc, nticks, npairs x { cycles, count0, count1 } }
+ */
+enum {
+    GPROF_PMU_NPAIRS = 4,
+    GPROF_PMU_ROTATE = 4,       // ticks on each pair.
+    GPROF_PMU_NPCS   = 1024,
+};
+
+// allocate room for <npcs> different pcs (0 = default), turn on the
+// PMU counters and start sampling.
+void gprof_pmu_init(unsigned npcs);
+
+// charge the counters since the last call to <pc>.  call from the
+// timer interrupt.
+void gprof_pmu_sample(uint32_t pc);
+
+// turn sampling on and off: returns the old setting.
+int gprof_pmu_enable(int on_p);
+
+// send the counts so far as one frame.
+void gprof_pmu_dump(void);
+
+#endif
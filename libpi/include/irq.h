@@ -0,0 +1,77 @@
+#ifndef __IRQ_H__
+#define __IRQ_H__
+// per-source interrupt handlers with a lean trampoline, plus one
+// source on the FIQ.
+//
+//      irq_init();
+//      irq_register(IRQ_ARM_TIMER, timer_handler, 0);
+//      enable_interrupts();
+//
+// irq_init points the vector base register at our own table (so
+// nothing is copied to 0), sets the IRQ and FIQ stacks once, and
+// disables every source.  an IRQ then:
+//   1. pushes only the caller-saved registers (r0-r3, r12, lr): the C
+//      handlers save whatever else they use themselves.
+//   2. reads the basic pending register, and pending 1/2 only if it
+//      says they have something.
+//   3. for each enabled pending bit, highest first (clz), calls its
+//      handler directly.
+// handlers must clear their device's interrupt and must not use the
+// VFP: we don't save it.
+//
+// the FIQ handler runs straight from the vector table (no branch, no
+// pending register reads): use it for the one source that can't wait.
+// it runs in FIQ mode, which has its own r8-r12, so those cost nothing
+// to use if you write it in assembly.
+#include "rpi.h"
+#include "rpi-interrupts.h"
+#include "rpi-inline-asm.h"
+
+// sources are numbered the way the FIQ control register does it
+// (bcm2835 p116): 0..63 are the GPU interrupts in pending 1 and 2
+// (p113), 64.. are the ARM ones in the basic pending register.
+enum {
+    IRQ_SYSTIMER1   = 1,
+    IRQ_SYSTIMER3   = 3,
+    IRQ_AUX         = 29,       // mini-uart.
+    IRQ_GPIO0       = 49,       // = GPIO_INT0
+    IRQ_ARM_BASE    = 64,
+    IRQ_ARM_TIMER   = IRQ_ARM_BASE + 0,
+    IRQ_NSOURCES    = IRQ_ARM_BASE + 8,
+};
+
+// <pc> is where the interrupt hit.
+typedef void (*irq_fn_t)(uint32_t pc, void *arg);
+
+// install our vector table, stacks and disable all sources.  leaves
+// the cpsr IRQ and FIQ bits off.
+void irq_init(void);
+
+// call <fn(pc, arg)> when <src> interrupts and enable <src>.  the
+// device still has to be told to interrupt.
+void irq_register(unsigned src, irq_fn_t fn, void *arg);
+void irq_unregister(unsigned src);
+
+// route <src> to the FIQ (and not the IRQ) and call <fn(pc, arg)> for
+// it.  only one source at a time.  enable with <fiq_enable>.
+void fiq_register(unsigned src, irq_fn_t fn, void *arg);
+void fiq_unregister(void);
+
+static inline void fiq_enable(void) {
+    cpsr_set(cpsr_get() & ~(1 << 6));
+}
+static inline void fiq_disable(void) {
+    cpsr_set(cpsr_get() | (1 << 6));
+}
+
+// set the vector base register to <vec> (32-byte aligned) and return
+// the old one: irq_init does this with ours.
+void *irq_vector_base_set(void *vec);
+
+// called by the trampoline (irq-asm.S).
+void irq_dispatch(uint32_t pc);
+
+// counts of interrupts with no handler (spurious or not enabled).
+extern volatile unsigned irq_nspurious;
+
+#endif
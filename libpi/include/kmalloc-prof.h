@@ -0,0 +1,79 @@
+// instrumented kmalloc: who is using the heap, and who is trashing it.
+//
+// compile your code with -DKMALLOC_PROF (e.g., "CFLAGS += -DKMALLOC_PROF"
+// in your Makefile) and every kmalloc, kmalloc_notzero, kmalloc_aligned
+// and slab_alloc/slab_free in it goes through here instead.  without
+// the define none of this exists: the calls are the plain ones and
+// nothing below is linked in.
+//
+// each allocation:
+//   - is charged to its call site (the pc after the call, from
+//     __builtin_return_address) in a table of sites: calls, bytes,
+//     live bytes, smallest and biggest request.
+//   - goes into a ring of the last KMALLOC_PROF_NLOG (pc, nbytes, usec)
+//     records.
+//   - gets a header in front (with a guard word) and a redzone after.
+//     slab_free and kmalloc_prof_check check both, slab_free panics on
+//     a double free (or on freeing something kmalloc'd) and fills what
+//     it frees with KMALLOC_PROF_POISON so use-after-free shows up.
+//
+// <kmalloc_prof_dump> prints the sites, biggest first.  turn the pcs
+// into lines with:
+//      arm-none-eabi-addr2line -e your-prog.elf <pc>
+//
+// rpi.h and slab.h include us when KMALLOC_PROF is defined, after the
+// prototypes we rename, so each part has its own guard.
+#ifndef __KMALLOC_PROF_H__
+#define __KMALLOC_PROF_H__
+
+enum {
+    KMALLOC_PROF_NSITES     = 256,      // after this: charged to pc 0.
+    KMALLOC_PROF_NLOG       = 256,
+    KMALLOC_PROF_RZ_NBYTES  = 16,       // redzone after each object.
+    KMALLOC_PROF_POISON     = 0xdf,
+};
+
+// kmalloc (slab_p = 0) or slab_alloc (slab_p = 1) <nbytes> aligned to
+// <align>.  don't call directly: use the macros below.
+void *kmalloc_prof_alloc(unsigned nbytes, unsigned align, int zero_p, int slab_p);
+void kmalloc_prof_free(void *p);
+
+typedef struct {
+    uint32_t pc;                // 0 = everyone that didn't fit.
+    unsigned nalloc, nfree;
+    unsigned nbytes;            // asked for, in total.
+    unsigned live_bytes;
+    unsigned min_nbytes, max_nbytes;
+} kmalloc_prof_site_t;
+
+typedef struct {
+    uint32_t pc;
+    uint32_t nbytes;
+    uint32_t usec;
+} kmalloc_prof_rec_t;
+
+// print every site, biggest total bytes first.
+void kmalloc_prof_dump(void);
+// print the last <n> allocations, oldest first.
+void kmalloc_prof_dump_log(unsigned n);
+
+// check the guard and redzone of every live object.  prints each bad
+// one and returns how many there were.
+unsigned kmalloc_prof_check(void);
+#endif
+
+#if defined(KMALLOC_PROF) && !defined(__KMALLOC_PROF_KMALLOC_H__)
+#define __KMALLOC_PROF_KMALLOC_H__
+#define kmalloc(_n)                 kmalloc_prof_alloc(_n, 8, 1, 0)
+#define kmalloc_notzero(_n)         kmalloc_prof_alloc(_n, 8, 0, 0)
+#define kmalloc_aligned(_n, _a)     kmalloc_prof_alloc(_n, _a, 1, 0)
+#endif
+
+#if defined(KMALLOC_PROF) && defined(__SLAB_H__) \
+    && !defined(__KMALLOC_PROF_SLAB_H__)
+#define __KMALLOC_PROF_SLAB_H__
+#define slab_alloc(_n)              kmalloc_prof_alloc(_n, 8, 1, 1)
+#define slab_alloc_notzero(_n)      kmalloc_prof_alloc(_n, 8, 0, 1)
+#define slab_alloc_aligned(_n, _a)  kmalloc_prof_alloc(_n, _a, 1, 1)
+#define slab_free(_p)               kmalloc_prof_free(_p)
+#endif
@@ -69,4 +69,10 @@ static inline uint32_t cpsr_int_reset(uint32_t cpsr) {
     else
         return cpsr_int_enable();
 }
+
+// sleep until an interrupt is pending: wakes up even if they are
+// disabled in the cpsr (arm1176 3-74).
+static inline void wait_for_interrupt(void) {
+    asm volatile("mcr p15, 0, %0, c7, c0, 4" :: "r"(0) : "memory");
+}
 #endif
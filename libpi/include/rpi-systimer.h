@@ -0,0 +1,76 @@
+#ifndef __RPI_SYSTIMER_H__
+#define __RPI_SYSTIMER_H__
+/*
+ * the free-running 1MHz system timer: ch 12, pages 172--174 of the
+ * broadcom doc.  CLO/CHI are the low/high 32 bits of a 64-bit usec
+ * counter (see <timer_get_usec64>); an interrupt fires when CLO equals
+ * a compare register.
+ *
+ * C0 and C2 are the GPU's: the ARM can use C1 and C3, which are bits 1
+ * and 3 of <IRQ_pending_1>/<IRQ_Enable_1> (rpi-interrupts.h).
+ */
+#include "rpi.h"
+#include "timer-wheel.h"
+
+enum {
+    SYSTIMER_BASE   = 0x20003000,
+    SYSTIMER_CS     = SYSTIMER_BASE + 0x00, // match bits: write 1 to clear.
+    SYSTIMER_CLO    = SYSTIMER_BASE + 0x04,
+    SYSTIMER_CHI    = SYSTIMER_BASE + 0x08,
+    SYSTIMER_C0     = SYSTIMER_BASE + 0x0c, // C<n> is at C0 + 4*n
+};
+
+static inline int systimer_chan_ok(unsigned ch) {
+    return ch == 1 || ch == 3;
+}
+
+// interrupt when CLO reaches <usec>.  the match is exact: if CLO is
+// already past, you won't hear about it for 71 minutes.
+static inline void systimer_compare_set(unsigned ch, uint32_t usec) {
+    assert(systimer_chan_ok(ch));
+    PUT32(SYSTIMER_C0 + 4*ch, usec);
+}
+static inline int systimer_match_p(unsigned ch) {
+    return (GET32(SYSTIMER_CS) >> ch) & 1;
+}
+static inline void systimer_match_clear(unsigned ch) {
+    PUT32(SYSTIMER_CS, 1 << ch);
+}
+
+/*
+ * a timer wheel (timer-wheel.h) run off one compare register instead
+ * of a fixed-period tick: the register is always set for the wheel's
+ * next event, so there are no interrupts when nothing is due.
+ *
+ *      timer_wheel_init(1);
+ *      enable_interrupts();
+ *      ...
+ *      // in your interrupt_vector:
+ *      if(timer_wheel_interrupt())
+ *          return;
+ *
+ * callbacks run from the interrupt, with interrupts off.
+ */
+
+// smallest lead we give the compare register: has to cover setting it.
+enum { TIMER_WHEEL_MIN_USEC = 4 };
+
+// take over compare register <ch> (1 or 3) and enable its interrupt.
+void timer_wheel_init(unsigned ch);
+
+// run <fn(t,arg)> at <deadline> (absolute, in <timer_get_usec64> usec)
+// or <usec> from now.
+void timer_wheel_add_at(tw_timer_t *t, uint64_t deadline, tw_fn_t fn, void *arg);
+void timer_wheel_add(tw_timer_t *t, uint32_t usec, tw_fn_t fn, void *arg);
+// returns 1 if <t> was pending.
+int timer_wheel_cancel(tw_timer_t *t);
+
+// returns 1 if the compare register interrupted (and runs what's due).
+int timer_wheel_interrupt(void);
+
+// wait until <deadline> (or for <usec>) in wfi rather than spinning:
+// interrupts must be on.
+void timer_wheel_sleep_until(uint64_t deadline);
+void timer_wheel_sleep_us(uint32_t usec);
+
+#endif
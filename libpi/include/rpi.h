@@ -22,6 +22,12 @@
 #include <stdarg.h>
 #include <string.h>
 
+// NOTE: the arm1176 has no divide instruction, so any '/' or '%' gcc
+// can't turn into shifts or a multiply (a divisor that isn't a
+// constant, or anything 64-bit) is a call into libgcc.  the standard
+// Makefile.robust-v2 doesn't link libgcc, so libpi code must not divide
+// at runtime.  a program that wants to can link it itself (see
+// labs/9-mailbox/code/Makefile).
 
 /*****************************************************************************
  * output routines.
@@ -38,6 +44,21 @@ extern rpi_putchar_t rpi_putchar;
 rpi_putchar_t rpi_putchar_set(rpi_putchar_t putc);
 #define rpi_set_putc rpi_putchar_set
 
+// emit <n> bytes in one call: printk and putk format into a buffer
+// and hand it off here.  the default calls <rpi_putchar> on each byte,
+// so overriding just <rpi_putchar> still works.  override this too
+// if your device can do better than a byte at a time.
+typedef int (*rpi_putbuf_t)(const void *buf, unsigned n);
+extern rpi_putbuf_t rpi_putbuf;
+rpi_putbuf_t rpi_putbuf_set(rpi_putbuf_t putbuf);
+
+// if your <rpi_putbuf> buffers output (e.g., uart-int.h) install a 
+// routine to push it all out: clean_reboot and rpi_reboot call 
+// <rpi_putbuf_flush> so the last messages don't get lost.  
+typedef void (*rpi_putbuf_flush_t)(void);
+rpi_putbuf_flush_t rpi_putbuf_flush_set(rpi_putbuf_flush_t flush);
+void rpi_putbuf_flush(void);
+
 // copy at most <n> bytes from <src> into <dst>
 // null-terminate.
 void safe_strcpy(char *dst, const char *src, unsigned n);
@@ -45,13 +66,24 @@ void safe_strcpy(char *dst, const char *src, unsigned n);
 // emit a single string.
 int putk(const char *msg);
 
-// printf with a lot of restrictions.
+// printf with a lot of restrictions: %c %s %d %u %x %X %p %b %llx
+// with '-', '0' and width (or '*') flags.  see libc/printk-fmt.h.
+// returns the number of bytes printed.
 int printk(const char *format, ...);
 
 // vprintf with a lot of restrictions.
 int vprintk(const char *fmt, va_list ap);
 
-// print string to <buf>
+// batch printk output into <buf> instead of emitting each call: the
+// buffer goes to <rpi_putbuf> when it fills or on flush/stop.  
+// NOTE: not interrupt safe --- don't printk from a handler while 
+// batching.
+void printk_batch_start(void *buf, unsigned n);
+void printk_flush(void);
+void printk_batch_stop(void);
+
+// print string to <buf>: truncates and always 0-terminates.  returns
+// the length the untruncated string would have.
 #include <stdarg.h>
 int snprintk(char *buf, unsigned buflen, const char *fmt, ...);
 int vsnprintk(char *buf, unsigned buflen, const char *fmt, va_list ap);
@@ -116,6 +148,11 @@ uint32_t timer_get_usec(void) ;
 // no memory barrier.
 uint32_t timer_get_usec_raw(void);
 
+// the full 64-bit usec counter: doesn't wrap for ~580,000 years, so
+// you can compare directly.  rpi-systimer.h has interrupts and a
+// timer wheel on top of it.
+uint64_t timer_get_usec64(void);
+
 /****************************************************************************
  * Reboot the pi smoothly.
  */
@@ -142,6 +179,7 @@ void dev_barrier(void);
 
 /*******************************************************************************
  * simple memory allocation: no free, just have to reboot().
+ * slab.h has an allocator with free on top of this.
  */
 
 // returns 0-filled memory.
@@ -288,5 +326,9 @@ void * custom_c_runtime_init(void);
 // where the final end of the [data+code+extra] is.
 void *program_end(void);
 
+// -DKMALLOC_PROF: send kmalloc through the heap profiler.
+#ifdef KMALLOC_PROF
+#include "kmalloc-prof.h"
+#endif
 
 #endif
@@ -0,0 +1,82 @@
+#ifndef __SLAB_H__
+#define __SLAB_H__
+// size-class ("slab") allocator with free, on top of kmalloc.
+//
+//      struct foo *f = slab_alloc(sizeof *f);
+//      ...
+//      slab_free(f);
+//
+// kmalloc never gives memory back, so anything that comes and goes
+// (threads, procs, queue entries) either leaks or keeps its own free
+// list.  this does the free list for everyone:
+//   - requests up to 2048 bytes are rounded up to one of 15 size
+//     classes and carved out of 16KB slabs.
+//   - bigger ones (up to 1MB) are rounded up to a power of two and
+//     get their own kmalloc.
+//   - each class keeps a free list (the link lives in the freed
+//     object), so alloc and free are O(1).  memory that has been
+//     handed to a class stays with that class.
+//   - a byte per 4KB page of the kmalloc heap records which class the
+//     page belongs to, so slab_free doesn't need the size and objects
+//     don't need a header.
+//
+// alignment: everything is 8-byte aligned.  a class whose size is a
+// power of two is aligned to that size, up to 4096, so
+// <slab_alloc_aligned> just picks one of those.
+//
+// call kmalloc_init (or kmalloc_init_set_start) before the first
+// slab_alloc.  if you reset the kmalloc heap, call <slab_init> again.
+#include "rpi.h"
+
+// biggest request slab_alloc takes.
+#define SLAB_MAX_NBYTES (1024*1024)
+
+// returns 0-filled memory, like kmalloc.  panics if <nbytes> is more
+// than SLAB_MAX_NBYTES or the heap is out of memory.
+void *slab_alloc(unsigned nbytes);
+// same, but reused memory isn't zeroed.
+void *slab_alloc_notzero(unsigned nbytes);
+
+// same, aligned to <align> (a power of two no bigger than 4096).
+void *slab_alloc_aligned(unsigned nbytes, unsigned align);
+
+// give <p> back to its class.  0 is ignored.  panics if <p> didn't come
+// from slab_alloc.
+void slab_free(void *p);
+
+// forget everything: all slab_alloc'd memory is gone.  called for you
+// by the first slab_alloc.
+void slab_init(void);
+
+typedef struct {
+    unsigned nalloc, nfree;     // calls so far.
+
+    unsigned live_objs;
+    unsigned live_bytes;        // in use, rounded up to the class size.
+    unsigned max_live_bytes;    // high-water mark of <live_bytes>.
+
+    // bytes taken from kmalloc (including the page map).  they are
+    // never given back so this only grows.
+    unsigned heap_bytes;
+
+    // over every slab_alloc so far: bytes asked for and what that
+    // got rounded up to.  the difference is what rounding costs.
+    unsigned req_bytes, round_bytes;
+} slab_stats_t;
+
+slab_stats_t slab_stats(void);
+
+// print the totals and the live objects in each class.  fragmentation
+// is given as bytes wasted out of bytes:
+//  - internal: bytes lost rounding up to a class, out of the rounded
+//    total.
+//  - external: heap taken from kmalloc that isn't live (free objects,
+//    uncarved slab, page map), out of all of it.
+void slab_stats_print(const char *msg);
+
+// -DKMALLOC_PROF: send slab_alloc/slab_free through the heap profiler.
+#ifdef KMALLOC_PROF
+#include "kmalloc-prof.h"
+#endif
+
+#endif
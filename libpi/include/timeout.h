@@ -7,36 +7,26 @@
 // longer than wrap around can happen.
 // 
 // each time we want to wait, we record the current state of time.
-//
-// NOTE: you must keep checking (calling <timeout_get_usec>) more frequently
-// than a wrap-around can happen (4billion cycles) otherwise we will lose
-// some ticks.
-//
-// alternatively: we could have interrupt code with timing, etc and explicitly
-// track time like a real OS.  however, this obviously makes things significatly
-// more complex.
+// we use the full 64-bit counter (<timer_get_usec64>) so there is no
+// wrap-around to worry about: you can check as rarely as you like.
 typedef struct {
-    uint32_t time_last;
-    uint64_t time_usecs;
+    uint64_t time_start;
 } timeout_t;
 
 // call this first.
 static inline timeout_t timeout_start(void) {
-    return (timeout_t) { .time_usecs = 0, .time_last = timer_get_usec() };
+    return (timeout_t) { .time_start = timer_get_usec64() };
 }
 
 // return the number of usecs since we started tracking time.
 // don't need to use this directly.
 static inline uint64_t timeout_get_usec(timeout_t *t) {
-    uint32_t now = timer_get_usec();
-    t->time_usecs += (now - t->time_last);
-    t->time_last = now;
-    return t->time_usecs;
+    return timer_get_usec64() - t->time_start;
 }
 
 #if 0
 static inline int timeout_null(timeout_t *t) {
-    return t->time_last == 0 && t->time_usecs == 0;
+    return t->time_start == 0;
 }
 #endif
 
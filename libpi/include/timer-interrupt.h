@@ -49,6 +49,8 @@ enum {
 // <prescale> can be 1, 16, 256. see the timer value.
 // NOTE: a better interface = specify the timer period.
 // worth doing as an extension!
+// if you only need to run things at given times, the timer wheel in
+// rpi-systimer.h doesn't interrupt at all when nothing is due.
 static inline
 void timer_init(uint32_t prescale, uint32_t ncycles) {
     //**************************************************
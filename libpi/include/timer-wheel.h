@@ -0,0 +1,68 @@
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+// hierarchical timer wheel over 64-bit microsecond deadlines.
+//
+// there is no tick: the wheel tells you when it next has work
+// (<tw_next>), you arrange to be woken then (rpi-systimer.h programs a
+// system timer compare register), and call <tw_run> with the time.
+// nothing costs anything between events.
+//
+// level <l> has TW_NSLOTS slots, each 2^(l*TW_BITS) usec wide: a timer
+// goes in the lowest level where its deadline is less than TW_NSLOTS
+// slots out, and moves down a level (is "cascaded") when time reaches
+// its slot.  add and cancel are O(1); run is O(levels) per event.
+// deadlines past the top level are parked at its far end and re-placed
+// when we get there.
+//
+// the timers are yours (embed them in whatever is waiting): the wheel
+// never allocates.  not thread or interrupt safe: the caller locks.
+#include "rpi.h"
+
+enum {
+    TW_BITS     = 5,
+    TW_NSLOTS   = 1 << TW_BITS,     // a bitmap of slots fits in a word.
+    TW_NLEVELS  = 7,                // 2^35 usec (~9.5 hours) before parking.
+};
+
+typedef struct tw_timer tw_timer_t;
+typedef void (*tw_fn_t)(tw_timer_t *t, void *arg);
+
+struct tw_timer {
+    uint64_t deadline;
+    tw_fn_t fn;
+    void *arg;
+
+    // private: the slot list we are on (pprev = 0 if not pending).
+    tw_timer_t *next, **pprev;
+    uint8_t level, slot;
+};
+
+typedef struct {
+    uint64_t now;               // everything due before this has run.
+    unsigned npending;
+    uint32_t occupied[TW_NLEVELS];  // bit <i> set = slots[l][i] non-empty.
+    tw_timer_t *slots[TW_NLEVELS][TW_NSLOTS];
+} tw_t;
+
+void tw_init(tw_t *w, uint64_t now);
+
+// call <fn(t,arg)> at <deadline> usec (or on the next <tw_run> if it
+// has passed).  re-adding a pending timer moves it.
+void tw_add(tw_t *w, tw_timer_t *t, uint64_t deadline, tw_fn_t fn, void *arg);
+
+// returns 1 if <t> was pending.
+int tw_cancel(tw_t *w, tw_timer_t *t);
+
+static inline int tw_pending(const tw_timer_t *t) { return t->pprev != 0; }
+
+// returns 0 if nothing is pending, otherwise 1 and sets <*when> to
+// the earliest time <tw_run> has something to do: a timer to fire or
+// one to move down a level.  never later than the earliest deadline.
+int tw_next(tw_t *w, uint64_t *when);
+
+// fire everything due at or before <now>, in deadline order.  the
+// callbacks can add and cancel timers (including their own).  returns
+// how many fired.
+unsigned tw_run(tw_t *w, uint64_t now);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef __UART_INT_H__
+#define __UART_INT_H__
+// interrupt-driven mini-uart: output and input go through byte
+// rings (libc/ring-T.h) that the uart interrupt drains and fills, so
+//  - printk/putk/rpi_putchar never spin on the 8-byte hw FIFO: they
+//    copy into the tx queue and return.  if the queue is full the
+//    bytes are dropped and counted in <tx_dropped>.
+//  - input that arrives while you're busy (e.g., printing) lands in
+//    the rx queue rather than overrunning the 8-byte rx FIFO.
+//
+// usage:
+//   1. uart_init() as usual.
+//   2. uart_int_init(): installs our rpi_putbuf/rpi_putchar and
+//      enables the uart interrupt source.
+//   3. call uart_int_handler() from your interrupt_vector; it returns
+//      0 if the uart had nothing pending.
+//   4. enable interrupts (cpsr).
+//
+// output queued while interrupts are off goes out once they are
+// turned on.   clean_reboot and rpi_reboot drain the queue by polling
+// (via rpi_putbuf_flush), so a final panic message still appears.
+//
+// the mini-uart has no DMA request line (only the pl011 does) so
+// there is no DMA mode: the interrupt moves up to 8 bytes each time.
+#include "rpi.h"
+
+// queue sizes in bytes: powers of two, set independently with -D.
+// both default to the 8192 the old circular queues had.  output wants
+// a big one (a burst of printk's); input has to cover however long
+// you go without reading, so shrinking it drops input sooner
+// (<rx_dropped>).
+#ifndef UART_INT_TX_NBYTES
+#   define UART_INT_TX_NBYTES 8192
+#endif
+#ifndef UART_INT_RX_NBYTES
+#   define UART_INT_RX_NBYTES 8192
+#endif
+
+void uart_int_init(void);
+
+// interrupt handler: returns 1 if the uart interrupted, 0 otherwise.
+int uart_int_handler(void);
+
+// drain the tx queue by polling, turn off uart interrupts and go
+// back to the old rpi_putbuf/rpi_putchar.
+void uart_int_disable(void);
+
+// non-blocking: queue up to <n> bytes for output.  returns the number
+// queued; the rest were dropped (and counted).
+int uart_int_putbuf(const void *buf, unsigned n);
+int uart_int_put8(uint8_t c);
+
+// push everything in the tx queue out by polling the hw.  works with
+// interrupts off.
+void uart_int_flush_tx(void);
+
+// 1 if there is input in the rx queue.
+int uart_int_has_data(void);
+// -1 if no input, otherwise the next byte.
+int uart_int_get8_async(void);
+// blocks until there is input: interrupts must be on.
+int uart_int_get8(void);
+// non-blocking: copy up to <n> bytes of input to <buf>, returns how
+// many.
+unsigned uart_int_getn(void *buf, unsigned n);
+
+typedef struct {
+    unsigned nints;         // number of uart interrupts.
+    unsigned tx_dropped;    // bytes dropped b/c the tx queue was full.
+    unsigned rx_dropped;    // bytes dropped b/c the rx queue was full.
+    unsigned tx_max;        // most bytes ever queued for output.
+} uart_int_stats_t;
+
+uart_int_stats_t uart_int_stats(void);
+
+#endif
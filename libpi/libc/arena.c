@@ -0,0 +1,89 @@
+// arena allocator: see arena.h.
+#include "rpi.h"
+#include "arena.h"
+#include "slab.h"
+
+void arena_init(kmalloc_arena_t *a, unsigned chunk_nbytes) {
+    *a = (kmalloc_arena_t){ .chunk_nbytes = chunk_nbytes };
+}
+
+static inline uint8_t *chunk_data(arena_chunk_t *c) {
+    return (uint8_t *)(c + 1);
+}
+
+// a chunk with room for <need> bytes to come after <a->cur>.  we take
+// the first one left over from before a reset that fits (moving it up
+// if it's not next), otherwise get a new one from slab.
+static arena_chunk_t *next_chunk(kmalloc_arena_t *a, unsigned need) {
+    arena_chunk_t **link = a->cur ? &a->cur->next : &a->chunks;
+    arena_chunk_t *c = *link;
+
+    for(arena_chunk_t **l = link; *l; l = &(*l)->next) {
+        arena_chunk_t *f = *l;
+        if(f->nbytes < need)
+            continue;
+        if(f != c) {
+            *l = f->next;
+            f->next = c;
+            *link = f;
+        }
+        return f;
+    }
+
+    unsigned nbytes = a->chunk_nbytes ? a->chunk_nbytes : ARENA_CHUNK_NBYTES;
+    nbytes -= sizeof *c;
+    if(nbytes < need)
+        nbytes = need;
+
+    arena_chunk_t *n = slab_alloc_notzero(sizeof *n + nbytes);
+    n->nbytes = nbytes;
+    n->next = c;
+    *link = n;
+    a->heap_bytes += sizeof *n + nbytes;
+    return n;
+}
+
+// offset of the first <align>ed spot at or after <off> in <c>: chunk
+// data is only 8-byte aligned.
+static unsigned align_off(arena_chunk_t *c, unsigned off, unsigned align) {
+    uintptr_t p = (uintptr_t)chunk_data(c) + off;
+    return off + (((p + align - 1) & ~(uintptr_t)(align - 1)) - p);
+}
+
+void *arena_alloc_aligned(kmalloc_arena_t *a, unsigned nbytes, unsigned align) {
+    if(!align || (align & (align - 1)))
+        panic("arena: bad alignment %d\n", align);
+    if(align < 8)
+        align = 8;
+
+    unsigned off = 0;
+    if(a->cur)
+        off = align_off(a->cur, a->off, align);
+    if(!a->cur || off + nbytes > a->cur->nbytes) {
+        a->cur = next_chunk(a, nbytes + align - 8);
+        off = align_off(a->cur, 0, align);
+    }
+
+    void *p = chunk_data(a->cur) + off;
+    a->off = off + nbytes;
+    memset(p, 0, nbytes);
+    return p;
+}
+
+void *arena_alloc(kmalloc_arena_t *a, unsigned nbytes) {
+    return arena_alloc_aligned(a, nbytes, 8);
+}
+
+void arena_reset_to_mark(kmalloc_arena_t *a, arena_mark_t m) {
+    a->cur = m.cur;
+    a->off = m.off;
+}
+
+void arena_free_all(kmalloc_arena_t *a) {
+    arena_chunk_t *c, *next;
+    for(c = a->chunks; c; c = next) {
+        next = c->next;
+        slab_free(c);
+    }
+    arena_init(a, a->chunk_nbytes);
+}
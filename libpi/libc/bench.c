@@ -0,0 +1,113 @@
+// benchmark regions: see bench.h.
+#include "rpi.h"
+#include "bench.h"
+
+bench_result_t bench_last;
+
+static uint32_t overhead;
+static int calibrated_p;
+
+// sort <n> values: n is small.
+static void sort_u32(uint32_t *v, unsigned n) {
+    for(unsigned i = 1; i < n; i++) {
+        uint32_t x = v[i];
+        unsigned j = i;
+        for(; j > 0 && v[j-1] > x; j--)
+            v[j] = v[j-1];
+        v[j] = x;
+    }
+}
+
+static bench_t mk(const char *name, unsigned nbytes, unsigned nwarm, unsigned ntrials) {
+    if(!ntrials || ntrials > BENCH_MAX_TRIALS)
+        panic("bench <%s>: %d trials: must be 1..%d\n",
+            name, ntrials, BENCH_MAX_TRIALS);
+    return (bench_t) {
+        .name = name,
+        .nbytes = nbytes,
+        .nwarm = nwarm,
+        .ntrials = ntrials,
+    };
+}
+
+// an empty region: the best of a few is what reading the counters and
+// going around the loop costs.
+uint32_t bench_overhead(void) {
+    if(!calibrated_p) {
+        calibrated_p = 1;
+        cycle_cnt_init();
+        bench_t b = mk("calibrate", 0, BENCH_NWARM, 16);
+        b.calibrate_p = 1;
+        while(bench_next(&b))
+            ;
+        overhead = bench_last.min;
+    }
+    return overhead;
+}
+
+bench_t bench_mk(const char *name, unsigned nbytes, unsigned nwarm, unsigned ntrials) {
+    bench_overhead();
+    return mk(name, nbytes, nwarm, ntrials);
+}
+
+static void done(bench_t *b) {
+    bench_result_t r = {
+        .name = b->name,
+        .ntrials = b->ntrials,
+        .nbytes = b->nbytes,
+        .overhead = b->calibrate_p ? 0 : overhead,
+    };
+
+    for(unsigned i = 0; i < b->ntrials; i++) {
+        if(b->usec[i] >= BENCH_WRAP_USEC) {
+            b->cyc[i] = ~0;
+            r.nwrapped++;
+        } else if(b->cyc[i] > r.overhead)
+            b->cyc[i] -= r.overhead;
+        else
+            b->cyc[i] = 0;
+    }
+    sort_u32(b->cyc, b->ntrials);
+    sort_u32(b->usec, b->ntrials);
+    unsigned mid = (b->ntrials - 1) / 2;
+    r.min = b->cyc[0];
+    r.median = b->cyc[mid];
+    r.max = b->cyc[b->ntrials - 1];
+    r.usec = b->usec[mid];
+    bench_last = r;
+
+    if(b->calibrate_p)
+        return;
+    // one printk per line so other output can't land in the middle.
+#   define BENCH_FMT "BENCH-REGION: name=%s trials=%d min=%u median=%u max=%u overhead=%u"
+    if(!r.nbytes)
+        printk(BENCH_FMT " usec=%u wrapped=%d\n",
+            r.name, r.ntrials, r.min, r.median, r.max, r.overhead,
+            r.usec, r.nwrapped);
+    else
+        printk(BENCH_FMT " bytes=%d usec=%u wrapped=%d\n",
+            r.name, r.ntrials, r.min, r.median, r.max, r.overhead,
+            r.nbytes, r.usec, r.nwrapped);
+#   undef BENCH_FMT
+}
+
+// read the cycle counter innermost so as little as possible of our
+// own code lands in the region.
+int bench_next(bench_t *b) {
+    uint32_t cyc = cycle_cnt_read();
+    uint32_t usec = timer_get_usec();
+
+    if(b->i > b->nwarm) {
+        unsigned t = b->i - b->nwarm - 1;
+        b->cyc[t] = cyc - b->cyc0;
+        b->usec[t] = usec - b->usec0;
+    }
+    if(b->i == b->nwarm + b->ntrials) {
+        done(b);
+        return 0;
+    }
+    b->i++;
+    b->usec0 = timer_get_usec();
+    b->cyc0 = cycle_cnt_read();
+    return 1;
+}
@@ -0,0 +1,53 @@
+// ring buffer side of binlog.h: init and shipping records to unix.
+#include "rpi.h"
+#include "binlog.h"
+#include "our-crc32.h"
+
+binlog_t binlog_ring;
+
+void binlog_init(void *buf, unsigned nbytes) {
+    unsigned nwords = nbytes / 4;
+    if(!nwords || (nwords & (nwords - 1)))
+        panic("binlog: size must be a power of two, have %d bytes\n", nbytes);
+    demand((uint32_t)buf % 4 == 0, binlog buffer must be word aligned);
+
+    cycle_cnt_init();
+    binlog_ring = (binlog_t) { .buf = buf, .nwords = nwords };
+}
+
+// the frame we send:
+//   word 0: BINLOG_MAGIC
+//   word 1: number of record words that follow.
+//   word 2: total records dropped so far.
+//   word 3: crc32 of the record words.
+//   word 4..: the records.
+// the unix side uses the magic to find frames in the uart's text
+// stream and the crc to make sure it didn't get fooled.
+void binlog_flush(void) {
+    binlog_t *b = &binlog_ring;
+
+    // records can keep arriving from interrupt handlers: we send
+    // up to <head> as of now and leave the rest for next time.
+    unsigned tail = b->tail, head = b->head;
+    unsigned n = head - tail;
+    if(!n)
+        return;
+
+    // the live part of the ring might wrap: send as two pieces.
+    unsigned mask = b->nwords - 1;
+    unsigned off = tail & mask;
+    unsigned n0 = n < b->nwords - off ? n : b->nwords - off;
+    uint32_t *p0 = &b->buf[off], *p1 = b->buf;
+    unsigned n1 = n - n0;
+
+    uint32_t crc = our_crc32(p0, n0*4);
+    crc = our_crc32_inc(p1, n1*4, crc);
+
+    uint32_t hdr[4] = { BINLOG_MAGIC, n, b->ndropped, crc };
+    rpi_putbuf(hdr, sizeof hdr);
+    rpi_putbuf(p0, n0*4);
+    if(n1)
+        rpi_putbuf(p1, n1*4);
+
+    b->tail = head;
+}
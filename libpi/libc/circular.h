@@ -13,6 +13,8 @@
 #   include <stdlib.h>
 #   include <string.h>
 #   define int_is_enabled() 0
+    // fake-pi's that model interrupts (e.g., fake-uart.c) define this.
+    int cpsr_int_enabled(void);
 //#   include "demand.h"
 #endif
 
@@ -29,6 +31,8 @@
 
 
 // make the code templatized on this? (ala fraser and hanson)  
+// ring-T.h does: typed elements, caller-sized storage, bulk ops and a
+// multi-producer variant.  new code should use that.
 #ifndef CQE_T
     typedef unsigned char cqe_t;
 #else
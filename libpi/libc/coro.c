@@ -0,0 +1,146 @@
+// the event loop for coro.h coroutines.
+//
+// a coroutine is on exactly one of: the run list, the poll list
+// (maybe with a timeout on the wheel), or only the wheel (sleeping).
+// running it takes it off everything; the wait macro it returns from
+// puts it back where it belongs.
+#include "rpi.h"
+#include "coro.h"
+
+static void q_append(coro_list_t *l, coro_t *c) {
+    c->next = 0;
+    c->prev = l->tail;
+    if(l->tail)
+        l->tail->next = c;
+    else
+        l->head = c;
+    l->tail = c;
+}
+
+static void q_remove(coro_list_t *l, coro_t *c) {
+    if(c->prev)
+        c->prev->next = c->next;
+    else
+        l->head = c->next;
+    if(c->next)
+        c->next->prev = c->prev;
+    else
+        l->tail = c->prev;
+    c->next = c->prev = 0;
+}
+
+static void make_runnable(coro_t *c) {
+    coro_sched_t *s = c->s;
+    if(c->state == CORO_POLLING)
+        q_remove(&s->pollq, c);
+    tw_cancel(&s->wheel, &c->timer);
+    c->state = CORO_RUNNABLE;
+    q_append(&s->runq, c);
+}
+
+void coro_sched_init(coro_sched_t *s) {
+    memset(s, 0, sizeof *s);
+    tw_init(&s->wheel, timer_get_usec64());
+}
+
+void coro_spawn(coro_sched_t *s, coro_t *c, coro_fn_t fn, const char *name) {
+    memset(c, 0, sizeof *c);
+    c->fn = fn;
+    c->name = name;
+    c->s = s;
+    s->ncoros++;
+    c->state = CORO_RUNNABLE;
+    q_append(&s->runq, c);
+}
+
+/******************************************************************
+ * waits: called by the macros while <c> is running.
+ */
+
+static void check_running(coro_t *c) {
+    if(c->state != CORO_RUNNING)
+        panic("coroutine <%s>: waiting while not running (state=%d)\n",
+            c->name, c->state);
+}
+
+// sleep or wait-ready timed out.
+static void timer_fired(tw_timer_t *t, void *arg) {
+    coro_t *c = arg;
+    c->timed_out = (c->state == CORO_POLLING);
+    make_runnable(c);
+}
+
+void coro_wait_ready_(coro_t *c, coro_ready_fn_t fn, void *arg, uint32_t usec) {
+    check_running(c);
+    c->ready = fn;
+    c->ready_arg = arg;
+    c->state = CORO_POLLING;
+    q_append(&c->s->pollq, c);
+    if(usec)
+        tw_add(&c->s->wheel, &c->timer, timer_get_usec64() + usec,
+                timer_fired, c);
+}
+
+void coro_sleep_until_(coro_t *c, uint64_t deadline) {
+    check_running(c);
+    c->state = CORO_SLEEPING;
+    tw_add(&c->s->wheel, &c->timer, deadline, timer_fired, c);
+}
+
+void coro_yield_(coro_t *c) {
+    check_running(c);
+    c->state = CORO_RUNNABLE;
+    q_append(&c->s->runq, c);
+}
+
+/******************************************************************
+ * the loop.
+ */
+
+static void resume(coro_sched_t *s, coro_t *c) {
+    c->state = CORO_RUNNING;
+    c->nresumes++;
+    s->nresumes++;
+    if(c->fn(c) == CORO_DONE) {
+        c->state = CORO_EXITED;
+        tw_cancel(&s->wheel, &c->timer);
+        s->ncoros--;
+        return;
+    }
+    if(c->state == CORO_RUNNING)
+        panic("coroutine <%s>: returned CORO_WAITING without waiting\n",
+            c->name);
+}
+
+unsigned coro_run_once(coro_sched_t *s) {
+    s->npasses++;
+    tw_run(&s->wheel, timer_get_usec64());
+
+    coro_t *c, *next;
+    for(c = s->pollq.head; c; c = next) {
+        next = c->next;
+        if(c->ready) {
+            s->npolls++;
+            if(!c->ready(c->ready_arg))
+                continue;
+        }
+        make_runnable(c);
+    }
+
+    // just the ones runnable now: a coroutine that yields goes again
+    // next pass, after the timers and pollers.
+    coro_list_t run = s->runq;
+    s->runq = (coro_list_t){0};
+    if(!run.head)
+        s->nidle++;
+    while((c = run.head)) {
+        q_remove(&run, c);
+        resume(s, c);
+    }
+    return s->ncoros;
+}
+
+void coro_run(coro_sched_t *s) {
+    while(coro_run_once(s))
+        ;
+}
@@ -0,0 +1,324 @@
+// pi side of the statistical profiler: see gprof.h.
+//
+// both tables are open addressed with linear probing and always keep
+// one slot empty so a lookup stops.  a sample that finds its table full
+// is counted as lost rather than evicting anything.
+#include "rpi.h"
+#include "gprof.h"
+#include "memmap.h"
+#include "our-crc32.h"
+#include "armv6-pmu.h"
+
+typedef struct {
+    uint32_t pc, n;
+} gprof_pc_t;
+
+typedef struct {
+    uint32_t n;
+    uint32_t hash;
+    uint32_t depth;
+    uint32_t pcs[GPROF_MAX_DEPTH];
+} gprof_stack_t;
+
+static gprof_pc_t *pcs;
+static gprof_stack_t *stacks;
+static unsigned pc_mask, stack_mask;
+
+static volatile int on_p;
+static unsigned nsamples, npcs, nstacks, nlost_pcs, nlost_stacks;
+
+static unsigned pow2_up(unsigned n) {
+    unsigned p = 2;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+
+void gprof_init(unsigned max_pcs, unsigned max_stacks) {
+    unsigned n = pow2_up(max_pcs ? max_pcs : GPROF_NPCS);
+    pcs = kmalloc(n * sizeof *pcs);
+    pc_mask = n - 1;
+
+    n = pow2_up(max_stacks ? max_stacks : GPROF_NSTACKS);
+    stacks = kmalloc(n * sizeof *stacks);
+    stack_mask = n - 1;
+
+    gprof_reset();
+    on_p = 1;
+}
+
+void gprof_reset(void) {
+    int on = gprof_enable(0);
+    memset(pcs, 0, (pc_mask + 1) * sizeof *pcs);
+    memset(stacks, 0, (stack_mask + 1) * sizeof *stacks);
+    nsamples = npcs = nstacks = nlost_pcs = nlost_stacks = 0;
+    gprof_enable(on);
+}
+
+int gprof_enable(int on) {
+    int old = on_p;
+    on_p = on;
+    return old;
+}
+
+static inline unsigned hash32(uint32_t x) {
+    return (x >> 2) * 2654435761u;
+}
+
+static void pc_inc(uint32_t pc) {
+    for(unsigned i = hash32(pc) & pc_mask; ; i = (i + 1) & pc_mask) {
+        gprof_pc_t *p = &pcs[i];
+        if(p->pc == pc && p->n) {
+            p->n++;
+            return;
+        }
+        if(!p->n) {
+            if(npcs == pc_mask) {
+                nlost_pcs++;
+                return;
+            }
+            npcs++;
+            p->pc = pc;
+            p->n = 1;
+            return;
+        }
+    }
+}
+
+static void stack_inc(const uint32_t *s, unsigned depth) {
+    uint32_t h = depth;
+    for(unsigned i = 0; i < depth; i++)
+        h = (h ^ s[i]) * 16777619u;
+
+    for(unsigned i = hash32(h) & stack_mask; ; i = (i + 1) & stack_mask) {
+        gprof_stack_t *e = &stacks[i];
+        if(!e->n) {
+            if(nstacks == stack_mask) {
+                nlost_stacks++;
+                return;
+            }
+            nstacks++;
+            e->n = 1;
+            e->hash = h;
+            e->depth = depth;
+            memcpy(e->pcs, s, depth * 4);
+            return;
+        }
+        if(e->hash == h && e->depth == depth
+        && memcmp(e->pcs, s, depth * 4) == 0) {
+            e->n++;
+            return;
+        }
+    }
+}
+
+void gprof_sample_stack(const uint32_t *s, unsigned depth) {
+    if(!on_p || !depth)
+        return;
+    if(depth > GPROF_MAX_DEPTH)
+        depth = GPROF_MAX_DEPTH;
+    nsamples++;
+    pc_inc(s[0]);
+    stack_inc(s, depth);
+}
+
+// is <pc> in our code?  stops the walk at garbage return addresses.
+static inline int code_p(uint32_t pc) {
+    return pc >= (uintptr_t)__code_start__ && pc < (uintptr_t)__code_end__;
+}
+
+// walk the -mapcs-frame frames: each function pushes {fp, ip, lr, pc}
+// and points fp at the saved pc, so
+//      fp[-1] = return address
+//      fp[-3] = caller's fp
+// the stack grows down, so each caller's frame must be above the last
+// one: anything else means the chain is garbage (or we interrupted a
+// prologue) and we stop.
+void gprof_sample(uint32_t pc, uint32_t fp) {
+    uint32_t s[GPROF_MAX_DEPTH];
+    unsigned n = 0;
+
+    if(!on_p)
+        return;
+    s[n++] = pc;
+    while(n < GPROF_MAX_DEPTH && fp >= 12 && fp % 4 == 0
+    && fp < 512*1024*1024) {
+        const uint32_t *f = (const uint32_t *)(uintptr_t)fp;
+        uint32_t ret = f[-1], next = f[-3];
+        if(!code_p(ret))
+            break;
+        s[n++] = ret;
+        if(next <= fp)
+            break;
+        fp = next;
+    }
+    gprof_sample_stack(s, n);
+}
+
+// frames go out in pieces: pass 0 just counts and crcs them, pass 1
+// sends them.
+static void emit(int pass, crc32_ctx_t *c, const void *p, unsigned nbytes) {
+    if(pass)
+        rpi_putbuf(p, nbytes);
+    else
+        crc32_ctx_update(c, p, nbytes);
+}
+
+// send one frame: <body> emits the words after the header.
+static void frame_send(void (*body)(int pass, crc32_ctx_t *c)) {
+    crc32_ctx_t c;
+    crc32_ctx_init(&c);
+    body(0, &c);
+    uint32_t frame[3] = { GPROF_MAGIC, c.nbytes / 4, crc32_ctx_final(&c) };
+    rpi_putbuf(frame, sizeof frame);
+    body(1, &c);
+    rpi_putbuf_flush();
+}
+
+static void samples_body(int pass, crc32_ctx_t *c) {
+    uint32_t hdr[6] = {
+        GPROF_SAMPLES, nsamples, npcs, nstacks, nlost_pcs, nlost_stacks
+    };
+    emit(pass, c, hdr, sizeof hdr);
+
+    for(unsigned i = 0; i <= pc_mask; i++)
+        if(pcs[i].n)
+            emit(pass, c, &pcs[i], sizeof pcs[i]);
+    for(unsigned i = 0; i <= stack_mask; i++) {
+        gprof_stack_t *e = &stacks[i];
+        if(!e->n)
+            continue;
+        uint32_t h[2] = { e->n, e->depth };
+        emit(pass, c, h, sizeof h);
+        emit(pass, c, e->pcs, e->depth * 4);
+    }
+}
+
+void gprof_dump(void) {
+    int on = gprof_enable(0);
+    frame_send(samples_body);
+    gprof_enable(on);
+}
+
+/**********************************************************************
+ * hardware events.
+ */
+
+// the events we rotate through.  the first pair has the instruction
+// count so the unix side can compute CPI and per-instruction rates.
+static const uint8_t pmu_pairs[GPROF_PMU_NPAIRS][2] = {
+    { PMU_INST_CNT,         PMU_ICACHE_MISS },
+    { PMU_DCACHE_MISS,      PMU_BRANCH_MISPREDICT },
+    { PMU_MAIN_TLB_MISS,    PMU_INST_STALL },
+    { PMU_DATA_STALL,       PMU_DCACHE_ACCESS },
+};
+
+typedef struct {
+    uint32_t pc, nticks;
+    // cycles, event0 and event1 while each pair was counting.
+    uint32_t n[GPROF_PMU_NPAIRS][3];
+} gprof_pmu_pc_t;
+
+static gprof_pmu_pc_t *pmu_pcs;
+static unsigned pmu_mask, pmu_npcs, pmu_nlost, pmu_nticks;
+static volatile int pmu_on_p;
+
+// the pair that is counting, how many ticks it's had, and the counter
+// values at the end of the last tick.
+static unsigned pair, pair_ticks;
+static uint32_t last_cyc, last0, last1;
+
+// point the two event counters at <pmu_pairs[p]>.  one write so both
+// start (from zero) together.
+static void pmu_pair_set(unsigned p) {
+    uint32_t r = pmu_control_get();
+    r = bits_set(r, 20, 27, pmu_pairs[p][0]);
+    r = bits_set(r, 12, 19, pmu_pairs[p][1]);
+    pmu_control_config(r | 0b11);
+    pair = p;
+    pair_ticks = 0;
+}
+
+// read the counters at the end of a tick so the next interval doesn't
+// include our own bookkeeping.
+static void pmu_mark(void) {
+    last0 = pmu_event0_get();
+    last1 = pmu_event1_get();
+    last_cyc = pmu_cycle_get();
+}
+
+void gprof_pmu_init(unsigned max_pcs) {
+    unsigned n = pow2_up(max_pcs ? max_pcs : GPROF_PMU_NPCS);
+    pmu_pcs = kmalloc(n * sizeof *pmu_pcs);
+    pmu_mask = n - 1;
+    pmu_npcs = pmu_nlost = pmu_nticks = 0;
+
+    pmu_pair_set(0);
+    pmu_mark();
+    pmu_on_p = 1;
+}
+
+int gprof_pmu_enable(int on) {
+    int old = pmu_on_p;
+    pmu_on_p = on;
+    // don't charge the time we were off to the next sample.
+    if(on && !old)
+        pmu_mark();
+    return old;
+}
+
+static gprof_pmu_pc_t *pmu_lookup(uint32_t pc) {
+    for(unsigned i = hash32(pc) & pmu_mask; ; i = (i + 1) & pmu_mask) {
+        gprof_pmu_pc_t *e = &pmu_pcs[i];
+        if(e->pc == pc && e->nticks)
+            return e;
+        if(!e->nticks) {
+            if(pmu_npcs == pmu_mask)
+                return 0;
+            pmu_npcs++;
+            e->pc = pc;
+            return e;
+        }
+    }
+}
+
+void gprof_pmu_sample(uint32_t pc) {
+    if(!pmu_on_p)
+        return;
+    uint32_t cyc = pmu_cycle_get();
+    uint32_t e0 = pmu_event0_get(), e1 = pmu_event1_get();
+
+    pmu_nticks++;
+    gprof_pmu_pc_t *e = pmu_lookup(pc);
+    if(!e)
+        pmu_nlost++;
+    else {
+        e->nticks++;
+        e->n[pair][0] += cyc - last_cyc;
+        e->n[pair][1] += e0 - last0;
+        e->n[pair][2] += e1 - last1;
+    }
+    if(++pair_ticks == GPROF_PMU_ROTATE)
+        pmu_pair_set((pair + 1) % GPROF_PMU_NPAIRS);
+    pmu_mark();
+}
+
+static void pmu_body(int pass, crc32_ctx_t *c) {
+    uint32_t hdr[5] = {
+        GPROF_PMU, pmu_nticks, GPROF_PMU_NPAIRS, pmu_npcs, pmu_nlost
+    };
+    emit(pass, c, hdr, sizeof hdr);
+    for(unsigned p = 0; p < GPROF_PMU_NPAIRS; p++) {
+        uint32_t ev[2] = { pmu_pairs[p][0], pmu_pairs[p][1] };
+        emit(pass, c, ev, sizeof ev);
+    }
+    for(unsigned i = 0; i <= pmu_mask; i++)
+        if(pmu_pcs[i].nticks)
+            emit(pass, c, &pmu_pcs[i], sizeof pmu_pcs[i]);
+}
+
+void gprof_pmu_dump(void) {
+    int on = gprof_pmu_enable(0);
+    frame_send(pmu_body);
+    gprof_pmu_enable(on);
+}
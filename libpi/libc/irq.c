@@ -0,0 +1,163 @@
+// per-source interrupt dispatch: see irq.h
+#include "rpi.h"
+#include "irq.h"
+#include "asm-helpers.h"
+
+typedef struct {
+    irq_fn_t fn;
+    void *arg;
+} handler_t;
+
+// the FIQ trampoline loads these directly (irq-asm.S).
+handler_t fiq_handler;
+
+static handler_t handlers[IRQ_NSOURCES];
+// the sources we enabled, in the layout of pending 1, pending 2 and
+// basic pending: sources we didn't enable can still show up pending.
+static uint32_t enabled[3];
+static int fiq_src = -1;
+
+volatile unsigned irq_nspurious;
+
+// basic pending bits 8 and 9 say pending 1/2 have something, except
+// for the GPU interrupts that also have their own bit in 10..20 (p113):
+// those don't set 8 or 9.
+enum {
+    PENDING1_BITS = 1 << 8 | 0b11111 << 10,     // + GPU 7,9,10,18,19
+    PENDING2_BITS = 1 << 9 | 0b111111 << 15,    // + GPU 53..57,62
+    BASIC_BITS    = 0xff,
+};
+
+void irq_stacks_set(uint32_t irq_sp, uint32_t fiq_sp);
+extern uint32_t irq_vector_table[];
+
+// the vector base register: arm1176 3-121.
+void *irq_vector_base_set(void *vec) {
+    if((uint32_t)vec % 32)
+        panic("vector base %p must be 32-byte aligned\n", vec);
+    void *old;
+    asm volatile("mrc p15, 0, %0, c12, c0, 0" : "=r"(old));
+    asm volatile("mcr p15, 0, %0, c12, c0, 0" :: "r"(vec));
+    prefetch_flush();
+    return old;
+}
+
+static void bad_source(unsigned src) {
+    if(src >= IRQ_NSOURCES)
+        panic("interrupt source %d: must be less than %d\n", src, IRQ_NSOURCES);
+}
+
+// the register for <src> given the bank's first (Enable or Disable)
+// register: 1 and 2 are next to each other, basic is two after.
+static uint32_t reg(uint32_t bank1, unsigned src) {
+    if(src >= IRQ_ARM_BASE)
+        return bank1 + 8;
+    return bank1 + 4 * (src / 32);
+}
+
+void irq_init(void) {
+    cpsr_int_disable();
+    fiq_disable();
+
+    dev_barrier();
+    PUT32(IRQ_FIQ_control, 0);
+    PUT32(IRQ_Disable_1, 0xffffffff);
+    PUT32(IRQ_Disable_2, 0xffffffff);
+    PUT32(IRQ_Disable_Basic, 0xffffffff);
+    dev_barrier();
+
+    memset(handlers, 0, sizeof handlers);
+    memset(enabled, 0, sizeof enabled);
+    fiq_src = -1;
+
+    irq_stacks_set(INT_STACK_ADDR, INT_STACK_ADDR2);
+    irq_vector_base_set(irq_vector_table);
+}
+
+void irq_register(unsigned src, irq_fn_t fn, void *arg) {
+    bad_source(src);
+    assert(fn);
+    if(src == fiq_src)
+        panic("source %d is on the FIQ\n", src);
+
+    uint32_t cpsr = cpsr_int_disable();
+    handlers[src] = (handler_t){ .fn = fn, .arg = arg };
+    enabled[src / 32] |= 1 << (src % 32);
+    dev_barrier();
+    PUT32(reg(IRQ_Enable_1, src), 1 << (src % 32));
+    dev_barrier();
+    cpsr_int_reset(cpsr);
+}
+
+void irq_unregister(unsigned src) {
+    bad_source(src);
+
+    uint32_t cpsr = cpsr_int_disable();
+    dev_barrier();
+    PUT32(reg(IRQ_Disable_1, src), 1 << (src % 32));
+    dev_barrier();
+    enabled[src / 32] &= ~(1 << (src % 32));
+    handlers[src] = (handler_t){0};
+    cpsr_int_reset(cpsr);
+}
+
+// bcm p116: a source routed to the FIQ should not be enabled as an IRQ.
+void fiq_register(unsigned src, irq_fn_t fn, void *arg) {
+    bad_source(src);
+    assert(fn);
+    if(fiq_src >= 0 && fiq_src != src)
+        panic("FIQ already taken by source %d\n", fiq_src);
+    if(handlers[src].fn)
+        irq_unregister(src);
+    else {
+        dev_barrier();
+        PUT32(reg(IRQ_Disable_1, src), 1 << (src % 32));
+    }
+
+    fiq_disable();
+    fiq_handler = (handler_t){ .fn = fn, .arg = arg };
+    fiq_src = src;
+    dev_barrier();
+    PUT32(IRQ_FIQ_control, 1 << 7 | src);
+    dev_barrier();
+}
+
+void fiq_unregister(void) {
+    fiq_disable();
+    dev_barrier();
+    PUT32(IRQ_FIQ_control, 0);
+    dev_barrier();
+    fiq_handler = (handler_t){0};
+    fiq_src = -1;
+}
+
+// call the handlers for the bits in <pending>, highest first.
+static inline void run(uint32_t pending, handler_t *h, uint32_t pc) {
+    do {
+        unsigned b = 31 - __builtin_clz(pending);
+        pending &= ~(1 << b);
+        h[b].fn(pc, h[b].arg);
+    } while(pending);
+}
+
+void irq_dispatch(uint32_t pc) {
+    dev_barrier();
+    uint32_t basic = GET32(IRQ_basic_pending);
+    uint32_t p, handled = 0;
+
+    if((p = basic & BASIC_BITS & enabled[2])) {
+        run(p, &handlers[IRQ_ARM_BASE], pc);
+        handled = 1;
+    }
+    if(basic & PENDING1_BITS && (p = GET32(IRQ_pending_1) & enabled[0])) {
+        run(p, &handlers[0], pc);
+        handled = 1;
+    }
+    if(basic & PENDING2_BITS && (p = GET32(IRQ_pending_2) & enabled[1])) {
+        run(p, &handlers[32], pc);
+        handled = 1;
+    }
+    if(!handled)
+        irq_nspurious++;
+    dev_barrier();
+}
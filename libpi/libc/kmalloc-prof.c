@@ -0,0 +1,271 @@
+// instrumented kmalloc/slab_alloc: see kmalloc-prof.h.
+//
+// libpi itself is never built with KMALLOC_PROF, so the kmalloc and
+// slab_alloc we call here are the real ones.  none of this is linked in
+// unless something compiled with -DKMALLOC_PROF calls it.
+//
+// each object is laid out as
+//      [pad][kp_hdr_t][object: nbytes][redzone: KMALLOC_PROF_RZ_NBYTES]
+// where the pad (if any) is to get <align>.  freed slab objects sit in
+// a small quarantine, poisoned, before we really free them so a double
+// free or a write after free has a chance to be caught before the
+// memory gets reused.
+#undef KMALLOC_PROF
+#include "rpi.h"
+#include "slab.h"
+#include "kmalloc-prof.h"
+
+enum {
+    KP_LIVE     = 0x4b4d4c56,       // "KMLV"
+    KP_FREED    = 0x4b4d4644,       // "KMFD"
+    KP_GUARD    = 0xfeedface,
+    KP_RZ_BYTE  = 0xfd,
+    KP_NQUAR    = 64,               // frees we hold on to.
+    KP_OTHER    = 0xffff,           // site of pcs that didn't fit.
+};
+
+// a multiple of 8 bytes with no padding (32 or 64-bit pointers) so the
+// guard is right before the object.
+typedef struct kp_hdr {
+    struct kp_hdr *next, *prev;     // live list.
+    uint32_t magic;                 // KP_LIVE or KP_FREED.
+    uint32_t nbytes;
+    uint32_t pc, free_pc;
+    uint32_t usec;                  // when allocated.
+    uint16_t site;
+    uint16_t slab_p;
+    uint32_t base_off;              // back to what we allocated.
+    uint32_t guard;
+} kp_hdr_t;
+_Static_assert(sizeof(kp_hdr_t) % 8 == 0, "kp_hdr_t must be 8-byte sized");
+_Static_assert(__builtin_offsetof(kp_hdr_t, guard) + 4 == sizeof(kp_hdr_t),
+    "guard must be last");
+
+static kmalloc_prof_site_t sites[KMALLOC_PROF_NSITES], other;
+static unsigned nsites;
+
+static kmalloc_prof_rec_t recs[KMALLOC_PROF_NLOG];
+static unsigned nlog;               // total ever: wraps the ring.
+
+static kp_hdr_t live = { .next = &live, .prev = &live };
+
+static kp_hdr_t *quar[KP_NQUAR];
+static unsigned nquar;              // total ever: wraps the ring.
+
+static inline void *obj(kp_hdr_t *h) { return h + 1; }
+
+static kmalloc_prof_site_t *site_get(unsigned i) {
+    return i == KP_OTHER ? &other : &sites[i];
+}
+
+// slot for <pc>: open addressing on the pc.
+static unsigned site_lookup(uint32_t pc) {
+    unsigned i = ((pc >> 2) * 2654435761u) >> 24;
+    for(unsigned n = 0; n < KMALLOC_PROF_NSITES; n++) {
+        kmalloc_prof_site_t *s = &sites[i];
+        if(s->pc == pc)
+            return i;
+        if(!s->pc) {
+            // keep one slot free so lookups always stop.
+            if(nsites == KMALLOC_PROF_NSITES - 1)
+                return KP_OTHER;
+            nsites++;
+            s->pc = pc;
+            s->min_nbytes = ~0;
+            return i;
+        }
+        i = (i + 1) % KMALLOC_PROF_NSITES;
+    }
+    return KP_OTHER;
+}
+
+// 0 if <h>'s guard and redzone are intact, otherwise what's wrong.
+static const char *hdr_bad(kp_hdr_t *h) {
+    if(h->guard != KP_GUARD)
+        return "header guard overwritten (underflow?)";
+    if(h->magic != KP_LIVE && h->magic != KP_FREED)
+        return "header overwritten (underflow?)";
+    uint8_t *rz = (uint8_t *)obj(h) + h->nbytes;
+    for(unsigned i = 0; i < KMALLOC_PROF_RZ_NBYTES; i++)
+        if(rz[i] != KP_RZ_BYTE)
+            return "redzone overwritten (overflow)";
+    if(h->magic == KP_FREED) {
+        uint8_t *p = obj(h);
+        for(unsigned i = 0; i < h->nbytes; i++)
+            if(p[i] != KMALLOC_PROF_POISON)
+                return "written after free";
+    }
+    return 0;
+}
+
+static void hdr_print(kp_hdr_t *h, const char *msg) {
+    printk("KMALLOC-PROF: %p: %d bytes allocated at pc=%x (usec=%d)", obj(h),
+        h->nbytes, h->pc, h->usec);
+    if(h->magic == KP_FREED)
+        printk(", freed at pc=%x", h->free_pc);
+    printk(": %s\n", msg);
+}
+
+void *kmalloc_prof_alloc(unsigned nbytes, unsigned align, int zero_p, int slab_p) {
+    uint32_t pc = (uintptr_t)__builtin_return_address(0);
+    if(!align || (align & (align - 1)))
+        panic("kmalloc_prof: bad alignment %d at pc=%x\n", align, pc);
+    if(align < 8)
+        align = 8;
+
+    // base is 8-aligned: pad so the object can be moved up to <align>.
+    unsigned tot = align - 8 + sizeof(kp_hdr_t) + nbytes + KMALLOC_PROF_RZ_NBYTES;
+    uint8_t *base = slab_p ? slab_alloc_notzero(tot) : kmalloc_notzero(tot);
+    uintptr_t o = ((uintptr_t)base + sizeof(kp_hdr_t) + align - 1)
+                    & ~(uintptr_t)(align - 1);
+    kp_hdr_t *h = (kp_hdr_t *)o - 1;
+
+    unsigned si = site_lookup(pc);
+    uint32_t usec = timer_get_usec();
+    *h = (kp_hdr_t) {
+        .magic = KP_LIVE,
+        .nbytes = nbytes,
+        .pc = pc,
+        .usec = usec,
+        .site = si,
+        .slab_p = slab_p,
+        .base_off = (uint8_t *)h - base,
+        .guard = KP_GUARD,
+    };
+    if(zero_p)
+        memset(obj(h), 0, nbytes);
+    memset((uint8_t *)obj(h) + nbytes, KP_RZ_BYTE, KMALLOC_PROF_RZ_NBYTES);
+
+    h->next = live.next;
+    h->prev = &live;
+    live.next->prev = h;
+    live.next = h;
+
+    kmalloc_prof_site_t *s = site_get(si);
+    s->nalloc++;
+    s->nbytes += nbytes;
+    s->live_bytes += nbytes;
+    if(nbytes < s->min_nbytes)
+        s->min_nbytes = nbytes;
+    if(nbytes > s->max_nbytes)
+        s->max_nbytes = nbytes;
+
+    recs[nlog++ % KMALLOC_PROF_NLOG] = (kmalloc_prof_rec_t) {
+        .pc = pc,
+        .nbytes = nbytes,
+        .usec = usec,
+    };
+    return obj(h);
+}
+
+// really free <h>: the oldest thing in the quarantine.
+static void release(kp_hdr_t *h) {
+    const char *bad = hdr_bad(h);
+    if(bad) {
+        hdr_print(h, bad);
+        panic("kmalloc_prof: heap corruption\n");
+    }
+    slab_free((uint8_t *)h - h->base_off);
+}
+
+void kmalloc_prof_free(void *p) {
+    uint32_t pc = (uintptr_t)__builtin_return_address(0);
+    if(!p)
+        return;
+
+    kp_hdr_t *h = (kp_hdr_t *)p - 1;
+    if(h->magic == KP_FREED && h->guard == KP_GUARD) {
+        hdr_print(h, "freed again");
+        panic("kmalloc_prof: double free of %p at pc=%x\n", p, pc);
+    }
+    if(h->magic != KP_LIVE || h->guard != KP_GUARD)
+        panic("kmalloc_prof: slab_free(%p) at pc=%x: not allocated here "
+              "or its header was overwritten\n", p, pc);
+    if(!h->slab_p) {
+        hdr_print(h, "kmalloc'd, not slab_alloc'd");
+        panic("kmalloc_prof: slab_free(%p) at pc=%x\n", p, pc);
+    }
+    const char *bad = hdr_bad(h);
+    if(bad) {
+        hdr_print(h, bad);
+        panic("kmalloc_prof: heap corruption found by free at pc=%x\n", pc);
+    }
+
+    h->prev->next = h->next;
+    h->next->prev = h->prev;
+    kmalloc_prof_site_t *s = site_get(h->site);
+    s->nfree++;
+    s->live_bytes -= h->nbytes;
+
+    h->magic = KP_FREED;
+    h->free_pc = pc;
+    memset(p, KMALLOC_PROF_POISON, h->nbytes);
+
+    kp_hdr_t **q = &quar[nquar++ % KP_NQUAR];
+    if(*q)
+        release(*q);
+    *q = h;
+}
+
+unsigned kmalloc_prof_check(void) {
+    unsigned nbad = 0;
+    const char *bad;
+
+    for(kp_hdr_t *h = live.next; h != &live; h = h->next)
+        if((bad = hdr_bad(h))) {
+            hdr_print(h, bad);
+            nbad++;
+        }
+    for(unsigned i = 0; i < KP_NQUAR; i++)
+        if(quar[i] && (bad = hdr_bad(quar[i]))) {
+            hdr_print(quar[i], bad);
+            nbad++;
+        }
+    return nbad;
+}
+
+void kmalloc_prof_dump(void) {
+    // biggest first: selection sort is fine for a few hundred.
+    uint16_t order[KMALLOC_PROF_NSITES + 1];
+    unsigned n = 0, nalloc = 0, live_bytes = 0;
+    for(unsigned i = 0; i < KMALLOC_PROF_NSITES; i++)
+        if(sites[i].nalloc)
+            order[n++] = i;
+    if(other.nalloc)
+        order[n++] = KP_OTHER;
+
+    for(unsigned i = 0; i < n; i++) {
+        unsigned m = i;
+        for(unsigned j = i + 1; j < n; j++)
+            if(site_get(order[j])->nbytes > site_get(order[m])->nbytes)
+                m = j;
+        uint16_t t = order[i];
+        order[i] = order[m];
+        order[m] = t;
+
+        kmalloc_prof_site_t *s = site_get(order[i]);
+        nalloc += s->nalloc;
+        live_bytes += s->live_bytes;
+    }
+
+    printk("KMALLOC-PROF: %d sites, %d allocations, %d bytes live\n",
+        n, nalloc, live_bytes);
+    for(unsigned i = 0; i < n; i++) {
+        kmalloc_prof_site_t *s = site_get(order[i]);
+        printk("  pc=%x: %d allocs, %d frees, %d bytes (%d live), sizes %d..%d\n",
+            s->pc, s->nalloc, s->nfree, s->nbytes, s->live_bytes,
+            s->min_nbytes, s->max_nbytes);
+    }
+}
+
+void kmalloc_prof_dump_log(unsigned n) {
+    if(n > nlog)
+        n = nlog;
+    if(n > KMALLOC_PROF_NLOG)
+        n = KMALLOC_PROF_NLOG;
+    printk("KMALLOC-PROF: last %d of %d allocations:\n", n, nlog);
+    for(unsigned i = nlog - n; i < nlog; i++) {
+        kmalloc_prof_rec_t *r = &recs[i % KMALLOC_PROF_NLOG];
+        printk("  usec=%d: pc=%x: %d bytes\n", r->usec, r->pc, r->nbytes);
+    }
+}
@@ -1,6 +1,7 @@
 #ifndef __LLMEMCPY_H__
 #define __LLMEMCPY_H__
 #include "pointer-T.h"
+#include "memcpy-engine.h"
 
 #if 0
 #define aligned(ptr, n)  ((unsigned)ptr % n == 0)
@@ -27,12 +28,8 @@ lmemcpy(void *dst, void *src, size_t nbytes) {
     assert(nbytes%4 == 0);
     assert(is_aligned4(dst));
 
-    uint32_t *to = dst;
-    uint32_t *from = src;
-    uint32_t n = nbytes / 4;
-
-    for(unsigned i = 0; i < n; i++)
-        to[i] = from[i];
+    // if <src> is aligned too this is all ldm/stm + words.
+    mcpy_fwd(dst, src, nbytes);
 }
 
 static inline void 
@@ -42,11 +39,6 @@ llmemcpy(void *dst, void *src, size_t nbytes) {
     assert(nbytes%8 == 0);
     assert(is_aligned8(dst));
 
-    uint64_t *to = dst;
-    uint64_t *from = src;
-    uint32_t n = nbytes / 8;
-
-    for(unsigned i = 0; i < n; i++)
-        to[i] = from[i];
+    mcpy_fwd(dst, src, nbytes);
 }
 #endif
@@ -0,0 +1,238 @@
+#ifndef __MEMCPY_ENGINE_H__
+#define __MEMCPY_ENGINE_H__
+// the copy engine used by memcpy, memmove, memcpy256 and lmemcpy.h.
+//
+// picks a path based on size and alignment:
+//   1. small copies (< MCPY_SMALL bytes): words then bytes if both
+//      pointers are word-aligned, otherwise a byte loop --- setup for
+//      the other paths costs more than it saves.
+//   2. byte copy the head until <dst> is word-aligned.
+//   3. if <src> is now also word-aligned: copy 32-byte blocks with
+//      8-register ldm/stm (memcpy-asm.S), then words.
+//   4. otherwise: load aligned words from <src> and shift-and-merge
+//      adjacent pairs so we only ever do aligned word stores.
+//   5. byte copy the tail (< 4 bytes).
+//
+// the shift-and-merge path reads whole aligned words that can include
+// a few bytes before/after the source range.   every such word
+// contains at least one byte of the range, so it can never cross into
+// another page.
+//
+// NOTE:
+//  - the merge code assumes little-endian, which is what we run the
+//    arm1176 in.
+//  - this file does not include rpi.h so that we can compile it
+//    directly on unix (RPI_UNIX) to check it against libc.
+#include <stdint.h>
+#include <stddef.h>
+
+// anything smaller than this skips the alignment fixups: word copied
+// if it's already aligned, byte copied if not.
+#define MCPY_SMALL 16
+
+// word type that gcc will not use for aliasing assumptions: memcpy
+// gets called on every type under the sun.
+typedef uint32_t __attribute__((may_alias)) mcpy_u32;
+
+#ifndef RPI_UNIX
+// copy <nblk> 32-byte blocks from <src> to <dst> using 8-register
+// ldm/stm with a pld prefetch.  both must be word-aligned.
+void memcpy_blk32(void *dst, const void *src, unsigned nblk);
+
+// same, but copy backwards: <dst_end> and <src_end> point one past
+// the last byte to copy.  used by memmove for overlapping copies.
+void memcpy_blk32_rev(void *dst_end, const void *src_end, unsigned nblk);
+#else
+// unix versions so we can check the engine logic on our laptop.
+static inline void
+memcpy_blk32(void *dst, const void *src, unsigned nblk) {
+    mcpy_u32 *d = dst;
+    const mcpy_u32 *s = src;
+    for(; nblk; nblk--, d += 8, s += 8) {
+        uint32_t r0 = s[0], r1 = s[1], r2 = s[2], r3 = s[3],
+                 r4 = s[4], r5 = s[5], r6 = s[6], r7 = s[7];
+        d[0] = r0; d[1] = r1; d[2] = r2; d[3] = r3;
+        d[4] = r4; d[5] = r5; d[6] = r6; d[7] = r7;
+    }
+}
+static inline void
+memcpy_blk32_rev(void *dst_end, const void *src_end, unsigned nblk) {
+    mcpy_u32 *d = dst_end;
+    const mcpy_u32 *s = src_end;
+    for(; nblk; nblk--) {
+        d -= 8; s -= 8;
+        uint32_t r0 = s[0], r1 = s[1], r2 = s[2], r3 = s[3],
+                 r4 = s[4], r5 = s[5], r6 = s[6], r7 = s[7];
+        d[0] = r0; d[1] = r1; d[2] = r2; d[3] = r3;
+        d[4] = r4; d[5] = r5; d[6] = r6; d[7] = r7;
+    }
+}
+#endif
+
+// how far ahead (in bytes) the C loops prefetch.
+#define MCPY_PLD_AHEAD 64
+#define mcpy_pld(p) __builtin_prefetch(p)
+
+// forward shift-and-merge: <*dp> is word aligned, <*sp> is off by <off>
+// (1,2,3) bytes.  copies all full words of <n> and returns the bytes
+// left over (< 4); updates <*dp> and <*sp>.
+static inline size_t
+mcpy_merge_fwd(uint8_t **dp, const uint8_t **sp, size_t n, unsigned off) {
+    mcpy_u32 *d = (void *)*dp;
+    const mcpy_u32 *s = (const void *)(*sp - off);
+    unsigned lsh = off * 8, rsh = 32 - lsh;
+
+    // every word we load holds at least one byte of the source.
+    uint32_t cur = *s++;
+    size_t m = n / 4;
+    for(; m >= 4; m -= 4, s += 4, d += 4) {
+        mcpy_pld((const uint8_t *)s + MCPY_PLD_AHEAD);
+        uint32_t a = s[0], b = s[1], c = s[2], e = s[3];
+        d[0] = (cur >> lsh) | (a << rsh);
+        d[1] = (a >> lsh)   | (b << rsh);
+        d[2] = (b >> lsh)   | (c << rsh);
+        d[3] = (c >> lsh)   | (e << rsh);
+        cur = e;
+    }
+    for(; m; m--) {
+        uint32_t a = *s++;
+        *d++ = (cur >> lsh) | (a << rsh);
+        cur = a;
+    }
+    // bytes [off..3] of <cur> have not been copied yet.
+    *dp = (uint8_t *)d;
+    *sp = (const uint8_t *)(s - 1) + off;
+    return n % 4;
+}
+
+// backward shift-and-merge: <*dp> and <*sp> point one past the end.
+// <*dp> is word-aligned, <*sp> is off by <off>.
+static inline size_t
+mcpy_merge_bwd(uint8_t **dp, const uint8_t **sp, size_t n, unsigned off) {
+    mcpy_u32 *d = (void *)*dp;
+    const mcpy_u32 *s = (const void *)(*sp - off);
+    unsigned lsh = off * 8, rsh = 32 - lsh;
+
+    // the first <off> bytes of this word are the last <off> bytes
+    // of the source.
+    uint32_t hi = *s;
+    size_t m = n / 4;
+    for(; m >= 4; m -= 4) {
+        s -= 4; d -= 4;
+        mcpy_pld((const uint8_t *)s - MCPY_PLD_AHEAD);
+        uint32_t e = s[3], c = s[2], b = s[1], a = s[0];
+        d[3] = (e >> lsh) | (hi << rsh);
+        d[2] = (c >> lsh) | (e << rsh);
+        d[1] = (b >> lsh) | (c << rsh);
+        d[0] = (a >> lsh) | (b << rsh);
+        hi = a;
+    }
+    for(; m; m--) {
+        uint32_t lo = *--s;
+        *--d = (lo >> lsh) | (hi << rsh);
+        hi = lo;
+    }
+    *dp = (uint8_t *)d;
+    *sp = (const uint8_t *)s + off;
+    return n % 4;
+}
+
+// copy <n> bytes from <src> to <dst> going low to high.  this is
+// safe for overlapping copies where <dst> <= <src>.
+static inline void *
+mcpy_fwd(void *dst, const void *src, size_t n) {
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+    if(n < MCPY_SMALL) {
+        // small aligned structs (device registers!) still get words.
+        if(((uintptr_t)d | (uintptr_t)s) % 4 == 0)
+            for(; n >= 4; n -= 4, d += 4, s += 4)
+                *(mcpy_u32 *)d = *(const mcpy_u32 *)s;
+        while(n--)
+            *d++ = *s++;
+        return dst;
+    }
+
+    // head: get <dst> word-aligned.
+    for(; (uintptr_t)d % 4; n--)
+        *d++ = *s++;
+
+    unsigned off = (uintptr_t)s % 4;
+    if(off)
+        n = mcpy_merge_fwd(&d, &s, n, off);
+    else {
+        unsigned nblk = n / 32;
+        if(nblk) {
+            memcpy_blk32(d, s, nblk);
+            d += nblk * 32;
+            s += nblk * 32;
+            n %= 32;
+        }
+        for(; n >= 4; n -= 4, d += 4, s += 4)
+            *(mcpy_u32 *)d = *(const mcpy_u32 *)s;
+    }
+
+    // tail.
+    while(n--)
+        *d++ = *s++;
+    return dst;
+}
+
+// copy <n> bytes from <src> to <dst> going high to low.  this is
+// safe for overlapping copies where <dst> >= <src>.
+static inline void *
+mcpy_bwd(void *dst, const void *src, size_t n) {
+    uint8_t *d = (uint8_t *)dst + n;
+    const uint8_t *s = (const uint8_t *)src + n;
+
+    if(n < MCPY_SMALL) {
+        if(((uintptr_t)d | (uintptr_t)s) % 4 == 0)
+            for(; n >= 4; n -= 4) {
+                d -= 4; s -= 4;
+                *(mcpy_u32 *)d = *(const mcpy_u32 *)s;
+            }
+        while(n--)
+            *--d = *--s;
+        return dst;
+    }
+
+    // tail: get the end of <dst> word-aligned.
+    for(; (uintptr_t)d % 4; n--)
+        *--d = *--s;
+
+    unsigned off = (uintptr_t)s % 4;
+    if(off)
+        n = mcpy_merge_bwd(&d, &s, n, off);
+    else {
+        unsigned nblk = n / 32;
+        if(nblk) {
+            memcpy_blk32_rev(d, s, nblk);
+            d -= nblk * 32;
+            s -= nblk * 32;
+            n %= 32;
+        }
+        for(; n >= 4; n -= 4) {
+            d -= 4; s -= 4;
+            *(mcpy_u32 *)d = *(const mcpy_u32 *)s;
+        }
+    }
+
+    // head.
+    while(n--)
+        *--d = *--s;
+    return dst;
+}
+
+// handles any overlap.
+static inline void *
+mcpy_move(void *dst, const void *src, size_t n) {
+    uintptr_t d = (uintptr_t)dst, s = (uintptr_t)src;
+
+    if(d == s || !n)
+        return dst;
+    if(d < s || d >= s + n)
+        return mcpy_fwd(dst, src, n);
+    return mcpy_bwd(dst, src, n);
+}
+#endif
@@ -1,10 +1,8 @@
 #include "rpi.h"
+#include "word-at-a-time.h"
 
-int memiszero(const void *_p, unsigned n) {
-    const char *p = _p;
-    for(int i = 0; i < n; i++)
-        if(p[i] != 0)
-            return 0;
-    return 1;
+// used to scan whole sd sectors and page tables, so it's worth
+// doing 32 bytes at a time.
+int memiszero(const void *p, unsigned n) {
+    return wat_memiszero(p,n);
 }
-
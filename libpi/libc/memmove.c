@@ -1,19 +1,8 @@
 #include "rpi.h"
+#include "memcpy-engine.h"
 
+// uses the same engine as memcpy: copies forward if <dst> is below
+// <src> (or they don't overlap) and backward otherwise.
 void *memmove(void *dst, const void *src, size_t count) {
-  char *a = dst;
-  const char *b = src;
-
-  if (src == dst)
-    return dst;
-
-  if (src>dst) {
-    while (count--) *a++ = *b++;
-  } else {
-    a+=count-1;
-    b+=count-1;
-    while (count--) *a-- = *b--;
-  }
-
-  return dst;
+    return mcpy_move(dst, src, count);
 }
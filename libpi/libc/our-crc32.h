@@ -1,2 +1,51 @@
+#ifndef __OUR_CRC32_H__
+#define __OUR_CRC32_H__
+#include <stdint.h>
+// standard CRC32 (the zlib/ethernet one).  the same our-crc32.c is
+// compiled into both libpi and libunix so the two sides always agree.
+
+// builds the tables.  the first crc does it if you don't, but that
+// is not interrupt safe: call this first if an interrupt handler will
+// use the crc routines.  multiple calls are fine.
+void our_crc32_init(void);
+
 uint32_t our_crc32(const void *buf, unsigned size);
+// our_crc32_inc(buf,size,0) is the same as our_crc32 
 uint32_t our_crc32_inc(const void *buf, unsigned size, uint32_t crc);
+
+// given <crc1> = crc of A and <crc2> = crc of B (where B is <len2> 
+// bytes), returns the crc of A followed by B.  lets you crc chunks
+// separately (or out of order) and merge them.  cost is O(log len2).
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint32_t len2);
+
+// streaming interface: 
+//      crc32_ctx_t c;
+//      crc32_ctx_init(&c);
+//      crc32_ctx_update(&c, p0, n0);
+//      crc32_ctx_update(&c, p1, n1);
+//      crc = crc32_ctx_final(&c);
+// gives the same result as our_crc32 on the concatenated buffer.
+typedef struct crc32_ctx {
+    uint32_t crc;       // crc so far.
+    uint32_t nbytes;    // total bytes seen.
+} crc32_ctx_t;
+
+static inline void crc32_ctx_init(crc32_ctx_t *c) {
+    c->crc = 0;
+    c->nbytes = 0;
+}
+static inline void 
+crc32_ctx_update(crc32_ctx_t *c, const void *buf, unsigned size) {
+    c->crc = our_crc32_inc(buf, size, c->crc);
+    c->nbytes += size;
+}
+// append a chunk whose crc was computed somewhere else.
+static inline void 
+crc32_ctx_append(crc32_ctx_t *c, uint32_t crc, unsigned size) {
+    c->crc = crc32_combine(c->crc, crc, size);
+    c->nbytes += size;
+}
+static inline uint32_t crc32_ctx_final(crc32_ctx_t *c) {
+    return c->crc;
+}
+#endif
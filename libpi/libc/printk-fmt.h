@@ -0,0 +1,49 @@
+#ifndef __PRINTK_FMT_H__
+#define __PRINTK_FMT_H__
+#include <stdarg.h>
+// the formatting core shared by printk (printk.c) and snprintk
+// (sprintk.c).
+//
+// output goes into a buffer described by a <fmt_out_t>.  when the
+// buffer fills we call <flush> (printk hands the bytes to rpi_putbuf
+// and reuses the buffer); if <flush> is 0 we drop the extra bytes
+// (snprintk truncates).  either way <nbytes> counts every byte the
+// format produced.
+//
+// supported: %c %s %d %u %x %X %p %b %llx %%, with optional flags
+//  - '-': left justify.
+//  - '0': pad numbers with zeros rather than spaces.
+//  - width: a number or '*' (taken from the arguments).
+// e.g., "%-8s|%08x|%*d".   %x and %p print a leading "0x" (counted
+// in the width); %X does not.
+
+typedef struct fmt_out {
+    char *buf;          // start of the buffer.
+    char *p;            // next free byte.
+    char *end;          // one past the last byte we can use.
+    unsigned nbytes;    // total bytes produced by the format.
+
+    // called when <p> == <end>: must make room (reset <p>).
+    // if 0, output past <end> is dropped.
+    void (*flush)(struct fmt_out *o);
+} fmt_out_t;
+
+static inline fmt_out_t
+fmt_out_mk(char *buf, unsigned n, void (*flush)(fmt_out_t *)) {
+    return (fmt_out_t) { .buf = buf, .p = buf, .end = buf + n, .flush = flush };
+}
+
+static inline void fmt_putc(fmt_out_t *o, char c) {
+    o->nbytes++;
+    if(o->p == o->end) {
+        if(!o->flush)
+            return;
+        o->flush(o);
+    }
+    *o->p++ = c;
+}
+
+// format <fmt> into <o>: returns the number of bytes produced.
+int fmt_vformat(fmt_out_t *o, const char *fmt, va_list ap);
+
+#endif
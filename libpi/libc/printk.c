@@ -1,106 +1,251 @@
 #include "rpi.h"
+#include "printk-fmt.h"
 
-#ifndef putchar
-#   define putchar rpi_putchar
+// how much printk formats on the stack before handing it to
+// rpi_putbuf.  most lines fit, so we usually do one call per printk.
+#ifndef PRINTK_BUFSIZE
+#   define PRINTK_BUFSIZE 128
 #endif
 
-static void emit_val(unsigned base, uint32_t u) {
-    char num[33], *p = num;
-
-    switch(base) {
-    case 2:
-        do {
-            *p++ = "01"[u % 2];
-        } while(u /= 2);
-        break;
-    case 10:
-        do {
-            *p++ = "0123456789"[u % 10];
-        } while(u /= 10);
-        break;
-    case 16:
-        do {
-            *p++ = "0123456789abcdef"[u % 16];
-        } while(u /= 16);
-        break;
-    default: 
-        panic("invalid base=%d\n", base);
-    }
+/**********************************************************************
+ * number conversion: no divides.
+ *
+ * gcc turns u/100 into a reciprocal multiply when it feels like it;
+ * we do it by hand so it happens at every optimization level.
+ * 0x51EB851F = ceil(2^37/100) is exact for all 32-bit <u>.
+ * we do two digits per multiply using a 00..99 table.
+ */
+static inline uint32_t udiv100(uint32_t u) {
+    return ((uint64_t)u * 0x51EB851FU) >> 37;
+}
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
 
-    // buffered in reverse, so emit backwards
-    while(p > &num[0]) {
-        p--;
-        putchar(*p);
+// all of these fill backwards from <end> and return the first char.
+static char *fmt_dec(char *end, uint32_t u) {
+    while(u >= 100) {
+        uint32_t q = udiv100(u);
+        const char *d = &digit_pairs[(u - q*100) * 2];
+        *--end = d[1];
+        *--end = d[0];
+        u = q;
     }
+    if(u >= 10) {
+        *--end = digit_pairs[u*2+1];
+        *--end = digit_pairs[u*2];
+    } else
+        *--end = '0' + u;
+    return end;
 }
 
-// a really simple printk. 
-// need to do <sprintk>
-int vprintk(const char *fmt, va_list ap) {
+// base 2 or 16: just shifts.
+static char *fmt_pow2(char *end, uint32_t u, unsigned log2base) {
+    unsigned mask = (1 << log2base) - 1;
+    do {
+        *--end = "0123456789abcdef"[u & mask];
+    } while(u >>= log2base);
+    return end;
+}
+
+/**********************************************************************
+ * the core.
+ */
+
+typedef struct {
+    unsigned width;
+    char pad;       // ' ' or '0'
+    char left;      // 1 = left justify
+} fmt_spec_t;
+
+static void fmt_pad(fmt_out_t *o, char c, unsigned n) {
+    while(n--)
+        fmt_putc(o, c);
+}
+
+// emit <prefix> (sign or "0x") and the <n> bytes at <s>, padded out to
+// the spec's width.  zero padding goes between the prefix and digits.
+static void
+fmt_field(fmt_out_t *o, const fmt_spec_t *spec,
+            const char *prefix, const char *s, unsigned n) {
+    unsigned len = n;
+    for(const char *p = prefix; *p; p++)
+        len++;
+    unsigned npad = spec->width > len ? spec->width - len : 0;
+
+    if(!spec->left && spec->pad == ' ')
+        fmt_pad(o, ' ', npad);
+    for(; *prefix; prefix++)
+        fmt_putc(o, *prefix);
+    if(!spec->left && spec->pad == '0')
+        fmt_pad(o, '0', npad);
+    for(unsigned i = 0; i < n; i++)
+        fmt_putc(o, s[i]);
+    if(spec->left)
+        fmt_pad(o, ' ', npad);
+}
+
+int fmt_vformat(fmt_out_t *o, const char *fmt, va_list ap) {
+    unsigned start = o->nbytes;
+    // big enough for 64 binary digits.
+    char num[66], *end = &num[sizeof num], *s;
+
     for(; *fmt; fmt++) {
-        if(*fmt != '%')
-            putchar(*fmt);
-        else {
-            fmt++; // skip the %
-
-            uint32_t u;
-            int v;
-            char *s;
-
-            switch(*fmt) {
-            case 'b': emit_val(2, va_arg(ap, uint32_t)); break;
-            case 'u': emit_val(10, va_arg(ap, uint32_t)); break;
-            case 'c': putchar(va_arg(ap, int)); break;
-
-            // we only handle %llx.   
-            case 'l':  
-                fmt++;
-                if(*fmt != 'l')
-                    panic("only handling llx format, have: <%s>\n", fmt);
-                fmt++;
-                if(*fmt != 'x')
-                    panic("only handling llx format, have: <%s>\n", fmt);
-                putchar('0');
-                putchar('x');
-                // have to get as a 64 vs two 32's b/c of arg passing.
-                uint64_t x = va_arg(ap, uint64_t);
-                // we break it up otherwise gcc will emit a divide
-                // since it doesn't seem to strength reduce uint64_t
-                // on a 32-bit machine.
-                uint32_t hi = x>>32;
-                uint32_t lo = x;
-                if(hi)
-                    emit_val(16, hi);
-                emit_val(16, lo);
-                break;
+        if(*fmt != '%') {
+            fmt_putc(o, *fmt);
+            continue;
+        }
+        fmt++; // skip the %
 
-            // leading 0x
-            case 'x':  
-            case 'p': 
-                putchar('0');
-                putchar('x');
-            case 'X': // ughly: no leading 0x [not right but b/w compat]
-                emit_val(16, va_arg(ap, uint32_t));
-                break;
-            // print '-' if < 0
-            case 'd':
-                v = va_arg(ap, int);
-                if(v < 0) {
-                    putchar('-');
-                    v = -v;
-                }
-                emit_val(10, v);
-                break;
-            // string
-            case 's':
-                for(s = va_arg(ap, char *); *s; s++) 
-                    putchar(*s);
+        fmt_spec_t spec = { .width = 0, .pad = ' ', .left = 0 };
+        for(;; fmt++) {
+            if(*fmt == '-')
+                spec.left = 1;
+            else if(*fmt == '0')
+                spec.pad = '0';
+            else
                 break;
-            default: panic("bogus identifier: <%c>\n", *fmt);
+        }
+        if(*fmt == '*') {
+            int w = va_arg(ap, int);
+            if(w < 0) {
+                spec.left = 1;
+                w = -w;
+            }
+            spec.width = w;
+            fmt++;
+        } else {
+            for(; *fmt >= '0' && *fmt <= '9'; fmt++)
+                spec.width = spec.width * 10 + (*fmt - '0');
+        }
+
+        uint32_t u;
+        int v;
+
+        switch(*fmt) {
+        case '%': fmt_putc(o, '%'); break;
+        case 'b':
+            s = fmt_pow2(end, va_arg(ap, uint32_t), 1);
+            fmt_field(o, &spec, "", s, end-s);
+            break;
+        case 'u':
+            s = fmt_dec(end, va_arg(ap, uint32_t));
+            fmt_field(o, &spec, "", s, end-s);
+            break;
+        case 'c':
+            num[0] = va_arg(ap, int);
+            fmt_field(o, &spec, "", num, 1);
+            break;
+
+        // we only handle %llx.
+        case 'l':
+            fmt++;
+            if(*fmt != 'l')
+                panic("only handling llx format, have: <%s>\n", fmt);
+            fmt++;
+            if(*fmt != 'x')
+                panic("only handling llx format, have: <%s>\n", fmt);
+            // have to get as a 64 vs two 32's b/c of arg passing.
+            uint64_t x = va_arg(ap, uint64_t);
+            // we break it up otherwise gcc will emit a divide
+            // since it doesn't seem to strength reduce uint64_t
+            // on a 32-bit machine.
+            uint32_t hi = x>>32;
+            uint32_t lo = x;
+            s = fmt_pow2(end, lo, 4);
+            if(hi) {
+                // low word needs all 8 digits.
+                while(end - s < 8)
+                    *--s = '0';
+                s = fmt_pow2(s, hi, 4);
             }
+            fmt_field(o, &spec, "0x", s, end-s);
+            break;
+
+        // leading 0x
+        case 'x':
+        case 'p':
+            s = fmt_pow2(end, va_arg(ap, uint32_t), 4);
+            fmt_field(o, &spec, "0x", s, end-s);
+            break;
+        case 'X': // ughly: no leading 0x [not right but b/w compat]
+            s = fmt_pow2(end, va_arg(ap, uint32_t), 4);
+            fmt_field(o, &spec, "", s, end-s);
+            break;
+        // print '-' if < 0
+        case 'd':
+            v = va_arg(ap, int);
+            // negate as unsigned so INT_MIN works.
+            u = v < 0 ? -(uint32_t)v : (uint32_t)v;
+            s = fmt_dec(end, u);
+            fmt_field(o, &spec, v < 0 ? "-" : "", s, end-s);
+            break;
+        // string
+        case 's':
+            s = va_arg(ap, char *);
+            for(u = 0; s[u]; u++)
+                ;
+            fmt_field(o, &spec, "", s, u);
+            break;
+        default: panic("bogus identifier: <%c>\n", *fmt);
         }
     }
-    return 0;
+    return o->nbytes - start;
+}
+
+/**********************************************************************
+ * printk: format into a buffer and hand the whole thing to rpi_putbuf.
+ */
+
+static void printk_flush_out(fmt_out_t *o) {
+    if(o->p > o->buf)
+        rpi_putbuf(o->buf, o->p - o->buf);
+    o->p = o->buf;
+}
+
+// if non-zero: we are batching output into a caller-supplied buffer.
+// we only have one cpu, so this is our "per-cpu" buffer.
+static fmt_out_t batch;
+static int batch_on_p;
+
+void printk_batch_start(void *buf, unsigned n) {
+    assert(n);
+    if(batch_on_p)
+        printk_flush_out(&batch);
+    batch = fmt_out_mk(buf, n, printk_flush_out);
+    batch_on_p = 1;
+}
+
+void printk_flush(void) {
+    if(batch_on_p)
+        printk_flush_out(&batch);
+}
+
+void printk_batch_stop(void) {
+    if(batch_on_p) {
+        printk_flush_out(&batch);
+        batch_on_p = 0;
+    }
+}
+
+int vprintk(const char *fmt, va_list ap) {
+    if(batch_on_p)
+        return fmt_vformat(&batch, fmt, ap);
+
+    char buf[PRINTK_BUFSIZE];
+    fmt_out_t o = fmt_out_mk(buf, sizeof buf, printk_flush_out);
+    int n = fmt_vformat(&o, fmt, ap);
+    printk_flush_out(&o);
+    return n;
 }
 
 int printk(const char *fmt, ...) {
@@ -20,3 +20,34 @@ rpi_putchar_t rpi_putchar_set(rpi_putchar_t putc) {
     rpi_putchar = putc;
     return old;
 }
+
+// default: go through <rpi_putchar> so that code that only overrides
+// the single-character routine (sw-uart, pl011) still gets everything.
+static int default_putbuf(const void *buf, unsigned n) {
+    const uint8_t *p = buf;
+    for(unsigned i = 0; i < n; i++)
+        rpi_putchar(p[i]);
+    return n;
+}
+
+rpi_putbuf_t rpi_putbuf = default_putbuf;
+
+rpi_putbuf_t rpi_putbuf_set(rpi_putbuf_t putbuf) {
+    rpi_putbuf_t old  = rpi_putbuf;
+    rpi_putbuf = putbuf;
+    return old;
+}
+
+// default: nothing is buffered.
+static rpi_putbuf_flush_t putbuf_flush;
+
+rpi_putbuf_flush_t rpi_putbuf_flush_set(rpi_putbuf_flush_t flush) {
+    rpi_putbuf_flush_t old = putbuf_flush;
+    putbuf_flush = flush;
+    return old;
+}
+
+void rpi_putbuf_flush(void) {
+    if(putbuf_flush)
+        putbuf_flush();
+}
@@ -1,8 +1,7 @@
 #include "rpi.h"
 
 int putk(const char *p) {
-    for(; *p; p++)
-        rpi_putchar(*p);
+    rpi_putbuf(p, strlen(p));
 //  we were adding this.
 //  rpi_putchar('\n');
     return 1;
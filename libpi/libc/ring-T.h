@@ -0,0 +1,282 @@
+#ifndef __RING_T_H__
+#define __RING_T_H__
+// generic lock-free ring buffers: the typed, sizeable replacement for
+// circular.h's cq_t (fixed 8192 bytes, one element type per program).
+//
+// single producer, single consumer:
+//
+//      gen_ring_T(byteq, uint8_t)
+//
+//      static uint8_t buf[1024];       // must be a power of two.
+//      static byteq_t q;
+//      byteq_init(&q, buf, 1024);
+//
+// gives a <byteq_t> and
+//   - byteq_push(q,e) / byteq_pop(q,&e) / byteq_peek(q,&e): one element,
+//     return 1 on success, 0 if full (counted in <noverflow>) / empty.
+//   - byteq_push_n(q,src,n) / byteq_pop_n(q,dst,n): up to <n> elements,
+//     return how many.  at most two memcpy's each.
+//   - byteq_nelem, byteq_nspace, byteq_empty, byteq_full.
+//
+// <head> and <tail> are free-running counters (only ever incremented,
+// wrapping at 2^32) and we index with <mask>, so the ring holds all <n>
+// elements and there are no divides.  the producer only writes <head>,
+// the consumer only writes <tail>: no locks, and an interrupt handler
+// can be either side.  (it can't be both with a thread that's also
+// both, of course.)
+//
+// multiple producers, single consumer:
+//
+//      gen_ring_mp_T(evq, event_t)
+//
+//      static evq_slot_t slots[64];
+//      evq_init(&q, slots, 64);
+//
+// same names but each slot carries a sequence number (vyukov's bounded
+// queue): a producer claims a slot with compare-and-swap on <head>
+// (ldrex/strex on the pi), fills it and then marks it ready.  nobody
+// waits for anyone else to finish, so a producer interrupted halfway
+// doesn't block an interrupt handler that also produces --- it just
+// means the consumer sees the ring as ending at the unfinished slot
+// until the producer resumes.
+//
+// on unix (RPI_UNIX) the barriers and cas are gcc's __atomic builtins,
+// so libpi/tests/test-ring.c can hammer both with pthreads.
+#ifndef RPI_UNIX
+#   include "rpi.h"
+#   define ring_mb() gcc_mb()
+
+// armv6 ldrex/strex (arm1176 A2-...): 1 if *p was <old> and is now
+// <new>, 0 if it wasn't <old> or someone else got in between.
+static inline int ring_cas32(volatile uint32_t *p, uint32_t old, uint32_t new) {
+    uint32_t cur, fail;
+    asm volatile(
+        "ldrex   %0, [%2]\n"
+        "mov     %1, #1\n"
+        "cmp     %0, %3\n"
+        "strexeq %1, %4, [%2]\n"
+        : "=&r"(cur), "=&r"(fail)
+        : "r"(p), "r"(old), "r"(new)
+        : "cc", "memory");
+    return !fail;
+}
+#else
+#   include <stdint.h>
+#   include <string.h>
+#   define ring_mb() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+static inline int ring_cas32(volatile uint32_t *p, uint32_t old, uint32_t new) {
+    return __atomic_compare_exchange_n(p, &old, new, 0,
+                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif
+
+#define ring_is_pow2(n) ((n) && !((n) & ((n) - 1)))
+
+static inline void ring_add32(volatile uint32_t *p, uint32_t k) {
+    uint32_t old;
+    do {
+        old = *p;
+    } while(!ring_cas32(p, old, old + k));
+}
+
+#define gen_ring_T(pfx, E_T)                                                \
+    typedef struct {                                                        \
+        E_T *buf;                                                           \
+        uint32_t n, mask;                                                   \
+        /* head - tail = number of elements. */                             \
+        volatile uint32_t head, tail;                                       \
+        /* elements dropped b/c the ring was full. */                       \
+        unsigned noverflow;                                                 \
+    } pfx ## _t;                                                            \
+                                                                            \
+    static inline void                                                      \
+    pfx ## _init(pfx ## _t *r, E_T *buf, unsigned n) {                      \
+        if(!ring_is_pow2(n))                                                \
+            panic("ring size %d is not a power of two\n", n);               \
+        *r = (pfx ## _t){ .buf = buf, .n = n, .mask = n - 1 };              \
+    }                                                                       \
+                                                                            \
+    static inline unsigned pfx ## _nelem(pfx ## _t *r)                      \
+        { return r->head - r->tail; }                                       \
+    static inline unsigned pfx ## _nspace(pfx ## _t *r)                     \
+        { return r->n - pfx ## _nelem(r); }                                 \
+    static inline int pfx ## _empty(pfx ## _t *r)                           \
+        { return r->head == r->tail; }                                      \
+    static inline int pfx ## _full(pfx ## _t *r)                            \
+        { return pfx ## _nelem(r) == r->n; }                                \
+                                                                            \
+    /* producer. */                                                         \
+    static inline int pfx ## _push(pfx ## _t *r, E_T e) {                   \
+        uint32_t head = r->head;                                            \
+        if(head - r->tail == r->n) {                                        \
+            r->noverflow++;                                                 \
+            return 0;                                                       \
+        }                                                                   \
+        r->buf[head & r->mask] = e;                                         \
+        ring_mb();                                                          \
+        r->head = head + 1;                                                 \
+        return 1;                                                           \
+    }                                                                       \
+                                                                            \
+    /* producer: as many of src[0..k) as fit, the rest are dropped. */      \
+    static inline unsigned                                                  \
+    pfx ## _push_n(pfx ## _t *r, const E_T *src, unsigned k) {              \
+        uint32_t head = r->head;                                            \
+        unsigned space = r->n - (head - r->tail);                           \
+        if(k > space) {                                                     \
+            r->noverflow += k - space;                                      \
+            k = space;                                                      \
+        }                                                                   \
+        unsigned i = head & r->mask, k1 = r->n - i;                         \
+        if(k1 > k)                                                          \
+            k1 = k;                                                         \
+        memcpy(&r->buf[i], src, k1 * sizeof(E_T));                          \
+        memcpy(r->buf, src + k1, (k - k1) * sizeof(E_T));                   \
+        ring_mb();                                                          \
+        r->head = head + k;                                                 \
+        return k;                                                           \
+    }                                                                       \
+                                                                            \
+    /* consumer. */                                                         \
+    static inline int pfx ## _peek(pfx ## _t *r, E_T *e) {                  \
+        uint32_t tail = r->tail;                                            \
+        if(r->head == tail)                                                 \
+            return 0;                                                       \
+        ring_mb();                                                          \
+        *e = r->buf[tail & r->mask];                                        \
+        return 1;                                                           \
+    }                                                                       \
+    static inline int pfx ## _pop(pfx ## _t *r, E_T *e) {                   \
+        if(!pfx ## _peek(r, e))                                             \
+            return 0;                                                       \
+        ring_mb();                                                          \
+        r->tail++;                                                          \
+        return 1;                                                           \
+    }                                                                       \
+                                                                            \
+    /* consumer: up to <k> elements into <dst>, returns how many. */        \
+    static inline unsigned                                                  \
+    pfx ## _pop_n(pfx ## _t *r, E_T *dst, unsigned k) {                     \
+        uint32_t tail = r->tail;                                            \
+        unsigned nelem = r->head - tail;                                    \
+        if(k > nelem)                                                       \
+            k = nelem;                                                      \
+        ring_mb();                                                          \
+        unsigned i = tail & r->mask, k1 = r->n - i;                         \
+        if(k1 > k)                                                          \
+            k1 = k;                                                         \
+        memcpy(dst, &r->buf[i], k1 * sizeof(E_T));                          \
+        memcpy(dst + k1, r->buf, (k - k1) * sizeof(E_T));                   \
+        ring_mb();                                                          \
+        r->tail = tail + k;                                                 \
+        return k;                                                           \
+    }
+
+// multi-producer: slot <i> is free for the producer claiming position
+// <pos> when seq == pos, and ready for the consumer when seq == pos+1;
+// popping sets it to pos+n (free for the next time around).
+#define gen_ring_mp_T(pfx, E_T)                                             \
+    typedef struct {                                                        \
+        volatile uint32_t seq;                                              \
+        E_T e;                                                              \
+    } pfx ## _slot_t;                                                       \
+                                                                            \
+    typedef struct {                                                        \
+        pfx ## _slot_t *slots;                                              \
+        uint32_t n, mask;                                                   \
+        /* next position to claim / to pop. */                              \
+        volatile uint32_t head, tail;                                       \
+        volatile uint32_t noverflow;                                        \
+    } pfx ## _t;                                                            \
+                                                                            \
+    static inline void                                                      \
+    pfx ## _init(pfx ## _t *r, pfx ## _slot_t *slots, unsigned n) {         \
+        if(!ring_is_pow2(n))                                                \
+            panic("ring size %d is not a power of two\n", n);               \
+        *r = (pfx ## _t){ .slots = slots, .n = n, .mask = n - 1 };          \
+        for(unsigned i = 0; i < n; i++)                                     \
+            slots[i].seq = i;                                               \
+    }                                                                       \
+                                                                            \
+    /* approximate if producers are running. */                             \
+    static inline unsigned pfx ## _nelem(pfx ## _t *r)                      \
+        { return r->head - r->tail; }                                       \
+    static inline int pfx ## _empty(pfx ## _t *r)                           \
+        { return r->slots[r->tail & r->mask].seq != r->tail + 1; }          \
+                                                                            \
+    /* claim <k> consecutive positions: returns the first, or 0 with        \
+       *ok = 0 if they aren't all free. */                                  \
+    static inline uint32_t                                                  \
+    pfx ## _claim(pfx ## _t *r, unsigned k, int *ok) {                      \
+        while(1) {                                                          \
+            uint32_t pos = r->head;                                         \
+            /* the consumer frees in order: if the last is free, all are. */\
+            int32_t d = r->slots[(pos + k - 1) & r->mask].seq - (pos + k - 1); \
+            if(d < 0 || k > r->n) {                                         \
+                *ok = 0;                                                    \
+                return 0;                                                   \
+            }                                                               \
+            /* d > 0: someone claimed it after we read <head>. */           \
+            if(d == 0 && ring_cas32(&r->head, pos, pos + k)) {              \
+                *ok = 1;                                                    \
+                return pos;                                                 \
+            }                                                               \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    /* any producer. */                                                     \
+    static inline int pfx ## _push(pfx ## _t *r, E_T e) {                   \
+        int ok;                                                             \
+        uint32_t pos = pfx ## _claim(r, 1, &ok);                            \
+        if(!ok) {                                                           \
+            ring_add32(&r->noverflow, 1);                                   \
+            return 0;                                                       \
+        }                                                                   \
+        pfx ## _slot_t *s = &r->slots[pos & r->mask];                       \
+        s->e = e;                                                           \
+        ring_mb();                                                          \
+        s->seq = pos + 1;                                                   \
+        return 1;                                                           \
+    }                                                                       \
+                                                                            \
+    /* any producer: all <k> or none, so a batch stays together. */         \
+    static inline unsigned                                                  \
+    pfx ## _push_n(pfx ## _t *r, const E_T *src, unsigned k) {              \
+        int ok;                                                             \
+        if(!k)                                                              \
+            return 0;                                                       \
+        uint32_t pos = pfx ## _claim(r, k, &ok);                            \
+        if(!ok) {                                                           \
+            ring_add32(&r->noverflow, k);                                   \
+            return 0;                                                       \
+        }                                                                   \
+        for(unsigned i = 0; i < k; i++)                                     \
+            r->slots[(pos + i) & r->mask].e = src[i];                       \
+        ring_mb();                                                          \
+        for(unsigned i = 0; i < k; i++)                                     \
+            r->slots[(pos + i) & r->mask].seq = pos + i + 1;                \
+        return k;                                                           \
+    }                                                                       \
+                                                                            \
+    /* the one consumer. */                                                 \
+    static inline int pfx ## _pop(pfx ## _t *r, E_T *e) {                   \
+        uint32_t tail = r->tail;                                            \
+        pfx ## _slot_t *s = &r->slots[tail & r->mask];                      \
+        if(s->seq != tail + 1)                                              \
+            return 0;                                                       \
+        ring_mb();                                                          \
+        *e = s->e;                                                          \
+        ring_mb();                                                          \
+        s->seq = tail + r->n;                                               \
+        r->tail = tail + 1;                                                 \
+        return 1;                                                           \
+    }                                                                       \
+    static inline unsigned                                                  \
+    pfx ## _pop_n(pfx ## _t *r, E_T *dst, unsigned k) {                     \
+        unsigned i;                                                         \
+        for(i = 0; i < k && pfx ## _pop(r, &dst[i]); i++)                   \
+            ;                                                               \
+        return i;                                                           \
+    }
+
+#endif
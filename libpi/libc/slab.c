@@ -0,0 +1,205 @@
+// size-class allocator on top of kmalloc: see slab.h.
+#include "rpi.h"
+#include "slab.h"
+
+enum {
+    SLAB_PAGE       = 4096,         // granularity of the page map.
+    SLAB_PAGE_SHIFT = 12,
+    SLAB_BYTES      = 16*1024,      // small classes grab this much at a time.
+    SLAB_SMALL_MAX  = 2048,
+};
+
+// about 1.5x apart so rounding up wastes at most a third.  everything
+// after 2048 gets its own page aligned kmalloc.
+static const unsigned class_size[] = {
+    8, 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048,
+    4096, 8192, 16384, 32768, 65536, 131072, 262144, 524288, 1048576,
+};
+enum {
+    NCLASS = sizeof class_size / sizeof class_size[0],
+    NSMALL = 15,                    // classes carved from slabs.
+};
+
+// SLAB_BYTES / class_size[c] for the small classes, written out so we
+// don't divide (see rpi.h).  slab_init checks them.
+static const unsigned short slab_nobj[NSMALL] = {
+    2048, 1024, 512, 341, 256, 170, 128, 85, 64, 42, 32, 21, 16, 10, 8,
+};
+
+typedef struct free_obj {
+    struct free_obj *next;
+} free_obj_t;
+
+static struct {
+    free_obj_t *free;
+    uint8_t *next, *end;            // what's left of the current slab.
+    unsigned nlive;
+} classes[NCLASS];
+
+// (nbytes+7)/8 -> class for the small classes.
+static uint8_t small_class[SLAB_SMALL_MAX/8 + 1];
+
+// class+1 of each heap page we've handed out, 0 if none.  a big object
+// only marks its first page so a pointer into the middle of one isn't
+// taken as a start.
+static uint8_t *page_map;
+static uintptr_t heap_lo, heap_hi;
+
+static slab_stats_t stats;
+static int init_p;
+
+void slab_init(void) {
+    memset(classes, 0, sizeof classes);
+    stats = (slab_stats_t){};
+
+    for(unsigned c = 0; c < NSMALL; c++) {
+        unsigned n = slab_nobj[c] * class_size[c];
+        if(n > SLAB_BYTES || n + class_size[c] <= SLAB_BYTES)
+            panic("slab: class %d: %d objects per slab is wrong\n",
+                class_size[c], slab_nobj[c]);
+    }
+
+    unsigned c = 0;
+    for(unsigned i = 0; i <= SLAB_SMALL_MAX/8; i++) {
+        while(class_size[c] < i*8)
+            c++;
+        small_class[i] = c;
+    }
+
+    // index from a page boundary so map pages are real pages.
+    heap_lo = (uintptr_t)kmalloc_heap_start() & ~(uintptr_t)(SLAB_PAGE-1);
+    heap_hi = (uintptr_t)kmalloc_heap_end();
+    if(heap_hi <= heap_lo)
+        panic("slab: empty kmalloc heap: call kmalloc_init first\n");
+    unsigned npages = (heap_hi - heap_lo + SLAB_PAGE-1) >> SLAB_PAGE_SHIFT;
+    page_map = kmalloc(npages);
+    stats.heap_bytes = npages;
+    init_p = 1;
+}
+
+static unsigned size_to_class(unsigned nbytes) {
+    if(nbytes <= SLAB_SMALL_MAX)
+        return small_class[(nbytes + 7) / 8];
+    if(nbytes > SLAB_MAX_NBYTES)
+        panic("slab: %d bytes is more than the max %d\n",
+                nbytes, SLAB_MAX_NBYTES);
+    // ceil(log2(nbytes)): 4096 is the first big class.
+    unsigned lg = 32 - __builtin_clz(nbytes - 1);
+    return NSMALL + lg - SLAB_PAGE_SHIFT;
+}
+
+static void page_map_set(void *p, unsigned nbytes, unsigned c) {
+    unsigned i = ((uintptr_t)p - heap_lo) >> SLAB_PAGE_SHIFT;
+    for(unsigned n = 0; n < nbytes; n += SLAB_PAGE)
+        page_map[i++] = c + 1;
+}
+
+static void *alloc_class(unsigned nbytes, unsigned c, int zero_p) {
+    unsigned sz = class_size[c];
+    void *p;
+
+    if(classes[c].free) {
+        free_obj_t *o = classes[c].free;
+        classes[c].free = o->next;
+        if(zero_p)
+            memset(o, 0, nbytes);
+        p = o;
+    } else if(c >= NSMALL) {
+        p = kmalloc_aligned(sz, SLAB_PAGE);
+        page_map_set(p, SLAB_PAGE, c);
+        stats.heap_bytes += sz;
+    } else {
+        if(classes[c].next == classes[c].end) {
+            uint8_t *s = kmalloc_aligned(SLAB_BYTES, SLAB_PAGE);
+            page_map_set(s, SLAB_BYTES, c);
+            stats.heap_bytes += SLAB_BYTES;
+            classes[c].next = s;
+            classes[c].end = s + slab_nobj[c] * sz;
+        }
+        // fresh from kmalloc: already zero.
+        p = classes[c].next;
+        classes[c].next += sz;
+    }
+
+    classes[c].nlive++;
+    stats.nalloc++;
+    stats.live_objs++;
+    stats.live_bytes += sz;
+    if(stats.live_bytes > stats.max_live_bytes)
+        stats.max_live_bytes = stats.live_bytes;
+    stats.req_bytes += nbytes;
+    stats.round_bytes += sz;
+    return p;
+}
+
+void *slab_alloc(unsigned nbytes) {
+    if(!init_p)
+        slab_init();
+    return alloc_class(nbytes, size_to_class(nbytes), 1);
+}
+
+void *slab_alloc_notzero(unsigned nbytes) {
+    if(!init_p)
+        slab_init();
+    return alloc_class(nbytes, size_to_class(nbytes), 0);
+}
+
+void *slab_alloc_aligned(unsigned nbytes, unsigned align) {
+    if(!align || (align & (align - 1)) || align > SLAB_PAGE)
+        panic("slab: bad alignment %d\n", align);
+    if(!init_p)
+        slab_init();
+    if(align <= 8)
+        return alloc_class(nbytes, size_to_class(nbytes), 1);
+
+    // the power-of-two classes are aligned to their size.
+    unsigned n = nbytes > align ? nbytes : align;
+    if(n > SLAB_MAX_NBYTES)
+        panic("slab: %d bytes is more than the max %d\n",
+                nbytes, SLAB_MAX_NBYTES);
+    unsigned lg = 32 - __builtin_clz(n - 1);
+    return alloc_class(nbytes, size_to_class(1u << lg), 1);
+}
+
+void slab_free(void *p) {
+    if(!p)
+        return;
+
+    uintptr_t a = (uintptr_t)p;
+    if(!init_p || a < heap_lo || a >= heap_hi)
+        panic("slab_free: %p is not in the heap\n", p);
+    unsigned c = page_map[(a - heap_lo) >> SLAB_PAGE_SHIFT];
+    if(!c--)
+        panic("slab_free: %p was not allocated with slab_alloc\n", p);
+    if(a % 8)
+        panic("slab_free: %p is not the start of an object\n", p);
+    if(!classes[c].nlive)
+        panic("slab_free: %p: class %d has nothing live\n", p, class_size[c]);
+
+    free_obj_t *o = p;
+    o->next = classes[c].free;
+    classes[c].free = o;
+
+    classes[c].nlive--;
+    stats.nfree++;
+    stats.live_objs--;
+    stats.live_bytes -= class_size[c];
+}
+
+slab_stats_t slab_stats(void) {
+    return stats;
+}
+
+void slab_stats_print(const char *msg) {
+    slab_stats_t s = stats;
+    printk("%s: slab: %d allocs, %d frees, %d live objects\n",
+        msg, s.nalloc, s.nfree, s.live_objs);
+    printk("\tlive bytes=%d (max=%d), heap bytes=%d\n",
+        s.live_bytes, s.max_live_bytes, s.heap_bytes);
+    printk("\tfragmentation: internal=%d of %d bytes, external=%d of %d bytes\n",
+        s.round_bytes - s.req_bytes, s.round_bytes,
+        s.heap_bytes - s.live_bytes, s.heap_bytes);
+    for(unsigned c = 0; c < NCLASS; c++)
+        if(classes[c].nlive)
+            printk("\t%d bytes: %d live\n", class_size[c], classes[c].nlive);
+}
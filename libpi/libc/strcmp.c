@@ -1,8 +1,6 @@
 #include "rpi.h"
+#include "word-at-a-time.h"
 
 int strcmp(const char *a, const char *b) {
-        while (*a && *a == *b)
-                ++a, ++b;
-        return *a - *b;
+    return wat_strcmp(a,b);
 }
-
@@ -1,8 +1,6 @@
 #include "rpi.h"
+#include "word-at-a-time.h"
 
 size_t strlen(const char *p) {
-    size_t ret;
-    for (ret = 0; p[ret]; ++ret)
-        ;
-    return ret;
+    return wat_strlen(p);
 }
@@ -0,0 +1,101 @@
+// a timer wheel run off a system timer compare register: see
+// rpi-systimer.h
+#include "rpi.h"
+#include "rpi-interrupts.h"
+#include "rpi-inline-asm.h"
+#include "rpi-systimer.h"
+
+static tw_t wheel;
+static unsigned chan;
+
+// point the compare register at the wheel's next event.  we can't
+// set it more than 2^32 usec out, or so close that CLO passes it
+// before the write lands: those get a wakeup that just re-arms.
+// call with interrupts off.
+static void rearm(void) {
+    uint64_t when;
+    if(!tw_next(&wheel, &when))
+        return;
+
+    uint64_t now = timer_get_usec64();
+    if(when < now + TIMER_WHEEL_MIN_USEC)
+        when = now + TIMER_WHEEL_MIN_USEC;
+    else if(when - now > 1u << 31)
+        when = now + (1u << 31);
+
+    dev_barrier();
+    systimer_compare_set(chan, when);
+    dev_barrier();
+}
+
+void timer_wheel_init(unsigned ch) {
+    if(!systimer_chan_ok(ch))
+        panic("compare register %d: the ARM can only use 1 or 3\n", ch);
+    chan = ch;
+    tw_init(&wheel, timer_get_usec64());
+
+    dev_barrier();
+    systimer_match_clear(ch);
+    dev_barrier();
+    PUT32(IRQ_Enable_1, 1 << ch);
+    dev_barrier();
+}
+
+void timer_wheel_add_at(tw_timer_t *t, uint64_t deadline, tw_fn_t fn, void *arg) {
+    uint32_t cpsr = cpsr_int_disable();
+    tw_add(&wheel, t, deadline, fn, arg);
+    rearm();
+    cpsr_int_reset(cpsr);
+}
+
+void timer_wheel_add(tw_timer_t *t, uint32_t usec, tw_fn_t fn, void *arg) {
+    timer_wheel_add_at(t, timer_get_usec64() + usec, fn, arg);
+}
+
+// we don't bother re-arming: if <t> was next, the interrupt finds
+// nothing due and re-arms for what is.
+int timer_wheel_cancel(tw_timer_t *t) {
+    uint32_t cpsr = cpsr_int_disable();
+    int pending = tw_cancel(&wheel, t);
+    cpsr_int_reset(cpsr);
+    return pending;
+}
+
+int timer_wheel_interrupt(void) {
+    dev_barrier();
+    if(!systimer_match_p(chan))
+        return 0;
+    systimer_match_clear(chan);
+    dev_barrier();
+
+    tw_run(&wheel, timer_get_usec64());
+    rearm();
+    return 1;
+}
+
+static void wakeup(tw_timer_t *t, void *arg) {
+    *(volatile int *)arg = 1;
+}
+
+// check <done> with interrupts off so the wakeup can't land between
+// the check and the wfi (which returns on a pending interrupt even
+// with them masked).
+void timer_wheel_sleep_until(uint64_t deadline) {
+    assert(cpsr_int_enabled());
+
+    volatile int done = 0;
+    tw_timer_t t = {0};
+    timer_wheel_add_at(&t, deadline, wakeup, (void *)&done);
+
+    uint32_t cpsr = cpsr_int_disable();
+    while(!done) {
+        wait_for_interrupt();
+        cpsr_int_enable();
+        cpsr_int_disable();
+    }
+    cpsr_int_reset(cpsr);
+}
+
+void timer_wheel_sleep_us(uint32_t usec) {
+    timer_wheel_sleep_until(timer_get_usec64() + usec);
+}
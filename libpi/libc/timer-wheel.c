@@ -0,0 +1,132 @@
+// hierarchical timer wheel: see timer-wheel.h
+#include "rpi.h"
+#include "timer-wheel.h"
+
+#define SHIFT(l) ((l) * TW_BITS)
+enum { SLOT_MASK = TW_NSLOTS - 1 };
+
+static void push(tw_timer_t **head, tw_timer_t *t) {
+    t->next = *head;
+    if(t->next)
+        t->next->pprev = &t->next;
+    t->pprev = head;
+    *head = t;
+}
+
+static void list_remove(tw_timer_t *t) {
+    *t->pprev = t->next;
+    if(t->next)
+        t->next->pprev = t->pprev;
+    t->pprev = 0;
+    t->next = 0;
+}
+
+// put <t> in the lowest level where it's less than TW_NSLOTS slots
+// from now.  the slot for now itself is only ever used on level 0:
+// anything else would have fit a level lower.
+static void insert(tw_t *w, tw_timer_t *t) {
+    uint64_t d = t->deadline < w->now ? w->now : t->deadline;
+
+    unsigned l;
+    for(l = 0; l < TW_NLEVELS - 1; l++)
+        if((d >> SHIFT(l)) - (w->now >> SHIFT(l)) < TW_NSLOTS)
+            break;
+    uint64_t cur = w->now >> SHIFT(l);
+    uint64_t blk = d >> SHIFT(l);
+    if(blk - cur >= TW_NSLOTS)
+        blk = cur + TW_NSLOTS - 1;
+
+    unsigned i = blk & SLOT_MASK;
+    t->level = l;
+    t->slot = i;
+    push(&w->slots[l][i], t);
+    w->occupied[l] |= 1 << i;
+}
+
+void tw_init(tw_t *w, uint64_t now) {
+    memset(w, 0, sizeof *w);
+    w->now = now;
+}
+
+int tw_cancel(tw_t *w, tw_timer_t *t) {
+    if(!tw_pending(t))
+        return 0;
+    list_remove(t);
+    if(!w->slots[t->level][t->slot])
+        w->occupied[t->level] &= ~(1 << t->slot);
+    w->npending--;
+    return 1;
+}
+
+void tw_add(tw_t *w, tw_timer_t *t, uint64_t deadline, tw_fn_t fn, void *arg) {
+    tw_cancel(w, t);
+    t->deadline = deadline;
+    t->fn = fn;
+    t->arg = arg;
+    insert(w, t);
+    w->npending++;
+}
+
+// the first occupied slot at or after the current one on each level:
+// the earliest slot start is when we next have work.
+static int next(tw_t *w, uint64_t *when, unsigned *level, unsigned *slot) {
+    int found = 0;
+    for(unsigned l = 0; l < TW_NLEVELS; l++) {
+        uint32_t bits = w->occupied[l];
+        if(!bits)
+            continue;
+        uint64_t cur = w->now >> SHIFT(l);
+        unsigned s = cur & SLOT_MASK;
+        // rotate so the current slot is bit 0.
+        if(s)
+            bits = bits >> s | bits << (TW_NSLOTS - s);
+        unsigned k = __builtin_ctz(bits);
+
+        uint64_t t = (cur + k) << SHIFT(l);
+        if(t < w->now)
+            t = w->now;
+        if(!found || t < *when) {
+            found = 1;
+            *when = t;
+            *level = l;
+            *slot = (s + k) & SLOT_MASK;
+        }
+    }
+    return found;
+}
+
+int tw_next(tw_t *w, uint64_t *when) {
+    unsigned l, i;
+    return next(w, when, &l, &i);
+}
+
+unsigned tw_run(tw_t *w, uint64_t now) {
+    unsigned nfired = 0, l, i;
+    uint64_t when;
+
+    while(next(w, &when, &l, &i) && when <= now) {
+        w->now = when;
+
+        // take the whole slot: callbacks can add to it or cancel
+        // what's left on our copy.
+        tw_timer_t *list = w->slots[l][i];
+        w->slots[l][i] = 0;
+        w->occupied[l] &= ~(1 << i);
+        list->pprev = &list;
+
+        tw_timer_t *t;
+        while((t = list)) {
+            list_remove(t);
+            if(t->deadline > when)
+                insert(w, t);
+            else {
+                w->npending--;
+                nfired++;
+                t->fn(t, t->arg);
+            }
+        }
+    }
+    if(now > w->now)
+        w->now = now;
+    return nfired;
+}
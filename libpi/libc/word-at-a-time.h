@@ -0,0 +1,183 @@
+#ifndef __WORD_AT_A_TIME_H__
+#define __WORD_AT_A_TIME_H__
+// word-at-a-time kernels for strlen, strcmp, strncmp, memcmp and
+// memiszero.
+//
+// the trick: for a 32-bit word <x>,
+//      (x - 0x01010101) & ~x & 0x80808080
+// is non-zero iff some byte of <x> is 0.  it can give false hits, but
+// only in bytes *above* a real zero byte, so the lowest set bit
+// always marks the first zero byte (we are little-endian).
+//
+// page safety: we only ever do *aligned* word (or double-word) loads.
+// an aligned load can never straddle a page, so if it contains even
+// one byte we are allowed to read, the whole load is safe even if
+// it goes past the terminating 0 or the end of the buffer.
+//
+// like memcpy-engine.h, this does not include rpi.h so we can check
+// it on unix against libc.
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t __attribute__((may_alias)) wat_u32;
+typedef uint64_t __attribute__((may_alias)) wat_u64;
+
+#define WAT_ONES  0x01010101u
+#define WAT_HIGHS 0x80808080u
+
+// non-zero iff <x> has a 0 byte.
+static inline uint32_t wat_zero_mask(uint32_t x) {
+    return (x - WAT_ONES) & ~x & WAT_HIGHS;
+}
+
+// index of the lowest non-zero byte in <mask> (must be non-zero).
+static inline unsigned wat_byte_idx(uint32_t mask) {
+    return __builtin_ctz(mask) / 8;
+}
+
+// extract byte <i> of <x>.
+static inline unsigned wat_byte(uint32_t x, unsigned i) {
+    return (x >> (i*8)) & 0xff;
+}
+
+static inline size_t wat_strlen(const char *s) {
+    const char *p = s;
+
+    // unaligned prologue.
+    for(; (uintptr_t)p % 4; p++)
+        if(!*p)
+            return p - s;
+
+    const wat_u32 *w = (const void *)p;
+    uint32_t m;
+    while(!(m = wat_zero_mask(*w)))
+        w++;
+    return (const char *)w - s + wat_byte_idx(m);
+}
+
+// compare two words that we know either differ or contain a 0 in <a>:
+// return the strcmp result for the first byte that differs or ends.
+static inline int wat_str_word_cmp(uint32_t a, uint32_t b) {
+    uint32_t m = wat_zero_mask(a) | (a ^ b);
+    unsigned i = wat_byte_idx(m);
+    return (int)wat_byte(a,i) - (int)wat_byte(b,i);
+}
+
+// if <a> and <b> are not mutually aligned there is no way to do
+// aligned loads of both without a shift-merge; strings are short
+// enough that we just do bytes.
+static inline int wat_strcmp(const char *_a, const char *_b) {
+    const unsigned char *a = (const void *)_a, *b = (const void *)_b;
+
+    if((uintptr_t)a % 4 == (uintptr_t)b % 4) {
+        for(; (uintptr_t)a % 4; a++, b++)
+            if(!*a || *a != *b)
+                return *a - *b;
+
+        const wat_u32 *wa = (const void *)a, *wb = (const void *)b;
+        for(;; wa++, wb++) {
+            uint32_t x = *wa, y = *wb;
+            if(x != y || wat_zero_mask(x))
+                return wat_str_word_cmp(x,y);
+        }
+    }
+
+    while(*a && *a == *b)
+        a++, b++;
+    return *a - *b;
+}
+
+static inline int wat_strncmp(const char *_a, const char *_b, size_t n) {
+    const unsigned char *a = (const void *)_a, *b = (const void *)_b;
+
+    if((uintptr_t)a % 4 == (uintptr_t)b % 4) {
+        for(; n && (uintptr_t)a % 4; n--, a++, b++)
+            if(!*a || *a != *b)
+                return *a - *b;
+
+        const wat_u32 *wa = (const void *)a, *wb = (const void *)b;
+        for(; n >= 4; n -= 4, wa++, wb++) {
+            uint32_t x = *wa, y = *wb;
+            if(x != y || wat_zero_mask(x))
+                return wat_str_word_cmp(x,y);
+        }
+        a = (const void *)wa;
+        b = (const void *)wb;
+    }
+
+    for(; n; n--, a++, b++)
+        if(!*a || *a != *b)
+            return *a - *b;
+    return 0;
+}
+
+// first differing byte of two words that differ.
+static inline int wat_mem_word_cmp(uint32_t a, uint32_t b) {
+    unsigned i = wat_byte_idx(a ^ b);
+    return (int)wat_byte(a,i) - (int)wat_byte(b,i);
+}
+
+static inline int wat_memcmp(const void *_a, const void *_b, size_t n) {
+    const unsigned char *a = _a, *b = _b;
+
+    if(n >= 8) {
+        // align <a>.
+        for(; (uintptr_t)a % 4; n--, a++, b++)
+            if(*a != *b)
+                return *a - *b;
+
+        const wat_u32 *wa = (const void *)a;
+        unsigned off = (uintptr_t)b % 4;
+        if(!off) {
+            const wat_u32 *wb = (const void *)b;
+            for(; n >= 4; n -= 4, wa++, wb++)
+                if(*wa != *wb)
+                    return wat_mem_word_cmp(*wa, *wb);
+            b = (const void *)wb;
+        } else {
+            // shift-and-merge <b> just like memcpy-engine.h: every
+            // aligned word we load holds at least one byte of <b>.
+            const wat_u32 *wb = (const void *)(b - off);
+            unsigned lsh = off*8, rsh = 32 - lsh;
+            uint32_t cur = *wb++;
+            for(; n >= 4; n -= 4, wa++) {
+                uint32_t next = *wb++;
+                uint32_t y = (cur >> lsh) | (next << rsh);
+                if(*wa != y)
+                    return wat_mem_word_cmp(*wa, y);
+                cur = next;
+            }
+            b = (const unsigned char *)(wb - 1) + off;
+        }
+        a = (const void *)wa;
+    }
+
+    for(; n; n--, a++, b++)
+        if(*a != *b)
+            return *a - *b;
+    return 0;
+}
+
+// returns 1 if [p, p+n) is all zeros.  we OR together 32 bytes at a
+// time using 64-bit loads and only branch once per block.
+static inline int wat_memiszero(const void *_p, size_t n) {
+    const unsigned char *p = _p;
+
+    for(; n && (uintptr_t)p % 8; n--, p++)
+        if(*p)
+            return 0;
+
+    const wat_u64 *w = (const void *)p;
+    for(; n >= 32; n -= 32, w += 4)
+        if(w[0] | w[1] | w[2] | w[3])
+            return 0;
+    for(; n >= 8; n -= 8, w++)
+        if(*w)
+            return 0;
+
+    for(p = (const void *)w; n; n--, p++)
+        if(*p)
+            return 0;
+    return 1;
+}
+#endif
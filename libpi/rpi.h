@@ -38,6 +38,21 @@ extern rpi_putchar_t rpi_putchar;
 rpi_putchar_t rpi_putchar_set(rpi_putchar_t putc);
 #define rpi_set_putc rpi_putchar_set
 
+// emit <n> bytes in one call: printk and putk format into a buffer
+// and hand it off here.  the default calls <rpi_putchar> on each byte,
+// so overriding just <rpi_putchar> still works.  override this too
+// if your device can do better than a byte at a time.
+typedef int (*rpi_putbuf_t)(const void *buf, unsigned n);
+extern rpi_putbuf_t rpi_putbuf;
+rpi_putbuf_t rpi_putbuf_set(rpi_putbuf_t putbuf);
+
+// if your <rpi_putbuf> buffers output (e.g., uart-int.h) install a 
+// routine to push it all out: clean_reboot and rpi_reboot call 
+// <rpi_putbuf_flush> so the last messages don't get lost.  
+typedef void (*rpi_putbuf_flush_t)(void);
+rpi_putbuf_flush_t rpi_putbuf_flush_set(rpi_putbuf_flush_t flush);
+void rpi_putbuf_flush(void);
+
 // copy at most <n> bytes from <src> into <dst>
 // null-terminate.
 void safe_strcpy(char *dst, const char *src, unsigned n);
@@ -45,13 +60,24 @@ void safe_strcpy(char *dst, const char *src, unsigned n);
 // emit a single string.
 int putk(const char *msg);
 
-// printf with a lot of restrictions.
+// printf with a lot of restrictions: %c %s %d %u %x %X %p %b %llx
+// with '-', '0' and width (or '*') flags.  see libc/printk-fmt.h.
+// returns the number of bytes printed.
 int printk(const char *format, ...);
 
 // vprintf with a lot of restrictions.
 int vprintk(const char *fmt, va_list ap);
 
-// print string to <buf>
+// batch printk output into <buf> instead of emitting each call: the
+// buffer goes to <rpi_putbuf> when it fills or on flush/stop.  
+// NOTE: not interrupt safe --- don't printk from a handler while 
+// batching.
+void printk_batch_start(void *buf, unsigned n);
+void printk_flush(void);
+void printk_batch_stop(void);
+
+// print string to <buf>: truncates and always 0-terminates.  returns
+// the length the untruncated string would have.
 #include <stdarg.h>
 int snprintk(char *buf, unsigned buflen, const char *fmt, ...);
 int vsnprintk(char *buf, unsigned buflen, const char *fmt, va_list ap);
@@ -107,6 +133,11 @@ uint32_t timer_get_usec(void) ;
 // no memory barrier.
 uint32_t timer_get_usec_raw(void);
 
+// the full 64-bit usec counter: doesn't wrap for ~580,000 years, so
+// you can compare directly.  rpi-systimer.h has interrupts and a
+// timer wheel on top of it.
+uint64_t timer_get_usec64(void);
+
 /****************************************************************************
  * Reboot the pi smoothly.
  */
@@ -2,7 +2,10 @@
 
 // print out a special message so bootloader exits
 void clean_reboot(void) {
+    // push out anything buffered first so there is room for DONE!!!
+    rpi_putbuf_flush();
     putk("DONE!!!\n");
+    rpi_putbuf_flush();
     uart_flush_tx();
     delay_ms(10);       // (hopefully) enough time for message to get flushed.
     rpi_reboot();
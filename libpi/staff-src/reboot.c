@@ -2,6 +2,7 @@
 #include "rpi.h"
 
 void rpi_reboot(void) {
+    rpi_putbuf_flush();
     uart_flush_tx();
     delay_ms(10);
 
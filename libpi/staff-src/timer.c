@@ -15,6 +15,19 @@ uint32_t timer_get_usec(void) {
     return u;
 }
 
+// all 64 bits (broadcom p172): CLO can wrap between our reads of the
+// two halves, so read CHI on both sides and retry if it moved.
+uint64_t timer_get_usec64(void) {
+    uint32_t hi, lo;
+    dev_barrier();
+    do {
+        hi = GET32(0x20003008);
+        lo = GET32(0x20003004);
+    } while(hi != GET32(0x20003008));
+    dev_barrier();
+    return (uint64_t)hi << 32 | lo;
+}
+
 void delay_us(uint32_t us) {
     uint32_t s = timer_get_usec();
     while(1) {
@@ -24,12 +37,19 @@ void delay_us(uint32_t us) {
     }
 }
 
+// the longer delays use 64-bit time so ms*1000 can't overflow
+// (delay_sec of more than ~71 minutes used to).
+static void delay_until(uint64_t end) {
+    while(timer_get_usec64() < end)
+        ;
+}
+
 // delay in milliseconds
 void delay_ms(uint32_t ms) {
-    delay_us(ms*1000);
+    delay_until(timer_get_usec64() + ms * 1000ULL);
 }
 
 // delay in seconds
 void delay_sec(uint32_t sec) {
-    delay_ms(sec*1000);
+    delay_until(timer_get_usec64() + sec * 1000ULL * 1000);
 }
@@ -0,0 +1,197 @@
+// interrupt-driven mini-uart: see uart-int.h
+//
+// the tx side is the usual producer/consumer split: printk pushes into
+// <tx> and turns the tx interrupt on; the handler moves bytes into the
+// hw FIFO while it has room and turns the tx interrupt off once <tx>
+// is empty (otherwise it would fire forever).   the rx side is the
+// reverse: the handler drains the hw FIFO into <rx>.
+//
+// both queues are single-producer/single-consumer rings so the only
+// shared state that needs interrupts off is <ier> (both sides modify
+// it).
+#include "rpi.h"
+#include "uart-int.h"
+#include "ring-T.h"
+
+#ifndef RPI_UNIX
+#   include "rpi-interrupts.h"
+#   include "rpi-inline-asm.h"
+#else
+    // the fake uart (labs/7-uart/2-fake-pi/fake-uart.c) models the
+    // cpsr interrupt bit.
+    uint32_t cpsr_int_disable(void);
+    uint32_t cpsr_int_reset(uint32_t cpsr);
+    enum { IRQ_Enable_1 = 0x2000b210, IRQ_Disable_1 = 0x2000b21c };
+#endif
+
+// bcm2835 p8-p19
+enum {
+    AUX_MU_IO   = 0x20215040,
+    AUX_MU_IER  = 0x20215044,
+    AUX_MU_IIR  = 0x20215048,
+    AUX_MU_LSR  = 0x20215054,
+
+    // errata: the IER bits are swapped in the manual and bits 2,3 must
+    // be set to get any interrupt at all.
+    IER_RX      = 1<<0,
+    IER_TX      = 1<<1,
+    IER_MUST    = 0b11<<2,
+
+    IIR_NONE    = 1<<0,     // 1 = no interrupt pending.
+
+    LSR_RX_READY = 1<<0,    // at least one byte in rx FIFO.
+    LSR_TX_ROOM  = 1<<5,    // tx FIFO can take at least one byte.
+
+    // the aux interrupt (shared by the mini-uart and spi1/2) in
+    // IRQ_Enable_1
+    AUX_IRQ     = 1<<29,
+};
+
+gen_ring_T(byteq, uint8_t)
+
+static uint8_t tx_buf[UART_INT_TX_NBYTES], rx_buf[UART_INT_RX_NBYTES];
+static byteq_t tx, rx;
+static uint32_t ier;
+static uart_int_stats_t stats;
+
+static rpi_putbuf_t old_putbuf;
+static rpi_putchar_t old_putchar;
+static rpi_putbuf_flush_t old_flush;
+
+static inline void ier_set(uint32_t v) {
+    ier = v;
+    PUT32(AUX_MU_IER, v);
+}
+
+// move as much of <tx> into the hw FIFO as fits.  caller has
+// interrupts off (or is the handler).
+static void tx_fill(void) {
+    uint8_t c;
+    while((GET32(AUX_MU_LSR) & LSR_TX_ROOM) && byteq_pop(&tx, &c))
+        PUT32(AUX_MU_IO, c);
+}
+
+int uart_int_handler(void) {
+    dev_barrier();
+    if(GET32(AUX_MU_IIR) & IIR_NONE) {
+        dev_barrier();
+        return 0;
+    }
+    stats.nints++;
+
+    while(GET32(AUX_MU_LSR) & LSR_RX_READY) {
+        uint8_t c = GET32(AUX_MU_IO) & 0xff;
+        if(!byteq_push(&rx, c))
+            stats.rx_dropped++;
+    }
+
+    tx_fill();
+    if(byteq_empty(&tx))
+        ier_set(ier & ~IER_TX);
+
+    dev_barrier();
+    return 1;
+}
+
+int uart_int_putbuf(const void *buf, unsigned n) {
+    const uint8_t *p = buf;
+
+    uint32_t cpsr = cpsr_int_disable();
+    dev_barrier();
+
+    // nothing queued: skip the queue for whatever fits in the hw FIFO.
+    unsigned i = 0;
+    if(byteq_empty(&tx))
+        for(; i < n && (GET32(AUX_MU_LSR) & LSR_TX_ROOM); i++)
+            PUT32(AUX_MU_IO, p[i]);
+
+    unsigned nq = 0;
+    if(i < n) {
+        nq = byteq_push_n(&tx, &p[i], n - i);
+        stats.tx_dropped += n - i - nq;
+        unsigned nelem = byteq_nelem(&tx);
+        if(nelem > stats.tx_max)
+            stats.tx_max = nelem;
+        ier_set(ier | IER_TX);
+    }
+
+    dev_barrier();
+    cpsr_int_reset(cpsr);
+    return i + nq;
+}
+
+int uart_int_put8(uint8_t c) {
+    return uart_int_putbuf(&c, 1);
+}
+
+static int uart_int_putc(int c) {
+    uart_int_put8(c);
+    return c;
+}
+
+void uart_int_flush_tx(void) {
+    uint32_t cpsr = cpsr_int_disable();
+    dev_barrier();
+    while(!byteq_empty(&tx))
+        tx_fill();
+    dev_barrier();
+    cpsr_int_reset(cpsr);
+}
+
+int uart_int_has_data(void) {
+    return !byteq_empty(&rx);
+}
+
+int uart_int_get8_async(void) {
+    uint8_t c;
+    if(!byteq_pop(&rx, &c))
+        return -1;
+    return c;
+}
+
+int uart_int_get8(void) {
+    int c;
+    while((c = uart_int_get8_async()) < 0)
+        rpi_wait();
+    return c;
+}
+
+unsigned uart_int_getn(void *buf, unsigned n) {
+    return byteq_pop_n(&rx, buf, n);
+}
+
+uart_int_stats_t uart_int_stats(void) {
+    return stats;
+}
+
+void uart_int_init(void) {
+    byteq_init(&tx, tx_buf, UART_INT_TX_NBYTES);
+    byteq_init(&rx, rx_buf, UART_INT_RX_NBYTES);
+    stats = (uart_int_stats_t){};
+
+    dev_barrier();
+    ier_set(IER_MUST | IER_RX);
+    dev_barrier();
+    PUT32(IRQ_Enable_1, AUX_IRQ);
+    dev_barrier();
+
+    old_putbuf = rpi_putbuf_set(uart_int_putbuf);
+    old_putchar = rpi_putchar_set(uart_int_putc);
+    old_flush = rpi_putbuf_flush_set(uart_int_flush_tx);
+}
+
+void uart_int_disable(void) {
+    uart_int_flush_tx();
+
+    uint32_t cpsr = cpsr_int_disable();
+    dev_barrier();
+    PUT32(IRQ_Disable_1, AUX_IRQ);
+    dev_barrier();
+    ier_set(0);
+    dev_barrier();
+    cpsr_int_reset(cpsr);
+
+    rpi_putbuf_set(old_putbuf);
+    rpi_putchar_set(old_putchar);
+    rpi_putbuf_flush_set(old_flush);
+}
@@ -0,0 +1,27 @@
+// cost of binlog vs printk for the same message.  run with 
+// "my-install --binlog bench-binlog.bin" to see the decoded records.
+#include "rpi.h"
+#include "cycle-count.h"
+#include "binlog.h"
+
+enum { NTRIALS = 8 };
+
+static uint32_t logbuf[1024];
+
+void notmain(void) {
+    caches_enable();
+    binlog_init(logbuf, sizeof logbuf);
+
+    unsigned best_bl = ~0, best_pk = ~0;
+    for(unsigned i = 0; i < NTRIALS; i++) {
+        unsigned t = TIME_CYC(binlog("trial %d: x=%x\n", i, i*0x1000));
+        if(t < best_bl)
+            best_bl = t;
+        t = TIME_CYC(printk("trial %d: x=%x\n", i, i*0x1000));
+        if(t < best_pk)
+            best_pk = t;
+    }
+    binlog_flush();
+    printk("BENCH: binlog=%d cycles, printk=%d cycles per call\n", 
+        best_bl, best_pk);
+}
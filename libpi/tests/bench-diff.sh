@@ -0,0 +1,64 @@
+#!/bin/sh
+# compare the BENCH-REGION lines (libpi/include/bench.h) of two runs:
+#       ./bench-diff.sh old.out new.out [percent]
+# prints the median cycles of each region in both and the change, and
+# the new median cycles per byte for regions that give bytes=.  a
+# region more than <percent> (default 5) slower is a regression and
+# makes us exit 1, so you can use it in a script.
+if [ $# -lt 2 ] || [ $# -gt 3 ]; then
+    echo "usage: $0 old-output new-output [percent]" >&2
+    exit 2
+fi
+
+awk -v pct="${3:-5}" '
+# name and median from a BENCH-REGION line.
+function parse(line,    n, i, kv, f) {
+    name = ""; median = ""; bytes = 0
+    n = split(line, f, " ")
+    for(i = 1; i <= n; i++) {
+        if(split(f[i], kv, "=") != 2)
+            continue
+        if(kv[1] == "name") name = kv[2]
+        if(kv[1] == "median") median = kv[2]
+        if(kv[1] == "bytes") bytes = kv[2]
+    }
+}
+FNR == 1 { file++ }
+/BENCH-REGION:/ {
+    parse(substr($0, index($0, "BENCH-REGION:")))
+    if(name == "")
+        next
+    if(file == 1)
+        old[name] = median
+    else {
+        new[name] = median
+        nbytes[name] = bytes
+        if(!(name in seen))
+            order[nnew++] = name
+        seen[name] = 1
+    }
+}
+END {
+    printf "%-24s %12s %12s %8s %8s\n", "region", "old", "new", "cpb", "change"
+    bad = 0
+    for(i = 0; i < nnew; i++) {
+        n = order[i]
+        cpb = nbytes[n] ? sprintf("%.2f", new[n] / nbytes[n]) : "-"
+        if(!(n in old)) {
+            printf "%-24s %12s %12d %8s %8s\n", n, "-", new[n], cpb, "new"
+            continue
+        }
+        if(old[n] == 0)
+            change = new[n] == 0 ? 0 : 100
+        else
+            change = (new[n] - old[n]) * 100.0 / old[n]
+        flag = change > pct ? "  REGRESSION" : ""
+        if(flag != "")
+            bad = 1
+        printf "%-24s %12d %12d %8s %+7.1f%%%s\n", n, old[n], new[n], cpb, change, flag
+    }
+    for(n in old)
+        if(!(n in new))
+            printf "%-24s %12d %12s %8s %8s\n", n, old[n], "-", "-", "gone"
+    exit bad
+}' "$1" "$2"
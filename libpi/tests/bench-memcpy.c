@@ -0,0 +1,74 @@
+// print a table of cycles for memcpy by size and (src,dst) alignment,
+// next to a plain byte loop so you can see what the engine buys you.
+// we run each copy once to warm the caches and take the best of
+// <NTRIALS>.
+#include "rpi.h"
+#include "cycle-count.h"
+
+enum { MAXN = 64*1024, NTRIALS = 4 };
+
+// keep gcc from turning this into a call to memcpy.
+static void __attribute__((noinline))
+byte_copy(void *dst, const void *src, unsigned n) {
+    volatile uint8_t *d = dst;
+    const uint8_t *s = src;
+    for(unsigned i = 0; i < n; i++)
+        d[i] = s[i];
+}
+
+typedef void (*copy_fn_t)(void *, const void *, unsigned);
+
+static void memcpy_wrap(void *dst, const void *src, unsigned n) {
+    memcpy(dst,src,n);
+}
+
+static unsigned
+time_copy(copy_fn_t fn, uint8_t *dst, const uint8_t *src, unsigned n) {
+    unsigned best = ~0;
+    for(unsigned i = 0; i < NTRIALS; i++) {
+        unsigned s = cycle_cnt_read();
+        fn(dst, src, n);
+        unsigned t = cycle_cnt_read() - s;
+        if(t < best)
+            best = t;
+    }
+    return best;
+}
+
+void notmain(void) {
+    cycle_cnt_init();
+    caches_enable();
+
+    // 8 bytes of slop so we can shift both pointers.
+    uint8_t *src = kmalloc_aligned(MAXN+8, 32);
+    uint8_t *dst = kmalloc_aligned(MAXN+8, 32);
+    for(unsigned i = 0; i < MAXN+8; i++)
+        src[i] = i;
+
+    static const unsigned sizes[] =
+        { 4, 16, 32, 64, 128, 256, 1024, 4096, 16*1024, MAXN };
+    static const struct { unsigned s,d; } offs[] =
+        { {0,0}, {1,1}, {0,1}, {1,0}, {2,0}, {3,1} };
+
+    printk("BENCH: memcpy cycles: <engine> / <byte loop>\n");
+    printk("BENCH: nbytes");
+    for(unsigned j = 0; j < sizeof offs / sizeof offs[0]; j++)
+        printk("\tsrc+%d,dst+%d", offs[j].s, offs[j].d);
+    printk("\n");
+
+    for(unsigned i = 0; i < sizeof sizes / sizeof sizes[0]; i++) {
+        unsigned n = sizes[i];
+        printk("BENCH: %d", n);
+        for(unsigned j = 0; j < sizeof offs / sizeof offs[0]; j++) {
+            uint8_t *s = src + offs[j].s;
+            uint8_t *d = dst + offs[j].d;
+
+            unsigned t_eng  = time_copy(memcpy_wrap, d, s, n);
+            unsigned t_byte = time_copy(byte_copy, d, s, n);
+            if(memcmp(d, s, n) != 0)
+                panic("copy of %d bytes is wrong\n", n);
+            printk("\t%d/%d", t_eng, t_byte);
+        }
+        printk("\n");
+    }
+}
@@ -0,0 +1,35 @@
+// the libc kernels under the benchmark harness (bench.h): one
+// BENCH-REGION line each.  save the output of a run and compare a
+// later one against it with
+//      ./bench-diff.sh old.out new.out
+#include "rpi.h"
+#include "bench.h"
+
+enum { N = 4096 };
+
+// results go here so gcc can't drop the calls.
+static volatile int sink;
+
+void notmain(void) {
+    caches_enable();
+
+    char *a = kmalloc_aligned(N+8, 8);
+    char *b = kmalloc_aligned(N+8, 8);
+    memset(a, 'x', N-1);
+    a[N-1] = 0;
+    memcpy(b, a, N);
+
+    BENCH_REGION_BYTES("memcpy-4k", N)
+        memcpy(b, a, N);
+    BENCH_REGION_BYTES("memcpy-4k-unaligned", N-1)
+        memcpy(b+1, a, N-1);
+    BENCH_REGION_BYTES("memset-4k", N)
+        memset(b, 'x', N);
+    b[N-1] = 0;
+    BENCH_REGION_BYTES("memcmp-4k", N)
+        sink = memcmp(a, b, N);
+    BENCH_REGION_BYTES("strlen-4k", N)
+        sink = strlen(a);
+    BENCH_REGION_BYTES("strcmp-4k", N)
+        sink = strcmp(a, b);
+}
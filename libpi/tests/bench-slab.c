@@ -0,0 +1,40 @@
+// cycles per slab_alloc+slab_free vs a kmalloc (which can't free) for a
+// few sizes, and the stats after a burst of mixed allocations.
+#include "rpi.h"
+#include "cycle-count.h"
+#include "slab.h"
+
+enum { NTRIALS = 8, NLIVE = 256 };
+
+static void *live[NLIVE];
+
+void notmain(void) {
+    kmalloc_init();
+    caches_enable();
+
+    // warm up each class so we time the free list, not the first slab.
+    static const unsigned sizes[] = { 16, 100, 1000, 8000 };
+    for(unsigned i = 0; i < sizeof sizes / sizeof sizes[0]; i++) {
+        unsigned n = sizes[i];
+        slab_free(slab_alloc(n));
+
+        unsigned best_slab = ~0, best_km = ~0;
+        for(unsigned j = 0; j < NTRIALS; j++) {
+            unsigned t = TIME_CYC(slab_free(slab_alloc(n)));
+            if(t < best_slab)
+                best_slab = t;
+            t = TIME_CYC(kmalloc(n));
+            if(t < best_km)
+                best_km = t;
+        }
+        printk("BENCH: %d bytes: slab alloc+free=%d cycles, kmalloc=%d cycles\n",
+            n, best_slab, best_km);
+    }
+
+    for(unsigned j = 0; j < 4*NLIVE; j++) {
+        unsigned i = j * 37 % NLIVE;
+        slab_free(live[i]);
+        live[i] = slab_alloc(j * 13 % 3000 + 1);
+    }
+    slab_stats_print("BENCH");
+}
@@ -0,0 +1,81 @@
+// throughput of the word-at-a-time string kernels vs a byte loop.
+// printk can't do floats, so we print bytes per 100 cycles.
+#include "rpi.h"
+#include "cycle-count.h"
+
+enum { N = 16*1024, NTRIALS = 4 };
+
+// results go here so gcc can't drop the calls.
+static volatile int sink;
+
+static size_t __attribute__((noinline)) byte_strlen(const char *p) {
+    const volatile char *v = p;
+    size_t n = 0;
+    while(v[n])
+        n++;
+    return n;
+}
+static int __attribute__((noinline)) byte_memiszero(const void *_p, unsigned n) {
+    const volatile char *p = _p;
+    for(unsigned i = 0; i < n; i++)
+        if(p[i])
+            return 0;
+    return 1;
+}
+static int __attribute__((noinline)) byte_memcmp(const void *_a, const void *_b, unsigned n) {
+    const volatile unsigned char *a = _a, *b = _b;
+    for(unsigned i = 0; i < n; i++)
+        if(a[i] != b[i])
+            return a[i] - b[i];
+    return 0;
+}
+
+// best of <NTRIALS> runs of <_stmt>
+#define BEST_CYC(_stmt) ({                      \
+    unsigned _best = ~0;                        \
+    for(unsigned _i = 0; _i < NTRIALS; _i++) {  \
+        unsigned _t = TIME_CYC(_stmt);          \
+        if(_t < _best)                          \
+            _best = _t;                         \
+    }                                           \
+    _best;                                      \
+})
+
+static void emit(const char *name, unsigned nbytes, unsigned fast, unsigned slow) {
+    printk("BENCH: %s: %d bytes: %d cycles (%d bytes/100cyc), byte loop %d cycles (%d bytes/100cyc)\n",
+        name, nbytes, fast, nbytes*100/fast, slow, nbytes*100/slow);
+}
+
+void notmain(void) {
+    cycle_cnt_init();
+    caches_enable();
+
+    char *a = kmalloc_aligned(N+8, 8);
+    char *b = kmalloc_aligned(N+8, 8);
+    char *c = kmalloc_aligned(N+8, 8);
+
+    // strings of length N-1: <b> is offset by one byte to test the
+    // misaligned paths too.
+    memset(a, 'x', N-1);
+    memset(b+1, 'x', N-1);
+    a[N-1] = b[N] = 0;
+    memcpy(c, a, N);
+
+    for(unsigned n = 64; n <= N; n *= 4) {
+        printk("BENCH: ---- n=%d ----\n", n);
+        a[n-1] = c[n-1] = 0;
+        b[n] = 0;
+        emit("strlen", n, BEST_CYC(sink = strlen(a)), BEST_CYC(sink = byte_strlen(a)));
+        emit("strcmp(aligned)", n, BEST_CYC(sink = strcmp(a, c)), BEST_CYC(sink = byte_memcmp(a, c, n)));
+        emit("strcmp(unaligned)", n, BEST_CYC(sink = strcmp(a, b+1)), BEST_CYC(sink = byte_memcmp(a, b+1, n)));
+        emit("memcmp(aligned)", n, BEST_CYC(sink = memcmp(a, c, n)), BEST_CYC(sink = byte_memcmp(a, c, n)));
+        emit("memcmp(unaligned)", n, BEST_CYC(sink = memcmp(a, b+1, n)), BEST_CYC(sink = byte_memcmp(a, b+1, n)));
+        a[n-1] = c[n-1] = 'x';
+        b[n] = 'x';
+    }
+
+    // memiszero: a zeroed SD-sector-sized and page-table-sized buffer.
+    memset(a, 0, N);
+    emit("memiszero", 512, BEST_CYC(sink = memiszero(a, 512)), BEST_CYC(sink = byte_memiszero(a, 512)));
+    emit("memiszero", N, BEST_CYC(sink = memiszero(a, N)), BEST_CYC(sink = byte_memiszero(a, N)));
+}
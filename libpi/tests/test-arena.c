@@ -0,0 +1,120 @@
+// check the arena allocator (libpi/libc/arena.c) on top of slab.c and
+// a fake kmalloc: random nests of marks, where everything allocated
+// before a mark has to survive its reset, and a long run of alloc/reset
+// cycles that must not keep growing the heap.
+//
+// we pull arena.c and slab.c straight in: defining rpi.h's guard makes
+// their #include "rpi.h" a no-op so libunix.h supplies panic and assert.
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+#define printk(args...) ({ trace(args); 0; })
+
+enum { HEAP_NBYTES = 16*1024*1024 };
+static uint8_t heap[HEAP_NBYTES] __attribute__((aligned(4096)));
+static unsigned heap_used;
+
+static void *kmalloc_aligned(unsigned nbytes, unsigned align) {
+    heap_used = (heap_used + align - 1) & ~(align - 1);
+    if(heap_used + nbytes > HEAP_NBYTES)
+        panic("fake kmalloc: out of memory\n");
+    void *p = &heap[heap_used];
+    heap_used += nbytes;
+    return p;
+}
+static void *kmalloc(unsigned nbytes) { return kmalloc_aligned(nbytes, 8); }
+static void *kmalloc_heap_start(void) { return heap; }
+static void *kmalloc_heap_end(void) { return heap + HEAP_NBYTES; }
+
+#include "slab.h"
+#include "arena.h"
+#include "slab.c"
+#include "arena.c"
+
+enum { NOBJ = 4096, NLEVEL = 8, NROUNDS = 2000 };
+
+// every object we allocated and haven't reset away.
+static struct obj {
+    uint8_t *p;
+    unsigned n;
+    uint8_t seed;
+} objs[NOBJ];
+static unsigned nobj;
+
+static void obj_check(struct obj *o) {
+    for(unsigned i = 0; i < o->n; i++)
+        if(o->p[i] != (uint8_t)(o->seed + i))
+            panic("%d bytes at %p: byte %d was overwritten\n", o->n, o->p, i);
+}
+
+static void alloc_some(kmalloc_arena_t *a) {
+    unsigned k = random() % 16;
+    for(unsigned j = 0; j < k && nobj < NOBJ; j++) {
+        struct obj *o = &objs[nobj++];
+        o->n = random() % 100 ? random() % 200 + 1 : random() % 40000 + 1;
+        unsigned align = 1 << (random() % 8);
+        o->p = arena_alloc_aligned(a, o->n, align);
+        if((uintptr_t)o->p % (align < 8 ? 8 : align))
+            panic("%d bytes aligned to %d: got %p\n", o->n, align, o->p);
+        for(unsigned i = 0; i < o->n; i++)
+            if(o->p[i])
+                panic("%d bytes: byte %d is not zero\n", o->n, i);
+        o->seed = random();
+        for(unsigned i = 0; i < o->n; i++)
+            o->p[i] = o->seed + i;
+    }
+}
+
+// allocate, take a mark, recurse, reset to it and check what came
+// before is still intact.
+static void nest(kmalloc_arena_t *a, unsigned level) {
+    alloc_some(a);
+    if(level == NLEVEL)
+        return;
+    unsigned nmarks = random() % 3;
+    for(unsigned i = 0; i < nmarks; i++) {
+        arena_mark_t m = arena_mark(a);
+        unsigned n = nobj;
+        nest(a, level + 1);
+        arena_reset_to_mark(a, m);
+        nobj = n;
+        for(unsigned j = 0; j < nobj; j++)
+            obj_check(&objs[j]);
+    }
+}
+
+int main(void) {
+    kmalloc_arena_t a = {};
+
+    unsigned heap1 = 0;
+    for(unsigned r = 0; r < NROUNDS; r++) {
+        nobj = 0;
+        nest(&a, 0);
+        for(unsigned j = 0; j < nobj; j++)
+            obj_check(&objs[j]);
+        arena_reset_to_mark(&a, (arena_mark_t){});
+        if(r == NROUNDS/2)
+            heap1 = a.heap_bytes;
+    }
+    trace("%d rounds: arena holds %d bytes, %d after half\n",
+        NROUNDS, a.heap_bytes, heap1);
+    if(a.heap_bytes > heap1 + heap1 / 4)
+        panic("resets don't reuse chunks: %d bytes -> %d\n",
+            heap1, a.heap_bytes);
+
+    // give it all back: a second arena should get a chunk of it without
+    // going to kmalloc.
+    unsigned used = heap_used;
+    arena_free_all(&a);
+    if(slab_stats().live_objs)
+        panic("arena_free_all left %d chunks live\n", slab_stats().live_objs);
+    kmalloc_arena_t b = {};
+    for(unsigned i = 0; i < 100; i++)
+        arena_alloc(&b, 100);
+    if(heap_used != used)
+        panic("second arena took %d new bytes\n", heap_used - used);
+    arena_free_all(&b);
+    trace("arena_free_all: chunks reused by the next arena\n");
+    return 0;
+}
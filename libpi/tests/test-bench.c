@@ -0,0 +1,72 @@
+// check the benchmark harness (libpi/libc/bench.c) on unix against a
+// fake cycle counter: each read costs a fixed number of cycles and the
+// region bodies "run" for however long we tell them, so the overhead
+// correction, the stats and the wraparound check all have exact
+// answers.
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+#define printk(args...) ({ trace(args); 0; })
+
+enum { READ_CYC = 7, MHZ = 700 };
+
+// 64-bit so we can run past a 32-bit wrap.
+static uint64_t now;
+void cycle_cnt_init(void) { }
+unsigned cycle_cnt_read(void) {
+    uint32_t c = now;
+    now += READ_CYC;
+    return c;
+}
+static uint32_t timer_get_usec(void) { return now / MHZ; }
+
+#include "bench.h"
+#include "bench.c"
+
+static void run(uint64_t ncyc) { now += ncyc; }
+
+int main(void) {
+    // reads on either side of the empty loop.
+    trace("overhead=%d\n", bench_overhead());
+
+    BENCH_REGION("empty")
+        ;
+    assert(bench_last.median == 0 && bench_last.max == 0);
+
+    // 11 trials of 1000..1100: the warm-up runs are slower and must
+    // not show up.
+    unsigned i = 0;
+    BENCH_REGION_BYTES("memcpy-4k", 4096) {
+        if(i < BENCH_NWARM)
+            run(50000);
+        else
+            run(1000 + (i * 7 % 11) * 10);
+        i++;
+    }
+    assert(i == BENCH_NWARM + BENCH_NTRIALS);
+    assert(bench_last.min == 1000 && bench_last.median == 1050);
+    assert(bench_last.max == 1100);
+
+    // odd trial counts and no warm-up.
+    i = 0;
+    BENCH_REGION_CFG("three", 3, 0, 3)
+        run(++i * 3);
+    assert(bench_last.median == 6);
+
+    // start near the top so the counter wraps inside a trial: unsigned
+    // subtraction has to get it right.
+    now = 0xffffff00;
+    BENCH_REGION_BYTES("wrap-once", 1)
+        run(0x200);
+    assert(bench_last.min == 0x200 && bench_last.nwrapped == 0);
+
+    // longer than the counter can hold: flagged and saturated.
+    i = 0;
+    BENCH_REGION_CFG("wrap-all", 0, 0, 4) {
+        run(i++ == 1 ? (1ULL << 32) + 100 : 100);
+    }
+    assert(bench_last.nwrapped == 1 && bench_last.max == ~0u);
+    assert(bench_last.min == 100);
+    return 0;
+}
@@ -0,0 +1,109 @@
+// check the unix-side binlog decoder (libunix/pi-binlog.c): we build
+// frames the way libpi/libc/binlog.c lays them out, mix them into a
+// text stream, feed it in random sized pieces and compare what comes
+// out to what printk would have printed.
+#include <string.h>
+#include "libunix.h"
+
+// fake .binlog_fmt section at pi address <FMT_ADDR>.
+enum { FMT_ADDR = 0x100 };
+static const char fmts[] =
+    "hello\n\0"
+    "n=%d u=%u x=%x\n\0"
+    "<%-4d|%04X|%6x|%b|%c>\n\0"
+    "str=%s\n";
+
+// pi address of the <i>th format string.
+static uint32_t fmt_id(unsigned i) {
+    const char *p = fmts;
+    while(i--)
+        p += strlen(p) + 1;
+    return FMT_ADDR + (p - fmts);
+}
+
+// a frame: magic, header and records.
+static uint32_t frame[256];
+static unsigned nframe;
+
+static void rec(uint32_t id, uint32_t cyc, unsigned nargs, const uint32_t *args) {
+    frame[nframe++] = id << 4 | nargs;
+    frame[nframe++] = cyc;
+    for(unsigned i = 0; i < nargs; i++)
+        frame[nframe++] = args[i];
+}
+
+// append the frame to <s>: returns new length.
+static unsigned frame_emit(uint8_t *s, unsigned ndropped, int corrupt_p) {
+    uint32_t recs = nframe - 4;
+    frame[0] = BINLOG_MAGIC;
+    frame[1] = recs;
+    frame[2] = ndropped;
+    frame[3] = our_crc32(&frame[4], recs*4) ^ corrupt_p;
+    memcpy(s, frame, nframe*4);
+    unsigned n = nframe*4;
+    nframe = 4;
+    return n;
+}
+
+// feed <n> bytes in random pieces; return the decoded text.
+static char *decode(const uint8_t *s, unsigned n, binlog_dec_t *d_out) {
+    char *out = 0;
+    size_t nout = 0;
+    FILE *f = open_memstream(&out, &nout);
+    binlog_dec_t d = binlog_dec_mk_fmts(f, fmts, sizeof fmts, FMT_ADDR);
+
+    for(unsigned i = 0; i < n; ) {
+        unsigned k = 1 + random() % 17;
+        if(k > n - i)
+            k = n - i;
+        binlog_dec_feed(&d, s + i, k);
+        i += k;
+    }
+    fclose(f);
+    *d_out = d;
+    return out;
+}
+
+int main(void) {
+    uint8_t s[4096];
+    unsigned n = 0;
+    nframe = 4;
+
+    n += sprintf((char *)s, "text before ");
+    rec(fmt_id(0), 1000, 0, 0);
+    rec(fmt_id(1), 1500, 3, (uint32_t[]){ -12, 4000000000U, 0xbeef });
+    n += frame_emit(s+n, 0, 0);
+    n += sprintf((char *)s+n, "middle\n");
+
+    // the cycle counter wraps between these two.
+    rec(fmt_id(2), 0xfffffff0, 5, (uint32_t[]){ 7, 0xab, 0x1f, 5, 'z' });
+    rec(fmt_id(3), 0x10, 1, (uint32_t[]){ 0x1234 });
+    n += frame_emit(s+n, 3, 0);
+
+    // a bad crc: should be dropped.
+    rec(fmt_id(0), 0x20, 0, 0);
+    n += frame_emit(s+n, 3, 1);
+    n += sprintf((char *)s+n, "the end\n");
+
+    const char *expect =
+        "text before [cyc=0] hello\n"
+        "[cyc=500] n=-12 u=4000000000 x=0xbeef\n"
+        "middle\n"
+        "BINLOG: pi dropped 3 records (ring was full)\n"
+        "[cyc=4294966280] <7   |00ab|  0x1f|101|z>\n"
+        "[cyc=4294966312] str=<str@0x1234>\n"
+        "BINLOG: frame with bad crc: dropping 2 words\n"
+        "the end\n";
+
+    for(unsigned trial = 0; trial < 100; trial++) {
+        binlog_dec_t d;
+        char *out = decode(s, n, &d);
+        if(strcmp(out, expect) != 0)
+            panic("mismatch: got:\n<%s>\nexpected:\n<%s>\n", out, expect);
+        if(d.nrecords != 4 || d.nbad_frames != 1)
+            panic("nrecords=%d, nbad_frames=%d\n", d.nrecords, d.nbad_frames);
+        free(out);
+    }
+    trace("binlog decoder ok\n");
+    return 0;
+}
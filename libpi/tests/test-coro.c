@@ -0,0 +1,168 @@
+// run the coroutine event loop (libpi/libc/coro.c) on unix against
+// fake devices and a fake clock (every read of it is one usec later):
+//   - a uart that gets a byte of <input> every UART_USEC: a
+//     coroutine reads it a line at a time with CORO_WAIT_READY.
+//   - a radio with packets arriving on a schedule: a receiver waits
+//     for them with a timeout (CORO_WAIT_READY_TIMEOUT).
+//   - NSLEEP coroutines sleeping on the timer wheel: none wakes early.
+//   - a watcher that waits (CORO_WAIT_UNTIL) for the others to finish.
+// all of them on the one stack, interleaved by one loop.
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+static uint64_t now;
+uint64_t timer_get_usec64(void) { return now++; }
+int uart_has_data(void);
+
+#include "timer-wheel.c"
+#include "coro.c"
+
+/**********************************************************************
+ * fake devices.
+ */
+enum { UART_USEC = 90 };
+static const char input[] = "hello\nworld\nthe last line\n";
+static unsigned uart_pos;
+
+int uart_has_data(void) {
+    return uart_pos < sizeof input - 1 && now >= (uart_pos + 1) * UART_USEC;
+}
+static int uart_get8(void) {
+    assert(uart_has_data());
+    return input[uart_pos++];
+}
+
+typedef struct {
+    const uint64_t *arrive;     // when each packet shows up.
+    unsigned n, next;
+} nrf_t;
+
+static int nrf_nbytes_avail(nrf_t *nic) {
+    return nic->next < nic->n && now >= nic->arrive[nic->next] ? 32 : 0;
+}
+static int nrf_ready(void *nic) {
+    return nrf_nbytes_avail(nic) > 0;
+}
+
+/**********************************************************************
+ * coroutines.
+ */
+typedef struct {
+    coro_t c;
+    char line[32];
+    unsigned n, nlines;
+} reader_t;
+
+static coro_status_t reader(coro_t *c) {
+    reader_t *r = (void *)c;
+    CORO_BEGIN(c);
+    while(r->nlines < 3) {
+        for(r->n = 0; ; r->n++) {
+            CORO_WAIT_READY(c, coro_uart_ready, 0);
+            r->line[r->n] = uart_get8();
+            if(r->line[r->n] == '\n')
+                break;
+        }
+        r->line[r->n] = 0;
+        r->nlines++;
+        trace("reader: line %d: <%s>\n", r->nlines, r->line);
+    }
+    CORO_END(c);
+}
+
+enum { NPKT = 6, RX_TIMEOUT = 500 };
+static const uint64_t arrivals[NPKT] = { 100, 300, 1500, 1600, 2900, 3000 };
+
+typedef struct {
+    coro_t c;
+    nrf_t *nic;
+    unsigned npkts, ntimeouts;
+} receiver_t;
+
+static coro_status_t receiver(coro_t *c) {
+    receiver_t *r = (void *)c;
+    CORO_BEGIN(c);
+    while(r->npkts < NPKT) {
+        CORO_WAIT_READY_TIMEOUT(c, nrf_ready, r->nic, RX_TIMEOUT);
+        if(coro_timed_out(c)) {
+            r->ntimeouts++;
+            continue;
+        }
+        r->nic->next++;
+        r->npkts++;
+    }
+    trace("receiver: %d packets, %d timeouts\n", r->npkts, r->ntimeouts);
+    CORO_END(c);
+}
+
+enum { NSLEEP = 500, NNAPS = 5 };
+
+typedef struct {
+    coro_t c;
+    unsigned id, i;
+    uint64_t deadline;
+} sleeper_t;
+
+static unsigned nnaps;
+static uint64_t max_late;
+
+static coro_status_t sleeper(coro_t *c) {
+    sleeper_t *s = (void *)c;
+    CORO_BEGIN(c);
+    for(s->i = 0; s->i < NNAPS; s->i++) {
+        s->deadline = now + (s->id % 13 + 1) * 50;
+        CORO_SLEEP_UNTIL(c, s->deadline);
+        if(now < s->deadline)
+            panic("sleeper %d: woke at %lld, before %lld\n",
+                s->id, now, s->deadline);
+        if(now - s->deadline > max_late)
+            max_late = now - s->deadline;
+        nnaps++;
+    }
+    CORO_END(c);
+}
+
+static reader_t rd;
+static receiver_t rx;
+static sleeper_t sleepers[NSLEEP];
+
+// everyone else is done once only we are left.
+static coro_status_t watcher(coro_t *c) {
+    CORO_BEGIN(c);
+    CORO_YIELD(c);
+    CORO_WAIT_UNTIL(c, c->s->ncoros == 1);
+    trace("watcher: reader got %d lines, %d naps taken\n", rd.nlines, nnaps);
+    CORO_END(c);
+}
+
+int main(void) {
+    coro_sched_t s;
+    coro_sched_init(&s);
+
+    nrf_t nic = { .arrive = arrivals, .n = NPKT };
+    rx.nic = &nic;
+
+    coro_t w;
+    coro_spawn(&s, &w, watcher, "watcher");
+    coro_spawn(&s, &rd.c, reader, "reader");
+    coro_spawn(&s, &rx.c, receiver, "receiver");
+    for(unsigned i = 0; i < NSLEEP; i++) {
+        coro_spawn(&s, &sleepers[i].c, sleeper, "sleeper");
+        sleepers[i].id = i;
+    }
+    coro_run(&s);
+
+    assert(rd.nlines == 3 && uart_pos == sizeof input - 1);
+    assert(rx.npkts == NPKT && rx.ntimeouts > 0);
+    assert(nnaps == NSLEEP * NNAPS);
+    // each pass reads the clock once, plus once per sleeper that goes
+    // back to sleep: a pass can't take longer than every sleeper
+    // re-arming.
+    assert(max_late <= NSLEEP + 1);
+    // the sleepers were never polled, only the reader and receiver
+    // (and the watcher, which is resumed each pass instead).
+    assert(s.npolls < 2 * s.npasses);
+    trace("all done\n");
+    return 0;
+}
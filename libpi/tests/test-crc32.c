@@ -0,0 +1,85 @@
+// check the slice-by-8 crc32 (libpi/libc/our-crc32.c, linked in via
+// libunix) against the original byte-at-a-time version for every
+// alignment and lots of sizes; check crc32_combine and the streaming
+// context; print host MB/s for both.
+#include <string.h>
+#include "libunix.h"
+
+// the original bitwise definition: slow but obviously right.
+static uint32_t ref_crc32(const void *buf, unsigned n) {
+    const uint8_t *p = buf;
+    uint32_t crc = ~0U;
+    while(n--) {
+        crc ^= *p++;
+        for(unsigned j = 0; j < 8; j++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+enum { N = 4096, NBENCH = 64*1024*1024 };
+static uint8_t buf[N+8];
+
+// so gcc can't drop the benchmark calls.
+static volatile uint32_t sink;
+
+static double mb_per_sec(unsigned nbytes, time_usec_t usec) {
+    return usec ? (double)nbytes / usec : 0;
+}
+
+int main(void) {
+    for(unsigned i = 0; i < sizeof buf; i++)
+        buf[i] = random();
+
+    // known answer.
+    if(our_crc32("123456789", 9) != 0xcbf43926)
+        panic("bad crc of 123456789: %x\n", our_crc32("123456789", 9));
+
+    unsigned ntests = 0;
+    for(unsigned n = 0; n < 300; n++)
+        for(unsigned off = 0; off < 8; off++, ntests++)
+            if(our_crc32(buf+off, n) != ref_crc32(buf+off, n))
+                panic("crc mismatch: n=%u, off=%u\n", n, off);
+    for(unsigned i = 0; i < 1000; i++, ntests++) {
+        unsigned off = random() % 8, n = random() % N;
+        if(our_crc32(buf+off, n) != ref_crc32(buf+off, n))
+            panic("crc mismatch: n=%u, off=%u\n", n, off);
+    }
+    trace("our_crc32: %u sizes/alignments match the bitwise crc\n", ntests);
+
+    // split a buffer at random points and merge the pieces.
+    ntests = 0;
+    for(unsigned i = 0; i < 2000; i++, ntests++) {
+        unsigned n = random() % N;
+        unsigned k = n ? random() % (n+1) : 0;
+        uint32_t whole = our_crc32(buf, n);
+
+        uint32_t c1 = our_crc32(buf, k);
+        uint32_t c2 = our_crc32(buf+k, n-k);
+        if(crc32_combine(c1, c2, n-k) != whole)
+            panic("combine mismatch: n=%u, split=%u\n", n, k);
+
+        crc32_ctx_t c;
+        crc32_ctx_init(&c);
+        crc32_ctx_update(&c, buf, k/2);
+        crc32_ctx_update(&c, buf+k/2, k-k/2);
+        crc32_ctx_append(&c, c2, n-k);
+        if(crc32_ctx_final(&c) != whole || c.nbytes != n)
+            panic("ctx mismatch: n=%u, split=%u\n", n, k);
+    }
+    trace("crc32_combine/crc32_ctx: %u random splits match\n", ntests);
+
+    // host speed: not part of the .out since it varies.
+    uint8_t *big = calloc(1, NBENCH);
+    time_usec_t s = time_get_usec();
+    sink = our_crc32(big, NBENCH);
+    time_usec_t t_fast = time_get_usec() - s;
+
+    s = time_get_usec();
+    sink = ref_crc32(big, NBENCH/16);
+    time_usec_t t_ref = time_get_usec() - s;
+    output("BENCH: slice-by-8: %.1f MB/s, bitwise: %.1f MB/s\n",
+        mb_per_sec(NBENCH, t_fast), mb_per_sec(NBENCH/16, t_ref));
+    free(big);
+    return 0;
+}
@@ -0,0 +1,201 @@
+// check the profiler end to end on unix: the pi side
+// (libpi/libc/gprof.c) counts made-up samples and dumps them with a
+// fake rpi_putbuf into a buffer, mixed in with text; the unix side
+// (libunix/pi-gprof.c) pulls the frames back out in random sized
+// pieces and reports against a made-up symbol table.
+//
+// we can't walk real frames here (the pi's are 32-bit), so stacks go
+// in through gprof_sample_stack, plus gprof_sample with no fp.  the PMU
+// counters are fakes we bump by hand.
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+
+enum { HEAP_NBYTES = 1024*1024 };
+static uint8_t heap[HEAP_NBYTES] __attribute__((aligned(8)));
+static unsigned heap_used;
+static void *kmalloc(unsigned nbytes) {
+    heap_used = (heap_used + 7) & ~7;
+    if(heap_used + nbytes > HEAP_NBYTES)
+        panic("fake kmalloc: out of memory\n");
+    void *p = &heap[heap_used];
+    heap_used += nbytes;
+    return p;
+}
+
+// what the pi "sent".
+static uint8_t wire[64*1024];
+static unsigned nwire;
+static int rpi_putbuf(const void *p, unsigned n) {
+    assert(nwire + n <= sizeof wire);
+    memcpy(&wire[nwire], p, n);
+    nwire += n;
+    return n;
+}
+static void rpi_putbuf_flush(void) { }
+static void text(const char *s) { rpi_putbuf(s, strlen(s)); }
+
+uint32_t __code_start__[1], __code_end__[1];
+
+// fake PMU: the test bumps the counters by hand before each tick.
+#define __ARMV6_PMU_H__
+enum {
+    PMU_ICACHE_MISS = 0x0, PMU_INST_STALL = 0x1, PMU_DATA_STALL = 0x2,
+    PMU_BRANCH_MISPREDICT = 0x6, PMU_INST_CNT = 0x7,
+    PMU_DCACHE_ACCESS = 0xa, PMU_DCACHE_MISS = 0xb, PMU_MAIN_TLB_MISS = 0xf,
+};
+static uint32_t pmu_ctrl, pmu_cyc, pmu_ev[2];
+static uint32_t pmu_control_get(void) { return pmu_ctrl; }
+// setting the control register with the reset bits clears the counts.
+static void pmu_control_config(uint32_t r) { pmu_ctrl = r; pmu_ev[0] = pmu_ev[1] = 0; }
+static uint32_t pmu_event0_get(void) { return pmu_ev[0]; }
+static uint32_t pmu_event1_get(void) { return pmu_ev[1]; }
+static uint32_t pmu_cycle_get(void) { return pmu_cyc; }
+
+#include "gprof.c"
+
+// made-up functions: baz has no size so runs to the end.
+enum { NOTMAIN = 0x8000, FOO = 0x8100, BAR = 0x8180, BAZ = 0x8200 };
+static const pi_elf_func_t syms[] = {
+    { NOTMAIN,  0x100,  "notmain" },
+    { FOO,      0x80,   "foo" },
+    { BAR,      0x80,   "bar" },
+    { BAZ,      0,      "baz" },
+};
+
+static void sample(unsigned n, unsigned depth, const uint32_t *s) {
+    for(unsigned i = 0; i < n; i++)
+        gprof_sample_stack(s, depth);
+}
+#define SAMPLE(_n, _pcs...) \
+    sample(_n, sizeof (uint32_t[]){_pcs} / 4, (uint32_t[]){_pcs})
+
+// feed the wire in random pieces.
+static pi_gprof_dec_t decode(FILE *out) {
+    pi_gprof_dec_t d = pi_gprof_dec_mk(out);
+    for(unsigned i = 0; i < nwire; ) {
+        unsigned k = 1 + random() % 29;
+        if(k > nwire - i)
+            k = nwire - i;
+        pi_gprof_dec_feed(&d, &wire[i], k);
+        i += k;
+    }
+    return d;
+}
+
+// run <fn> for a tick at its event rates (per tick, indexed by event
+// number) and then take the sample.
+static void pmu_tick(uint32_t pc, uint32_t cyc, const uint32_t *rate) {
+    pmu_cyc += cyc;
+    pmu_ev[0] += rate[bits_get(pmu_ctrl, 20, 27)];
+    pmu_ev[1] += rate[bits_get(pmu_ctrl, 12, 19)];
+    gprof_pmu_sample(pc);
+}
+
+// trace each line of <s>.
+static void trace_lines(char *s) {
+    for(char *nl; (nl = strchr(s, '\n')); s = nl + 1) {
+        *nl = 0;
+        trace("%s\n", s);
+    }
+}
+
+int main(void) {
+    gprof_init(0, 0);
+
+    text("before\n");
+    // the sampled pc, then the return addresses, innermost first.
+    SAMPLE(30, FOO+8, NOTMAIN+0x20);
+    SAMPLE(20, BAR+4, FOO+0x10, NOTMAIN+0x20);
+    SAMPLE(10, BAR+0xc, NOTMAIN+0x40);
+    // baz calls itself: counts once per stack.
+    SAMPLE(5, BAZ+4, BAZ+0x10, BAZ+0x10, NOTMAIN+0x50);
+    // a return address just past the end of foo is still foo's.
+    SAMPLE(3, BAR+0x8, FOO+0x80, NOTMAIN+0x20);
+    // no symbol.
+    gprof_sample(0x100, 0);
+    gprof_sample(0x100, 0);
+    gprof_dump();
+
+    // a corrupted copy of the same frame.
+    unsigned start = strlen("before\n"), end = nwire;
+    text("middle\n");
+    unsigned bad = nwire;
+    rpi_putbuf(&wire[start], end - start);
+    wire[bad + 20] ^= 1;
+
+    // sampling is off while disabled.
+    gprof_enable(0);
+    SAMPLE(100, FOO);
+    gprof_enable(1);
+    SAMPLE(1, FOO+4, NOTMAIN+0x20);
+    gprof_dump();
+    text("after\nDONE!!!\n");
+
+    char *out = 0;
+    size_t nout = 0;
+    FILE *f = open_memstream(&out, &nout);
+    pi_gprof_dec_t d = decode(f);
+    fclose(f);
+    trace_lines(out);
+    free(out);
+    trace("%d frames, %d bad\n", d.nframes, d.nbad_frames);
+
+    unsigned nsyms = sizeof syms / sizeof syms[0];
+    f = open_memstream(&out, &nout);
+    pi_gprof_report(f, &d.last, syms, nsyms);
+    pi_gprof_folded(f, &d.last, syms, nsyms);
+    fclose(f);
+    trace_lines(out);
+    free(out);
+
+    // tiny tables: (4 slots, 3 usable) so some samples get lost.
+    gprof_init(3, 3);
+    for(unsigned i = 0; i < 5; i++)
+        SAMPLE(1, FOO + i*4, NOTMAIN);
+    nwire = 0;
+    gprof_dump();
+    pi_gprof_free(&d.last);
+    d = decode(stdout);
+    trace("tiny tables: %d samples, %d pcs (%d lost), %d stacks (%d lost)\n",
+        d.last.nsamples, d.last.npcs, d.last.nlost_pcs,
+        d.last.nstacks, d.last.nlost_stacks);
+
+    // hardware events: foo runs three ticks for each of bar's, so each
+    // pair of events sees both.  foo has CPI 2 and misses a lot, bar
+    // has CPI 1.
+    static const uint32_t foo_rate[16] = {
+        [PMU_INST_CNT] = 500,  [PMU_ICACHE_MISS] = 5, [PMU_DCACHE_MISS] = 20,
+        [PMU_BRANCH_MISPREDICT] = 3, [PMU_INST_STALL] = 100,
+        [PMU_DATA_STALL] = 200, [PMU_DCACHE_ACCESS] = 150,
+    };
+    static const uint32_t bar_rate[16] = {
+        [PMU_INST_CNT] = 1000, [PMU_DCACHE_MISS] = 1, [PMU_MAIN_TLB_MISS] = 2,
+        [PMU_DCACHE_ACCESS] = 300,
+    };
+    gprof_pmu_init(0);
+    for(unsigned i = 0; i < 160; i++) {
+        if(i % 4 == 3)
+            pmu_tick(BAR + 4 * (i % 3), 1000, bar_rate);
+        else
+            pmu_tick(FOO + 4 * (i % 5), 1000, foo_rate);
+    }
+    // off: not counted, and doesn't leak into the next tick.
+    gprof_pmu_enable(0);
+    pmu_tick(FOO, 5000, bar_rate);
+    pmu_cyc += 1000000;
+    gprof_pmu_enable(1);
+    pmu_tick(0x100, 1000, bar_rate);
+
+    nwire = 0;
+    text("pmu\n");
+    gprof_pmu_dump();
+    f = open_memstream(&out, &nout);
+    d = decode(f);
+    pi_gprof_pmu_report(f, &d.last_pmu, syms, nsyms);
+    fclose(f);
+    trace_lines(out);
+    free(out);
+    return 0;
+}
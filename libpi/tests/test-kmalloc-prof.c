@@ -0,0 +1,147 @@
+// check the heap profiler (libpi/libc/kmalloc-prof.c) on unix: calls
+// are charged to the right sites, and overflows, writes after free,
+// double frees and frees of kmalloc'd memory are all caught.
+//
+// we pull slab.c and kmalloc-prof.c straight in over a fake kmalloc
+// (defining rpi.h's guard makes their #include "rpi.h" a no-op), then
+// define KMALLOC_PROF so the rest of this file's kmalloc and slab calls
+// go through the profiler, just like a pi program built with it.
+// panic longjmps back so we can check the errors we expect.
+#include <setjmp.h>
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+#define printk(args...) ({ output(args); 0; })
+
+static jmp_buf panic_jb;
+static int expect_panic_p;
+#undef panic
+#define panic(args...) do {                                 \
+    output(args);                                           \
+    if(!expect_panic_p)                                     \
+        exit(1);                                            \
+    longjmp(panic_jb, 1);                                   \
+} while(0)
+
+enum { HEAP_NBYTES = 16*1024*1024 };
+static uint8_t heap[HEAP_NBYTES] __attribute__((aligned(4096)));
+static unsigned heap_used;
+
+static void *kmalloc_aligned(unsigned nbytes, unsigned align) {
+    heap_used = (heap_used + align - 1) & ~(align - 1);
+    if(heap_used + nbytes > HEAP_NBYTES)
+        panic("fake kmalloc: out of memory\n");
+    void *p = &heap[heap_used];
+    heap_used += nbytes;
+    return p;
+}
+static void *kmalloc(unsigned nbytes) { return kmalloc_aligned(nbytes, 8); }
+static void *kmalloc_notzero(unsigned nbytes) { return kmalloc(nbytes); }
+static void *kmalloc_heap_start(void) { return heap; }
+static void *kmalloc_heap_end(void) { return heap + HEAP_NBYTES; }
+static uint32_t timer_get_usec(void) { static uint32_t t; return t += 10; }
+
+#include "slab.h"
+#include "slab.c"
+#include "kmalloc-prof.c"
+
+#define KMALLOC_PROF
+#include "kmalloc-prof.h"
+
+// run <_stmt>, which should panic.
+#define EXPECT_PANIC(_msg, _stmt) do {                      \
+    expect_panic_p = 1;                                     \
+    if(!setjmp(panic_jb)) {                                 \
+        _stmt;                                              \
+        expect_panic_p = 0;                                 \
+        panic("expected a panic: %s\n", _msg);              \
+    }                                                       \
+    expect_panic_p = 0;                                     \
+    trace("caught: %s\n", _msg);                            \
+} while(0)
+
+// three call sites with different sizes and counts.
+static void *site_a(void) { return kmalloc(100); }
+static void *site_b(void) { return slab_alloc(32); }
+static void *site_c(unsigned n) { return slab_alloc(n); }
+
+static void check_sites(void) {
+    void *b[20];
+    for(unsigned i = 0; i < 10; i++)
+        site_a();
+    for(unsigned i = 0; i < 20; i++)
+        b[i] = site_b();
+    for(unsigned i = 0; i < 15; i++)
+        slab_free(b[i]);
+    for(unsigned i = 1; i <= 5; i++)
+        slab_free(site_c(i * 1000));
+
+    // the pcs (and so the slots) change from run to run: print the
+    // rest, biggest first.
+    trace("%d sites\n", nsites);
+    unsigned last = ~0;
+    for(unsigned n = 0; n < nsites; n++) {
+        kmalloc_prof_site_t *s = 0;
+        for(unsigned i = 0; i < KMALLOC_PROF_NSITES; i++)
+            if(sites[i].nalloc && sites[i].nbytes < last
+            && (!s || sites[i].nbytes > s->nbytes))
+                s = &sites[i];
+        last = s->nbytes;
+        trace("site: %d allocs, %d frees, %d bytes (%d live), sizes %d..%d\n",
+            s->nalloc, s->nfree, s->nbytes, s->live_bytes,
+            s->min_nbytes, s->max_nbytes);
+    }
+    if(nsites != 3)
+        panic("expected 3 sites, have %d\n", nsites);
+    kmalloc_prof_dump();
+    kmalloc_prof_dump_log(4);
+}
+
+int main(void) {
+    check_sites();
+
+    uint8_t *p = kmalloc_aligned(100, 64);
+    if((uintptr_t)p % 64)
+        panic("kmalloc_aligned(100, 64) gave %p\n", p);
+    if(kmalloc_prof_check())
+        panic("clean heap has errors\n");
+
+    // overflow by one.
+    p[100] = 1;
+    unsigned nbad = kmalloc_prof_check();
+    trace("overflow: %d bad\n", nbad);
+    EXPECT_PANIC("slab_free of kmalloc'd memory", slab_free(p));
+    p[100] = KP_RZ_BYTE;
+
+    // underflow into the header.
+    uint8_t *q = slab_alloc(40);
+    q[-1] = 0;
+    nbad = kmalloc_prof_check();
+    trace("underflow: %d bad\n", nbad);
+    EXPECT_PANIC("free with a trashed header", slab_free(q));
+    q[-1] = KP_GUARD >> 24;
+
+    slab_free(q);
+    q[3] = 0;
+    nbad = kmalloc_prof_check();
+    trace("write after free: %d bad\n", nbad);
+    q[3] = KMALLOC_PROF_POISON;
+    EXPECT_PANIC("double free", slab_free(q));
+
+    static uint64_t junk[8];
+    EXPECT_PANIC("free of memory we didn't allocate", slab_free(&junk[4]));
+
+    // lots of allocs and frees so the quarantine turns over: none of
+    // it should trip.
+    void *objs[64] = {0};
+    for(unsigned i = 0; i < 5000; i++) {
+        unsigned k = random() % 64;
+        slab_free(objs[k]);
+        objs[k] = slab_alloc(random() % 500);
+    }
+    if(kmalloc_prof_check())
+        panic("random allocs and frees have errors\n");
+    trace("%d allocations, no errors\n", nlog);
+    return 0;
+}
@@ -0,0 +1,83 @@
+// check the memcpy engine (libpi/libc/memcpy-engine.h) against libc
+// for every size up to <MAXN> and every src/dst alignment, plus
+// overlapping memmoves.   we put guard bytes around each copy to
+// catch writes outside of [dst, dst+n).
+#include <string.h>
+#include "libunix.h"
+#include "memcpy-engine.h"
+
+enum { MAXN = 300, PAD = 64, BUFSZ = 4096 };
+
+static uint8_t src[BUFSZ], dst[BUFSZ], ref[BUFSZ];
+
+static void fill(uint8_t *p, unsigned n) {
+    for(unsigned i = 0; i < n; i++)
+        p[i] = random();
+}
+
+static void check(const char *what, unsigned n, unsigned soff, unsigned doff) {
+    if(memcmp(dst, ref, BUFSZ) != 0)
+        panic("%s mismatch: n=%u, src off=%u, dst off=%u\n", 
+            what, n, soff, doff);
+}
+
+static void check_cpy(unsigned n, unsigned soff, unsigned doff) {
+    fill(src, BUFSZ);
+    fill(dst, BUFSZ);
+    memcpy(ref, dst, BUFSZ);
+
+    void *ret = mcpy_fwd(dst+PAD+doff, src+PAD+soff, n);
+    if(ret != dst+PAD+doff)
+        panic("bad return value\n");
+    memcpy(ref+PAD+doff, src+PAD+soff, n);
+    check("memcpy", n, soff, doff);
+}
+
+// copy within <dst> from offset <from> to offset <to>.
+static void check_move(unsigned n, unsigned from, unsigned to) {
+    fill(dst, BUFSZ);
+    memcpy(ref, dst, BUFSZ);
+
+    void *ret = mcpy_move(dst+to, dst+from, n);
+    if(ret != dst+to)
+        panic("bad return value\n");
+    memmove(ref+to, ref+from, n);
+    check("memmove", n, from, to);
+}
+
+int main(void) {
+    unsigned ncopies = 0;
+
+    for(unsigned n = 0; n <= MAXN; n++)
+        for(unsigned soff = 0; soff < 8; soff++)
+            for(unsigned doff = 0; doff < 8; doff++, ncopies++)
+                check_cpy(n, soff, doff);
+    trace("memcpy: %u copies (n <= %u, all alignments) passed\n", 
+        ncopies, MAXN);
+
+    // a few big ones to hit the 32-byte block loops hard.
+    ncopies = 0;
+    for(unsigned i = 0; i < 1000; i++, ncopies++) 
+        check_cpy(random() % (BUFSZ - 2*PAD - 8), random()%8, random()%8);
+    trace("memcpy: %u random large copies passed\n", ncopies);
+
+    // overlapping in both directions, every distance < 40.
+    unsigned nmoves = 0;
+    for(unsigned n = 0; n <= MAXN; n++)
+        for(unsigned base = 0; base < 4; base++)
+            for(unsigned dist = 0; dist < 40; dist++, nmoves += 2) {
+                check_move(n, PAD+base, PAD+base+dist);
+                check_move(n, PAD+base+dist, PAD+base);
+            }
+    trace("memmove: %u overlapping moves passed\n", nmoves);
+
+    nmoves = 0;
+    for(unsigned i = 0; i < 1000; i++, nmoves++) {
+        unsigned n = random() % (BUFSZ / 2);
+        unsigned from = random() % (BUFSZ - n);
+        unsigned to = random() % (BUFSZ - n);
+        check_move(n, from, to);
+    }
+    trace("memmove: %u random moves passed\n", nmoves);
+    return 0;
+}
@@ -0,0 +1,151 @@
+// check the printk/snprintk formatting core (libpi/libc/printk.c)
+// against libc snprintf: widths, padding, truncation, the divide-free
+// decimal conversion, and that printk hands whole buffers to
+// rpi_putbuf rather than a byte at a time.
+//
+// we pull printk.c and sprintk.c straight in: defining rpi.h's guard
+// makes their #include "rpi.h" a no-op so libunix.h supplies panic
+// and assert.
+#include <stdio.h>
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+int printk(const char *format, ...);
+int vprintk(const char *fmt, va_list ap);
+int snprintk(char *buf, unsigned buflen, const char *fmt, ...);
+int vsnprintk(char *buf, unsigned buflen, const char *fmt, va_list ap);
+void printk_batch_start(void *buf, unsigned n);
+void printk_flush(void);
+void printk_batch_stop(void);
+
+// capture everything printk emits.
+static char out[8192];
+static unsigned nout, ncalls;
+static int rpi_putbuf(const void *buf, unsigned n) {
+    assert(nout + n < sizeof out);
+    memcpy(out + nout, buf, n);
+    nout += n;
+    ncalls++;
+    return n;
+}
+
+#include "printk.c"
+#include "sprintk.c"
+
+static unsigned ntests;
+
+// run <_kfmt> through snprintk and the equivalent <_cfmt> through
+// snprintf.
+#define CHECK2(_kfmt, _cfmt, _args...) do {                         \
+    char _a[256], _b[256];                                          \
+    int _na = snprintk(_a, sizeof _a, _kfmt, ##_args);              \
+    int _nb = snprintf(_b, sizeof _b, _cfmt, ##_args);              \
+    if(_na != _nb || strcmp(_a,_b) != 0)                            \
+        panic("fmt=<%s>: snprintk=<%s> (%d), snprintf=<%s> (%d)\n", \
+            _kfmt, _a, _na, _b, _nb);                               \
+    ntests++;                                                       \
+} while(0)
+#define CHECK(_fmt, _args...) CHECK2(_fmt, _fmt, ##_args)
+
+static void reset(void) { nout = ncalls = 0; }
+
+int main(void) {
+    // divide-free decimal: check the reciprocal at the edges and
+    // randomly in between.
+    for(uint32_t u = 0; u < 1000000; u++)
+        if(udiv100(u) != u/100)
+            panic("udiv100(%u) = %u\n", u, udiv100(u));
+    for(uint32_t u = ~0U; u > ~0U - 1000000; u--)
+        if(udiv100(u) != u/100)
+            panic("udiv100(%u) = %u\n", u, udiv100(u));
+    for(unsigned i = 0; i < 1000000; i++) {
+        uint32_t u = random() ^ (random() << 16);
+        if(udiv100(u) != u/100)
+            panic("udiv100(%u) = %u\n", u, udiv100(u));
+    }
+    trace("udiv100 matches u/100\n");
+
+    // %x and %p print a leading 0x, which is %#x for non-zero values
+    // but not for 0, so check those by hand below.
+    for(unsigned i = 0; i < 100000; i++) {
+        uint32_t u = random() ^ (random() << 16);
+        int d = u;
+        // make small numbers common too.
+        if(i % 2)
+            u >>= random() % 32;
+        CHECK("%d|%u", d, u);
+        CHECK("%10d|%-10d|%010d|%3d", d, d, d, d>>(i%32));
+        CHECK("%12u|%-12u|%012u|%1u", u, u, u, u);
+        CHECK("%*d|%*u", (int)(i%20), d, -(int)(i%20), u);
+        // %X is lower case hex without the 0x.
+        CHECK2("%08X|%X|%-9X|", "%08x|%x|%-9x|", u, u, u);
+        if(u)
+            CHECK2("%x|%12x|%-12x|%012x",
+                   "%#x|%#12x|%#-12x|%#012x", u, u, u, u);
+    }
+    CHECK("%d %d %u", (int)0x80000000, -1, ~0U);
+    CHECK("<%s> <%8s> <%-8s> <%c> <%3c> <%-3c> 100%%", "hi", "hi", "hi", 'x', 'y', 'z');
+    CHECK("%s", "");
+
+    // no snprintf equivalents.
+    char buf[64];
+    snprintk(buf, sizeof buf, "%x %p %6x %b %08b", 0, 0x10, 0xab, 5, 5);
+    if(strcmp(buf, "0x0 0x10   0xab 101 00000101") != 0)
+        panic("bad: <%s>\n", buf);
+    snprintk(buf, sizeof buf, "%llx %llx", 0x1ULL<<32, 0xdeadbeefcafeULL);
+    if(strcmp(buf, "0x100000000 0xdeadbeefcafe") != 0)
+        panic("bad: <%s>\n", buf);
+    trace("%u formats match snprintf\n", ntests);
+
+    // truncation: always 0-terminate, return the full length.
+    for(unsigned n = 1; n < 16; n++) {
+        memset(buf, 'z', sizeof buf);
+        int len = snprintk(buf, n, "hello %d world", 12345);
+        if(len != 17 || strlen(buf) != n-1 || memcmp(buf, "hello 12345 world", n-1))
+            panic("truncate to %u: <%s> len=%d\n", n, buf, len);
+        if(buf[n] != 'z')
+            panic("wrote past the end at n=%u\n", n);
+    }
+    trace("snprintk truncates\n");
+
+    // printk: one rpi_putbuf call per short printk; long ones get
+    // flushed in PRINTK_BUFSIZE chunks.
+    reset();
+    printk("hello %s %d\n", "world", 10);
+    if(ncalls != 1 || nout != 15 || memcmp(out, "hello world 10\n", 15))
+        panic("printk: %u calls, <%.*s>\n", ncalls, nout, out);
+
+    char big[1000];
+    memset(big, 'a', sizeof big - 1);
+    big[sizeof big - 1] = 0;
+    reset();
+    int n = printk("%s!", big);
+    if(n != 1000 || nout != 1000 || out[999] != '!')
+        panic("printk: returned %d, emitted %u\n", n, nout);
+    if(ncalls != (1000 + PRINTK_BUFSIZE - 1) / PRINTK_BUFSIZE)
+        panic("printk: %u calls for 1000 bytes\n", ncalls);
+
+    // batching: nothing comes out until flush or the buffer fills.
+    char bbuf[64];
+    reset();
+    printk_batch_start(bbuf, sizeof bbuf);
+    for(unsigned i = 0; i < 10; i++)
+        printk("%d,", i);
+    if(ncalls)
+        panic("batched printk emitted early\n");
+    printk_flush();
+    if(ncalls != 1 || nout != 20 || memcmp(out, "0,1,2,3,4,5,6,7,8,9,", 20))
+        panic("batch flush: %u calls, <%.*s>\n", ncalls, nout, out);
+    for(unsigned i = 0; i < 100; i++)
+        printk("%d,", i % 10);
+    printk_batch_stop();
+    if(nout != 220 || ncalls != 1 + (200 + sizeof bbuf - 1) / sizeof bbuf)
+        panic("batch: %u bytes in %u calls\n", nout, ncalls);
+    reset();
+    printk("x");
+    if(ncalls != 1)
+        panic("batch stop didn't stop\n");
+    trace("printk buffering ok\n");
+    return 0;
+}
@@ -0,0 +1,194 @@
+// stress the lock-free rings (libpi/libc/ring-T.h) on unix with real
+// threads: a producer and a consumer hammering a small spsc ring with
+// random sized batches, then several producers and one consumer on the
+// mpsc ring.  every element carries who sent it and a sequence number
+// so we catch anything lost, duplicated, torn or out of order.
+//
+// the interleavings (and so how often the rings fill) change from run
+// to run; only the totals are traced.
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+#include "ring-T.h"
+
+gen_ring_T(u32q, uint32_t)
+gen_ring_mp_T(mpq, uint64_t)
+
+enum { SP_N = 64, SP_COUNT = 2000000 };
+enum { MP_N = 128, MP_NPROD = 4, MP_COUNT = 250000 };
+
+static u32q_t sp;
+static uint32_t sp_buf[SP_N];
+
+// no progress: let the other side run (we may only have one cpu).
+static void backoff(unsigned n) {
+    if(!n)
+        sched_yield();
+}
+
+// cheap per-thread random so the threads don't fight over random()'s lock.
+static unsigned rnd(unsigned *s) {
+    *s = *s * 1103515245 + 12345;
+    return (*s >> 16) & 0x7fff;
+}
+
+static void *sp_producer(void *arg) {
+    unsigned s = 1, next = 0;
+    uint32_t batch[SP_N + 8];
+    while(next < SP_COUNT) {
+        // sometimes more than fits so push_n has to clip.
+        unsigned k = 1 + rnd(&s) % (SP_N + 8);
+        if(k > SP_COUNT - next)
+            k = SP_COUNT - next;
+        if(k == 1) {
+            unsigned n = u32q_push(&sp, next);
+            next += n;
+            backoff(n);
+            continue;
+        }
+        for(unsigned i = 0; i < k; i++)
+            batch[i] = next + i;
+        unsigned n = u32q_push_n(&sp, batch, k);
+        next += n;
+        backoff(n);
+    }
+    return 0;
+}
+
+static void spsc(void) {
+    u32q_init(&sp, sp_buf, SP_N);
+    pthread_t t;
+    if(pthread_create(&t, 0, sp_producer, 0))
+        panic("pthread_create failed\n");
+
+    unsigned s = 2, expect = 0;
+    uint32_t batch[SP_N], x;
+    while(expect < SP_COUNT) {
+        unsigned k = rnd(&s) % SP_N;
+        if(!k) {
+            if(u32q_peek(&sp, &x)) {
+                assert(u32q_pop(&sp, &x));
+                if(x != expect)
+                    panic("spsc: expected %u, got %u\n", expect, x);
+                expect++;
+            } else
+                backoff(0);
+            continue;
+        }
+        k = u32q_pop_n(&sp, batch, k);
+        backoff(k);
+        for(unsigned i = 0; i < k; i++, expect++)
+            if(batch[i] != expect)
+                panic("spsc: expected %u, got %u\n", expect, batch[i]);
+    }
+    pthread_join(t, 0);
+    assert(u32q_empty(&sp) && !u32q_pop(&sp, &x));
+    trace("spsc: %d elements through a %d slot ring in order\n", SP_COUNT, SP_N);
+}
+
+static mpq_t mp;
+static mpq_slot_t mp_slots[MP_N];
+
+// element = producer id in the top half, sequence in the bottom.
+static void *mp_producer(void *arg) {
+    uint64_t id = (uintptr_t)arg;
+    unsigned s = 3 + id, next = 0;
+    uint64_t batch[8];
+    while(next < MP_COUNT) {
+        unsigned k = 1 + rnd(&s) % 8;
+        if(k > MP_COUNT - next)
+            k = MP_COUNT - next;
+        if(k == 1) {
+            unsigned n = mpq_push(&mp, id << 32 | next);
+            next += n;
+            backoff(n);
+            continue;
+        }
+        for(unsigned i = 0; i < k; i++)
+            batch[i] = id << 32 | (next + i);
+        // all or nothing.
+        unsigned n = mpq_push_n(&mp, batch, k);
+        assert(n == 0 || n == k);
+        next += n;
+        backoff(n);
+    }
+    return 0;
+}
+
+static void mpsc(void) {
+    mpq_init(&mp, mp_slots, MP_N);
+    pthread_t t[MP_NPROD];
+    for(uintptr_t i = 0; i < MP_NPROD; i++)
+        if(pthread_create(&t[i], 0, mp_producer, (void *)i))
+            panic("pthread_create failed\n");
+
+    // each producer's elements must come out in the order it pushed.
+    unsigned expect[MP_NPROD] = {0}, total = 0, s = 4;
+    uint64_t batch[16];
+    while(total < MP_NPROD * MP_COUNT) {
+        unsigned k = mpq_pop_n(&mp, batch, 1 + rnd(&s) % 16);
+        backoff(k);
+        for(unsigned i = 0; i < k; i++, total++) {
+            unsigned id = batch[i] >> 32;
+            uint32_t seq = batch[i];
+            if(id >= MP_NPROD)
+                panic("mpsc: bad producer %u\n", id);
+            if(seq != expect[id])
+                panic("mpsc: producer %u: expected %u, got %u\n",
+                    id, expect[id], seq);
+            expect[id]++;
+        }
+    }
+    for(unsigned i = 0; i < MP_NPROD; i++)
+        pthread_join(t[i], 0);
+    uint64_t x;
+    assert(mpq_empty(&mp) && !mpq_pop(&mp, &x));
+    trace("mpsc: %d producers x %d elements through a %d slot ring in order\n",
+        MP_NPROD, MP_COUNT, MP_N);
+}
+
+// single threaded edge cases: exact capacity, wrapping bulk copies,
+// counters wrapping at 2^32.
+static void edges(void) {
+    uint32_t buf[8], in[12], out[12];
+    u32q_t q;
+    u32q_init(&q, buf, 8);
+    for(unsigned i = 0; i < 12; i++)
+        in[i] = 100 + i;
+
+    assert(u32q_push_n(&q, in, 12) == 8);
+    assert(u32q_full(&q) && q.noverflow == 4 && !u32q_push(&q, 1));
+    assert(u32q_pop_n(&q, out, 5) == 5 && out[4] == 104);
+    // wraps the end of <buf>.
+    assert(u32q_push_n(&q, in, 5) == 5 && u32q_nelem(&q) == 8);
+    assert(u32q_pop_n(&q, out, 12) == 8);
+    assert(out[2] == 107 && out[3] == 100 && out[7] == 104);
+
+    // start just short of 2^32.
+    q.head = q.tail = 0xfffffffd;
+    assert(u32q_push_n(&q, in, 6) == 6 && u32q_nelem(&q) == 6);
+    assert(u32q_pop_n(&q, out, 6) == 6 && out[5] == 105);
+    assert(u32q_empty(&q) && q.head == 3);
+
+    mpq_slot_t slots[4];
+    mpq_t m;
+    uint64_t e[5] = {1,2,3,4,5}, o[5];
+    mpq_init(&m, slots, 4);
+    assert(mpq_push_n(&m, e, 5) == 0 && m.noverflow == 5);
+    assert(mpq_push_n(&m, e, 3) == 3);
+    // doesn't fit: nothing goes in.
+    assert(mpq_push_n(&m, e, 2) == 0 && mpq_push(&m, 9));
+    assert(!mpq_push(&m, 10) && m.noverflow == 8);
+    assert(mpq_pop_n(&m, o, 5) == 4 && o[2] == 3 && o[3] == 9);
+    trace("edge cases ok\n");
+}
+
+int main(void) {
+    edges();
+    spsc();
+    mpsc();
+    return 0;
+}
@@ -0,0 +1,138 @@
+// randomized alloc/free stress test of the size-class allocator
+// (libpi/libc/slab.c) on top of a fake kmalloc: every object is filled
+// with a pattern when allocated and checked when freed, so any overlap
+// or free list corruption shows up.  also checks alignment, zero fill
+// and that the stats agree with what we think is live.
+//
+// we pull slab.c straight in: defining rpi.h's guard makes its
+// #include "rpi.h" a no-op so libunix.h supplies panic and assert.
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+#define printk(args...) ({ trace(args); 0; })
+
+// kmalloc: a bump allocator over <heap>, which is zero and never reused
+// so everything comes back 0-filled.
+enum { HEAP_NBYTES = 64*1024*1024 };
+static uint8_t heap[HEAP_NBYTES] __attribute__((aligned(4096)));
+static unsigned heap_used;
+
+static void *kmalloc_aligned(unsigned nbytes, unsigned align) {
+    heap_used = (heap_used + align - 1) & ~(align - 1);
+    if(heap_used + nbytes > HEAP_NBYTES)
+        panic("fake kmalloc: out of memory\n");
+    void *p = &heap[heap_used];
+    heap_used += nbytes;
+    return p;
+}
+static void *kmalloc(unsigned nbytes) { return kmalloc_aligned(nbytes, 8); }
+static void *kmalloc_heap_start(void) { return heap; }
+static void *kmalloc_heap_end(void) { return heap + HEAP_NBYTES; }
+
+#include "slab.h"
+#include "slab.c"
+
+enum { NSLOT = 2048, NOPS = 400*1000 };
+
+static struct slot {
+    uint8_t *p;
+    unsigned n;
+    uint8_t seed;
+} slots[NSLOT];
+static unsigned nlive;
+
+// mostly small, some medium, a few big.
+static unsigned rand_size(void) {
+    unsigned r = random() % 100;
+    if(r < 60)
+        return random() % 128 + 1;
+    if(r < 90)
+        return random() % 2048 + 1;
+    if(r < 99)
+        return random() % (16*1024) + 1;
+    return random() % (256*1024) + 1;
+}
+
+static void slot_alloc(struct slot *s) {
+    s->n = rand_size();
+    s->seed = random();
+    s->p = slab_alloc(s->n);
+    if((uintptr_t)s->p % 8)
+        panic("%d bytes: %p is not 8-byte aligned\n", s->n, s->p);
+    for(unsigned i = 0; i < s->n; i++)
+        if(s->p[i])
+            panic("%d bytes: byte %d is not zero\n", s->n, i);
+    for(unsigned i = 0; i < s->n; i++)
+        s->p[i] = s->seed + i * 7;
+    nlive++;
+}
+
+static void slot_free(struct slot *s) {
+    for(unsigned i = 0; i < s->n; i++)
+        if(s->p[i] != (uint8_t)(s->seed + i * 7))
+            panic("%d bytes at %p: byte %d was overwritten\n", s->n, s->p, i);
+    slab_free(s->p);
+    s->p = 0;
+    nlive--;
+}
+
+// <NOPS> random allocs and frees: an empty slot gets allocated, a full
+// one freed.
+static void stress(void) {
+    for(unsigned i = 0; i < NOPS; i++) {
+        struct slot *s = &slots[random() % NSLOT];
+        if(s->p)
+            slot_free(s);
+        else
+            slot_alloc(s);
+    }
+    if(slab_stats().live_objs != nlive)
+        panic("stats say %d live, have %d\n", slab_stats().live_objs, nlive);
+}
+
+static void free_all(void) {
+    for(unsigned i = 0; i < NSLOT; i++)
+        if(slots[i].p)
+            slot_free(&slots[i]);
+    slab_stats_t s = slab_stats();
+    if(s.live_objs || s.live_bytes)
+        panic("freed everything but %d objects, %d bytes live\n",
+            s.live_objs, s.live_bytes);
+}
+
+static void check_aligned(void) {
+    unsigned n = 0;
+    for(unsigned align = 16; align <= 4096; align *= 2)
+        for(unsigned sz = 1; sz < 3*align; sz += align / 4 + 3) {
+            void *p = slab_alloc_aligned(sz, align);
+            if((uintptr_t)p % align)
+                panic("%d bytes aligned to %d: got %p\n", sz, align, p);
+            slab_free(p);
+            n++;
+        }
+    trace("slab_alloc_aligned: %d allocations aligned\n", n);
+}
+
+int main(void) {
+    slab_init();
+    check_aligned();
+
+    stress();
+    slab_stats_print("after stress");
+    free_all();
+
+    // everything freed stays with its class, so a second run of the
+    // same mix should mostly reuse it.
+    unsigned heap1 = slab_stats().heap_bytes;
+    stress();
+    free_all();
+    unsigned heap2 = slab_stats().heap_bytes;
+    trace("second run grew the heap %d%%\n", (heap2 - heap1) * 100 / heap1);
+    if(heap2 - heap1 > heap1 / 10)
+        panic("second run took %d more bytes after %d\n", heap2 - heap1, heap1);
+
+    slab_stats_print("after free");
+    trace("%d allocs and frees: patterns intact\n", slab_stats().nalloc);
+    return 0;
+}
@@ -0,0 +1,114 @@
+// randomized differential test of the word-at-a-time string/compare
+// kernels (libpi/libc/word-at-a-time.h) against libc.
+//
+// we also put strings and buffers right up against a PROT_NONE page:
+// if a kernel reads past the page it will segfault.
+#include <string.h>
+#include <sys/mman.h>
+#include "libunix.h"
+#include "word-at-a-time.h"
+
+enum { NTRIALS = 200000, MAXN = 200 };
+
+static int sign(int x) { return (x > 0) - (x < 0); }
+
+// random string of length <n> at <p>: small alphabet so we get lots
+// of long common prefixes.
+static void rand_str(char *p, unsigned n) {
+    for(unsigned i = 0; i < n; i++)
+        p[i] = 'a' + random() % 3;
+    p[n] = 0;
+}
+
+static void check_str(const char *a, const char *b, size_t n) {
+    if(wat_strlen(a) != strlen(a))
+        panic("strlen mismatch: <%s>\n", a);
+    if(sign(wat_strcmp(a,b)) != sign(strcmp(a,b)))
+        panic("strcmp mismatch: <%s> <%s>\n", a, b);
+    if(sign(wat_strncmp(a,b,n)) != sign(strncmp(a,b,n)))
+        panic("strncmp(n=%zu) mismatch: <%s> <%s>\n", n, a, b);
+}
+
+static void check_mem(const void *a, const void *b, size_t n) {
+    if(sign(wat_memcmp(a,b,n)) != sign(memcmp(a,b,n)))
+        panic("memcmp mismatch: n=%zu\n", n);
+
+    int iszero = 1;
+    for(size_t i = 0; i < n; i++)
+        if(((const char *)a)[i])
+            iszero = 0;
+    if(wat_memiszero(a,n) != iszero)
+        panic("memiszero mismatch: n=%zu\n", n);
+}
+
+static void random_trials(void) {
+    static char a[MAXN+16], b[MAXN+16];
+
+    for(unsigned i = 0; i < NTRIALS; i++) {
+        char *pa = a + random() % 8, *pb = b + random() % 8;
+        unsigned na = random() % MAXN;
+        rand_str(pa, na);
+
+        // mostly make <b> a copy of <a> with a tweak so we test
+        // long matches.
+        switch(random() % 3) {
+        case 0: rand_str(pb, random() % MAXN); break;
+        case 1: strcpy(pb, pa); break;
+        case 2: strcpy(pb, pa);
+                if(na)
+                    pb[random() % na] ^= random() % 256;
+                break;
+        }
+        check_str(pa, pb, random() % (MAXN+8));
+
+        // memcmp/memiszero: sometimes all zeros with one byte set.
+        unsigned n = random() % MAXN;
+        if(random() % 2) {
+            memset(pa, 0, n+1);
+            memset(pb, 0, n+1);
+            if(n && random() % 2)
+                pa[random() % n] = 1;
+        }
+        check_mem(pa, pb, n);
+    }
+    trace("%d random string/memory trials passed\n", NTRIALS);
+}
+
+// put strings/buffers so they end exactly at the start of a
+// PROT_NONE page.
+static void guard_page_trials(void) {
+    long pg = sysconf(_SC_PAGESIZE);
+    char *m = mmap(0, 2*pg, PROT_READ|PROT_WRITE,
+                    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(m == MAP_FAILED)
+        sys_die(mmap, "can't map two pages");
+    if(mprotect(m+pg, pg, PROT_NONE) < 0)
+        sys_die(mprotect, "can't protect guard page");
+    char *end = m + pg;
+
+    unsigned ntrials = 0;
+    for(unsigned n = 0; n < 64; n++) {
+        // string of length <n> whose 0 is the last byte of the page.
+        char *a = end - n - 1;
+        rand_str(a, n);
+        char *b = m;
+        strcpy(b, a);
+        check_str(a, b, n+8);
+        check_str(b, a, n+8);
+
+        // buffer of <n> bytes that ends at the page.
+        char *z = end - n;
+        memset(z, 0, n);
+        check_mem(z, b, n);
+        check_mem(b, z, n);
+        ntrials += 4;
+    }
+    munmap(m, 2*pg);
+    trace("%d guard page trials passed\n", ntrials);
+}
+
+int main(void) {
+    random_trials();
+    guard_page_trials();
+    return 0;
+}
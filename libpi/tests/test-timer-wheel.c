@@ -0,0 +1,162 @@
+// check the timer wheel (libpi/libc/timer-wheel.c) on unix against a
+// brute force list of the same timers: everything fires exactly when
+// it's due, in deadline order, cancels stick, and time only stops
+// where there is work to do.
+#include <string.h>
+#include "libunix.h"
+
+#define __RPI_H__
+#include "timer-wheel.h"
+#include "timer-wheel.c"
+
+enum { NTIMERS = 512, NSTEPS = 20000 };
+
+typedef struct {
+    tw_timer_t t;
+    uint64_t deadline;      // what we asked for.
+    int pending;            // what we think.
+    unsigned nfired, nrearm;
+} tmr_t;
+
+static tw_t w;
+static tmr_t tmrs[NTIMERS];
+static uint64_t run_from, run_to, last_fired;
+static unsigned nfired;
+
+// some near, some seconds out, a few past the top level.
+static uint64_t rand_delay(void) {
+    switch(random() % 8) {
+    case 0: return 0;
+    case 1: return random() % 32;
+    case 2: case 3: return random() % 5000;
+    case 4: case 5: return random() % 2000000;
+    case 6: return random() % (1ULL << 31);
+    default: return (uint64_t)random() << 8;
+    }
+}
+
+static void add(tmr_t *x, uint64_t deadline);
+
+static void fire(tw_timer_t *t, void *arg) {
+    tmr_t *x = arg;
+    assert(&x->t == t && x->pending);
+    assert(!tw_pending(t));
+    // not early, not late, and in order.
+    if(t->deadline > run_to)
+        panic("fired early: deadline=%llu, running to %llu\n",
+            (unsigned long long)t->deadline, (unsigned long long)run_to);
+    if(t->deadline >= run_from && t->deadline < w.now)
+        panic("fired late: deadline=%llu, now=%llu\n",
+            (unsigned long long)t->deadline, (unsigned long long)w.now);
+    assert(t->deadline >= last_fired || t->deadline < run_from);
+    last_fired = t->deadline;
+
+    x->pending = 0;
+    x->nfired++;
+    nfired++;
+    // some re-arm themselves from the callback.
+    if(x->nrearm) {
+        x->nrearm--;
+        add(x, w.now + rand_delay());
+    }
+}
+
+static void add(tmr_t *x, uint64_t deadline) {
+    x->deadline = deadline;
+    x->pending = 1;
+    tw_add(&w, &x->t, deadline, fire, x);
+}
+
+static uint64_t earliest(void) {
+    uint64_t min = ~0ULL;
+    for(unsigned i = 0; i < NTIMERS; i++)
+        if(tmrs[i].pending && tmrs[i].deadline < min)
+            min = tmrs[i].deadline;
+    return min;
+}
+
+static unsigned npending(void) {
+    unsigned n = 0;
+    for(unsigned i = 0; i < NTIMERS; i++)
+        n += tmrs[i].pending;
+    return n;
+}
+
+static void run(uint64_t to) {
+    run_from = w.now;
+    run_to = to;
+    last_fired = 0;
+    tw_run(&w, to);
+    // nothing left that is due.
+    assert(earliest() > to);
+}
+
+static void check_next(void) {
+    uint64_t when;
+    int p = tw_next(&w, &when);
+    assert(p == (npending() != 0));
+    assert(w.npending == npending());
+    if(p)
+        assert(when >= w.now && when <= earliest());
+}
+
+int main(void) {
+    // a few by hand: the parked one has to get re-placed twice.
+    static const uint64_t d[] = {
+        10, 5, 5, 33, 1024, 1025, 40000, 1ULL << 36, (1ULL << 37) + 3
+    };
+    enum { N = sizeof d / sizeof d[0] };
+    tw_init(&w, 0);
+    for(unsigned i = 0; i < N; i++)
+        add(&tmrs[i], d[i]);
+    tw_cancel(&w, &tmrs[5].t);
+    tmrs[5].pending = 0;
+
+    unsigned nwakeups = 0;
+    uint64_t when;
+    while(tw_next(&w, &when)) {
+        nwakeups++;
+        unsigned before = nfired;
+        run(when);
+        if(nfired != before)
+            trace("t=%llu: fired %d\n", (unsigned long long)when, nfired - before);
+    }
+    trace("%d fired in %d wakeups\n", nfired, nwakeups);
+    for(unsigned i = 0; i < N; i++)
+        assert(tmrs[i].nfired == (i != 5));
+
+    // random adds, cancels, moves and re-arms; time moves either to
+    // the next event or jumps ahead.
+    memset(tmrs, 0, sizeof tmrs);
+    nfired = 0;
+    tw_init(&w, 12345);
+    unsigned ncancel = 0, nadd = 0;
+    for(unsigned s = 0; s < NSTEPS; s++) {
+        tmr_t *x = &tmrs[random() % NTIMERS];
+        switch(random() % 4) {
+        case 0:
+            if(tw_cancel(&w, &x->t))
+                ncancel++;
+            x->pending = 0;
+            break;
+        default:
+            x->nrearm = random() % 3;
+            add(x, w.now + rand_delay());
+            nadd++;
+            break;
+        }
+        check_next();
+
+        if(random() % 2 && tw_next(&w, &when))
+            run(when);
+        else
+            run(w.now + rand_delay() / 4);
+        check_next();
+    }
+    // drain.
+    while(tw_next(&w, &when))
+        run(when);
+    assert(!npending());
+    trace("random: %d adds, %d cancels, %d fired\n", nadd, ncancel, nfired);
+    return 0;
+}
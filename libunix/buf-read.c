@@ -0,0 +1,102 @@
+// buffered reads from the pi's tty.
+//
+// get_uint8 used to do a read() system call per byte, and the
+// bootloader reads a lot of bytes.  now one read() takes whatever has
+// shown up (up to BUF_READ_SIZE) and the calls after it come straight
+// out of the buffer.
+//
+// there is one buffer, for whichever fd was read last: we only talk
+// to one pi at a time.  after a buffered read, code that calls read()
+// on the tty itself has to take what's buffered first
+// (<buf_read_drain>: see pi-echo.c) or it loses it, and code that
+// flushes the tty has to drop it (<buf_read_flush>).
+#include <string.h>
+#include <unistd.h>
+#include "libunix.h"
+
+enum { BUF_READ_SIZE = 4096 };
+
+static struct {
+    int fd;
+    unsigned head, tail;        // [head, tail) not read yet.
+    uint8_t buf[BUF_READ_SIZE];
+} rb = { .fd = -1 };
+
+io_stats_t io_stats;
+
+unsigned buf_read_drain(int fd, void *data, unsigned n) {
+    if(rb.fd != fd)
+        return 0;
+    unsigned k = rb.tail - rb.head;
+    if(k > n)
+        k = n;
+    memcpy(data, &rb.buf[rb.head], k);
+    rb.head += k;
+    io_stats.nrx += k;
+    return k;
+}
+
+void buf_read_flush(int fd) {
+    if(rb.fd == fd)
+        rb.head = rb.tail = 0;
+}
+
+// one read() into the (empty) buffer: returns what read() did.
+static int rb_fill(int fd) {
+    assert(rb.fd != fd || rb.head == rb.tail);
+    rb.fd = fd;
+    rb.head = rb.tail = 0;
+
+    int n = read(fd, rb.buf, sizeof rb.buf);
+    io_stats.nreads++;
+    if(n > 0)
+        rb.tail = n;
+    return n;
+}
+
+int buf_read(int fd, void *data, unsigned n) {
+    unsigned k = buf_read_drain(fd, data, n);
+    if(k)
+        return k;
+    int got = rb_fill(fd);
+    if(got <= 0)
+        return got;
+    return buf_read_drain(fd, data, n);
+}
+
+int buf_read_timeout(int fd, void *data, unsigned n, unsigned usec) {
+    unsigned k = buf_read_drain(fd, data, n);
+    if(k)
+        return k;
+    if(!can_read_timeout(fd, usec))
+        return 0;
+    if(rb_fill(fd) < 0)
+        sys_die(read, read failed);
+    return buf_read_drain(fd, data, n);
+}
+
+int buf_read_exact(int fd, void *data, unsigned n) {
+    assert(n);
+    uint8_t *p = data;
+    for(unsigned left = n; left; ) {
+        int got = buf_read(fd, p, left);
+        if(got < 0)
+            sys_die(read, buf_read_exact failed);
+        if(!got)
+            panic("attempted to read %d bytes, got %d\n", n, n - left);
+        p += got;
+        left -= got;
+    }
+    return n;
+}
+
+void io_stats_reset(void) {
+    io_stats = (io_stats_t){ .start = time_get_usec() };
+}
+
+unsigned io_stats_bps(void) {
+    time_usec_t usec = time_get_usec() - io_stats.start;
+    if(!usec)
+        return 0;
+    return (io_stats.nrx + io_stats.ntx) * 1000 * 1000 / usec;
+}
@@ -58,9 +58,10 @@ int tty_gone(const char *ttyname);
 #define close_nofail(fd) no_fail(close(fd))
 
 
-uint32_t our_crc32(const void *buf, unsigned size);
-// our_crc32_inc(buf,size,0) is the same as our_crc32 
-uint32_t our_crc32_inc(const void *buf, unsigned size, uint32_t crc);
+// our_crc32, our_crc32_inc, crc32_combine and the streaming crc32_ctx_t.
+// we use the same code as the pi (compiled in via our Makefile) so 
+// the two sides can't disagree.
+#include "../libpi/libc/our-crc32.h"
 
 // fill in <fmt,..> using <...> and strcat it to <dst>
 char *strcatf(char *dst, const char *fmt, ...);
@@ -165,6 +166,30 @@ typedef unsigned time_usec_t;
 time_usec_t time_get_usec(void);
 unsigned time_get_sec(void);
 
+// buf-read.c: buffered reads from the pi's tty.  one read() system 
+// call takes everything that's there; later calls use it up first.
+// same results as read, read_timeout, read_exact.
+int buf_read(int fd, void *data, unsigned n);
+int buf_read_timeout(int fd, void *data, unsigned n, unsigned usec);
+int buf_read_exact(int fd, void *data, unsigned n);
+// only what's already buffered: call before using read() directly
+// on a fd you used the above on.  never blocks.
+unsigned buf_read_drain(int fd, void *data, unsigned n);
+// drop what's buffered for <fd> (e.g., after a tcflush).
+void buf_read_flush(int fd);
+
+// bytes in (through buf_read*) and out (through write_exact) and
+// read() calls made, since <start>.
+typedef struct {
+    uint64_t nrx, ntx;
+    unsigned nreads;
+    time_usec_t start;
+} io_stats_t;
+extern io_stats_t io_stats;
+void io_stats_reset(void);
+// bytes/sec, both ways, since io_stats_reset().
+unsigned io_stats_bps(void);
+
 // <fd> is open?  return 1, else 0.
 int is_fd_open(int fd);
 
@@ -179,6 +204,13 @@ void close_open_fds(void);
 
 #include "fast-hash32.h"
 
+// read sections and strings out of pi .elf files.
+#include "pi-elf.h"
+// decode the pi's binary log (libpi/include/binlog.h).
+#include "pi-binlog.h"
+// symbolize and report the pi's profiles (libpi/include/gprof.h).
+#include "pi-gprof.h"
+
 // look for a pi binary in "./" or colon-seperated list in
 // <PI_PATH> 
 const char *find_pi_binary(const char *name);
@@ -0,0 +1,321 @@
+// decode the binary log records the pi sends (see pi-binlog.h and
+// libpi/include/binlog.h).
+#include <string.h>
+#include "libunix.h"
+
+// frame header after the magic: nwords, ndropped, crc.
+enum { HDR_NBYTES = 3*4, MAX_FRAME_WORDS = 1<<24 };
+
+binlog_dec_t 
+binlog_dec_mk_fmts(FILE *out, const char *fmts, unsigned nbytes, uint32_t fmt_addr) {
+    return (binlog_dec_t) { 
+        .out = out, 
+        .fmts = fmts, 
+        .fmt_nbytes = nbytes, 
+        .fmt_addr = fmt_addr 
+    };
+}
+
+binlog_dec_t binlog_dec_mk(FILE *out, const pi_elf_t *elf) {
+    const elf32_shdr_t *sh = pi_elf_section(elf, ".binlog_fmt");
+    if(!sh)
+        panic("<%s>: no .binlog_fmt section: did you call binlog()?\n", elf->name);
+    binlog_dec_t d = binlog_dec_mk_fmts(out, 
+            pi_elf_section_data(elf, sh), sh->sh_size, sh->sh_addr);
+    d.elf = elf;
+    return d;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    uint32_t u;
+    memcpy(&u, p, 4);
+    return u;
+}
+
+// print <s> (<n> bytes) with <prefix> padded out to <width>: the same
+// rules as printk's fmt_field.
+static void 
+emit_field(FILE *out, int left, char pad, unsigned width, 
+        const char *prefix, const char *s, unsigned n) {
+    unsigned len = n + strlen(prefix);
+    unsigned npad = width > len ? width - len : 0;
+
+    if(!left && pad == ' ')
+        fprintf(out, "%*s", npad, "");
+    fputs(prefix, out);
+    if(!left && pad == '0')
+        for(unsigned i = 0; i < npad; i++)
+            fputc('0', out);
+    fwrite(s, 1, n, out);
+    if(left)
+        fprintf(out, "%*s", npad, "");
+}
+
+// print string at pi address <addr> if it's in the binary.
+static void 
+emit_str(binlog_dec_t *d, int left, char pad, unsigned width, uint32_t addr) {
+    unsigned n;
+    const char *s = d->elf ? pi_elf_addr(d->elf, addr, &n) : 0;
+    if(!s) {
+        fprintf(d->out, "<str@0x%x>", addr);
+        return;
+    }
+    emit_field(d->out, left, pad, width, "", s, strnlen(s, n));
+}
+
+// printk's formatting, but the args come from the record.
+static void 
+emit_record(binlog_dec_t *d, const char *fmt, const uint32_t *args, unsigned nargs) {
+    FILE *out = d->out;
+    unsigned a = 0;
+#   define next_arg() (a < nargs ? args[a++] : (missing = 1, 0))
+    int missing = 0;
+
+    for(; *fmt; fmt++) {
+        if(*fmt != '%') {
+            fputc(*fmt, out);
+            continue;
+        }
+        fmt++;
+
+        int left = 0;
+        char pad = ' ';
+        unsigned width = 0;
+        for(;; fmt++) {
+            if(*fmt == '-')
+                left = 1;
+            else if(*fmt == '0')
+                pad = '0';
+            else
+                break;
+        }
+        if(*fmt == '*') {
+            int w = next_arg();
+            if(w < 0) {
+                left = 1;
+                w = -w;
+            }
+            width = w;
+            fmt++;
+        } else {
+            for(; *fmt >= '0' && *fmt <= '9'; fmt++)
+                width = width * 10 + (*fmt - '0');
+        }
+
+        char num[40];
+        uint32_t u;
+        int n;
+        switch(*fmt) {
+        case '%': fputc('%', out); break;
+        case 'd': 
+            u = next_arg();
+            n = sprintf(num, "%u", (int)u < 0 ? -u : u);
+            emit_field(out, left, pad, width, (int)u < 0 ? "-" : "", num, n);
+            break;
+        case 'u':
+            n = sprintf(num, "%u", next_arg());
+            emit_field(out, left, pad, width, "", num, n);
+            break;
+        case 'x':
+        case 'p':
+            n = sprintf(num, "%x", next_arg());
+            emit_field(out, left, pad, width, "0x", num, n);
+            break;
+        case 'X':
+            n = sprintf(num, "%x", next_arg());
+            emit_field(out, left, pad, width, "", num, n);
+            break;
+        case 'b': 
+            u = next_arg();
+            n = 0;
+            do {
+                num[n++] = '0' + (u & 1);
+            } while(u >>= 1);
+            for(int i = 0; i < n/2; i++) {
+                char c = num[i];
+                num[i] = num[n-1-i];
+                num[n-1-i] = c;
+            }
+            emit_field(out, left, pad, width, "", num, n);
+            break;
+        case 'c':
+            num[0] = next_arg();
+            emit_field(out, left, pad, width, "", num, 1);
+            break;
+        case 's':
+            emit_str(d, left, pad, width, next_arg());
+            break;
+        case 0:
+            fmt--;
+            break;
+        default:
+            // includes %llx: the pi only stores 32-bit args.
+            fprintf(out, "<bad format %%%c>", *fmt);
+            break;
+        }
+    }
+#   undef next_arg
+    if(missing)
+        fprintf(out, " <binlog: missing arguments>\n");
+    else if(a != nargs)
+        fprintf(out, " <binlog: %d unused arguments>\n", nargs - a);
+}
+
+// decode all the records in a complete frame.
+static void decode_frame(binlog_dec_t *d) {
+    const uint8_t *p = d->frame;
+    unsigned nwords = get32(p);
+    unsigned ndropped = get32(p+4);
+    uint32_t crc = get32(p+8);
+    const uint8_t *w = p + HDR_NBYTES;
+
+    if(our_crc32(w, nwords*4) != crc) {
+        d->nbad_frames++;
+        fprintf(d->out, "BINLOG: frame with bad crc: dropping %d words\n", nwords);
+        return;
+    }
+    if(ndropped != d->ndropped) {
+        fprintf(d->out, "BINLOG: pi dropped %d records (ring was full)\n", 
+            ndropped - d->ndropped);
+        d->ndropped = ndropped;
+    }
+
+    for(unsigned i = 0; i < nwords; ) {
+        if(nwords - i < 2) {
+            fprintf(d->out, "BINLOG: truncated record\n");
+            return;
+        }
+        uint32_t hdr = get32(w + i*4), cyc = get32(w + (i+1)*4);
+        uint32_t id = hdr >> 4;
+        unsigned nargs = hdr & 0xf;
+        i += 2;
+        if(nwords - i < nargs) {
+            fprintf(d->out, "BINLOG: truncated record\n");
+            return;
+        }
+
+        uint32_t args[16];
+        for(unsigned j = 0; j < nargs; j++, i++)
+            args[j] = get32(w + i*4);
+
+        if(d->have_last_p)
+            d->cycles += cyc - d->last_cyc;
+        d->last_cyc = cyc;
+        d->have_last_p = 1;
+        d->nrecords++;
+
+        uint32_t off = id - d->fmt_addr;
+        if(id < d->fmt_addr || off >= d->fmt_nbytes) {
+            fprintf(d->out, "BINLOG: unknown format id %x\n", id);
+            continue;
+        }
+        fprintf(d->out, "[cyc=%llu] ", (unsigned long long)d->cycles);
+        emit_record(d, d->fmts + off, args, nargs);
+    }
+}
+
+// add a byte to the current frame: decode when we have all of it.
+static void frame_byte(binlog_dec_t *d, uint8_t b) {
+    if(d->frame_nbytes == d->frame_cap) {
+        d->frame_cap = d->frame_cap ? d->frame_cap * 2 : 1024;
+        d->frame = realloc(d->frame, d->frame_cap);
+        if(!d->frame)
+            panic("out of memory\n");
+    }
+    d->frame[d->frame_nbytes++] = b;
+
+    if(d->frame_nbytes < HDR_NBYTES)
+        return;
+    unsigned nwords = get32(d->frame);
+    if(nwords > MAX_FRAME_WORDS) {
+        // was text that happened to match the magic.
+        fprintf(d->out, "BINLOG: bogus frame size %d: ignoring\n", nwords);
+        d->nbad_frames++;
+        d->in_frame_p = 0;
+        return;
+    }
+    if(d->frame_nbytes == HDR_NBYTES + nwords * 4) {
+        decode_frame(d);
+        d->in_frame_p = 0;
+    }
+}
+
+int binlog_dec_feed(binlog_dec_t *d, const uint8_t *buf, unsigned n) {
+    static const uint8_t magic[4] = {
+        BINLOG_MAGIC & 0xff,
+        (BINLOG_MAGIC >> 8) & 0xff,
+        (BINLOG_MAGIC >> 16) & 0xff,
+        (BINLOG_MAGIC >> 24) & 0xff,
+    };
+
+    // the text we pass through: at most <n> bytes plus a partial magic
+    // from the last call.
+    uint8_t *text = malloc(n + sizeof magic + 1);
+    unsigned ntext = 0;
+    int done_p = 0;
+
+    for(unsigned i = 0; i < n; i++) {
+        uint8_t b = buf[i];
+        if(d->in_frame_p) {
+            frame_byte(d, b);
+            continue;
+        }
+        if(b == magic[d->magic_nbytes]) {
+            if(++d->magic_nbytes == sizeof magic) {
+                // flush text before the record so the order is right.
+                text[ntext] = 0;
+                remove_nonprint(text, ntext);
+                fputs((char *)text, d->out);
+                done_p |= pi_done(text);
+                ntext = 0;
+
+                d->magic_nbytes = 0;
+                d->in_frame_p = 1;
+                d->frame_nbytes = 0;
+            }
+            continue;
+        }
+        // wasn't the magic after all: the held back bytes were text.
+        // (the first magic byte doesn't appear again in the magic, so
+        // <b> can only restart a match.)
+        memcpy(&text[ntext], magic, d->magic_nbytes);
+        ntext += d->magic_nbytes;
+        d->magic_nbytes = 0;
+        if(b == magic[0])
+            d->magic_nbytes = 1;
+        else
+            text[ntext++] = b;
+    }
+    text[ntext] = 0;
+    remove_nonprint(text, ntext);
+    fputs((char *)text, d->out);
+    done_p |= pi_done(text);
+    fflush(d->out);
+    free(text);
+    return done_p;
+}
+
+// same loop as pi_cat.
+void pi_binlog_cat(int fd, const char *portname, const char *elf_name) {
+    pi_elf_t elf = pi_elf_read(elf_name);
+    binlog_dec_t d = binlog_dec_mk(stderr, &elf);
+    output("listening on ttyusb=<%s>, binlog formats from <%s>\n", 
+            portname, elf_name);
+
+    while(1) {
+        uint8_t buf[4096];
+        int n = buf_read(fd, buf, sizeof buf);
+
+        if(!n) {
+            if(tty_gone(portname))
+                clean_exit("pi ttyusb connection closed.  cleaning up\n");
+            usleep(1000);
+        } else if(n < 0) {
+            sys_die(read, "pi connection closed.  cleaning up\n");
+        } else if(binlog_dec_feed(&d, buf, n)) {
+            output("\nSaw done\n");
+            clean_exit("\nbootloader: pi exited.  cleaning up\n");
+        }
+    }
+    notreached();
+}
@@ -0,0 +1,59 @@
+#ifndef __PI_BINLOG_H__
+#define __PI_BINLOG_H__
+// unix side of the pi's deferred binary logging (libpi/include/binlog.h):
+// the pi sends raw records (format id, cycle count, 32-bit args) mixed
+// in with its normal text output.  we find the frames, look up each
+// format string in the .elf's ".binlog_fmt" section and print the
+// record as printk would have.  the text passes through untouched.
+#include <stdio.h>
+#include "pi-elf.h"
+
+// must match libpi/include/binlog.h
+#define BINLOG_MAGIC 0xb1b10600
+
+typedef struct {
+    FILE *out;
+
+    // the format strings and the address of the first one (the ids
+    // are addresses).
+    const char *fmts;
+    unsigned fmt_nbytes;
+    uint32_t fmt_addr;
+    // so we can print %s of strings in the binary.  can be 0.
+    const pi_elf_t *elf;
+
+    // parsing state.
+    unsigned magic_nbytes;  // how much of the magic we've matched.
+    int in_frame_p;
+    uint8_t *frame;         // header + records for the current frame.
+    unsigned frame_nbytes, frame_cap;
+
+    // running cycle count: sums the deltas between records so it
+    // doesn't wrap.
+    uint64_t cycles;
+    uint32_t last_cyc;
+    int have_last_p;
+    unsigned ndropped;      // last drop count the pi reported.
+
+    unsigned nrecords, nbad_frames;
+} binlog_dec_t;
+
+// decode using the format strings in the pi binary <elf>.
+binlog_dec_t binlog_dec_mk(FILE *out, const pi_elf_t *elf);
+
+// decode using the <nbytes> of format strings at <fmts>, where the 
+// first is at pi address <fmt_addr>.  (used for testing)
+binlog_dec_t 
+binlog_dec_mk_fmts(FILE *out, const char *fmts, unsigned nbytes, uint32_t fmt_addr);
+
+// feed <n> bytes read from the pi to the decoder: text is written
+// to <d->out> (with unprintable characters removed) and records are
+// printed as they are decoded.  returns 1 if the text contained the
+// "DONE!!!" shutdown string.
+int binlog_dec_feed(binlog_dec_t *d, const uint8_t *buf, unsigned n);
+
+// same as <pi_cat> but decodes binlog records using the format 
+// strings in <elf_name>.
+void pi_binlog_cat(int pi_fd, const char *portname, const char *elf_name);
+
+#endif
@@ -15,8 +15,10 @@ int pi_done(unsigned char *s) {
             return pi_done(s+1); // check remainder
         }
         // maybe should check if "DONE!!!" is last thing printed?
-        if(pos == sizeof exit_string - 1)
+        if(pos == sizeof exit_string - 1) {
+            pos = 0;
             return 1;
+        }
     }
     return 0;
 }
@@ -41,7 +43,8 @@ void pi_cat(int fd, const char *portname) {
 
     while(1) {
         unsigned char buf[4096];
-        int n = read(fd, buf, sizeof buf - 1);
+        // buf_read: takes what the bootloader read ahead first.
+        int n = buf_read(fd, buf, sizeof buf - 1);
 
         if(!n) {
             // this isn't the program's fault.  so we exit(0).
@@ -0,0 +1,110 @@
+#include <string.h>
+#include "libunix.h"
+
+pi_elf_t pi_elf_read(const char *name) {
+    pi_elf_t e = { .name = name };
+    e.data = read_file(&e.nbytes, name);
+
+    const elf32_ehdr_t *h = (const void *)e.data;
+    if(e.nbytes < sizeof *h || memcmp(h->e_ident, "\177ELF", 4) != 0)
+        panic("<%s> is not an ELF file\n", name);
+    // class=1 (32-bit), data=1 (little endian).
+    if(h->e_ident[4] != 1 || h->e_ident[5] != 1)
+        panic("<%s> is not a 32-bit little-endian ELF file\n", name);
+    if(h->e_shentsize != sizeof(elf32_shdr_t))
+        panic("<%s>: bad section header size %d\n", name, h->e_shentsize);
+    if(h->e_shoff + h->e_shnum * sizeof(elf32_shdr_t) > e.nbytes)
+        panic("<%s>: section headers past end of file\n", name);
+
+    e.sh = (const void *)(e.data + h->e_shoff);
+    e.nsh = h->e_shnum;
+    if(h->e_shstrndx >= e.nsh)
+        panic("<%s>: bad section string index\n", name);
+    e.shstr = pi_elf_section_data(&e, &e.sh[h->e_shstrndx]);
+    return e;
+}
+
+const void *pi_elf_section_data(const pi_elf_t *e, const elf32_shdr_t *sh) {
+    if(sh->sh_type == ELF32_SHT_NOBITS)
+        return 0;
+    if(sh->sh_offset + sh->sh_size > e->nbytes)
+        panic("<%s>: section past end of file\n", e->name);
+    return e->data + sh->sh_offset;
+}
+
+const elf32_shdr_t *pi_elf_section(const pi_elf_t *e, const char *name) {
+    for(unsigned i = 0; i < e->nsh; i++)
+        if(strcmp(&e->shstr[e->sh[i].sh_name], name) == 0)
+            return &e->sh[i];
+    return 0;
+}
+
+const void *pi_elf_addr(const pi_elf_t *e, uint32_t addr, unsigned *nbytes) {
+    for(unsigned i = 0; i < e->nsh; i++) {
+        const elf32_shdr_t *sh = &e->sh[i];
+        if(!(sh->sh_flags & ELF32_SHF_ALLOC) || sh->sh_type == ELF32_SHT_NOBITS)
+            continue;
+        if(addr < sh->sh_addr || addr - sh->sh_addr >= sh->sh_size)
+            continue;
+        unsigned off = addr - sh->sh_addr;
+        *nbytes = sh->sh_size - off;
+        return (const uint8_t *)pi_elf_section_data(e, sh) + off;
+    }
+    return 0;
+}
+
+static int func_cmp(const void *a, const void *b) {
+    const pi_elf_func_t *x = a, *y = b;
+    return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+pi_elf_func_t *pi_elf_funcs(const pi_elf_t *e, unsigned *n) {
+    const elf32_shdr_t *sh = 0;
+    for(unsigned i = 0; i < e->nsh && !sh; i++)
+        if(e->sh[i].sh_type == ELF32_SHT_SYMTAB)
+            sh = &e->sh[i];
+    if(!sh)
+        panic("<%s>: no symbol table\n", e->name);
+    if(sh->sh_link >= e->nsh)
+        panic("<%s>: bad symbol string table index\n", e->name);
+    const elf32_sym_t *syms = pi_elf_section_data(e, sh);
+    const char *str = pi_elf_section_data(e, &e->sh[sh->sh_link]);
+    unsigned nsyms = sh->sh_size / sizeof *syms;
+    unsigned str_nbytes = e->sh[sh->sh_link].sh_size;
+
+    pi_elf_func_t *fns = calloc(nsyms + 1, sizeof *fns);
+    unsigned k = 0;
+    for(unsigned i = 0; i < nsyms; i++) {
+        const elf32_sym_t *s = &syms[i];
+        if((s->st_info & 0xf) != ELF32_STT_FUNC || s->st_name >= str_nbytes)
+            continue;
+        fns[k++] = (pi_elf_func_t) {
+            // low bit is set for thumb code.
+            .addr = s->st_value & ~1,
+            .nbytes = s->st_size,
+            .name = &str[s->st_name],
+        };
+    }
+    qsort(fns, k, sizeof *fns, func_cmp);
+    *n = k;
+    return fns;
+}
+
+const pi_elf_func_t *
+pi_elf_func_lookup(const pi_elf_func_t *fns, unsigned n, uint32_t addr) {
+    // last function that starts at or before <addr>.
+    unsigned lo = 0, hi = n;
+    while(lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        if(fns[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if(!lo)
+        return 0;
+    const pi_elf_func_t *f = &fns[lo - 1];
+    if(f->nbytes && addr - f->addr >= f->nbytes)
+        return 0;
+    return f;
+}
@@ -0,0 +1,97 @@
+#ifndef __PI_ELF_H__
+#define __PI_ELF_H__
+// minimal reader for the 32-bit little-endian ELF files the pi 
+// toolchain produces (e.g., hello.elf next to hello.bin).  we use
+// it to pull strings and sections out of the pi binary on the unix
+// side.  we define the structs ourselves rather than use <elf.h>
+// since macos doesn't have it.
+#include <stdint.h>
+
+typedef struct {
+    uint8_t     e_ident[16];
+    uint16_t    e_type;
+    uint16_t    e_machine;
+    uint32_t    e_version;
+    uint32_t    e_entry;
+    uint32_t    e_phoff;
+    uint32_t    e_shoff;
+    uint32_t    e_flags;
+    uint16_t    e_ehsize;
+    uint16_t    e_phentsize;
+    uint16_t    e_phnum;
+    uint16_t    e_shentsize;
+    uint16_t    e_shnum;
+    uint16_t    e_shstrndx;
+} elf32_ehdr_t;
+
+typedef struct {
+    uint32_t    sh_name;
+    uint32_t    sh_type;
+    uint32_t    sh_flags;
+    uint32_t    sh_addr;
+    uint32_t    sh_offset;
+    uint32_t    sh_size;
+    uint32_t    sh_link;
+    uint32_t    sh_info;
+    uint32_t    sh_addralign;
+    uint32_t    sh_entsize;
+} elf32_shdr_t;
+
+typedef struct {
+    uint32_t    st_name;
+    uint32_t    st_value;
+    uint32_t    st_size;
+    uint8_t     st_info;
+    uint8_t     st_other;
+    uint16_t    st_shndx;
+} elf32_sym_t;
+
+enum { 
+    ELF32_SHT_SYMTAB = 2, 
+    ELF32_SHT_NOBITS = 8, 
+    ELF32_SHF_ALLOC = 2,
+    ELF32_STT_FUNC = 2,
+};
+
+// an ELF file read into memory.
+typedef struct {
+    const char *name;
+    const uint8_t *data;
+    unsigned nbytes;
+    const elf32_shdr_t *sh;     // section headers.
+    unsigned nsh;
+    const char *shstr;          // section name strings.
+} pi_elf_t;
+
+// read and sanity check elf file <name>: panics if it's not a 32-bit
+// little endian ELF.
+pi_elf_t pi_elf_read(const char *name);
+
+// section <name> or 0 if there isn't one.
+const elf32_shdr_t *pi_elf_section(const pi_elf_t *e, const char *name);
+
+// pointer to the contents of section <sh>.
+const void *pi_elf_section_data(const pi_elf_t *e, const elf32_shdr_t *sh);
+
+// the bytes the pi would have at address <addr> (from an allocated
+// section with contents in the file): sets <nbytes> to the number
+// of bytes left in that section.  returns 0 if <addr> isn't in one.
+const void *pi_elf_addr(const pi_elf_t *e, uint32_t addr, unsigned *nbytes);
+
+// a function from the symbol table.
+typedef struct {
+    uint32_t addr, nbytes;
+    const char *name;
+} pi_elf_func_t;
+
+// all the functions in <e>'s symbol table sorted by address: sets
+// <n> to how many.  panics if there is no symbol table (stripped?).
+// free the result when done.
+pi_elf_func_t *pi_elf_funcs(const pi_elf_t *e, unsigned *n);
+
+// the function in <fns> (sorted, <n> of them) that contains <addr>, or
+// 0.  a function with no size is taken to run up to the next one.
+const pi_elf_func_t *
+pi_elf_func_lookup(const pi_elf_func_t *fns, unsigned n, uint32_t addr);
+
+#endif
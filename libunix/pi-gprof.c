@@ -0,0 +1,632 @@
+// decode and report the profiles the pi sends (see pi-gprof.h and
+// libpi/include/gprof.h).
+#include <string.h>
+#include "libunix.h"
+
+// frame header after the magic: nwords, crc.
+enum { HDR_NBYTES = 2*4, MAX_FRAME_WORDS = 1<<24 };
+
+// header words: GPROF_SAMPLES, nsamples, npcs, nstacks, nlost_pcs,
+// nlost_stacks or GPROF_PMU, nticks, npairs, npcs, nlost.
+enum { NHDR = 6, NHDR_PMU = 5 };
+
+static uint32_t get32(const uint8_t *p) {
+    uint32_t u;
+    memcpy(&u, p, 4);
+    return u;
+}
+
+static int parse_pmu(pi_gprof_t *g, const uint32_t *w, unsigned nwords) {
+    if(nwords < NHDR_PMU)
+        return 0;
+    g->nsamples = w[1];
+    g->npairs = w[2];
+    g->npcs = w[3];
+    g->nlost_pcs = w[4];
+    unsigned i = NHDR_PMU;
+    if(g->npairs > 64 || nwords - i < 2 * g->npairs)
+        return 0;
+    g->events = &w[i];
+    i += 2 * g->npairs;
+
+    unsigned rec = 2 + 3 * g->npairs;
+    if((nwords - i) % rec || (nwords - i) / rec != g->npcs)
+        return 0;
+    g->pmu_pcs = &w[i];
+    return 1;
+}
+
+int pi_gprof_parse(pi_gprof_t *g, const uint32_t *w, unsigned nwords) {
+    memset(g, 0, sizeof *g);
+    if(!nwords)
+        return 0;
+    g->words = malloc(nwords * 4);
+    memcpy(g->words, w, nwords * 4);
+    w = g->words;
+    g->kind = w[0];
+
+    if(g->kind == PI_GPROF_PMU) {
+        if(parse_pmu(g, w, nwords))
+            return 1;
+        goto bad;
+    }
+    if(g->kind != PI_GPROF_SAMPLES || nwords < NHDR)
+        goto bad;
+    g->nsamples = w[1];
+    g->npcs = w[2];
+    g->nstacks = w[3];
+    g->nlost_pcs = w[4];
+    g->nlost_stacks = w[5];
+    if(g->npcs > nwords / 2 || g->nstacks > nwords / 2)
+        goto bad;
+    unsigned i = NHDR;
+
+    if(nwords - i < g->npcs * 2)
+        goto bad;
+    g->pcs = (void *)&w[i];
+    i += g->npcs * 2;
+
+    g->stacks = calloc(g->nstacks + 1, sizeof *g->stacks);
+    for(unsigned k = 0; k < g->nstacks; k++) {
+        pi_gprof_stack_t *s = &g->stacks[k];
+        if(nwords - i < 2)
+            goto bad;
+        s->n = w[i++];
+        s->depth = w[i++];
+        if(!s->depth || nwords - i < s->depth)
+            goto bad;
+        s->pcs = &w[i];
+        i += s->depth;
+    }
+    if(i == nwords)
+        return 1;
+bad:
+    pi_gprof_free(g);
+    return 0;
+}
+
+void pi_gprof_free(pi_gprof_t *g) {
+    free(g->words);
+    free(g->stacks);
+    memset(g, 0, sizeof *g);
+}
+
+/**************************************************************
+ * reports.
+ */
+
+// a function we saw (or a bare pc we couldn't find a symbol for).
+typedef struct {
+    uint32_t addr;
+    const char *sym;        // 0 if we didn't find one.
+    char pc_name[16];
+    unsigned self, total;
+    unsigned index;         // in the call graph.
+} fn_t;
+
+// caller -> callee, in samples.
+typedef struct {
+    unsigned from, to, n;
+} edge_t;
+
+typedef struct {
+    fn_t *fns;
+    unsigned nfns;
+    edge_t *edges;
+    unsigned nedges;
+    unsigned nsamples;
+} prof_t;
+
+// the fn_t for <pc>: <ret_p> if <pc> is a return address, which can be
+// just past the end of the function that made the call.
+static unsigned fn_get(prof_t *p, const pi_elf_func_t *syms, unsigned nsyms,
+                        uint32_t pc, int ret_p) {
+    const pi_elf_func_t *s = pi_elf_func_lookup(syms, nsyms, pc - ret_p);
+    uint32_t addr = s ? s->addr : pc;
+
+    for(unsigned i = 0; i < p->nfns; i++)
+        if(p->fns[i].addr == addr && !p->fns[i].sym == !s)
+            return i;
+
+    p->fns = realloc(p->fns, (p->nfns + 1) * sizeof *p->fns);
+    fn_t *f = &p->fns[p->nfns];
+    *f = (fn_t) { .addr = addr };
+    if(s)
+        f->sym = s->name;
+    else
+        snprintf(f->pc_name, sizeof f->pc_name, "0x%x", pc);
+    return p->nfns++;
+}
+
+static const char *name(const fn_t *f) {
+    return f->sym ? f->sym : f->pc_name;
+}
+
+static void edge_add(prof_t *p, unsigned from, unsigned to, unsigned n) {
+    for(unsigned i = 0; i < p->nedges; i++)
+        if(p->edges[i].from == from && p->edges[i].to == to) {
+            p->edges[i].n += n;
+            return;
+        }
+    p->edges = realloc(p->edges, (p->nedges + 1) * sizeof *p->edges);
+    p->edges[p->nedges++] = (edge_t) { from, to, n };
+}
+
+// the functions in stack <s>, innermost first.
+static unsigned
+stack_fns(prof_t *p, const pi_elf_func_t *syms, unsigned nsyms,
+            const pi_gprof_stack_t *s, unsigned *fns) {
+    for(unsigned i = 0; i < s->depth; i++)
+        fns[i] = fn_get(p, syms, nsyms, s->pcs[i], i > 0);
+    return s->depth;
+}
+
+static prof_t prof_mk(const pi_gprof_t *g, const pi_elf_func_t *syms, unsigned nsyms) {
+    prof_t p = { .nsamples = g->nsamples };
+
+    for(unsigned i = 0; i < g->npcs; i++) {
+        unsigned f = fn_get(&p, syms, nsyms, g->pcs[i].pc, 0);
+        p.fns[f].self += g->pcs[i].n;
+    }
+
+    for(unsigned k = 0; k < g->nstacks; k++) {
+        const pi_gprof_stack_t *s = &g->stacks[k];
+        unsigned fns[s->depth];
+        unsigned n = stack_fns(&p, syms, nsyms, s, fns);
+
+        // count each function and each edge once per stack so
+        // recursion doesn't push totals past 100%.
+        for(unsigned i = 0; i < n; i++) {
+            unsigned j;
+            for(j = 0; j < i && fns[j] != fns[i]; j++)
+                ;
+            if(j == i)
+                p.fns[fns[i]].total += s->n;
+            if(i + 1 == n)
+                continue;
+            for(j = 0; j < i; j++)
+                if(fns[j] == fns[i] && fns[j+1] == fns[i+1])
+                    break;
+            if(j == i)
+                edge_add(&p, fns[i+1], fns[i], s->n);
+        }
+    }
+    return p;
+}
+
+static void prof_free(prof_t *p) {
+    free(p->fns);
+    free(p->edges);
+}
+
+static double pct(unsigned n, unsigned tot) {
+    return tot ? 100.0 * n / tot : 0;
+}
+
+// sort by <key> (biggest first) then name so output doesn't depend on
+// table order.
+static const fn_t *sort_fns;
+static int by_self(const void *a, const void *b) {
+    const fn_t *x = &sort_fns[*(unsigned *)a], *y = &sort_fns[*(unsigned *)b];
+    if(x->self != y->self)
+        return x->self < y->self ? 1 : -1;
+    return strcmp(name(x), name(y));
+}
+static int by_total(const void *a, const void *b) {
+    const fn_t *x = &sort_fns[*(unsigned *)a], *y = &sort_fns[*(unsigned *)b];
+    if(x->total != y->total)
+        return x->total < y->total ? 1 : -1;
+    return strcmp(name(x), name(y));
+}
+static int by_count(const void *a, const void *b) {
+    const edge_t *x = a, *y = b;
+    if(x->n != y->n)
+        return x->n < y->n ? 1 : -1;
+    unsigned xi = sort_fns[x->from].index, yi = sort_fns[y->from].index;
+    if(xi == yi)
+        xi = sort_fns[x->to].index, yi = sort_fns[y->to].index;
+    return xi < yi ? -1 : xi > yi;
+}
+
+void pi_gprof_report(FILE *out, const pi_gprof_t *g,
+                     const pi_elf_func_t *syms, unsigned nsyms) {
+    prof_t p = prof_mk(g, syms, nsyms);
+    unsigned order[p.nfns + 1];
+    for(unsigned i = 0; i < p.nfns; i++)
+        order[i] = i;
+    sort_fns = p.fns;
+
+    fprintf(out, "Flat profile: %d samples, %d functions\n",
+        p.nsamples, p.nfns);
+    if(g->nlost_pcs || g->nlost_stacks)
+        fprintf(out, "  (tables were full: lost %d pcs, %d stacks)\n",
+            g->nlost_pcs, g->nlost_stacks);
+    fprintf(out, "\n  %%   cumulative    self     total\n");
+    fprintf(out, " time   samples   samples   samples  name\n");
+    qsort(order, p.nfns, sizeof order[0], by_self);
+    unsigned cum = 0;
+    for(unsigned i = 0; i < p.nfns; i++) {
+        fn_t *f = &p.fns[order[i]];
+        if(!f->self)
+            break;
+        cum += f->self;
+        fprintf(out, "%6.2f %9d %9d %9d  %s\n",
+            pct(f->self, p.nsamples), cum, f->self, f->total, name(f));
+    }
+
+    // index functions by total, as gprof does.
+    qsort(order, p.nfns, sizeof order[0], by_total);
+    for(unsigned i = 0; i < p.nfns; i++)
+        p.fns[order[i]].index = i + 1;
+    qsort(p.edges, p.nedges, sizeof *p.edges, by_count);
+
+    fprintf(out, "\nCall graph: callers above each function, callees below\n\n");
+    fprintf(out, "index  %% total    self    total  name\n");
+    for(unsigned i = 0; i < p.nfns; i++) {
+        unsigned fi = order[i];
+        fn_t *f = &p.fns[fi];
+        for(unsigned e = 0; e < p.nedges; e++)
+            if(p.edges[e].to == fi) {
+                fn_t *c = &p.fns[p.edges[e].from];
+                fprintf(out, "%25d           %s [%d]\n",
+                    p.edges[e].n, name(c), c->index);
+            }
+        char idx[16];
+        snprintf(idx, sizeof idx, "[%d]", f->index);
+        fprintf(out, "%-6s %6.1f %8d %8d  %s %s\n", idx,
+            pct(f->total, p.nsamples), f->self, f->total, name(f), idx);
+        for(unsigned e = 0; e < p.nedges; e++)
+            if(p.edges[e].from == fi) {
+                fn_t *c = &p.fns[p.edges[e].to];
+                fprintf(out, "%25d           %s [%d]\n",
+                    p.edges[e].n, name(c), c->index);
+            }
+        fprintf(out, "-----------------------------------------------\n");
+    }
+    prof_free(&p);
+}
+
+typedef struct {
+    char *s;
+    unsigned n;
+} folded_t;
+
+static int folded_cmp(const void *a, const void *b) {
+    return strcmp(((const folded_t *)a)->s, ((const folded_t *)b)->s);
+}
+
+void pi_gprof_folded(FILE *out, const pi_gprof_t *g,
+                     const pi_elf_func_t *syms, unsigned nsyms) {
+    prof_t p = {};
+    folded_t *lines = calloc(g->nstacks + 1, sizeof *lines);
+    for(unsigned k = 0; k < g->nstacks; k++) {
+        const pi_gprof_stack_t *s = &g->stacks[k];
+        unsigned fns[s->depth];
+        unsigned n = stack_fns(&p, syms, nsyms, s, fns);
+
+        size_t nbytes = 0;
+        FILE *f = open_memstream(&lines[k].s, &nbytes);
+        for(unsigned i = n; i-- > 0; )
+            fprintf(f, "%s%s", name(&p.fns[fns[i]]), i ? ";" : "");
+        fclose(f);
+        lines[k].n = s->n;
+    }
+
+    // different pcs in the same functions give the same line: sort
+    // and merge them.
+    qsort(lines, g->nstacks, sizeof *lines, folded_cmp);
+    for(unsigned k = 0; k < g->nstacks; k++) {
+        unsigned n = lines[k].n;
+        while(k + 1 < g->nstacks && strcmp(lines[k].s, lines[k+1].s) == 0) {
+            free(lines[k].s);
+            n += lines[++k].n;
+        }
+        fprintf(out, "%s %d\n", lines[k].s, n);
+        free(lines[k].s);
+    }
+    free(lines);
+    prof_free(&p);
+}
+
+// short names for the armv6-pmu.h events we know.
+static const char *event_name(uint32_t ev) {
+    switch(ev) {
+    case 0x0: return "icache";
+    case 0x1: return "istall%";
+    case 0x2: return "dstall%";
+    case 0x3: return "iutlb";
+    case 0x4: return "dutlb";
+    case 0x5: return "branch";
+    case 0x6: return "brmiss";
+    case 0x7: return "inst";
+    case 0xa: return "dcacc";
+    case 0xb: return "dcache";
+    case 0xc: return "dc-wb";
+    case 0xf: return "tlb";
+    default:  return 0;
+    }
+}
+// stall events count cycles, so we give them as % of cycles.
+static int stall_p(uint32_t ev) { return ev == 0x1 || ev == 0x2; }
+enum { PMU_INST = 0x7 };
+
+// one function's counts, summed over its pcs.
+typedef struct {
+    unsigned nticks;
+    uint64_t (*n)[3];           // npairs x { cycles, count0, count1 }
+} pmu_fn_t;
+
+// print <ev>'s rate given its pair's cycles and the instruction pair's.
+static void pmu_rate(FILE *out, uint32_t ev, uint64_t cnt, uint64_t cyc,
+                     uint64_t inst, uint64_t inst_cyc) {
+    if(stall_p(ev)) {
+        if(cyc)
+            fprintf(out, " %8.1f", 100.0 * cnt / cyc);
+        else
+            fprintf(out, " %8s", "-");
+    // scale to the instruction pair's cycles, then per 1000 instructions.
+    } else if(cyc && inst)
+        fprintf(out, " %8.2f", 1000.0 * cnt * inst_cyc / cyc / inst);
+    else
+        fprintf(out, " %8s", "-");
+}
+
+static void pmu_row(FILE *out, const pi_gprof_t *g, const pmu_fn_t *f,
+                    unsigned nticks, int ipair, int islot, const char *name) {
+    fprintf(out, "%6.2f", pct(f->nticks, nticks));
+
+    uint64_t inst = ipair < 0 ? 0 : f->n[ipair][1 + islot];
+    uint64_t inst_cyc = ipair < 0 ? 0 : f->n[ipair][0];
+    if(inst)
+        fprintf(out, " %6.2f", (double)inst_cyc / inst);
+    else
+        fprintf(out, " %6s", "-");
+
+    for(unsigned p = 0; p < g->npairs; p++)
+        for(unsigned k = 0; k < 2; k++) {
+            uint32_t ev = g->events[2*p + k];
+            if(ev != PMU_INST)
+                pmu_rate(out, ev, f->n[p][1 + k], f->n[p][0], inst, inst_cyc);
+        }
+    fprintf(out, "  %s\n", name);
+}
+
+static const pmu_fn_t *pmu_sort;
+static int by_ticks(const void *a, const void *b) {
+    unsigned x = *(unsigned *)a, y = *(unsigned *)b;
+    if(pmu_sort[x].nticks != pmu_sort[y].nticks)
+        return pmu_sort[x].nticks < pmu_sort[y].nticks ? 1 : -1;
+    return strcmp(name(&sort_fns[x]), name(&sort_fns[y]));
+}
+
+void pi_gprof_pmu_report(FILE *out, const pi_gprof_t *g,
+                         const pi_elf_func_t *syms, unsigned nsyms) {
+    prof_t p = {};
+    unsigned np = g->npairs, rec = 2 + 3 * np;
+
+    // sum the pcs into functions (and everything into <tot>).
+    pmu_fn_t *fns = 0, tot = { .n = calloc(np, sizeof *tot.n) };
+    for(unsigned i = 0; i < g->npcs; i++) {
+        const uint32_t *r = &g->pmu_pcs[i * rec];
+        unsigned nfns = p.nfns;
+        unsigned fi = fn_get(&p, syms, nsyms, r[0], 0);
+        if(p.nfns != nfns) {
+            fns = realloc(fns, p.nfns * sizeof *fns);
+            fns[fi] = (pmu_fn_t) { .n = calloc(np, sizeof *tot.n) };
+        }
+        pmu_fn_t *f = &fns[fi];
+        f->nticks += r[1];
+        tot.nticks += r[1];
+        for(unsigned k = 0; k < np; k++)
+            for(unsigned j = 0; j < 3; j++) {
+                f->n[k][j] += r[2 + 3*k + j];
+                tot.n[k][j] += r[2 + 3*k + j];
+            }
+    }
+
+    // where's the instruction count?
+    int ipair = -1, islot = 0;
+    for(unsigned k = 0; k < 2 * np; k++)
+        if(g->events[k] == PMU_INST) {
+            ipair = k / 2;
+            islot = k % 2;
+            break;
+        }
+
+    fprintf(out, "PMU profile: %d ticks, %d functions, %d event pairs\n",
+        g->nsamples, p.nfns, np);
+    if(g->nlost_pcs)
+        fprintf(out, "  (table was full: lost %d ticks)\n", g->nlost_pcs);
+    fprintf(out, "  (misses per 1000 instructions, stalls as %% of cycles)\n\n");
+    fprintf(out, " %%time    CPI");
+    for(unsigned k = 0; k < 2 * np; k++) {
+        uint32_t ev = g->events[k];
+        if(ev == PMU_INST)
+            continue;
+        const char *s = event_name(ev);
+        if(s)
+            fprintf(out, " %8s", s);
+        else
+            fprintf(out, "   ev0x%02x", ev);
+    }
+    fprintf(out, "  name\n");
+
+    unsigned order[p.nfns + 1];
+    for(unsigned i = 0; i < p.nfns; i++)
+        order[i] = i;
+    sort_fns = p.fns;
+    pmu_sort = fns;
+    qsort(order, p.nfns, sizeof order[0], by_ticks);
+    for(unsigned i = 0; i < p.nfns; i++)
+        pmu_row(out, g, &fns[order[i]], tot.nticks, ipair, islot,
+            name(&p.fns[order[i]]));
+    pmu_row(out, g, &tot, tot.nticks, ipair, islot, "<total>");
+
+    for(unsigned i = 0; i < p.nfns; i++)
+        free(fns[i].n);
+    free(fns);
+    free(tot.n);
+    prof_free(&p);
+}
+
+/**************************************************************
+ * pulling frames out of the pi's output.
+ */
+
+pi_gprof_dec_t pi_gprof_dec_mk(FILE *out) {
+    return (pi_gprof_dec_t) { .out = out };
+}
+
+static void decode_frame(pi_gprof_dec_t *d) {
+    unsigned nwords = get32(d->frame);
+    uint32_t crc = get32(d->frame + 4);
+    const uint8_t *w = d->frame + HDR_NBYTES;
+
+    if(our_crc32(w, nwords*4) != crc) {
+        d->nbad_frames++;
+        fprintf(d->out, "GPROF: frame with bad crc: dropping %d words\n", nwords);
+        return;
+    }
+    // <frame> is malloc'd, so the words are aligned.
+    pi_gprof_t g;
+    if(!pi_gprof_parse(&g, (const uint32_t *)w, nwords)) {
+        d->nbad_frames++;
+        fprintf(d->out, "GPROF: malformed frame: dropping %d words\n", nwords);
+    } else {
+        pi_gprof_t *last = g.kind == PI_GPROF_PMU ? &d->last_pmu : &d->last;
+        pi_gprof_free(last);
+        *last = g;
+        d->nframes++;
+    }
+}
+
+// add a byte to the current frame: decode when we have all of it.
+static void frame_byte(pi_gprof_dec_t *d, uint8_t b) {
+    if(d->frame_nbytes == d->frame_cap) {
+        d->frame_cap = d->frame_cap ? d->frame_cap * 2 : 1024;
+        d->frame = realloc(d->frame, d->frame_cap);
+        if(!d->frame)
+            panic("out of memory\n");
+    }
+    d->frame[d->frame_nbytes++] = b;
+
+    if(d->frame_nbytes < HDR_NBYTES)
+        return;
+    unsigned nwords = get32(d->frame);
+    if(nwords > MAX_FRAME_WORDS) {
+        // was text that happened to match the magic.
+        fprintf(d->out, "GPROF: bogus frame size %d: ignoring\n", nwords);
+        d->nbad_frames++;
+        d->in_frame_p = 0;
+        return;
+    }
+    if(d->frame_nbytes == HDR_NBYTES + nwords * 4) {
+        decode_frame(d);
+        d->in_frame_p = 0;
+    }
+}
+
+// same scan as binlog_dec_feed.
+int pi_gprof_dec_feed(pi_gprof_dec_t *d, const uint8_t *buf, unsigned n) {
+    static const uint8_t magic[4] = {
+        GPROF_MAGIC & 0xff,
+        (GPROF_MAGIC >> 8) & 0xff,
+        (GPROF_MAGIC >> 16) & 0xff,
+        (GPROF_MAGIC >> 24) & 0xff,
+    };
+
+    uint8_t *text = malloc(n + sizeof magic + 1);
+    unsigned ntext = 0;
+    int done_p = 0;
+
+    for(unsigned i = 0; i < n; i++) {
+        uint8_t b = buf[i];
+        if(d->in_frame_p) {
+            frame_byte(d, b);
+            continue;
+        }
+        if(b == magic[d->magic_nbytes]) {
+            if(++d->magic_nbytes == sizeof magic) {
+                text[ntext] = 0;
+                remove_nonprint(text, ntext);
+                fputs((char *)text, d->out);
+                done_p |= pi_done(text);
+                ntext = 0;
+
+                d->magic_nbytes = 0;
+                d->in_frame_p = 1;
+                d->frame_nbytes = 0;
+            }
+            continue;
+        }
+        // the first magic byte doesn't appear again in the magic, so
+        // <b> can only restart a match.
+        memcpy(&text[ntext], magic, d->magic_nbytes);
+        ntext += d->magic_nbytes;
+        d->magic_nbytes = 0;
+        if(b == magic[0])
+            d->magic_nbytes = 1;
+        else
+            text[ntext++] = b;
+    }
+    text[ntext] = 0;
+    remove_nonprint(text, ntext);
+    fputs((char *)text, d->out);
+    done_p |= pi_done(text);
+    fflush(d->out);
+    free(text);
+    return done_p;
+}
+
+static void report(pi_gprof_dec_t *d, const char *elf_name, const char *folded_name) {
+    if(!d->nframes) {
+        output("GPROF: the pi never called gprof_dump\n");
+        return;
+    }
+    pi_elf_t elf = pi_elf_read(elf_name);
+    unsigned nsyms;
+    pi_elf_func_t *syms = pi_elf_funcs(&elf, &nsyms);
+
+    if(d->last_pmu.kind)
+        pi_gprof_pmu_report(stderr, &d->last_pmu, syms, nsyms);
+    if(d->last.kind) {
+        pi_gprof_report(stderr, &d->last, syms, nsyms);
+
+        FILE *f = fopen(folded_name, "w");
+        if(!f)
+            sys_die(fopen, "can't open <%s>\n", folded_name);
+        pi_gprof_folded(f, &d->last, syms, nsyms);
+        fclose(f);
+        output("GPROF: wrote folded stacks to <%s>\n", folded_name);
+    }
+    free(syms);
+}
+
+// same loop as pi_binlog_cat.
+void pi_gprof_cat(int fd, const char *portname,
+                  const char *elf_name, const char *folded_name) {
+    pi_gprof_dec_t d = pi_gprof_dec_mk(stderr);
+    output("listening on ttyusb=<%s>, gprof symbols from <%s>\n",
+            portname, elf_name);
+
+    while(1) {
+        uint8_t buf[4096];
+        int n = buf_read(fd, buf, sizeof buf);
+
+        if(!n) {
+            if(tty_gone(portname)) {
+                report(&d, elf_name, folded_name);
+                clean_exit("pi ttyusb connection closed.  cleaning up\n");
+            }
+            usleep(1000);
+        } else if(n < 0) {
+            report(&d, elf_name, folded_name);
+            sys_die(read, "pi connection closed.  cleaning up\n");
+        } else if(pi_gprof_dec_feed(&d, buf, n)) {
+            output("\nSaw done\n");
+            report(&d, elf_name, folded_name);
+            clean_exit("\nbootloader: pi exited.  cleaning up\n");
+        }
+    }
+    notreached();
+}
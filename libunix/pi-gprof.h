@@ -0,0 +1,97 @@
+#ifndef __PI_GPROF_H__
+#define __PI_GPROF_H__
+// unix side of the pi's statistical profiler (libpi/include/gprof.h):
+// the pi sends raw pc and call stack counts mixed in with its text
+// output.  we pull the frames out, bucket the pcs by function using the
+// .elf's symbol table and print
+//   - a flat profile: samples in each function (self) and in it or
+//     anything it calls (total), like gprof's.
+//   - a call graph: for each function, who called it and who it
+//     called, by samples, like gprof's.
+//   - folded stacks ("outer;...;inner count" per line): the input for
+//     flamegraph.pl, speedscope or pprof's collapsed importers.
+//   - for PMU dumps: each function's CPI, cache/TLB misses and branch
+//     mispredicts per 1000 instructions and % of cycles stalled.
+#include <stdio.h>
+#include "pi-elf.h"
+
+// must match libpi/include/gprof.h
+#define GPROF_MAGIC 0x67706601
+enum { PI_GPROF_SAMPLES = 1, PI_GPROF_PMU = 2 };
+
+typedef struct {
+    uint32_t pc, n;
+} pi_gprof_pc_t;
+
+typedef struct {
+    uint32_t n, depth;
+    const uint32_t *pcs;        // pcs[0] is the sampled pc.
+} pi_gprof_stack_t;
+
+// one dump: pc samples and call stacks (PI_GPROF_SAMPLES) or hardware
+// event counts (PI_GPROF_PMU).
+typedef struct {
+    unsigned kind;
+    unsigned nsamples, nlost_pcs, nlost_stacks;
+    pi_gprof_pc_t *pcs;
+    unsigned npcs;
+    pi_gprof_stack_t *stacks;
+    unsigned nstacks;
+
+    // PI_GPROF_PMU: <npcs> records of
+    //      pc, nticks, npairs x { cycles, count0, count1 }
+    // where events[2*p], events[2*p+1] are the pair's armv6-pmu.h
+    // event numbers.
+    unsigned npairs;
+    const uint32_t *events;
+    const uint32_t *pmu_pcs;
+
+    uint32_t *words;            // everything points in here.
+} pi_gprof_t;
+
+// parse the <nwords> words after a frame's crc.  returns 0 if they
+// don't make sense.
+int pi_gprof_parse(pi_gprof_t *g, const uint32_t *w, unsigned nwords);
+void pi_gprof_free(pi_gprof_t *g);
+
+// flat profile and call graph, symbolized with <fns> (see pi_elf_funcs).
+void pi_gprof_report(FILE *out, const pi_gprof_t *g,
+                     const pi_elf_func_t *fns, unsigned nfns);
+// one line per call stack, outermost function first.
+void pi_gprof_folded(FILE *out, const pi_gprof_t *g,
+                     const pi_elf_func_t *fns, unsigned nfns);
+// PI_GPROF_PMU: per function CPI, misses per 1000 instructions and
+// % of cycles stalled.
+void pi_gprof_pmu_report(FILE *out, const pi_gprof_t *g,
+                         const pi_elf_func_t *fns, unsigned nfns);
+
+typedef struct {
+    FILE *out;
+
+    // parsing state.
+    unsigned magic_nbytes;  // how much of the magic we've matched.
+    int in_frame_p;
+    uint8_t *frame;         // header + words for the current frame.
+    unsigned frame_nbytes, frame_cap;
+
+    // the most recent good dump of each kind (the pi's counts only
+    // grow, so it has everything).
+    pi_gprof_t last, last_pmu;
+    unsigned nframes, nbad_frames;
+} pi_gprof_dec_t;
+
+pi_gprof_dec_t pi_gprof_dec_mk(FILE *out);
+
+// feed <n> bytes read from the pi: text is written to <d->out> (with
+// unprintable characters removed) and frames are parsed into <d->last> or
+// <d->last_pmu>.
+// returns 1 if the text contained the "DONE!!!" shutdown string.
+int pi_gprof_dec_feed(pi_gprof_dec_t *d, const uint8_t *buf, unsigned n);
+
+// same as <pi_cat> but collects gprof frames: when the pi is done,
+// prints the reports for the last ones using <elf_name>'s symbols and
+// writes the folded stacks to <folded_name>.
+void pi_gprof_cat(int pi_fd, const char *portname,
+                  const char *elf_name, const char *folded_name);
+
+#endif
@@ -13,32 +13,21 @@ void put_uint8(int fd, uint8_t b)   { write_exact(fd, &b, 1); }
 // this might only work b/c we are only running on little endien.
 void put_uint32(int fd, uint32_t u) { write_exact(fd, &u, 4); }
 
+// both go through the buffer in buf-read.c: one read() system call
+// per burst of bytes rather than one per byte.
 uint8_t get_uint8(int fd) {
     uint8_t b;
-    read_exact(fd, &b, 1);
+    buf_read_exact(fd, &b, 1);
     return b;
 }
 
-// we do 4 distinct get_uint8's b/c the bytes get dribbled back to 
-// use one at a time --- when we try to read 4 bytes at once it can
-// (occassionally!) fail.
+// the bytes get dribbled back to us so a single read() for 4 bytes
+// can (occassionally!) come up short: buf_read_exact keeps going
+// until it has all of them.
 //
-// NOTE: a more general approach: we could make a version of 
-// read_exact that will keep trying until a timeout.
-//
-// note: the other way to do is to assign these to a char array b and 
-//      return *(unsigned)b
-// however, the compiler doesn't have to align b to what unsigned 
-// requires, so this can go awry.  easier to just do the simple way.
-// 
-// note: we use seperate statements (ending with ";") to force get_byte8(fd) 
-// to get called in the right order.  the shorter, simpler:
-//    (get_byte(fd) | get_byte(fd) << 8 ...)
-// isn't guaranteed to be called in that order b/c '|' is not a seq point.
+// this might only work b/c we are only running on little endien.
 uint32_t get_uint32(int fd) {
-    uint32_t u = get_uint8(fd);
-    u |= get_uint8(fd) << 8;
-    u |= get_uint8(fd) << 16;
-    u |= get_uint8(fd) << 24;
+    uint32_t u;
+    buf_read_exact(fd, &u, 4);
     return u;
 }
@@ -8,5 +8,6 @@ int write_exact(int fd, const void *data, unsigned n) {
         sys_die(write, write_exact failed);
     if(got != n) 
         panic("expected a write of %d bytes, got %d\n", n, got);
+    io_stats.ntx += n;
     return n;
 }